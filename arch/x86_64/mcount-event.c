@@ -14,17 +14,177 @@
 #define PAGE_SIZE       4096
 #define PAGE_ADDR(a)    ((void *)((a) & ~(PAGE_SIZE - 1)))
 
+/* register names in SDT arguments */
+static const struct {
+	const char	*name[4];	/* 64, 32, 16 and 8-bit names */
+	int		reg;		/* index in ucontext gregs */
+} sdt_regs[] = {
+	{ { "rax", "eax",  "ax",   "al"   }, REG_RAX },
+	{ { "rbx", "ebx",  "bx",   "bl"   }, REG_RBX },
+	{ { "rcx", "ecx",  "cx",   "cl"   }, REG_RCX },
+	{ { "rdx", "edx",  "dx",   "dl"   }, REG_RDX },
+	{ { "rsi", "esi",  "si",   "sil"  }, REG_RSI },
+	{ { "rdi", "edi",  "di",   "dil"  }, REG_RDI },
+	{ { "rbp", "ebp",  "bp",   "bpl"  }, REG_RBP },
+	{ { "rsp", "esp",  "sp",   "spl"  }, REG_RSP },
+	{ { "r8",  "r8d",  "r8w",  "r8b"  }, REG_R8  },
+	{ { "r9",  "r9d",  "r9w",  "r9b"  }, REG_R9  },
+	{ { "r10", "r10d", "r10w", "r10b" }, REG_R10 },
+	{ { "r11", "r11d", "r11w", "r11b" }, REG_R11 },
+	{ { "r12", "r12d", "r12w", "r12b" }, REG_R12 },
+	{ { "r13", "r13d", "r13w", "r13b" }, REG_R13 },
+	{ { "r14", "r14d", "r14w", "r14b" }, REG_R14 },
+	{ { "r15", "r15d", "r15w", "r15b" }, REG_R15 },
+	{ { "rip", "eip",  NULL,   NULL   }, REG_RIP },
+};
+
+/* parse a register name after '%' and return the length */
+static int parse_sdt_reg(char *str, struct mcount_sdt_arg *arg, int *reg)
+{
+	static const char *high_regs[] = { "ah", "bh", "ch", "dh" };
+	static const int high_idx[] = { REG_RAX, REG_RBX, REG_RCX, REG_RDX };
+	size_t len = strspn(str, "abcdefghijklmnopqrstuvwxyz0123456789");
+	unsigned i, k;
+
+	for (i = 0; i < ARRAY_SIZE(high_regs); i++) {
+		if (len == 2 && !strncmp(str, high_regs[i], len)) {
+			*reg = high_idx[i];
+			arg->shift = 8;
+			return len;
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(sdt_regs); i++) {
+		for (k = 0; k < ARRAY_SIZE(sdt_regs[i].name); k++) {
+			const char *name = sdt_regs[i].name[k];
+
+			if (name && strlen(name) == len && !strncmp(str, name, len)) {
+				*reg = sdt_regs[i].reg;
+				return len;
+			}
+		}
+	}
+	return -1;
+}
+
+/*
+ * parse an operand in AT&T syntax: "%reg", "$imm" or
+ * "[offset](%base[,%index[,scale]])".
+ */
+int mcount_arch_parse_sdt_arg(struct mcount_sdt_arg *arg, char *desc)
+{
+	char *pos = desc;
+	int reg, len;
+
+	arg->index = -1;
+
+	if (*pos == '$') {
+		arg->type = SDT_ARG_IMM;
+		arg->val  = strtol(pos + 1, &pos, 0);
+		return *pos == '\0' ? 0 : -1;
+	}
+
+	if (*pos == '%') {
+		len = parse_sdt_reg(pos + 1, arg, &reg);
+		if (len < 0 || pos[len + 1] != '\0')
+			return -1;
+
+		arg->type = SDT_ARG_REG;
+		arg->reg  = reg;
+		return 0;
+	}
+
+	/* memory operand: symbol or segment is not supported */
+	arg->type = SDT_ARG_MEM;
+	arg->val  = strtol(pos, &pos, 0);
+	if (strncmp(pos, "(%", 2))
+		return -1;
+
+	len = parse_sdt_reg(pos + 2, arg, &reg);
+	if (len < 0 || arg->shift)
+		return -1;
+	arg->reg = reg;
+	pos += len + 2;
+
+	if (!strncmp(pos, ",%", 2)) {
+		len = parse_sdt_reg(pos + 2, arg, &reg);
+		if (len < 0 || arg->shift)
+			return -1;
+		arg->index = reg;
+		arg->scale = 1;
+		pos += len + 2;
+
+		if (*pos == ',')
+			arg->scale = strtol(pos + 1, &pos, 0);
+	}
+	return strcmp(pos, ")") ? -1 : 0;
+}
+
+static unsigned long sdt_reg_value(ucontext_t *ctx, int reg)
+{
+	unsigned long val = ctx->uc_mcontext.gregs[reg];
+
+	/* it's relative to the next insn (NOP) of the probe */
+	if (reg == REG_RIP)
+		val++;
+
+	return val;
+}
+
+static unsigned save_sdt_args(struct mcount_event_info *mei, ucontext_t *ctx,
+			      uint64_t *args)
+{
+	int i;
+
+	for (i = 0; i < mei->nr_args; i++) {
+		struct mcount_sdt_arg *arg = &mei->args[i];
+		int size = arg->size < 0 ? -arg->size : arg->size;
+		unsigned long val = 0;
+		unsigned long addr;
+
+		switch (arg->type) {
+		case SDT_ARG_IMM:
+			val = arg->val;
+			break;
+		case SDT_ARG_REG:
+			val = sdt_reg_value(ctx, arg->reg) >> arg->shift;
+			break;
+		case SDT_ARG_MEM:
+			addr = sdt_reg_value(ctx, arg->reg) + arg->val;
+			if (arg->index >= 0)
+				addr += sdt_reg_value(ctx, arg->index) * arg->scale;
+			memcpy(&val, (void *)addr, size);
+			break;
+		default:
+			break;
+		}
+
+		/* extend the value according to the size and sign */
+		if (size < 8) {
+			int bits = size * 8;
+
+			val &= (1UL << bits) - 1;
+			if (arg->size < 0 && (val & (1UL << (bits - 1))))
+				val |= ~0UL << bits;
+		}
+		args[i] = val;
+	}
+	return mei->nr_args * sizeof(*args);
+}
+
 static void sdt_handler(int sig, siginfo_t *info, void *arg)
 {
 	ucontext_t *ctx = arg;
 	unsigned long addr = ctx->uc_mcontext.gregs[REG_RIP];
 	struct mcount_event_info * mei;
+	uint64_t args[EVENT_MAX_ARGS];
+	unsigned size;
 
 	mei = mcount_lookup_event(addr);
 	assert(mei != NULL);
 
-	/* TODO: collect and write arguments */
-	mcount_save_event(mei);
+	size = save_sdt_args(mei, ctx, args);
+	mcount_save_event(mei, args, size);
 
 	/* skip the invalid insn and continue */
 	ctx->uc_mcontext.gregs[REG_RIP] = addr + 1;
@@ -54,7 +214,7 @@ int mcount_arch_enable_event(struct mcount_event_info *mei)
 	/* replace NOP to an invalid OP so that it can catch SIGILL */
 	memset((void *)mei->addr, INVALID_OPCODE, 1);
 
-	if (mprotect(PAGE_ADDR(mei->addr), PAGE_SIZE, PROT_EXEC))
+	if (mprotect(PAGE_ADDR(mei->addr), PAGE_SIZE, PROT_READ | PROT_EXEC))
 		pr_err("cannot setup event due to protection");
 
 	return 0;
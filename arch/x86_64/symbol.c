@@ -135,10 +135,8 @@ int arch_load_dynsymtab_bindnow(Elf *elf, struct symtab *dsymtab,
 			sym->size = PLTGOT_SIZE;
 			sym->type = ST_PLT;
 
-			if (flags & SYMTAB_FL_DEMANGLE)
-				sym->name = demangle(name);
-			else
-				sym->name = xstrdup(name);
+			sym->name = symtab_add_name(dsymtab, name);
+			sym->demangled = NULL;
 
 			pr_dbg3("[%zd] %c %lx + %-5u %s\n", dsymtab->nr_sym,
 				sym->type, sym->addr, sym->size, sym->name);
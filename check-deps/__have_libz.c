@@ -0,0 +1,8 @@
+#include <zlib.h>
+
+int main(void)
+{
+	uLongf len = compressBound(1);
+
+	return len == 0;
+}
@@ -4,6 +4,7 @@
 #include <inttypes.h>
 #include <limits.h>
 #include <time.h>
+#include <unistd.h>
 #include <assert.h>
 #include <sys/stat.h>
 
@@ -355,7 +356,8 @@ static void pr_args(struct fstack_arguments *args)
 						 (uint64_t)val);
 
 			if (sym)
-				pr_out("  args[%d] p: &%s\n", i, sym->name);
+				pr_out("  args[%d] p: &%s\n", i,
+				       symbol_getname(sym, sym->addr));
 			else
 				pr_out("  args[%d] p: %p\n", i, (void *)val);
 		}
@@ -427,7 +429,8 @@ static void pr_retval(struct fstack_arguments *args)
 						 (uint64_t)val);
 
 			if (sym)
-				pr_out("  retval p: &%s\n", sym->name);
+				pr_out("  retval p: &%s\n",
+				       symbol_getname(sym, sym->addr));
 			else
 				pr_out("  retval p: %p\n", (void *)val);
 		}
@@ -445,7 +448,8 @@ static void pr_retval(struct fstack_arguments *args)
 	}
 }
 
-static void pr_event(int eid, void *ptr, int len)
+static void pr_event(struct ftrace_file_handle *handle, int eid,
+		     void *ptr, int len)
 {
 	union {
 		struct uftrace_proc_statm *statm;
@@ -479,6 +483,13 @@ static void pr_event(int eid, void *ptr, int len)
 	}
 
 	/* user events */
+	if (eid >= EVENT_ID_USER) {
+		char *args = get_event_args(handle, eid, ptr, len);
+
+		if (args)
+			pr_out("  args: %s\n", args);
+		free(args);
+	}
 }
 
 static void get_feature_string(char *buf, size_t sz, uint64_t feature_mask)
@@ -489,7 +500,7 @@ static void get_feature_string(char *buf, size_t sz, uint64_t feature_mask)
 	const char *feat_str[] = { "PLTHOOK", "TASK_SESSION", "KERNEL",
 				   "ARGUMENT", "RETVAL", "SYM_REL_ADDR",
 				   "MAX_STACK", "EVENT", "PERF_EVENT",
-				   "AUTO_ARGS" };
+				   "AUTO_ARGS", "EVENT_ARGS" };
 
 	/* feat_str should match to enum uftrace_feat_bits */
 	for (i = 0; i < FEAT_BIT_MAX; i++) {
@@ -548,7 +559,7 @@ static void print_raw_task_start(struct uftrace_dump_ops *ops,
 	pr_out("reading %d.dat\n", task->tid);
 	raw->file_offset = 0;
 
-	setup_rstack_list(&task->rstack_list);
+	reset_rstack_list(&task->rstack_list);
 }
 
 static void print_raw_inverted_time(struct uftrace_dump_ops *ops,
@@ -618,7 +629,7 @@ static void print_raw_task_event(struct uftrace_dump_ops *ops,
 		pr_time(frs->time);
 		pr_out("%5d: [%s] length = %d\n", task->tid, "data ",
 		       task->args.len);
-		pr_event(frs->addr, task->args.data, task->args.len);
+		pr_event(task->h, frs->addr, task->args.data, task->args.len);
 		pr_hex(&raw->file_offset, task->args.data,
 		       ALIGN(task->args.len, 8));
 	}
@@ -830,6 +841,32 @@ static void print_chrome_inverted_time(struct uftrace_dump_ops *ops,
 {
 }
 
+/* it's called for every record so avoid printf */
+static void print_chrome_event_head(uint64_t time, char ph,
+				    struct ftrace_task_handle *task,
+				    bool is_process, char *name)
+{
+	pr_out_str("{\"ts\":");
+	pr_out_num(time / 1000, 0, ' ');
+	pr_out_str(".");
+	pr_out_num(time % 1000, 3, '0');
+	pr_out_str(",\"ph\":\"");
+	__pr_out_str(&ph, 1);
+	pr_out_str("\",\"pid\":");
+	if (is_process) {
+		/* no need to add "tid" field */
+		pr_out_num(task->tid, 0, ' ');
+	}
+	else {
+		pr_out_num(task->t->pid, 0, ' ');
+		pr_out_str(",\"tid\":");
+		pr_out_num(task->tid, 0, ' ');
+	}
+	pr_out_str(",\"name\":\"");
+	pr_out_str(name);
+	pr_out_str("\"");
+}
+
 static void print_chrome_task_rstack(struct uftrace_dump_ops *ops,
 				     struct ftrace_task_handle *task, char *name)
 {
@@ -857,14 +894,7 @@ static void print_chrome_task_rstack(struct uftrace_dump_ops *ops,
 	if ((frs->type == UFTRACE_ENTRY) ||
 	    (frs->type == UFTRACE_EVENT && frs->addr == EVENT_ID_PERF_SCHED_OUT)) {
 		ph = 'B';
-		if (is_process) {
-			/* no need to add "tid" field */
-			pr_out("{\"ts\":%"PRIu64".%03d,\"ph\":\"%c\",\"pid\":%d,\"name\":\"%s\"",
-			       frs->time / 1000, (int)(frs->time % 1000), ph, task->tid, name);
-		} else {
-			pr_out("{\"ts\":%"PRIu64".%03d,\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"name\":\"%s\"",
-			       frs->time / 1000, (int)(frs->time % 1000), ph, task->t->pid, task->tid, name);
-		}
+		print_chrome_event_head(frs->time, ph, task, is_process, name);
 		if (frs->more) {
 			str_mode |= HAS_MORE;
 			get_argspec_string(task, spec_buf, sizeof(spec_buf), str_mode);
@@ -877,14 +907,7 @@ static void print_chrome_task_rstack(struct uftrace_dump_ops *ops,
 	else if ((frs->type == UFTRACE_EXIT) ||
 		 (frs->type == UFTRACE_EVENT && frs->addr == EVENT_ID_PERF_SCHED_IN)) {
 		ph = 'E';
-		if (is_process) {
-			/* no need to add "tid" field */
-			pr_out("{\"ts\":%"PRIu64".%03d,\"ph\":\"%c\",\"pid\":%d,\"name\":\"%s\"",
-			       frs->time / 1000, (int)(frs->time % 1000), ph, task->tid, name);
-		} else {
-			pr_out("{\"ts\":%"PRIu64".%03d,\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"name\":\"%s\"",
-			       frs->time / 1000, (int)(frs->time % 1000), ph, task->t->pid, task->tid, name);
-		}
+		print_chrome_event_head(frs->time, ph, task, is_process, name);
 		if (frs->more) {
 			str_mode |= IS_RETVAL | HAS_MORE;
 			get_argspec_string(task, spec_buf, sizeof(spec_buf), str_mode);
@@ -1009,6 +1032,654 @@ static void print_chrome_footer(struct uftrace_dump_ops *ops,
 	}
 }
 
+/*
+ * perfetto support
+ *
+ * It writes the trace in the protobuf format used by perfetto without
+ * libprotobuf.  All packets are in a single sequence so that function
+ * names can be interned and timestamps can be delta-encoded using a
+ * sequence-scoped incremental clock.  Each thread has its own track.
+ */
+#define PERFETTO_BUF_SIZE		(1024 * 1024)
+#define PERFETTO_FLUSH_SIZE		(PERFETTO_BUF_SIZE - 64 * 1024)
+#define PERFETTO_NAME_HASH_SIZE		1024
+/* reset the interned names when it has too many */
+#define PERFETTO_MAX_NAMES		65536
+
+#define PERFETTO_SEQ_ID			1
+#define PERFETTO_CLOCK_MONOTONIC	3
+#define PERFETTO_CLOCK_INCREMENTAL	64
+
+enum pb_wire_type {
+	PB_WIRE_VARINT		= 0,
+	PB_WIRE_LEN		= 2,
+};
+
+/* field numbers in perfetto protos (only used ones) */
+enum perfetto_field {
+	PF_TRACE_PACKET			= 1,
+
+	PF_PACKET_CLOCK_SNAPSHOT	= 6,
+	PF_PACKET_TIMESTAMP		= 8,
+	PF_PACKET_SEQUENCE_ID		= 10,
+	PF_PACKET_TRACK_EVENT		= 11,
+	PF_PACKET_INTERNED_DATA		= 12,
+	PF_PACKET_SEQUENCE_FLAGS	= 13,
+	PF_PACKET_CLOCK_ID		= 58,
+	PF_PACKET_DEFAULTS		= 59,
+	PF_PACKET_TRACK_DESC		= 60,
+
+	PF_CLOCK_SNAPSHOT_CLOCKS	= 1,
+	PF_CLOCK_SNAPSHOT_PRIMARY	= 2,
+	PF_CLOCK_ID			= 1,
+	PF_CLOCK_TIMESTAMP		= 2,
+	PF_CLOCK_INCREMENTAL		= 3,
+
+	PF_DEFAULTS_TRACK_EVENT		= 11,
+	PF_DEFAULTS_CLOCK_ID		= 58,
+	PF_EVENT_DEFAULTS_TRACK_UUID	= 11,
+
+	PF_EVENT_DEBUG_ANNOTATION	= 4,
+	PF_EVENT_TYPE			= 9,
+	PF_EVENT_NAME_IID		= 10,
+	PF_EVENT_TRACK_UUID		= 11,
+
+	PF_ANNOTATION_STRING		= 6,
+	PF_ANNOTATION_NAME		= 10,
+
+	PF_INTERNED_EVENT_NAME		= 2,
+	PF_NAME_IID			= 1,
+	PF_NAME_NAME			= 2,
+
+	PF_TRACK_UUID			= 1,
+	PF_TRACK_PROCESS		= 3,
+	PF_TRACK_THREAD			= 4,
+	PF_TRACK_PARENT_UUID		= 5,
+
+	PF_PROCESS_PID			= 1,
+	PF_PROCESS_CMDLINE		= 2,
+	PF_PROCESS_NAME			= 6,
+
+	PF_THREAD_PID			= 1,
+	PF_THREAD_TID			= 2,
+	PF_THREAD_NAME			= 5,
+};
+
+enum perfetto_event_type {
+	PERFETTO_SLICE_BEGIN		= 1,
+	PERFETTO_SLICE_END		= 2,
+};
+
+enum perfetto_sequence_flags {
+	PERFETTO_STATE_CLEARED		= 1,
+	PERFETTO_NEEDS_STATE		= 2,
+};
+
+/* a simple protobuf encoder */
+struct pb_buf {
+	unsigned char	*data;
+	size_t		len;
+	size_t		size;
+	/* start offsets of nested messages */
+	size_t		nested[4];
+	int		depth;
+};
+
+static void pb_reserve(struct pb_buf *pb, size_t size)
+{
+	if (pb->len + size <= pb->size)
+		return;
+
+	while (pb->len + size > pb->size)
+		pb->size *= 2;
+	pb->data = xrealloc(pb->data, pb->size);
+}
+
+static int pb_encode_varint(unsigned char *buf, uint64_t val)
+{
+	int n = 0;
+
+	while (val >= 0x80) {
+		buf[n++] = val | 0x80;
+		val >>= 7;
+	}
+	buf[n++] = val;
+	return n;
+}
+
+static void pb_varint(struct pb_buf *pb, uint64_t val)
+{
+	pb_reserve(pb, 10);
+	pb->len += pb_encode_varint(pb->data + pb->len, val);
+}
+
+static void pb_tag(struct pb_buf *pb, int field, enum pb_wire_type type)
+{
+	pb_varint(pb, (field << 3) | type);
+}
+
+static void pb_uint(struct pb_buf *pb, int field, uint64_t val)
+{
+	pb_tag(pb, field, PB_WIRE_VARINT);
+	pb_varint(pb, val);
+}
+
+static void pb_string(struct pb_buf *pb, int field, const char *str)
+{
+	size_t len = strlen(str);
+
+	pb_tag(pb, field, PB_WIRE_LEN);
+	pb_varint(pb, len);
+	pb_reserve(pb, len);
+	memcpy(pb->data + pb->len, str, len);
+	pb->len += len;
+}
+
+static void pb_begin(struct pb_buf *pb, int field)
+{
+	assert(pb->depth < (int)ARRAY_SIZE(pb->nested));
+
+	pb_tag(pb, field, PB_WIRE_LEN);
+	pb->nested[pb->depth++] = pb->len;
+}
+
+/* prepend the length of the nested message */
+static void pb_end(struct pb_buf *pb)
+{
+	size_t start = pb->nested[--pb->depth];
+	size_t len = pb->len - start;
+	unsigned char hdr[10];
+	int n;
+
+	n = pb_encode_varint(hdr, len);
+	pb_reserve(pb, n);
+
+	memmove(pb->data + start + n, pb->data + start, len);
+	memcpy(pb->data + start, hdr, n);
+	pb->len += n;
+}
+
+struct perfetto_name {
+	char		*name;
+	uint64_t	iid;
+};
+
+struct perfetto_track {
+	struct rb_node	node;
+	int		id;
+	uint64_t	uuid;
+};
+
+struct uftrace_perfetto_dump {
+	struct uftrace_dump_ops ops;
+	struct pb_buf buf;
+	/* timestamp of the incremental clock */
+	uint64_t last_time;
+	/* interned function names */
+	struct perfetto_name *names;
+	unsigned nr_names;
+	unsigned names_size;
+	struct arena arena;
+	/* pid and tid which have track descriptors */
+	struct rb_root processes;
+	struct rb_root threads;
+	/* small uuids make the events smaller */
+	uint64_t next_uuid;
+	/* default track (of the main thread) */
+	uint64_t main_uuid;
+	unsigned lost_event_cnt;
+	uint64_t total_size;
+};
+
+static void perfetto_flush(struct uftrace_perfetto_dump *perfetto)
+{
+	struct pb_buf *pb = &perfetto->buf;
+
+	if (pb->len && fwrite(pb->data, pb->len, 1, outfp) != 1)
+		pr_err("writing perfetto trace failed");
+
+	perfetto->total_size += pb->len;
+	pb->len = 0;
+}
+
+static void perfetto_begin_packet(struct uftrace_perfetto_dump *perfetto)
+{
+	/* flush the buffer only between packets */
+	if (perfetto->buf.len >= PERFETTO_FLUSH_SIZE)
+		perfetto_flush(perfetto);
+
+	pb_begin(&perfetto->buf, PF_TRACE_PACKET);
+	pb_uint(&perfetto->buf, PF_PACKET_SEQUENCE_ID, PERFETTO_SEQ_ID);
+}
+
+static void perfetto_end_packet(struct uftrace_perfetto_dump *perfetto)
+{
+	pb_end(&perfetto->buf);
+}
+
+static void perfetto_clear_names(struct uftrace_perfetto_dump *perfetto)
+{
+	memset(perfetto->names, 0,
+	       perfetto->names_size * sizeof(*perfetto->names));
+	perfetto->nr_names = 0;
+
+	arena_free(&perfetto->arena);
+}
+
+/*
+ * This (re)starts the incremental state of the sequence - interned
+ * names and the timestamp of the incremental clock.
+ */
+static void perfetto_reset_state(struct uftrace_perfetto_dump *perfetto)
+{
+	struct pb_buf *pb = &perfetto->buf;
+
+	perfetto_clear_names(perfetto);
+
+	perfetto_begin_packet(perfetto);
+	pb_uint(pb, PF_PACKET_SEQUENCE_FLAGS, PERFETTO_STATE_CLEARED);
+
+	pb_begin(pb, PF_PACKET_CLOCK_SNAPSHOT);
+	pb_begin(pb, PF_CLOCK_SNAPSHOT_CLOCKS);
+	pb_uint(pb, PF_CLOCK_ID, PERFETTO_CLOCK_MONOTONIC);
+	pb_uint(pb, PF_CLOCK_TIMESTAMP, perfetto->last_time);
+	pb_end(pb);
+	pb_begin(pb, PF_CLOCK_SNAPSHOT_CLOCKS);
+	pb_uint(pb, PF_CLOCK_ID, PERFETTO_CLOCK_INCREMENTAL);
+	pb_uint(pb, PF_CLOCK_TIMESTAMP, perfetto->last_time);
+	pb_uint(pb, PF_CLOCK_INCREMENTAL, 1);
+	pb_end(pb);
+	pb_uint(pb, PF_CLOCK_SNAPSHOT_PRIMARY, PERFETTO_CLOCK_MONOTONIC);
+	pb_end(pb);
+
+	pb_begin(pb, PF_PACKET_DEFAULTS);
+	pb_uint(pb, PF_DEFAULTS_CLOCK_ID, PERFETTO_CLOCK_INCREMENTAL);
+	pb_begin(pb, PF_DEFAULTS_TRACK_EVENT);
+	pb_uint(pb, PF_EVENT_DEFAULTS_TRACK_UUID, perfetto->main_uuid);
+	pb_end(pb);
+	pb_end(pb);
+
+	perfetto_end_packet(perfetto);
+}
+
+/* FNV-1a hash of the string */
+static unsigned long perfetto_hash_name(const char *name)
+{
+	unsigned long hash = 2166136261UL;
+
+	while (*name) {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619UL;
+	}
+	return hash;
+}
+
+/* returns iid of the @name, @added is set if it's a new name */
+static uint64_t perfetto_intern_name(struct uftrace_perfetto_dump *perfetto,
+				     char *name, bool *added)
+{
+	struct perfetto_name *pn;
+	unsigned mask;
+	unsigned slot;
+
+	*added = false;
+
+	if (perfetto->nr_names >= PERFETTO_MAX_NAMES)
+		perfetto_reset_state(perfetto);
+
+	mask = perfetto->names_size - 1;
+	slot = perfetto_hash_name(name) & mask;
+	while ((pn = &perfetto->names[slot])->name != NULL) {
+		if (!strcmp(pn->name, name))
+			return pn->iid;
+		slot = (slot + 1) & mask;
+	}
+
+	pn->name = arena_strdup(&perfetto->arena, name);
+	pn->iid = ++perfetto->nr_names;
+	*added = true;
+
+	/* keep load factor under 50% */
+	if (perfetto->nr_names * 2 > perfetto->names_size) {
+		struct perfetto_name *old_names = perfetto->names;
+		unsigned old_size = perfetto->names_size;
+		unsigned i;
+
+		perfetto->names_size *= 2;
+		perfetto->names = xcalloc(perfetto->names_size,
+					  sizeof(*perfetto->names));
+		mask = perfetto->names_size - 1;
+
+		for (i = 0; i < old_size; i++) {
+			if (old_names[i].name == NULL)
+				continue;
+
+			slot = perfetto_hash_name(old_names[i].name) & mask;
+			while (perfetto->names[slot].name)
+				slot = (slot + 1) & mask;
+			perfetto->names[slot] = old_names[i];
+		}
+		free(old_names);
+	}
+
+	return perfetto->nr_names;
+}
+
+/* returns the track for the @id, @added is set if it's a new track */
+static struct perfetto_track *
+perfetto_get_track(struct uftrace_perfetto_dump *perfetto,
+		   struct rb_root *root, int id, bool *added)
+{
+	struct rb_node *parent = NULL;
+	struct rb_node **p = &root->rb_node;
+	struct perfetto_track *track;
+
+	*added = false;
+
+	while (*p) {
+		parent = *p;
+		track = rb_entry(parent, struct perfetto_track, node);
+
+		if (track->id == id)
+			return track;
+
+		if (track->id > id)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	track = xmalloc(sizeof(*track));
+	track->id = id;
+	track->uuid = ++perfetto->next_uuid;
+	*added = true;
+
+	rb_link_node(&track->node, parent, p);
+	rb_insert_color(&track->node, root);
+	return track;
+}
+
+static void perfetto_free_tracks(struct rb_root *root)
+{
+	struct rb_node *node;
+	struct perfetto_track *track;
+
+	while (!RB_EMPTY_ROOT(root)) {
+		node = rb_first(root);
+		track = rb_entry(node, struct perfetto_track, node);
+
+		rb_erase(node, root);
+		free(track);
+	}
+}
+
+static void perfetto_process_track(struct uftrace_perfetto_dump *perfetto,
+				   int pid, char *name, char *cmdline)
+{
+	struct pb_buf *pb = &perfetto->buf;
+	struct perfetto_track *track;
+	bool added;
+
+	track = perfetto_get_track(perfetto, &perfetto->processes, pid, &added);
+
+	perfetto_begin_packet(perfetto);
+	pb_begin(pb, PF_PACKET_TRACK_DESC);
+	pb_uint(pb, PF_TRACK_UUID, track->uuid);
+	pb_begin(pb, PF_TRACK_PROCESS);
+	pb_uint(pb, PF_PROCESS_PID, pid);
+	if (cmdline)
+		pb_string(pb, PF_PROCESS_CMDLINE, cmdline);
+	pb_string(pb, PF_PROCESS_NAME, name);
+	pb_end(pb);
+	pb_end(pb);
+	perfetto_end_packet(perfetto);
+}
+
+/* returns uuid of the thread track (process track is added if needed) */
+static uint64_t perfetto_thread_track(struct uftrace_perfetto_dump *perfetto,
+				      int pid, int tid, char *name)
+{
+	struct pb_buf *pb = &perfetto->buf;
+	struct perfetto_track *process;
+	struct perfetto_track *thread;
+	bool added;
+
+	process = perfetto_get_track(perfetto, &perfetto->processes, pid, &added);
+	if (added)
+		perfetto_process_track(perfetto, pid, name, NULL);
+
+	thread = perfetto_get_track(perfetto, &perfetto->threads, tid, &added);
+
+	perfetto_begin_packet(perfetto);
+	pb_begin(pb, PF_PACKET_TRACK_DESC);
+	pb_uint(pb, PF_TRACK_UUID, thread->uuid);
+	pb_uint(pb, PF_TRACK_PARENT_UUID, process->uuid);
+	pb_begin(pb, PF_TRACK_THREAD);
+	pb_uint(pb, PF_THREAD_PID, pid);
+	pb_uint(pb, PF_THREAD_TID, tid);
+	pb_string(pb, PF_THREAD_NAME, name);
+	pb_end(pb);
+	pb_end(pb);
+	perfetto_end_packet(perfetto);
+
+	return thread->uuid;
+}
+
+static void print_perfetto_header(struct uftrace_dump_ops *ops,
+				  struct ftrace_file_handle *handle,
+				  struct opts *opts)
+{
+	struct uftrace_perfetto_dump *perfetto = container_of(ops, typeof(*perfetto), ops);
+	struct uftrace_info *info = &handle->info;
+	char *cmdline = NULL;
+
+	perfetto->buf.size = PERFETTO_BUF_SIZE;
+	perfetto->buf.data = xmalloc(perfetto->buf.size);
+
+	perfetto->names_size = PERFETTO_NAME_HASH_SIZE;
+	perfetto->names = xcalloc(perfetto->names_size,
+				  sizeof(*perfetto->names));
+
+	if (handle->hdr.info_mask & (1UL << CMDLINE))
+		cmdline = info->cmdline;
+
+	perfetto_process_track(perfetto, info->tids[0],
+			       basename(info->exename), cmdline);
+	perfetto->main_uuid = perfetto_thread_track(perfetto, info->tids[0],
+						    info->tids[0],
+						    basename(info->exename));
+
+	perfetto_reset_state(perfetto);
+}
+
+static void print_perfetto_task_start(struct uftrace_dump_ops *ops,
+				      struct ftrace_task_handle *task)
+{
+}
+
+static void print_perfetto_inverted_time(struct uftrace_dump_ops *ops,
+					 struct ftrace_task_handle *task)
+{
+}
+
+static void print_perfetto_task_rstack(struct uftrace_dump_ops *ops,
+				       struct ftrace_task_handle *task, char *name)
+{
+	struct uftrace_perfetto_dump *perfetto = container_of(ops, typeof(*perfetto), ops);
+	struct uftrace_record *frs = task->rstack;
+	struct pb_buf *pb = &perfetto->buf;
+	enum argspec_string_bits str_mode = NEEDS_PAREN;
+	enum perfetto_event_type type;
+	struct perfetto_track *track;
+	char spec_buf[1024];
+	uint64_t iid = 0;
+	bool added = false;
+
+	if (frs->type == UFTRACE_EVENT) {
+		if (frs->addr != EVENT_ID_PERF_SCHED_IN &&
+		    frs->addr != EVENT_ID_PERF_SCHED_OUT)
+			return;
+
+		/* new thread starts with sched-in event which should be ignored */
+		if (frs->addr == EVENT_ID_PERF_SCHED_IN && task->timestamp_last == 0)
+			return;
+	}
+
+	if ((frs->type == UFTRACE_ENTRY) ||
+	    (frs->type == UFTRACE_EVENT && frs->addr == EVENT_ID_PERF_SCHED_OUT))
+		type = PERFETTO_SLICE_BEGIN;
+	else if ((frs->type == UFTRACE_EXIT) ||
+		 (frs->type == UFTRACE_EVENT && frs->addr == EVENT_ID_PERF_SCHED_IN))
+		type = PERFETTO_SLICE_END;
+	else {
+		if (frs->type == UFTRACE_LOST)
+			perfetto->lost_event_cnt++;
+		return;
+	}
+
+	track = perfetto_get_track(perfetto, &perfetto->threads, task->tid, &added);
+	if (added) {
+		perfetto_thread_track(perfetto, task->t->pid, task->tid,
+				      task->t->comm);
+	}
+
+	/* the end of slice doesn't need a name */
+	added = false;
+	if (type == PERFETTO_SLICE_BEGIN)
+		iid = perfetto_intern_name(perfetto, name, &added);
+
+	perfetto_begin_packet(perfetto);
+
+	if (frs->time >= perfetto->last_time) {
+		pb_uint(pb, PF_PACKET_TIMESTAMP, frs->time - perfetto->last_time);
+		perfetto->last_time = frs->time;
+	}
+	else {
+		/* use absolute time as it cannot go backward */
+		pb_uint(pb, PF_PACKET_TIMESTAMP, frs->time);
+		pb_uint(pb, PF_PACKET_CLOCK_ID, PERFETTO_CLOCK_MONOTONIC);
+	}
+
+	if (added) {
+		pb_begin(pb, PF_PACKET_INTERNED_DATA);
+		pb_begin(pb, PF_INTERNED_EVENT_NAME);
+		pb_uint(pb, PF_NAME_IID, iid);
+		pb_string(pb, PF_NAME_NAME, name);
+		pb_end(pb);
+		pb_end(pb);
+	}
+	pb_uint(pb, PF_PACKET_SEQUENCE_FLAGS, PERFETTO_NEEDS_STATE);
+
+	pb_begin(pb, PF_PACKET_TRACK_EVENT);
+	pb_uint(pb, PF_EVENT_TYPE, type);
+	if (track->uuid != perfetto->main_uuid)
+		pb_uint(pb, PF_EVENT_TRACK_UUID, track->uuid);
+	if (iid)
+		pb_uint(pb, PF_EVENT_NAME_IID, iid);
+
+	if (frs->more) {
+		str_mode |= HAS_MORE;
+		if (type == PERFETTO_SLICE_END)
+			str_mode |= IS_RETVAL;
+		get_argspec_string(task, spec_buf, sizeof(spec_buf), str_mode);
+
+		pb_begin(pb, PF_EVENT_DEBUG_ANNOTATION);
+		pb_string(pb, PF_ANNOTATION_NAME,
+			  type == PERFETTO_SLICE_BEGIN ? "arguments" : "retval");
+		pb_string(pb, PF_ANNOTATION_STRING, spec_buf);
+		pb_end(pb);
+	}
+	pb_end(pb);
+
+	perfetto_end_packet(perfetto);
+}
+
+static void print_perfetto_task_event(struct uftrace_dump_ops *ops,
+				      struct ftrace_task_handle *task)
+{
+}
+
+static void print_perfetto_kernel_start(struct uftrace_dump_ops *ops,
+					struct uftrace_kernel_reader *kernel)
+{
+}
+
+static void print_perfetto_cpu_start(struct uftrace_dump_ops *ops,
+				     struct uftrace_kernel_reader *kernel, int cpu)
+{
+}
+
+static void print_perfetto_kernel_rstack(struct uftrace_dump_ops *ops,
+					 struct uftrace_kernel_reader *kernel, int cpu,
+					 struct uftrace_record *frs, char *name)
+{
+}
+
+static void print_perfetto_kernel_event(struct uftrace_dump_ops *ops,
+					struct uftrace_kernel_reader *kernel, int cpu,
+					struct uftrace_record *frs)
+{
+}
+
+static void print_perfetto_kernel_lost(struct uftrace_dump_ops *ops,
+				       uint64_t time, int tid, int losts)
+{
+}
+
+static void print_perfetto_perf_start(struct uftrace_dump_ops *ops,
+				      struct uftrace_perf_reader *perf, int cpu)
+{
+}
+
+static void print_perfetto_perf_event(struct uftrace_dump_ops *ops,
+				      struct uftrace_perf_reader *perf,
+				      struct uftrace_record *frs)
+{
+	struct uftrace_perfetto_dump *perfetto = container_of(ops, typeof(*perfetto), ops);
+	int pid = perf->u.comm.pid;
+	char buf[32];
+
+	if (frs->addr != EVENT_ID_PERF_COMM)
+		return;
+
+	/* update names of the tracks */
+	if (pid == perf->tid) {
+		perfetto_process_track(perfetto, pid, perf->u.comm.comm, NULL);
+		perfetto_thread_track(perfetto, pid, perf->tid, perf->u.comm.comm);
+	}
+	else {
+		snprintf(buf, sizeof(buf), "%s (%d)", perf->u.comm.comm, perf->tid);
+		perfetto_thread_track(perfetto, pid, perf->tid, buf);
+	}
+}
+
+static void print_perfetto_footer(struct uftrace_dump_ops *ops,
+				  struct ftrace_file_handle *handle,
+				  struct opts *opts)
+{
+	struct uftrace_perfetto_dump *perfetto = container_of(ops, typeof(*perfetto), ops);
+
+	perfetto_flush(perfetto);
+	fflush(outfp);
+
+	pr_dbg("perfetto trace: %"PRIu64" bytes, %u names\n",
+	       perfetto->total_size, perfetto->nr_names);
+
+	/* see the comment in print_chrome_footer() */
+	if (perfetto->lost_event_cnt) {
+		pr_warn("Some of function trace records are lost. "
+			"(%d times shown)\n", perfetto->lost_event_cnt);
+		pr_warn("The output may not show the correct view "
+			"in perfetto UI.\n");
+	}
+
+	perfetto_free_tracks(&perfetto->processes);
+	perfetto_free_tracks(&perfetto->threads);
+	arena_free(&perfetto->arena);
+	free(perfetto->names);
+	free(perfetto->buf.data);
+}
+
 /* flamegraph support */
 static struct uftrace_graph flame_graph = {
 	.root.head     = LIST_HEAD_INIT(flame_graph.root.head),
@@ -1479,6 +2150,7 @@ int command_dump(int argc, char *argv[], struct opts *opts)
 	}
 
 	fstack_setup_filters(opts, &handle);
+	setup_output_buffer(outfp);
 
 	if (opts->chrome_trace) {
 		struct uftrace_chrome_dump dump = {
@@ -1501,6 +2173,36 @@ int command_dump(int argc, char *argv[], struct opts *opts)
 
 		do_dump_replay(&dump.ops, opts, &handle);
 	}
+	else if (opts->perfetto_trace) {
+		struct uftrace_perfetto_dump dump = {
+			.ops = {
+				.header         = print_perfetto_header,
+				.task_start     = print_perfetto_task_start,
+				.inverted_time  = print_perfetto_inverted_time,
+				.task_rstack    = print_perfetto_task_rstack,
+				.task_event     = print_perfetto_task_event,
+				.kernel_start   = print_perfetto_kernel_start,
+				.cpu_start      = print_perfetto_cpu_start,
+				.kernel_func    = print_perfetto_kernel_rstack,
+				.kernel_event   = print_perfetto_kernel_event,
+				.lost           = print_perfetto_kernel_lost,
+				.perf_start     = print_perfetto_perf_start,
+				.perf_event     = print_perfetto_perf_event,
+				.footer         = print_perfetto_footer,
+			},
+			.processes = RB_ROOT,
+			.threads = RB_ROOT,
+			.arena = ARENA_INIT,
+		};
+
+		if (isatty(fileno(outfp))) {
+			pr_warn("perfetto trace is binary, please redirect the output\n");
+			ret = -1;
+			goto out;
+		}
+
+		do_dump_replay(&dump.ops, opts, &handle);
+	}
 	else if (opts->flame_graph) {
 		struct uftrace_flame_dump dump = {
 			.ops = {
@@ -1546,6 +2248,8 @@ int command_dump(int argc, char *argv[], struct opts *opts)
 		do_dump_file(&dump.ops, opts, &handle);
 	}
 
+out:
+	finish_output_buffer();
 	close_data_file(opts, &handle);
 
 	return ret;
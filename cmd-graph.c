@@ -166,9 +166,7 @@ static struct uftrace_graph * get_graph(struct ftrace_task_handle *task,
 	struct uftrace_session_link *sessions = &task->h->sessions;
 	struct uftrace_session *sess;
 
-	sess = find_task_session(sessions, task->tid, time);
-	if (sess == NULL)
-		sess = find_task_session(sessions, task->t->pid, time);
+	sess = task_find_session(sessions, task, time);
 
 	if (sess == NULL) {
 		struct uftrace_session *fsess = sessions->first;
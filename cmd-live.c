@@ -3,6 +3,8 @@
 #include <dirent.h>
 #include <signal.h>
 #include <errno.h>
+#include <pthread.h>
+#include <time.h>
 
 #include "uftrace.h"
 #include "utils/utils.h"
@@ -74,6 +76,493 @@ static bool can_skip_replay(struct opts *opts, int record_result)
 	return false;
 }
 
+static bool can_stream_live(struct opts *opts)
+{
+	if (opts->nop || opts->host)
+		return false;
+
+	if (opts->kernel || has_kernel_event(opts->event)) {
+		pr_warn("--stream is not supported with kernel tracing\n");
+		return false;
+	}
+
+	if (opts->report) {
+		pr_warn("--stream is not supported with --report\n");
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * streaming live mode: the recorder passes trace data and messages to
+ * the replay thread directly instead of writing them to data files.
+ */
+
+/* max size of trace data waiting in the stream (recorder blocks) */
+#define LIVE_QUEUE_BUDGET  (64 * 1024 * 1024)
+
+/* wait for other tasks to send older data up to this time (in msec) */
+#define LIVE_REORDER_MSEC  100
+
+struct live_msg {
+	struct list_head	list;
+	int			type;
+	int			tid;
+	size_t			len;
+	/* read position of trace data */
+	size_t			pos;
+	char			data[];
+};
+
+/* a task in the stream, it's also the cookie of the data stream */
+struct live_task {
+	struct list_head	list;
+	/* trace data (live_msg) not read yet */
+	struct list_head	bufs;
+	int			tid;
+	/* it has read all the data received so far */
+	bool			starved;
+	bool			exited;
+	uint64_t		last_recv;
+};
+
+struct live_stream {
+	pthread_t		thread;
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	pthread_cond_t		space;
+	struct list_head	msgs;
+	size_t			queued;
+	bool			finished;
+	bool			stopped;
+	int			ret;
+
+	/* below are accessed by the replay thread only */
+	struct opts		opts;
+	struct list_head	tasks;
+	bool			last_round;
+	bool			stale;
+	uint64_t		watermark;
+};
+
+static struct live_stream live_stream = {
+	.lock	= PTHREAD_MUTEX_INITIALIZER,
+	.cond	= PTHREAD_COND_INITIALIZER,
+	.space	= PTHREAD_COND_INITIALIZER,
+	.msgs	= LIST_HEAD_INIT(live_stream.msgs),
+	.tasks	= LIST_HEAD_INIT(live_stream.tasks),
+};
+
+static uint64_t live_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void queue_live_msg(struct live_stream *ls, struct live_msg *m)
+{
+	pthread_mutex_lock(&ls->lock);
+
+	/* trace data should not grow without bound if replay is slow */
+	while (m->tid >= 0 && ls->queued &&
+	       ls->queued + m->len > LIVE_QUEUE_BUDGET && !ls->stopped)
+		pthread_cond_wait(&ls->space, &ls->lock);
+
+	if (ls->stopped) {
+		pthread_mutex_unlock(&ls->lock);
+		free(m);
+		return;
+	}
+
+	if (m->tid >= 0)
+		ls->queued += m->len;
+
+	list_add_tail(&m->list, &ls->msgs);
+	pthread_cond_signal(&ls->cond);
+	pthread_mutex_unlock(&ls->lock);
+}
+
+/**
+ * live_stream_message - pass a record message to the replay thread
+ * @type: message type (UFTRACE_MSG_*)
+ * @msg: message data
+ * @len: length of @msg
+ * @name: (optional) exe or library name of the message
+ */
+void live_stream_message(int type, void *msg, size_t len, char *name)
+{
+	struct live_msg *m;
+	size_t namelen = name ? strlen(name) + 1 : 0;
+
+	m = xmalloc(sizeof(*m) + len + namelen);
+	m->type = type;
+	m->tid  = -1;
+	m->len  = len;
+	m->pos  = 0;
+	memcpy(m->data, msg, len);
+	if (name)
+		memcpy(m->data + len, name, namelen);
+
+	queue_live_msg(&live_stream, m);
+}
+
+/**
+ * live_stream_data - pass trace data of a task to the replay thread
+ * @tid: task id
+ * @data: trace data (it should have complete records only)
+ * @len: length of @data
+ *
+ * This function copies the @data so the caller can reuse the buffer.
+ * It blocks if too much data is waiting for the replay.
+ */
+void live_stream_data(int tid, void *data, size_t len)
+{
+	struct live_msg *m;
+
+	m = xmalloc(sizeof(*m) + len);
+	m->type = UFTRACE_MSG_REC_END;
+	m->tid  = tid;
+	m->len  = len;
+	m->pos  = 0;
+	memcpy(m->data, data, len);
+
+	queue_live_msg(&live_stream, m);
+}
+
+static ssize_t read_live_task(void *cookie, char *buf, size_t size)
+{
+	struct live_task *lt = cookie;
+	struct live_stream *ls = &live_stream;
+	struct live_msg *m;
+	size_t done = 0;
+
+	while (done < size && !list_empty(&lt->bufs)) {
+		size_t len = size - done;
+
+		m = list_first_entry(&lt->bufs, struct live_msg, list);
+		if (len > m->len - m->pos)
+			len = m->len - m->pos;
+
+		memcpy(buf + done, m->data + m->pos, len);
+		m->pos += len;
+		done += len;
+
+		if (m->pos < m->len)
+			continue;
+
+		list_del(&m->list);
+
+		pthread_mutex_lock(&ls->lock);
+		ls->queued -= m->len;
+		pthread_cond_signal(&ls->space);
+		pthread_mutex_unlock(&ls->lock);
+
+		free(m);
+	}
+
+	if (done == 0) {
+		/* others should wait for this task now */
+		lt->starved = true;
+		ls->stale = true;
+	}
+	return done;
+}
+
+static cookie_io_functions_t live_task_io = {
+	.read	= read_live_task,
+};
+
+static struct live_task *get_live_task(struct live_stream *ls, int tid)
+{
+	struct live_task *lt;
+
+	list_for_each_entry(lt, &ls->tasks, list) {
+		if (lt->tid == tid)
+			return lt;
+	}
+
+	lt = xzalloc(sizeof(*lt));
+	lt->tid = tid;
+	lt->starved = true;
+	lt->last_recv = live_clock();
+	INIT_LIST_HEAD(&lt->bufs);
+
+	list_add_tail(&lt->list, &ls->tasks);
+	return lt;
+}
+
+static void add_live_data(struct live_stream *ls,
+			  struct ftrace_file_handle *handle,
+			  struct live_msg *m)
+{
+	struct live_task *lt = get_live_task(ls, m->tid);
+	struct ftrace_task_handle *task;
+
+	list_add_tail(&m->list, &lt->bufs);
+	lt->last_recv = live_clock();
+
+	task = get_task_handle(handle, lt->tid);
+	if (task == NULL) {
+		FILE *fp = fopencookie(lt, "r", live_task_io);
+
+		if (fp == NULL)
+			pr_err("cannot open data stream of task %d", lt->tid);
+
+		fstack_add_task(handle, lt->tid, fp);
+	}
+	else if (lt->starved)
+		fstack_resume_task(handle, task);
+
+	lt->starved = false;
+}
+
+static void apply_live_msg(struct live_stream *ls,
+			   struct ftrace_file_handle *handle,
+			   struct live_msg *m)
+{
+	struct uftrace_session_link *sessions = &handle->sessions;
+	struct uftrace_msg_task *tmsg = (void *)m->data;
+	struct uftrace_msg_sess *smsg = (void *)m->data;
+	struct uftrace_msg_dlopen *dmsg = (void *)m->data;
+	struct uftrace_session *s;
+	bool sym_rel = handle->hdr.feat_mask & SYM_REL_ADDR;
+
+	switch (m->type) {
+	case UFTRACE_MSG_REC_END:
+		/* the message will be freed after read */
+		add_live_data(ls, handle, m);
+		return;
+
+	case UFTRACE_MSG_SESSION:
+		create_session(sessions, smsg, (char *)handle->dirname,
+			       m->data + m->len, sym_rel);
+
+		s = get_session_from_sid(sessions, smsg->sid);
+		if (s)
+			fstack_setup_session(&ls->opts, handle, s);
+
+		/* events.txt is written before the first session */
+		if (s == sessions->first && (handle->hdr.feat_mask & EVENT))
+			read_events_file(handle);
+		break;
+
+	case UFTRACE_MSG_TASK_START:
+		create_task(sessions, tmsg, false, true);
+		get_live_task(ls, tmsg->tid)->exited = false;
+		break;
+
+	case UFTRACE_MSG_FORK_END:
+		create_task(sessions, tmsg, true, true);
+		get_live_task(ls, tmsg->tid);
+		break;
+
+	case UFTRACE_MSG_TASK_END:
+		/* its last data was sent before this message */
+		get_live_task(ls, tmsg->tid)->exited = true;
+		break;
+
+	case UFTRACE_MSG_DLOPEN:
+		s = get_session_from_sid(sessions, dmsg->sid);
+		if (s) {
+			session_add_dlopen(s, dmsg->task.time, dmsg->base_addr,
+					   m->data + m->len);
+		}
+		break;
+
+	default:
+		break;
+	}
+	free(m);
+}
+
+/**
+ * live_stream_update - wait for new messages and add them to the handle
+ * @handle: handle for the streaming data
+ *
+ * This function waits for new messages from the recorder for a while
+ * and updates the sessions and tasks in the @handle.  It returns
+ * %false when the recorder is finished and all data was processed.
+ */
+bool live_stream_update(struct ftrace_file_handle *handle)
+{
+	struct live_stream *ls = &live_stream;
+	struct live_msg *m, *tmp;
+	LIST_HEAD(msgs);
+	bool finished;
+
+	if (ls->last_round || uftrace_done)
+		return false;
+
+	pthread_mutex_lock(&ls->lock);
+	if (list_empty(&ls->msgs) && !ls->finished) {
+		struct timespec ts;
+
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += LIVE_REORDER_MSEC * NSEC_PER_MSEC;
+		if (ts.tv_nsec >= NSEC_PER_SEC) {
+			ts.tv_sec++;
+			ts.tv_nsec -= NSEC_PER_SEC;
+		}
+		pthread_cond_timedwait(&ls->cond, &ls->lock, &ts);
+	}
+	list_splice_tail_init(&ls->msgs, &msgs);
+	finished = ls->finished;
+	pthread_mutex_unlock(&ls->lock);
+
+	list_for_each_entry_safe(m, tmp, &msgs, list) {
+		list_del(&m->list);
+		apply_live_msg(ls, handle, m);
+	}
+
+	/* all data is here, no need to wait anymore */
+	ls->last_round = finished;
+	ls->stale = true;
+	return true;
+}
+
+static void update_watermark(struct live_stream *ls,
+			     struct ftrace_file_handle *handle)
+{
+	struct live_task *lt;
+	struct ftrace_task_handle *task;
+	uint64_t now = live_clock();
+	uint64_t last;
+
+	ls->watermark = -1ULL;
+
+	list_for_each_entry(lt, &ls->tasks, list) {
+		/* it has data to read, the heap will take care of it */
+		if (!lt->starved || lt->exited)
+			continue;
+
+		/* do not wait for an idle task */
+		if (now - lt->last_recv > LIVE_REORDER_MSEC * NSEC_PER_MSEC)
+			continue;
+
+		/* new data of the task comes after the last record read */
+		last = 0;
+		task = get_task_handle(handle, lt->tid);
+		if (task && task->rstack_list.count)
+			last = get_last_rstack_list(&task->rstack_list, 0)->time;
+		else if (task)
+			last = task->ustack.time;
+
+		if (ls->watermark > last)
+			ls->watermark = last;
+	}
+}
+
+/**
+ * live_stream_ready - check if the next record can be shown
+ * @handle: handle for the streaming data
+ * @task: task which has the next (oldest) record
+ *
+ * This function returns %true if no other task can have an older
+ * record than the @task->rstack.  As the data comes in a unit of buffer,
+ * an older record can be still in the buffer of a task which has read
+ * all data received.  It waits for such tasks unless they're idle.
+ */
+bool live_stream_ready(struct ftrace_file_handle *handle,
+		       struct ftrace_task_handle *task)
+{
+	struct live_stream *ls = &live_stream;
+
+	if (ls->last_round)
+		return true;
+
+	if (ls->stale) {
+		update_watermark(ls, handle);
+		ls->stale = false;
+	}
+
+	return task->rstack->time <= ls->watermark;
+}
+
+static void *live_stream_thread(void *arg)
+{
+	struct live_stream *ls = arg;
+	struct ftrace_file_handle handle;
+	struct live_task *lt, *tmp_lt;
+	struct live_msg *m, *tmp_m;
+	sigset_t sigset;
+
+	/* recorder handles the signals (but SIGPIPE is for the output) */
+	sigfillset(&sigset);
+	sigdelset(&sigset, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &sigset, NULL);
+
+	pr_dbg("start live-streaming...\n");
+
+	if (open_stream_data(&ls->opts, &handle) < 0) {
+		pr_warn("cannot open record data: %s: %m\n", ls->opts.dirname);
+		ls->ret = -1;
+	}
+	else {
+		ls->ret = replay_stream(&ls->opts, &handle);
+		close_data_file(&ls->opts, &handle);
+	}
+
+	/* let the recorder not wait for the replay */
+	pthread_mutex_lock(&ls->lock);
+	ls->stopped = true;
+	pthread_cond_broadcast(&ls->space);
+	pthread_mutex_unlock(&ls->lock);
+
+	list_for_each_entry_safe(lt, tmp_lt, &ls->tasks, list) {
+		list_for_each_entry_safe(m, tmp_m, &lt->bufs, list) {
+			list_del(&m->list);
+			free(m);
+		}
+		list_del(&lt->list);
+		free(lt);
+	}
+	return NULL;
+}
+
+/**
+ * start_live_stream - start a thread to replay the streaming data
+ * @opts: uftrace command line options
+ */
+void start_live_stream(struct opts *opts)
+{
+	struct live_stream *ls = &live_stream;
+
+	ls->opts = *opts;
+	reset_live_opts(&ls->opts);
+
+	errno = pthread_create(&ls->thread, NULL, live_stream_thread, ls);
+	if (errno)
+		pr_err("cannot create a thread for live streaming");
+}
+
+/**
+ * finish_live_stream - wait for the replay of the streaming data
+ *
+ * This function returns the result of the replay.
+ */
+int finish_live_stream(void)
+{
+	struct live_stream *ls = &live_stream;
+	struct live_msg *m, *tmp;
+
+	pthread_mutex_lock(&ls->lock);
+	ls->finished = true;
+	pthread_cond_signal(&ls->cond);
+	pthread_mutex_unlock(&ls->lock);
+
+	pthread_join(ls->thread, NULL);
+
+	/* messages after the replay was stopped */
+	list_for_each_entry_safe(m, tmp, &ls->msgs, list) {
+		list_del(&m->list);
+		free(m);
+	}
+	return ls->ret;
+}
+
 static void setup_child_environ(struct opts *opts)
 {
 	char buf[4096];
@@ -159,8 +648,11 @@ int command_live(int argc, char *argv[], struct opts *opts)
 		return 0;
 	}
 
+	if (opts->stream && !can_stream_live(opts))
+		opts->stream = false;
+
 	ret = command_record(argc, argv, opts);
-	if (!can_skip_replay(opts, ret)) {
+	if (!opts->stream && !can_skip_replay(opts, ret)) {
 		int ret2;
 
 		reset_live_opts(opts);
@@ -15,6 +15,7 @@
 #include <sys/wait.h>
 #include <sys/ioctl.h>
 #include <sys/eventfd.h>
+#include <sys/prctl.h>
 #include <sys/resource.h>
 #include <sys/epoll.h>
 
@@ -55,6 +56,10 @@ static bool buf_done;
 static int thread_ctl[2];
 
 static bool has_perf_event;
+/* pass trace data to the live replay instead of writing to files */
+static bool use_live_stream;
+/* aggregate trace data for uftrace top instead of writing to files */
+static bool use_top_view;
 
 
 static bool can_use_fast_libmcount(struct opts *opts)
@@ -315,8 +320,9 @@ static uint64_t calc_feat_mask(struct opts *opts)
 	if (opts->retval || opts->auto_args)
 		features |= RETVAL;
 
+	/* user events save their arguments */
 	if (opts->event)
-		features |= EVENT;
+		features |= EVENT | EVENT_ARGS;
 
 	return features;
 }
@@ -438,7 +444,9 @@ static void write_buffer(struct buf_list *buf, struct opts *opts, int sock)
 {
 	struct mcount_shmem_buffer *shmbuf = buf->shmem_buf;
 
-	if (!opts->host)
+	if (use_top_view)
+		top_view_data(buf->tid, shmbuf->data, shmbuf->size);
+	else if (!opts->host)
 		write_buffer_file(opts->dirname, buf);
 	else
 		send_trace_data(sock, buf->tid, shmbuf->data, shmbuf->size);
@@ -720,6 +728,22 @@ static void copy_to_buffer(struct mcount_shmem_buffer *shm, char *sess_id)
 	pthread_mutex_unlock(&write_list_lock);
 }
 
+static void stream_buffer(struct mcount_shmem_buffer *shm, char *sess_id,
+			  int bufsize)
+{
+	int tid;
+
+	parse_msg_id(sess_id, NULL, &tid, NULL);
+	live_stream_data(tid, shm->data, shm->size);
+
+	/* it's ok to reuse the buffer now */
+	shm->size = 0;
+	__sync_synchronize();
+	shm->flag = SHMEM_FL_WRITTEN;
+
+	munmap(shm, bufsize);
+}
+
 static void record_mmap_file(const char *dirname, char *sess_id, int bufsize)
 {
 	int fd;
@@ -764,7 +788,10 @@ static void record_mmap_file(const char *dirname, char *sess_id, int bufsize)
 
 		if (shmem_buf->size) {
 			/* shmem_buf will be unmapped */
-			copy_to_buffer(shmem_buf, sess_id);
+			if (use_live_stream)
+				stream_buffer(shmem_buf, sess_id, bufsize);
+			else
+				copy_to_buffer(shmem_buf, sess_id);
 			return;
 		}
 	}
@@ -979,6 +1006,15 @@ struct dlopen_list {
 
 static LIST_HEAD(dlopen_libs);
 
+/* pass the message to the live stream or top view (if any) */
+static void forward_message(int type, void *msg, size_t len, char *name)
+{
+	if (use_live_stream)
+		live_stream_message(type, msg, len, name);
+	else if (use_top_view)
+		top_view_message(type, msg, len, name);
+}
+
 static void read_record_mmap(int pfd, const char *dirname, int bufsize)
 {
 	char buf[128];
@@ -1058,6 +1094,7 @@ static void read_record_mmap(int pfd, const char *dirname, int bufsize)
 			add_tid_list(tmsg.pid, tmsg.tid);
 
 		write_task_info(dirname, &tmsg);
+		forward_message(msg.type, &tmsg, sizeof(tmsg), NULL);
 		break;
 
 	case UFTRACE_MSG_TASK_END:
@@ -1076,6 +1113,8 @@ static void read_record_mmap(int pfd, const char *dirname, int bufsize)
 				break;
 			}
 		}
+
+		forward_message(msg.type, &tmsg, sizeof(tmsg), NULL);
 		break;
 
 	case UFTRACE_MSG_FORK_START:
@@ -1126,6 +1165,7 @@ static void read_record_mmap(int pfd, const char *dirname, int bufsize)
 		pr_dbg2("MSG FORK2: %d/%d\n", tl->pid, tl->tid);
 
 		write_fork_info(dirname, &tmsg);
+		forward_message(msg.type, &tmsg, sizeof(tmsg), NULL);
 		break;
 
 	case UFTRACE_MSG_SESSION:
@@ -1146,6 +1186,7 @@ static void read_record_mmap(int pfd, const char *dirname, int bufsize)
 		pr_dbg2("MSG SESSION: %d: %s (%s)\n", sess.task.tid, exename, buf);
 
 		write_session_info(dirname, &sess, exename);
+		forward_message(msg.type, &sess, sizeof(sess), exename);
 		free(exename);
 		break;
 
@@ -1173,11 +1214,18 @@ static void read_record_mmap(int pfd, const char *dirname, int bufsize)
 
 		pr_dbg2("MSG DLOPEN: %d: %#lx %s\n", dmsg.task.tid, dmsg.base_addr, exename);
 
+		write_dlopen_info(dirname, &dmsg, exename);
+
+		if (use_live_stream || use_top_view) {
+			/* no need to save the symbol file */
+			forward_message(msg.type, &dmsg, sizeof(dmsg), exename);
+			free(exename);
+			break;
+		}
+
 		dlib = xmalloc(sizeof(*dlib));
 		dlib->libname = exename;
 		list_add_tail(&dlib->list, &dlopen_libs);
-
-		write_dlopen_info(dirname, &dmsg, exename);
 		/* exename will be freed with the dlib */
 		break;
 
@@ -1581,8 +1629,10 @@ static void setup_writers(struct writer_data *wd, struct opts *opts)
 	else if (opts->nr_thread > wd->nr_cpu)
 		opts->nr_thread = wd->nr_cpu;
 
-	if (setup_perf_record(perf, wd->nr_cpu, wd->pid,
-			      opts->dirname, has_perf_event) < 0)
+	if (use_live_stream || use_top_view)
+		has_perf_event = false;
+	else if (setup_perf_record(perf, wd->nr_cpu, wd->pid,
+				   opts->dirname, has_perf_event) < 0)
 		has_perf_event = false;
 	else
 		has_perf_event = true;  /* for task/comm events */
@@ -1783,8 +1833,15 @@ static void write_symbol_files(struct writer_data *wd, struct opts *opts)
 		close(sock);
 
 		remove_directory(opts->dirname);
+		return;
 	}
-	else if (geteuid() == 0)
+
+	/* live mode doesn't need it unless it shows the report */
+	if (opts->report_summary && !opts->nop && !opts->kernel &&
+	    (opts->mode != UFTRACE_MODE_LIVE || opts->report))
+		save_report_summary(opts);
+
+	if (geteuid() == 0)
 		chown_directory(opts->dirname);
 }
 
@@ -1798,6 +1855,25 @@ int do_main_loop(int pfd[2], int ready, struct opts *opts, int pid)
 	close(pfd[1]);
 
 	setup_writers(&wd, opts);
+
+	if (use_live_stream) {
+		struct timespec ts;
+		char *elapsed_time;
+
+		/* the replay needs the info file before the data */
+		memset(&wd.usage, 0, sizeof(wd.usage));
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		elapsed_time = get_child_time(&ts, &ts);
+
+		if (fill_file_header(opts, 0, &wd.usage, elapsed_time) < 0)
+			pr_err("cannot generate data file");
+		free(elapsed_time);
+
+		start_live_stream(opts);
+	}
+	else if (use_top_view)
+		start_top_view(opts);
+
 	start_tracing(&wd, opts, ready);
 	close(ready);
 
@@ -1818,11 +1894,27 @@ int do_main_loop(int pfd[2], int ready, struct opts *opts, int pid)
 
 		if (pollfd.revents & (POLLERR | POLLHUP))
 			break;
+
+		if (use_top_view)
+			update_top_view(false);
 	}
 
 	ret = stop_tracing(&wd, opts);
 	finish_writers(&wd, opts);
 
+	if (use_live_stream) {
+		int ret2 = finish_live_stream();
+
+		if (ret == UFTRACE_EXIT_SUCCESS)
+			ret = ret2;
+		return ret;
+	}
+
+	if (use_top_view) {
+		finish_top_view();
+		return ret;
+	}
+
 	write_symbol_files(&wd, opts);
 	return ret;
 }
@@ -1839,6 +1931,9 @@ int do_child_exec(int pfd[2], int ready, struct opts *opts, char *argv[])
 	if (read(ready, &dummy, sizeof(dummy)) != (ssize_t)sizeof(dummy))
 		pr_err("waiting for parent failed");
 
+	/* the traced program should not be killed by the parent */
+	prctl(PR_SET_PDEATHSIG, 0);
+
 	/*
 	 * I don't think the traced binary is in PATH.
 	 * So use plain 'execv' rather than 'execvp'.
@@ -1849,7 +1944,7 @@ int do_child_exec(int pfd[2], int ready, struct opts *opts, char *argv[])
 
 int command_record(int argc, char *argv[], struct opts *opts)
 {
-	int pid;
+	int pid, ppid;
 	int pfd[2];
 	int efd;
 	int ret = -1;
@@ -1869,21 +1964,37 @@ int command_record(int argc, char *argv[], struct opts *opts)
 	has_perf_event = check_linux_schedule_event(opts->event,
 						    opts->patt_type);
 
+	use_live_stream = opts->stream;
+	if (use_live_stream && has_perf_event)
+		pr_warn("linux:schedule event is not supported with --stream\n");
+
+	use_top_view = opts->mode == UFTRACE_MODE_TOP;
+
 	fflush(stdout);
 
 	efd = eventfd(0, EFD_CLOEXEC | EFD_SEMAPHORE);
 	if (efd < 0)
 		pr_dbg("creating eventfd failed: %d\n", efd);
 
+	ppid = getpid();
 	pid = fork();
 	if (pid < 0)
 		pr_err("cannot start child process");
 
 	if (pid == 0) {
 		if (opts->keep_pid)
-			ret = do_main_loop(pfd, efd, opts, getppid());
-		else
+			ret = do_main_loop(pfd, efd, opts, ppid);
+		else {
+			/*
+			 * do not wait forever if the parent failed to set up
+			 * (e.g. cannot connect to the server for -H option).
+			 */
+			prctl(PR_SET_PDEATHSIG, SIGKILL);
+			if (getppid() != ppid)
+				exit(1);
+
 			do_child_exec(pfd, efd, opts, argv);
+		}
 		return ret;
 	}
 
@@ -2,7 +2,6 @@
 #include <signal.h>
 #include <unistd.h>
 #include <fcntl.h>
-#include <stdarg.h>
 #include <inttypes.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -13,19 +12,18 @@
 #include <linux/limits.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <pthread.h>
 #include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+
+#ifdef HAVE_LIBZ
+# include <zlib.h>
+#endif
 
 #include "uftrace.h"
 #include "utils/utils.h"
-#include "utils/list.h"
-
-struct client_data {
-	struct list_head	list;
-	int			sock;
-	char			*dirname;
-};
-
-static LIST_HEAD(client_list);
+#include "utils/rbtree.h"
 
 static int server_socket(struct opts *opts)
 {
@@ -75,6 +73,310 @@ static int signal_fd(struct opts *opts)
 }
 
 /* client (record) side API */
+
+/* size of a frame to send messages (before compression) */
+#define SEND_FRAME_SIZE  (1024 * 1024)
+
+/* max size of (droppable) messages waiting in the queue */
+#define SEND_QUEUE_BUDGET  (64 * 1024 * 1024)
+
+/* flush a partially filled frame after this time (in msec) */
+#define SEND_FLUSH_MSEC  100
+
+struct send_frame {
+	struct list_head	list;
+	size_t			len;
+	size_t			size;
+	unsigned		nr_msgs;
+	unsigned char		data[];
+};
+
+/*
+ * messages are copied to the current frame and sent by a separate
+ * thread so that the writer threads won't be blocked by the network.
+ * Frames are used only with --frame or --compress since older recv
+ * doesn't know them.  Otherwise messages are sent directly as before.
+ */
+struct send_queue {
+	int			sock;
+	pthread_t		thread;
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	struct list_head	frames;
+	struct send_frame	*curr;
+	/* bytes of messages not sent yet */
+	size_t			queued;
+	bool			framed;
+	bool			compress;
+	bool			done;
+	/* buffer for compression (used by the sender thread only) */
+	void			*zbuf;
+	size_t			zbuf_size;
+	uint64_t		nr_frames;
+	uint64_t		bytes;
+	uint64_t		wire_bytes;
+	uint64_t		lost_msgs;
+	uint64_t		lost_bytes;
+};
+
+static struct send_queue send_queue = {
+	.sock	= -1,
+	.lock	= PTHREAD_MUTEX_INITIALIZER,
+	.cond	= PTHREAD_COND_INITIALIZER,
+	.frames	= LIST_HEAD_INIT(send_queue.frames),
+};
+
+/* Adler-32 checksum, compatible to zlib but doesn't require it */
+static uint32_t frame_checksum(void *data, size_t len)
+{
+#ifdef HAVE_LIBZ
+	/* zlib has an optimized version */
+	return adler32(1, data, len);
+#else
+	unsigned char *p = data;
+	uint32_t a = 1, b = 0;
+
+	while (len > 0) {
+		/* max number of bytes not to overflow 'b' */
+		size_t n = len < 5552 ? len : 5552;
+
+		len -= n;
+		while (n--) {
+			a += *p++;
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	return (b << 16) | a;
+#endif
+}
+
+static void send_frame(struct send_queue *q, struct send_frame *frame)
+{
+	struct uftrace_msg msg = {
+		.magic = htons(UFTRACE_MSG_MAGIC),
+		.type  = htons(UFTRACE_MSG_SEND_FRAME),
+	};
+	struct uftrace_msg_frame fhdr;
+	struct iovec iov[] = {
+		{ .iov_base = &msg,        .iov_len = sizeof(msg), },
+		{ .iov_base = &fhdr,       .iov_len = sizeof(fhdr), },
+		{ .iov_base = frame->data, .iov_len = frame->len, },
+	};
+	uint32_t flags = 0;
+
+#ifdef HAVE_LIBZ
+	if (q->compress) {
+		uLongf zlen = compressBound(frame->len);
+
+		if (q->zbuf_size < zlen) {
+			q->zbuf_size = zlen;
+			q->zbuf = xrealloc(q->zbuf, zlen);
+		}
+
+		/* send it uncompressed if it's not compressible */
+		if (compress2(q->zbuf, &zlen, frame->data, frame->len,
+			      Z_BEST_SPEED) == Z_OK && zlen < frame->len) {
+			iov[2].iov_base = q->zbuf;
+			iov[2].iov_len  = zlen;
+			flags |= UFTRACE_MSG_FRAME_ZLIB;
+		}
+	}
+#endif
+
+	fhdr.size    = htonl(frame->len);
+	fhdr.csum    = htonl(frame_checksum(iov[2].iov_base, iov[2].iov_len));
+	fhdr.flags   = htonl(flags);
+	fhdr.nr_msgs = htonl(frame->nr_msgs);
+	msg.len      = htonl(sizeof(fhdr) + iov[2].iov_len);
+
+	pr_dbg3("send UFTRACE_MSG_SEND_FRAME: %u messages, %zd -> %zd bytes\n",
+		frame->nr_msgs, frame->len, iov[2].iov_len);
+	if (writev_all(q->sock, iov, ARRAY_SIZE(iov)) < 0)
+		pr_err("send frame failed");
+
+	q->nr_frames++;
+	q->bytes      += frame->len;
+	q->wire_bytes += sizeof(msg) + sizeof(fhdr) + iov[2].iov_len;
+}
+
+static void *send_thread(void *arg)
+{
+	struct send_queue *q = arg;
+	struct send_frame *frame;
+	sigset_t sigset;
+
+	sigfillset(&sigset);
+	pthread_sigmask(SIG_BLOCK, &sigset, NULL);
+
+	pthread_mutex_lock(&q->lock);
+	while (true) {
+		if (list_empty(&q->frames) && !q->done) {
+			struct timespec ts;
+
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_nsec += SEND_FLUSH_MSEC * NSEC_PER_MSEC;
+			if (ts.tv_nsec >= NSEC_PER_SEC) {
+				ts.tv_sec++;
+				ts.tv_nsec -= NSEC_PER_SEC;
+			}
+
+			if (pthread_cond_timedwait(&q->cond, &q->lock,
+						   &ts) != ETIMEDOUT)
+				continue;
+		}
+
+		/* send the current frame at timeout or at the end */
+		if (list_empty(&q->frames)) {
+			if (q->curr == NULL) {
+				if (q->done)
+					break;
+				continue;
+			}
+
+			list_add_tail(&q->curr->list, &q->frames);
+			q->curr = NULL;
+		}
+
+		frame = list_first_entry(&q->frames, struct send_frame, list);
+		list_del(&frame->list);
+		pthread_mutex_unlock(&q->lock);
+
+		send_frame(q, frame);
+
+		pthread_mutex_lock(&q->lock);
+		q->queued -= frame->len;
+		free(frame);
+	}
+	pthread_mutex_unlock(&q->lock);
+
+	return NULL;
+}
+
+/**
+ * queue_message - add a message to the send queue
+ * @iov: message to send (including the header)
+ * @count: number of entries in @iov
+ * @may_drop: whether the message can be dropped
+ *
+ * This function copies the message to the current frame and returns.
+ * If @may_drop is true and the queue already has too many messages,
+ * the message is discarded and counted as lost.  If frames are not
+ * used, the message is sent directly and never dropped.
+ *
+ * It returns 0 if the message was queued, -1 if dropped.
+ */
+static int queue_message(struct iovec *iov, int count, bool may_drop)
+{
+	struct send_queue *q = &send_queue;
+	struct send_frame *frame;
+	size_t len = 0;
+	int i;
+
+	for (i = 0; i < count; i++)
+		len += iov[i].iov_len;
+
+	pthread_mutex_lock(&q->lock);
+
+	/* writer threads share the socket: don't mix the messages */
+	if (!q->framed) {
+		if (writev_all(q->sock, iov, count) < 0)
+			pr_err("send message failed");
+
+		pthread_mutex_unlock(&q->lock);
+		return 0;
+	}
+
+	if (may_drop && q->queued + len > SEND_QUEUE_BUDGET) {
+		q->lost_msgs++;
+		q->lost_bytes += len;
+		pthread_mutex_unlock(&q->lock);
+		return -1;
+	}
+
+	frame = q->curr;
+	if (frame && frame->len + len > frame->size) {
+		list_add_tail(&frame->list, &q->frames);
+		pthread_cond_signal(&q->cond);
+		frame = NULL;
+	}
+
+	if (frame == NULL) {
+		size_t size = len > SEND_FRAME_SIZE ? len : SEND_FRAME_SIZE;
+
+		frame = xmalloc(sizeof(*frame) + size);
+		frame->len  = 0;
+		frame->size = size;
+		frame->nr_msgs = 0;
+
+		q->curr = frame;
+	}
+
+	for (i = 0; i < count; i++) {
+		memcpy(frame->data + frame->len, iov[i].iov_base, iov[i].iov_len);
+		frame->len += iov[i].iov_len;
+	}
+	frame->nr_msgs++;
+	q->queued += len;
+
+	pthread_mutex_unlock(&q->lock);
+	return 0;
+}
+
+static void start_send_queue(int sock, struct opts *opts)
+{
+	struct send_queue *q = &send_queue;
+
+	q->sock = sock;
+
+	/* keep the old protocol for older recv unless requested */
+	if (!opts->frame && !opts->compress)
+		return;
+
+	q->framed = true;
+	q->compress = opts->compress;
+
+#ifndef HAVE_LIBZ
+	if (opts->compress) {
+		pr_warn("zlib is not found, sending data uncompressed\n");
+		q->compress = false;
+	}
+#endif
+
+	if (pthread_create(&q->thread, NULL, send_thread, q) != 0)
+		pr_err("creating send thread failed");
+}
+
+static void finish_send_queue(void)
+{
+	struct send_queue *q = &send_queue;
+
+	if (!q->framed) {
+		q->sock = -1;
+		return;
+	}
+
+	pthread_mutex_lock(&q->lock);
+	q->done = true;
+	pthread_cond_signal(&q->cond);
+	pthread_mutex_unlock(&q->lock);
+
+	pthread_join(q->thread, NULL);
+
+	pr_dbg("sent %"PRIu64" bytes in %"PRIu64" frames (%"PRIu64" bytes on wire)\n",
+	       q->bytes, q->nr_frames, q->wire_bytes);
+
+	if (q->lost_msgs) {
+		pr_warn("LOST %"PRIu64" bytes (%"PRIu64" messages) due to slow network\n",
+			q->lost_bytes, q->lost_msgs);
+	}
+
+	free(q->zbuf);
+	q->zbuf = NULL;
+	q->sock = -1;
+}
+
 int setup_client_socket(struct opts *opts)
 {
 	struct sockaddr_in addr = {
@@ -100,6 +402,7 @@ int setup_client_socket(struct opts *opts)
 	if (connect(sock, &addr, sizeof(addr)) < 0)
 		pr_err("socket connect failed");
 
+	start_send_queue(sock, opts);
 	return sock;
 }
 
@@ -117,8 +420,7 @@ void send_trace_dir_name(int sock, char *name)
 	};
 
 	pr_dbg2("send UFTRACE_MSG_SEND_HDR\n");
-	if (writev_all(sock, iov, ARRAY_SIZE(iov)) < 0)
-		pr_err("send header failed");
+	queue_message(iov, ARRAY_SIZE(iov), false);
 }
 
 void send_trace_data(int sock, int tid, void *data, size_t len)
@@ -134,10 +436,23 @@ void send_trace_data(int sock, int tid, void *data, size_t len)
 		{ .iov_base = &msg_tid, .iov_len = sizeof(msg_tid), },
 		{ .iov_base = data,     .iov_len = len, },
 	};
+	struct uftrace_record lost = {
+		.type  = UFTRACE_LOST,
+		.magic = RECORD_MAGIC,
+		/* it might contain arguments, but not so important */
+		.addr  = len / sizeof(lost),
+	};
 
 	pr_dbg2("send UFTRACE_MSG_SEND_DATA\n");
-	if (writev_all(sock, iov, ARRAY_SIZE(iov)) < 0)
-		pr_err("send data failed");
+	if (queue_message(iov, ARRAY_SIZE(iov), true) == 0)
+		return;
+
+	/* let replay know that some records are lost */
+	msg.len = htonl(sizeof(msg_tid) + sizeof(lost));
+	iov[2].iov_base = &lost;
+	iov[2].iov_len  = sizeof(lost);
+
+	queue_message(iov, ARRAY_SIZE(iov), false);
 }
 
 void send_trace_kernel_data(int sock, int cpu, void *data, size_t len)
@@ -155,27 +470,36 @@ void send_trace_kernel_data(int sock, int cpu, void *data, size_t len)
 	};
 
 	pr_dbg2("send UFTRACE_MSG_SEND_KERNEL_DATA\n");
-	if (writev_all(sock, iov, ARRAY_SIZE(iov)) < 0)
-		pr_err("send kernel data failed");
+	queue_message(iov, ARRAY_SIZE(iov), true);
 }
 
-void send_trace_perf_data(int sock, int cpu, void *data, size_t len)
+/*
+ * the perf ring buffer can be wrapped around so @data has one or two
+ * chunks.  they're sent in a single message not to drop a part of it.
+ */
+void send_trace_perf_data(int sock, int cpu, struct iovec *data, int count)
 {
 	int32_t msg_cpu = htonl(cpu);
 	struct uftrace_msg msg = {
 		.magic = htons(UFTRACE_MSG_MAGIC),
 		.type  = htons(UFTRACE_MSG_SEND_PERF_DATA),
-		.len   = htonl(sizeof(msg_cpu) + len),
 	};
-	struct iovec iov[] = {
+	struct iovec iov[4] = {
 		{ .iov_base = &msg,     .iov_len = sizeof(msg), },
 		{ .iov_base = &msg_cpu, .iov_len = sizeof(msg_cpu), },
-		{ .iov_base = data,     .iov_len = len, },
+		/* to be filled */
 	};
+	size_t len = 0;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		iov[i + 2] = data[i];
+		len += data[i].iov_len;
+	}
+	msg.len = htonl(sizeof(msg_cpu) + len);
 
 	pr_dbg2("send UFTRACE_MSG_SEND_PERF_DATA\n");
-	if (writev_all(sock, iov, ARRAY_SIZE(iov)) < 0)
-		pr_err("send kernel data failed");
+	queue_message(iov, count + 2, true);
 }
 
 void send_trace_metadata(int sock, const char *dirname, char *filename)
@@ -220,8 +544,7 @@ void send_trace_metadata(int sock, const char *dirname, char *filename)
 	namelen = htonl(namelen);
 
 	pr_dbg2("send UFTRACE_MSG_SEND_META_DATA: %s\n", filename);
-	if (writev_all(sock, iov, ARRAY_SIZE(iov)) < 0)
-		pr_err("send metadata failed");
+	queue_message(iov, ARRAY_SIZE(iov), false);
 
 	free(pathname);
 	free(buf);
@@ -249,8 +572,7 @@ void send_trace_info(int sock, struct uftrace_file_header *hdr,
 	hdr->max_stack   = htons(hdr->max_stack);
 
 	pr_dbg2("send UFTRACE_MSG_SEND_INFO\n");
-	if (writev_all(sock, iov, ARRAY_SIZE(iov)) < 0)
-		pr_err("send metadata failed");
+	queue_message(iov, ARRAY_SIZE(iov), false);
 }
 
 void send_trace_end(int sock)
@@ -260,204 +582,386 @@ void send_trace_end(int sock)
 		.type  = htons(UFTRACE_MSG_SEND_END),
 	};
 
+	struct iovec iov = {
+		.iov_base = &msg,
+		.iov_len  = sizeof(msg),
+	};
+	char buf[16];
+
 	pr_dbg2("send UFTRACE_MSG_SEND_END\n");
-	if (write_all(sock, &msg, sizeof(msg)) < 0)
-		pr_err("send end failed");
+	queue_message(&iov, 1, false);
+	finish_send_queue();
+
+	/*
+	 * wait for the server to close the connection so that
+	 * all data is written to the disk when record finishes.
+	 */
+	shutdown(sock, SHUT_WR);
+	while (read(sock, buf, sizeof(buf)) > 0)
+		continue;
 }
 
 
 /* server (recv) side API */
-static struct client_data *find_client(int sock)
+struct client_file {
+	struct rb_node		node;
+	int			type;
+	int			id;
+	int			fd;
+};
+
+struct recv_stats {
+	uint64_t		msgs;
+	uint64_t		bytes;
+	/* bytes moved by splice() without copying to user space */
+	uint64_t		spliced;
+	/* messages found with the socket queue more than half full */
+	uint64_t		nr_full;
+	unsigned		max_pending;
+	/* time spent to handle messages in nsec */
+	uint64_t		busy_time;
+	uint64_t		frames;
+	/* bytes of frames actually received (after compression) */
+	uint64_t		frame_bytes;
+};
+
+struct client_data {
+	int			sock;
+	char			*dirname;
+	/* cached file descriptors of (per-tid or per-cpu) data files */
+	struct rb_root		files;
+	int			rcvbuf;
+	struct recv_stats	stats;
+	char			host[NI_MAXHOST];
+	/* remaining messages in the current frame (if any) */
+	unsigned char		*frame;
+	size_t			frame_len;
+};
+
+struct recv_worker {
+	pthread_t		thread;
+	int			idx;
+	int			efd;
+	/* pipe to splice data from socket to file */
+	int			pipe[2];
+	bool			use_splice;
+	void			*buf;
+	/* buffers to receive and decompress frames */
+	void			*frame_buf;
+	size_t			frame_size;
+	void			*zbuf;
+	size_t			zbuf_size;
+	struct opts		*opts;
+	int			nr_clients;
+	struct recv_stats	stats;
+	uint64_t		start;
+};
+
+/* size of (fallback) buffer to copy data */
+#define RECV_BUFSIZE  (128 * 1024)
+
+/* pipe size to splice data, it's a hint and might not be applied */
+#define RECV_PIPESIZE  (1024 * 1024)
+
+static int done_fd;
+
+static uint64_t recv_time(void)
 {
-	struct client_data *c;
+	struct timespec ts;
 
-	list_for_each_entry(c, &client_list, list) {
-		if (c->sock == sock)
-			return c;
-	}
-	return NULL;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void add_stats(struct recv_stats *dst, struct recv_stats *src)
+{
+	dst->msgs      += src->msgs;
+	dst->bytes     += src->bytes;
+	dst->spliced   += src->spliced;
+	dst->nr_full   += src->nr_full;
+	dst->busy_time += src->busy_time;
+	dst->frames    += src->frames;
+	dst->frame_bytes += src->frame_bytes;
+
+	if (dst->max_pending < src->max_pending)
+		dst->max_pending = src->max_pending;
 }
 
-#define O_CLIENT_FLAGS  (O_WRONLY | O_APPEND | O_CREAT)
+static void print_stats(char *name, struct recv_stats *stats)
+{
+	pr_dbg("%s: %"PRIu64" messages, %"PRIu64" bytes (%"PRIu64" spliced)\n",
+	       name, stats->msgs, stats->bytes, stats->spliced);
+	if (stats->frames) {
+		pr_dbg("%s: %"PRIu64" frames, %"PRIu64" bytes on the wire\n",
+		       name, stats->frames, stats->frame_bytes);
+	}
+	pr_dbg("%s: socket queue max %u bytes, more than half full %"PRIu64" times\n",
+	       name, stats->max_pending, stats->nr_full);
+}
 
-static void write_client_file(struct client_data *c, char *filename, int nr, ...)
+static int open_client_file(struct client_data *c, char *filename)
 {
-	int i, fd;
-	va_list ap;
-	struct iovec iov[nr];
 	char buf[PATH_MAX];
+	int fd;
 
 	snprintf(buf, sizeof(buf), "%s/%s", c->dirname, filename);
-	fd = open(buf, O_CLIENT_FLAGS, 0644);
-	if (fd < 0)
-		pr_err("file open failed: %s", buf);
 
-	va_start(ap, nr);
-	for (i = 0; i < nr; i++) {
-		iov[i].iov_base = va_arg(ap, void *);
-		iov[i].iov_len  = va_arg(ap, int);
-	}
-	va_end(ap);
+	/* splice() doesn't work with O_APPEND, move to the end manually */
+	fd = open(buf, O_WRONLY | O_CREAT, 0644);
+	if (fd < 0)
+		return -1;
 
-	if (writev_all(fd, iov, nr) < 0)
-		pr_err("write client data failed on %s", buf);
+	if (lseek(fd, 0, SEEK_END) < 0)
+		pr_err("file seek failed: %s", buf);
 
-	close(fd);
+	return fd;
 }
 
-static void recv_trace_dir_name(int sock, int len)
+static void close_client_files(struct client_data *c)
 {
-	char dirname[len + 1];
-	struct client_data *client;
+	struct client_file *cf;
+	struct rb_node *node;
 
-	if (read_all(sock, dirname, len) < 0)
-		pr_err("recv header failed");
-	dirname[len] = '\0';
+	while (!RB_EMPTY_ROOT(&c->files)) {
+		node = rb_first(&c->files);
+		cf = rb_entry(node, struct client_file, node);
 
-	client = xmalloc(sizeof(*client));
+		rb_erase(node, &c->files);
+		close(cf->fd);
+		free(cf);
+	}
+}
 
-	client->sock = sock;
-	client->dirname = xstrdup(dirname);
-	INIT_LIST_HEAD(&client->list);
+static int get_client_file(struct client_data *c, int type, int id)
+{
+	struct rb_node *parent = NULL;
+	struct rb_node **p = &c->files.rb_node;
+	struct client_file *cf;
+	char filename[64];
+	int fd;
 
-	create_directory(dirname);
-	pr_dbg3("create directory: %s\n", dirname);
+	while (*p) {
+		parent = *p;
+		cf = rb_entry(parent, struct client_file, node);
 
-	list_add(&client->list, &client_list);
-}
+		if (cf->type == type && cf->id == id)
+			return cf->fd;
 
-static void recv_trace_data(int sock, int len)
-{
-	struct client_data *client;
-	int32_t tid;
-	char *filename = NULL;
-	void *buffer;
+		if (cf->type > type || (cf->type == type && cf->id > id))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
 
-	client = find_client(sock);
-	if (client == NULL)
-		pr_err_ns("no client on this socket\n");
+	switch (type) {
+	case UFTRACE_MSG_SEND_DATA:
+		snprintf(filename, sizeof(filename), "%d.dat", id);
+		break;
+	case UFTRACE_MSG_SEND_KERNEL_DATA:
+		snprintf(filename, sizeof(filename), "kernel-cpu%d.dat", id);
+		break;
+	case UFTRACE_MSG_SEND_PERF_DATA:
+		snprintf(filename, sizeof(filename), "perf-cpu%d.dat", id);
+		break;
+	default:
+		pr_err_ns("invalid data type: %d\n", type);
+	}
 
-	if (read_all(sock, &tid, sizeof(tid)) < 0)
-		pr_err("recv tid failed");
-	tid = ntohl(tid);
+	fd = open_client_file(c, filename);
+	if (fd < 0 && errno == EMFILE) {
+		/* too many files are open, drop the cache and retry */
+		pr_dbg("closing cached files of %s\n", c->dirname);
+		close_client_files(c);
 
-	xasprintf(&filename, "%d.dat", tid);
+		parent = NULL;
+		p = &c->files.rb_node;
+		fd = open_client_file(c, filename);
+	}
+	if (fd < 0)
+		pr_err("file open failed: %s/%s", c->dirname, filename);
 
-	len -= sizeof(tid);
-	buffer = xmalloc(len);
+	cf = xmalloc(sizeof(*cf));
+	cf->type = type;
+	cf->id   = id;
+	cf->fd   = fd;
 
-	if (read_all(sock, buffer, len) < 0)
-		pr_err("recv buffer failed");
+	rb_link_node(&cf->node, parent, p);
+	rb_insert_color(&cf->node, &c->files);
 
-	write_client_file(client, filename, 1, buffer, len);
+	return fd;
+}
 
-	free(buffer);
-	free(filename);
+/* read message data from the current frame or the socket */
+static int recv_client_data(struct client_data *c, void *buf, size_t len)
+{
+	if (c->frame == NULL)
+		return read_all(c->sock, buf, len);
+
+	if (len > c->frame_len)
+		return -1;
+
+	memcpy(buf, c->frame, len);
+	c->frame     += len;
+	c->frame_len -= len;
+	return 0;
 }
 
-static void recv_trace_kernel_data(int sock, int len)
+static void copy_client_data(struct recv_worker *w, struct client_data *c,
+			     int fd, size_t len)
 {
-	struct client_data *client;
-	int32_t cpu;
-	char *filename = NULL;
-	void *buffer;
+	ssize_t n;
 
-	client = find_client(sock);
-	if (client == NULL)
-		pr_err_ns("no client on this socket\n");
+	c->stats.bytes += len;
 
-	if (read_all(sock, &cpu, sizeof(cpu)) < 0)
-		pr_err("recv cpu failed");
-	cpu = ntohl(cpu);
+	if (c->frame) {
+		if (len > c->frame_len)
+			pr_err_ns("invalid message in a frame\n");
 
-	xasprintf(&filename, "kernel-cpu%d.dat", cpu);
+		if (write_all(fd, c->frame, len) < 0)
+			pr_err("write client data failed");
 
-	len -= sizeof(cpu);
-	buffer = xmalloc(len);
+		c->frame     += len;
+		c->frame_len -= len;
+		return;
+	}
 
-	if (read_all(sock, buffer, len) < 0)
-		pr_err("recv buffer failed");
+	while (len > 0 && w->use_splice) {
+		size_t size;
 
-	write_client_file(client, filename, 1, buffer, len);
+		n = splice(c->sock, NULL, w->pipe[1], NULL, len,
+			   SPLICE_F_MOVE | SPLICE_F_MORE);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EINVAL && errno != ENOSYS)
+				pr_err("recv data failed");
 
-	free(buffer);
-	free(filename);
+			pr_dbg("splice not supported, fallback to copy\n");
+			w->use_splice = false;
+			break;
+		}
+		if (n == 0)
+			pr_err_ns("client connection closed\n");
+
+		len -= n;
+		size = n;
+
+		while (size > 0) {
+			n = splice(w->pipe[0], NULL, fd, NULL, size,
+				   SPLICE_F_MOVE);
+			if (n > 0) {
+				size -= n;
+				c->stats.spliced += n;
+				continue;
+			}
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n < 0 && errno != EINVAL && errno != ENOSYS)
+				pr_err("write client data failed");
+
+			/* drain the pipe by copying */
+			pr_dbg("splice not supported, fallback to copy\n");
+			w->use_splice = false;
+
+			if (read_all(w->pipe[0], w->buf, size) < 0 ||
+			    write_all(fd, w->buf, size) < 0)
+				pr_err("write client data failed");
+			size = 0;
+		}
+	}
+
+	while (len > 0) {
+		size_t size = len < RECV_BUFSIZE ? len : RECV_BUFSIZE;
+
+		if (read_all(c->sock, w->buf, size) < 0)
+			pr_err("recv data failed");
+
+		if (write_all(fd, w->buf, size) < 0)
+			pr_err("write client data failed");
+
+		len -= size;
+	}
 }
 
-static void recv_trace_perf_data(int sock, int len)
+static void recv_trace_dir_name(struct recv_worker *w, struct client_data *c,
+				int len)
 {
-	struct client_data *client;
-	int32_t cpu;
-	char *filename = NULL;
-	void *buffer;
+	char dirname[len + 1];
 
-	client = find_client(sock);
-	if (client == NULL)
-		pr_err_ns("no client on this socket\n");
+	if (recv_client_data(c, dirname, len) < 0)
+		pr_err("recv header failed");
+	dirname[len] = '\0';
 
-	if (read_all(sock, &cpu, sizeof(cpu)) < 0)
-		pr_err("recv cpu failed");
-	cpu = ntohl(cpu);
+	/* the client might reuse the connection for another data */
+	close_client_files(c);
+	free(c->dirname);
+	c->dirname = xstrdup(dirname);
 
-	xasprintf(&filename, "perf-cpu%d.dat", cpu);
+	create_directory(dirname);
+	pr_dbg3("create directory: %s\n", dirname);
+}
 
-	len -= sizeof(cpu);
-	buffer = xmalloc(len);
+/* handles trace data for tasks, kernel and perf events */
+static void recv_trace_data(struct recv_worker *w, struct client_data *c,
+			    int type, int len)
+{
+	int32_t id;
+	int fd;
 
-	if (read_all(sock, buffer, len) < 0)
-		pr_err("recv buffer failed");
+	if (c->dirname == NULL)
+		pr_err_ns("no client on this socket\n");
 
-	write_client_file(client, filename, 1, buffer, len);
+	if (recv_client_data(c, &id, sizeof(id)) < 0)
+		pr_err("recv tid or cpu failed");
+	id = ntohl(id);
 
-	free(buffer);
-	free(filename);
+	fd = get_client_file(c, type, id);
+	copy_client_data(w, c, fd, len - sizeof(id));
 }
 
-static void recv_trace_metadata(int sock, int len)
+static void recv_trace_metadata(struct recv_worker *w, struct client_data *c,
+				int len)
 {
-	struct client_data *client;
 	int32_t namelen;
 	char *filename = NULL;
-	void *filedata;
+	int fd;
 
-	client = find_client(sock);
-	if (client == NULL)
+	if (c->dirname == NULL)
 		pr_err_ns("no client on this socket\n");
 
-	if (read_all(sock, &namelen, sizeof(namelen)) < 0)
+	if (recv_client_data(c, &namelen, sizeof(namelen)) < 0)
 		pr_err("recv symfile name length failed");
 
 	namelen = ntohl(namelen);
 	filename = xmalloc(namelen + 1);
 
-	if (read_all(sock, filename, namelen) < 0)
+	if (recv_client_data(c, filename, namelen) < 0)
 		pr_err("recv file name failed");
 	filename[namelen] = '\0';
 
 	len -= sizeof(namelen) + namelen;
-	filedata = xmalloc(len);
 
-	pr_dbg2("reading %s (%d bytes)\n", filename, len);
-	if (read_all(sock, filedata, len) < 0)
-		pr_err("recv symfile failed");
+	fd = open_client_file(c, filename);
+	if (fd < 0)
+		pr_err("file open failed: %s/%s", c->dirname, filename);
 
-	write_client_file(client, filename, 1, filedata, len);
+	pr_dbg2("reading %s (%d bytes)\n", filename, len);
+	copy_client_data(w, c, fd, len);
 
-	free(filedata);
+	close(fd);
 	free(filename);
 }
 
-static void recv_trace_info(int sock, int len)
+static void recv_trace_info(struct recv_worker *w, struct client_data *c,
+			    int len)
 {
-	struct client_data *client;
 	struct uftrace_file_header hdr;
-	void *info;
+	int fd;
 
-	client = find_client(sock);
-	if (client == NULL)
+	if (c->dirname == NULL)
 		pr_err_ns("no client on this socket\n");
 
-	if (read_all(sock, &hdr, sizeof(hdr)) < 0)
+	if (recv_client_data(c, &hdr, sizeof(hdr)) < 0)
 		pr_err("recv file header failed");
 
 	hdr.version     = ntohl(hdr.version);
@@ -466,35 +970,35 @@ static void recv_trace_info(int sock, int len)
 	hdr.info_mask   = ntohq(hdr.info_mask);
 	hdr.max_stack   = ntohs(hdr.max_stack);
 
-	len -= sizeof(hdr);
-	info = xmalloc(len);
-
-	if (read_all(sock, info, len) < 0)
-		pr_err("recv info failed");
+	fd = open_client_file(c, "info");
+	if (fd < 0)
+		pr_err("file open failed: %s/info", c->dirname);
 
-	write_client_file(client, "info", 2, &hdr, sizeof(hdr), info, len);
+	if (write_all(fd, &hdr, sizeof(hdr)) < 0)
+		pr_err("write client info failed");
 
-	free(info);
+	copy_client_data(w, c, fd, len - sizeof(hdr));
+	close(fd);
 }
 
-static void recv_trace_end(int sock, int efd)
+static void recv_trace_end(struct recv_worker *w, struct client_data *c)
 {
-	struct client_data *client;
-
-	client = find_client(sock);
-	if (client) {
-		list_del(&client->list);
+	if (epoll_ctl(w->efd, EPOLL_CTL_DEL, c->sock, NULL) < 0)
+		pr_err("epoll del failed");
 
-		pr_dbg("wrote client data to %s\n", client->dirname);
+	close_client_files(c);
+	close(c->sock);
 
-		free(client->dirname);
-		free(client);
+	if (c->dirname) {
+		pr_dbg("wrote client data to %s\n", c->dirname);
+		print_stats(c->host, &c->stats);
 	}
 
-	if (epoll_ctl(efd, EPOLL_CTL_DEL, sock, NULL) < 0)
-		pr_err("epoll del failed");
+	add_stats(&w->stats, &c->stats);
+	__sync_sub_and_fetch(&w->nr_clients, 1);
 
-	close(sock);
+	free(c->dirname);
+	free(c);
 }
 
 static void execute_run_cmd(char **argv) {
@@ -511,12 +1015,12 @@ static void execute_run_cmd(char **argv) {
 	}
 }
 
-static void epoll_add(int efd, int fd, unsigned event)
+static void epoll_add(int efd, int fd, unsigned event, void *data)
 {
 	struct epoll_event ev = {
 		.events	= event,
 		.data	= {
-			.fd = fd,
+			.ptr = data,
 		},
 	};
 
@@ -524,88 +1028,308 @@ static void epoll_add(int efd, int fd, unsigned event)
 		pr_err("epoll add failed");
 }
 
-static void handle_server_sock(struct epoll_event *ev, int efd)
+static void check_backpressure(struct client_data *c)
 {
-	int client;
-	int sock = ev->data.fd;
-	struct sockaddr_in addr;
-	socklen_t len = sizeof(addr);
-	char hbuf[NI_MAXHOST];
-
-	client = accept(sock, &addr, &len);
-	if (client < 0)
-		pr_err("socket accept failed");
+	int pending = 0;
 
-	getnameinfo((struct sockaddr *)&addr, len, hbuf, sizeof(hbuf),
-		    NULL, 0, NI_NUMERICHOST);
+	/* the sender would block if the socket queue is full */
+	if (ioctl(c->sock, FIONREAD, &pending) < 0)
+		return;
 
-	epoll_add(efd, client, EPOLLIN);
-	pr_dbg("new connection added from %s\n", hbuf);
+	if (c->stats.max_pending < (unsigned)pending)
+		c->stats.max_pending = pending;
+	if (pending * 2 >= c->rcvbuf)
+		c->stats.nr_full++;
 }
 
-static void handle_client_sock(struct epoll_event *ev, int efd, struct opts *opts)
-{
-	int sock = ev->data.fd;
-	struct uftrace_msg msg;
-
-	if (ev->events & (EPOLLERR | EPOLLHUP)) {
-		pr_dbg("client socket closed\n");
-		recv_trace_end(sock, efd);
-		return;
-	}
-
-	if (read_all(sock, &msg, sizeof(msg)) < 0)
-		pr_err("message recv failed");
+static bool recv_trace_frame(struct recv_worker *w, struct client_data *c,
+			     int len);
 
-	msg.magic = ntohs(msg.magic);
-	msg.type  = ntohs(msg.type);
-	msg.len   = ntohl(msg.len);
+/* returns false if the client is finished */
+static bool handle_message(struct recv_worker *w, struct client_data *c,
+			   struct uftrace_msg *msg)
+{
+	msg->magic = ntohs(msg->magic);
+	msg->type  = ntohs(msg->type);
+	msg->len   = ntohl(msg->len);
 
-	if (msg.magic != UFTRACE_MSG_MAGIC)
+	if (msg->magic != UFTRACE_MSG_MAGIC)
 		pr_err_ns("invalid message\n");
 
-	switch (msg.type) {
+	c->stats.msgs++;
+
+	switch (msg->type) {
 	case UFTRACE_MSG_SEND_DIR_NAME:
 		pr_dbg2("receive UFTRACE_MSG_SEND_DIR_NAME\n");
-		recv_trace_dir_name(sock, msg.len);
+		recv_trace_dir_name(w, c, msg->len);
 		break;
 	case UFTRACE_MSG_SEND_DATA:
 		pr_dbg2("receive UFTRACE_MSG_SEND_DATA\n");
-		recv_trace_data(sock, msg.len);
+		recv_trace_data(w, c, msg->type, msg->len);
 		break;
 	case UFTRACE_MSG_SEND_KERNEL_DATA:
 		pr_dbg2("receive UFTRACE_MSG_SEND_KERNEL_DATA\n");
-		recv_trace_kernel_data(sock, msg.len);
+		recv_trace_data(w, c, msg->type, msg->len);
 		break;
 	case UFTRACE_MSG_SEND_PERF_DATA:
 		pr_dbg2("receive UFTRACE_MSG_SEND_PERF_DATA\n");
-		recv_trace_perf_data(sock, msg.len);
+		recv_trace_data(w, c, msg->type, msg->len);
 		break;
 	case UFTRACE_MSG_SEND_INFO:
 		pr_dbg2("receive UFTRACE_MSG_SEND_INFO\n");
-		recv_trace_info(sock, msg.len);
+		recv_trace_info(w, c, msg->len);
 		break;
 	case UFTRACE_MSG_SEND_META_DATA:
 		pr_dbg2("receive UFTRACE_MSG_SEND_META_DATA\n");
-		recv_trace_metadata(sock, msg.len);
+		recv_trace_metadata(w, c, msg->len);
 		break;
+	case UFTRACE_MSG_SEND_FRAME:
+		pr_dbg2("receive UFTRACE_MSG_SEND_FRAME\n");
+		return recv_trace_frame(w, c, msg->len);
 	case UFTRACE_MSG_SEND_END:
 		pr_dbg2("receive UFTRACE_MSG_SEND_END\n");
-		recv_trace_end(sock, efd);
-		execute_run_cmd(opts->run_cmd);
-		break;
+		recv_trace_end(w, c);
+		execute_run_cmd(w->opts->run_cmd);
+		return false;
 	default:
-		pr_dbg("unknown message: %d\n", msg.type);
+		pr_dbg("unknown message: %d\n", msg->type);
 		break;
 	}
+	return true;
+}
+
+static bool recv_trace_frame(struct recv_worker *w, struct client_data *c,
+			     int len)
+{
+	struct uftrace_msg_frame frame;
+	void *data;
+	unsigned i;
+
+	/* frames cannot be nested */
+	if (c->frame)
+		pr_err_ns("invalid message in a frame\n");
+
+	if (read_all(c->sock, &frame, sizeof(frame)) < 0)
+		pr_err("recv frame header failed");
+
+	frame.size    = ntohl(frame.size);
+	frame.csum    = ntohl(frame.csum);
+	frame.flags   = ntohl(frame.flags);
+	frame.nr_msgs = ntohl(frame.nr_msgs);
+
+	len -= sizeof(frame);
+	if (len < 0)
+		pr_err_ns("invalid frame size: %d\n", len);
+
+	if (w->frame_size < (size_t)len) {
+		w->frame_size = len;
+		w->frame_buf = xrealloc(w->frame_buf, len);
+	}
+
+	if (read_all(c->sock, w->frame_buf, len) < 0)
+		pr_err("recv frame failed");
+
+	c->stats.frames++;
+	c->stats.frame_bytes += sizeof(struct uftrace_msg) + sizeof(frame) + len;
+
+	if (frame_checksum(w->frame_buf, len) != frame.csum)
+		pr_err_ns("frame checksum mismatch from %s\n", c->host);
+
+	data = w->frame_buf;
+
+	if (frame.flags & UFTRACE_MSG_FRAME_ZLIB) {
+#ifdef HAVE_LIBZ
+		uLongf size = frame.size;
+
+		if (w->zbuf_size < frame.size) {
+			w->zbuf_size = frame.size;
+			w->zbuf = xrealloc(w->zbuf, frame.size);
+		}
+
+		if (uncompress(w->zbuf, &size, data, len) != Z_OK ||
+		    size != frame.size)
+			pr_err_ns("cannot decompress frame from %s\n", c->host);
+
+		data = w->zbuf;
+		len  = size;
+#else
+		pr_err_ns("compressed frame is not supported: zlib not found\n");
+#endif
+	}
+
+	c->frame     = data;
+	c->frame_len = len;
+
+	for (i = 0; i < frame.nr_msgs; i++) {
+		struct uftrace_msg msg;
+
+		if (recv_client_data(c, &msg, sizeof(msg)) < 0)
+			pr_err_ns("invalid message in a frame\n");
+
+		/* the client data is freed when it's finished */
+		if (!handle_message(w, c, &msg))
+			return false;
+	}
+
+	c->frame = NULL;
+	return true;
+}
+
+static void handle_client_sock(struct recv_worker *w, struct epoll_event *ev)
+{
+	struct client_data *c = ev->data.ptr;
+	struct uftrace_msg msg;
+	uint64_t start;
+	ssize_t n;
+
+	/* the last message might come with the hang-up */
+	if (!(ev->events & EPOLLIN)) {
+		pr_dbg("client socket closed\n");
+		recv_trace_end(w, c);
+		return;
+	}
+
+	start = recv_time();
+	check_backpressure(c);
+
+	n = recv(c->sock, &msg, sizeof(msg), MSG_WAITALL);
+	if (n == 0 || (n < 0 && errno == ECONNRESET)) {
+		pr_dbg("client socket closed\n");
+		recv_trace_end(w, c);
+		return;
+	}
+	if (n != sizeof(msg))
+		pr_err("message recv failed");
+
+	handle_message(w, c, &msg);
+
+	w->stats.busy_time += recv_time() - start;
+}
+
+static void *recv_worker_thread(void *arg)
+{
+	struct recv_worker *w = arg;
+
+	while (true) {
+		struct epoll_event ev[10];
+		int i, len;
+
+		len = epoll_wait(w->efd, ev, 10, -1);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			pr_err("epoll wait failed");
+		}
+
+		for (i = 0; i < len; i++) {
+			/* done_fd has no data */
+			if (ev[i].data.ptr == NULL)
+				return NULL;
+
+			handle_client_sock(w, &ev[i]);
+		}
+	}
+	return NULL;
+}
+
+static void setup_recv_worker(struct recv_worker *w, int idx,
+			      struct opts *opts)
+{
+	w->idx  = idx;
+	w->opts = opts;
+	w->buf  = xmalloc(RECV_BUFSIZE);
+	w->start = recv_time();
+
+	w->efd = epoll_create1(EPOLL_CLOEXEC);
+	if (w->efd < 0)
+		pr_err("epoll create failed");
+
+	epoll_add(w->efd, done_fd, EPOLLIN, NULL);
+
+	w->use_splice = pipe2(w->pipe, O_CLOEXEC) == 0;
+	if (w->use_splice)
+		fcntl(w->pipe[1], F_SETPIPE_SZ, RECV_PIPESIZE);
+
+	if (pthread_create(&w->thread, NULL, recv_worker_thread, w))
+		pr_err("creating recv thread failed");
+}
+
+static void finish_recv_worker(struct recv_worker *w, struct recv_stats *total)
+{
+	uint64_t elapsed;
+	char name[32];
+
+	pthread_join(w->thread, NULL);
+
+	elapsed = recv_time() - w->start;
+	snprintf(name, sizeof(name), "recv thread %d", w->idx);
+
+	print_stats(name, &w->stats);
+	pr_dbg("%s: busy %.2f%% of %.3f sec\n", name,
+	       elapsed ? 100.0 * w->stats.busy_time / elapsed : 0.0,
+	       elapsed / 1e9);
+
+	add_stats(total, &w->stats);
+
+	if (w->use_splice) {
+		close(w->pipe[0]);
+		close(w->pipe[1]);
+	}
+	close(w->efd);
+	free(w->buf);
+	free(w->frame_buf);
+	free(w->zbuf);
+}
+
+static void handle_server_sock(int sock, struct recv_worker *workers,
+			       int nr_workers)
+{
+	int client;
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	socklen_t optlen = sizeof(int);
+	struct client_data *c;
+	struct recv_worker *w;
+	int i;
+
+	client = accept4(sock, &addr, &len, SOCK_CLOEXEC);
+	if (client < 0)
+		pr_err("socket accept failed");
+
+	c = xzalloc(sizeof(*c));
+	c->sock  = client;
+	c->files = RB_ROOT;
+
+	getnameinfo((struct sockaddr *)&addr, len, c->host, sizeof(c->host),
+		    NULL, 0, NI_NUMERICHOST);
+
+	if (getsockopt(client, SOL_SOCKET, SO_RCVBUF, &c->rcvbuf, &optlen) < 0)
+		c->rcvbuf = 0;
+
+	/* distribute connections to the least loaded thread */
+	w = &workers[0];
+	for (i = 1; i < nr_workers; i++) {
+		if (w->nr_clients > workers[i].nr_clients)
+			w = &workers[i];
+	}
+
+	__sync_add_and_fetch(&w->nr_clients, 1);
+
+	epoll_add(w->efd, client, EPOLLIN, c);
+	pr_dbg("new connection added from %s (thread %d)\n", c->host, w->idx);
 }
 
 int command_recv(int argc, char *argv[], struct opts *opts)
 {
 	struct signalfd_siginfo si;
+	struct recv_worker *workers;
+	struct recv_stats total = {};
+	int nr_workers = opts->nr_thread;
+	uint64_t one = 1;
 	int sock;
 	int sigfd;
 	int efd;
+	int i;
 
 	if (strcmp(opts->dirname, UFTRACE_DIR_NAME)) {
 		char *dirname = "current";
@@ -624,32 +1348,55 @@ int command_recv(int argc, char *argv[], struct opts *opts)
 	if (efd < 0)
 		pr_err("epoll create failed");
 
-	epoll_add(efd, sock,  EPOLLIN);
-	epoll_add(efd, sigfd, EPOLLIN);
+	epoll_add(efd, sock,  EPOLLIN, &sock);
+	epoll_add(efd, sigfd, EPOLLIN, &sigfd);
+
+	/* it wakes up all the threads when it's done */
+	done_fd = eventfd(0, EFD_CLOEXEC);
+	if (done_fd < 0)
+		pr_err("eventfd failed");
+
+	if (nr_workers <= 0)
+		nr_workers = DIV_ROUND_UP(sysconf(_SC_NPROCESSORS_ONLN), 4);
+
+	pr_dbg("creating %d thread(s) for receiving\n", nr_workers);
+	workers = xcalloc(nr_workers, sizeof(*workers));
+	for (i = 0; i < nr_workers; i++)
+		setup_recv_worker(&workers[i], i, opts);
 
 	while (!uftrace_done) {
 		struct epoll_event ev[10];
-		int i, len;
+		int len;
 
 		len = epoll_wait(efd, ev, 10, -1);
-		if (len < 0)
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
 			pr_err("epoll wait failed");
+		}
 
 		for (i = 0; i < len; i++) {
-			if (ev[i].data.fd == sigfd) {
+			if (ev[i].data.ptr == &sigfd) {
 				int nr = read(sigfd, &si, sizeof si);
 				if (nr > 0 && si.ssi_signo == SIGCHLD)
 					waitpid(-1, NULL, WNOHANG);
 				else
 					uftrace_done = true;
 			}
-			else if (ev[i].data.fd == sock)
-				handle_server_sock(&ev[i], efd);
 			else
-				handle_client_sock(&ev[i], efd, opts);
+				handle_server_sock(sock, workers, nr_workers);
 		}
 	}
 
+	if (write(done_fd, &one, sizeof(one)) != sizeof(one))
+		pr_warn("cannot wake up recv threads\n");
+
+	for (i = 0; i < nr_workers; i++)
+		finish_recv_worker(&workers[i], &total);
+	print_stats("total", &total);
+
+	free(workers);
+	close(done_fd);
 	close(efd);
 	close(sigfd);
 	close(sock);
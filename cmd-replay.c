@@ -1,5 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/uio.h>
 #include <signal.h>
 #include <inttypes.h>
 #include <stdio_ext.h>
@@ -40,7 +43,10 @@ static void print_duration(struct field_data *fd)
 static void print_tid(struct field_data *fd)
 {
 	struct ftrace_task_handle *task = fd->task;
-	pr_out("[%6d]", task->tid);
+
+	pr_out_str("[");
+	pr_out_num(task->tid, 6, ' ');
+	pr_out_str("]");
 }
 
 static void print_addr(struct field_data *fd)
@@ -63,7 +69,9 @@ static void print_timestamp(struct field_data *fd)
 	uint64_t  sec = task->timestamp / NSEC_PER_SEC;
 	uint64_t nsec = task->timestamp % NSEC_PER_SEC;
 
-	pr_out("%8"PRIu64".%09"PRIu64, sec, nsec);
+	pr_out_num(sec, 8, ' ');
+	pr_out_str(".");
+	pr_out_num(nsec, 9, '0');
 }
 
 static void print_timedelta(struct field_data *fd)
@@ -225,7 +233,7 @@ static void print_field(struct ftrace_task_handle *task,
 	};
 
 	if (print_field_data(&output_fields, &fd, 1))
-		pr_out(" | ");
+		pr_out_str(" | ");
 }
 
 static void setup_default_field(struct list_head *fields, struct opts *opts)
@@ -251,16 +259,17 @@ static int task_column_depth(struct ftrace_task_handle *task, struct opts *opts)
 	return task->column_index * opts->column_offset;
 }
 
-static void print_backtrace(struct ftrace_task_handle *task)
+static void print_backtrace(struct ftrace_task_handle *task,
+			    struct fstack *func_stack, int nr_stack)
 {
 	struct uftrace_session_link *sessions = &task->h->sessions;
 	int i;
 
-	for (i = 0; i < task->stack_count - 1; i++) {
+	for (i = 0; i < nr_stack; i++) {
 		struct display_field *field;
 		struct sym *sym;
 		char *name;
-		struct fstack *fstack = &task->func_stack[i];
+		struct fstack *fstack = &func_stack[i];
 		struct field_data fd = {
 			.task = task,
 			.fstack = fstack,
@@ -294,8 +303,16 @@ static void print_event(struct ftrace_task_handle *task,
 	char *evt_name = get_event_name(task->h, evt_id);
 
 	if (evt_id >= EVENT_ID_USER) {
-		/* TODO: some events might have arguments */
+		char *args = NULL;
+
+		if (urec->more)
+			args = get_event_args(task->h, evt_id, task->args.data,
+					      task->args.len);
+
 		pr_color(color, "%s", evt_name);
+		if (args)
+			pr_color(color, " (%s)", args);
+		free(args);
 	}
 	else if (evt_id >= EVENT_ID_PERF) {
 		pr_color(color, "%s", evt_name);
@@ -425,17 +442,6 @@ static int print_flat_rstack(struct ftrace_file_handle *handle,
 	return 0;
 }
 
-static void print_task_newline(int current_tid)
-{
-	if (prev_tid != -1 && current_tid != prev_tid) {
-		if (print_empty_field(&output_fields, 1))
-			pr_out(" | ");
-		pr_out("\n");
-	}
-
-	prev_tid = current_tid;
-}
-
 void get_argspec_string(struct ftrace_task_handle *task,
 		        char *args, size_t len,
 		        enum argspec_string_bits str_mode)
@@ -626,7 +632,8 @@ void get_argspec_string(struct ftrace_task_handle *task,
 						 (uint64_t)val.i);
 
 			if (sym)
-				n += snprintf(args + n, len, "&%s", sym->name);
+				n += snprintf(args + n, len, "&%s",
+					      symbol_getname(sym, sym->addr));
 			else
 				n += snprintf(args + n, len, "%p", val.p);
 		}
@@ -672,40 +679,105 @@ void get_argspec_string(struct ftrace_task_handle *task,
 	}
 }
 
-static int print_graph_rstack(struct ftrace_file_handle *handle,
-			      struct ftrace_task_handle *task,
-			      struct opts *opts)
+enum replay_line_type {
+	REPLAY_LINE_NEWLINE,
+	REPLAY_LINE_BACKTRACE,
+	REPLAY_LINE_ENTRY,
+	REPLAY_LINE_LEAF,
+	REPLAY_LINE_EXIT,
+	REPLAY_LINE_LOST,
+	REPLAY_LINE_EVENT,
+	REPLAY_LINE_WARNING,
+};
+
+/*
+ * An output line of the replay.  The function stack of tasks should be
+ * updated in order but the symbol lookup and formatting of the line
+ * can be done later (and in parallel) using the saved info here.
+ */
+struct replay_line {
+	enum replay_line_type		type;
+	int				depth;
+	bool				has_color;
+	int				color;
+	struct ftrace_task_handle	*task;
+	struct fstack			*fstack;
+	void				*field_arg;
+	/* entry (or exit) record and exit record of leaf functions */
+	struct uftrace_record		rec;
+	struct uftrace_record		exit;
+	struct fstack_arguments		args;
+	struct fstack_arguments		retval;
+	/* saved function stack for backtrace */
+	struct fstack			*backtrace;
+	int				nr_backtrace;
+};
+
+static void emit_replay_line(struct replay_line *line, struct opts *opts);
+
+/*
+ * argument data in the task will be overwritten when it reads next
+ * records for fstack_skip(), save it until the line is emitted.
+ */
+static void save_line_args(struct fstack_arguments *dst,
+			   struct fstack_arguments *src)
+{
+	static void *buf;
+	static unsigned buflen;
+
+	*dst = *src;
+	if (src->len == 0)
+		return;
+
+	if (buflen < src->len) {
+		buflen = src->len;
+		buf = xrealloc(buf, buflen);
+	}
+	memcpy(buf, src->data, src->len);
+	dst->data = buf;
+}
+
+static void get_line_argspec(struct replay_line *line,
+			     struct uftrace_record *rec,
+			     struct fstack_arguments *args,
+			     char *buf, size_t len,
+			     enum argspec_string_bits str_mode)
 {
+	struct ftrace_task_handle *task = line->task;
 	struct uftrace_record *rstack = task->rstack;
-	struct uftrace_session_link *sessions = &handle->sessions;
-	struct sym *sym = NULL;
-	enum argspec_string_bits str_mode = 0;
-	char *symname = NULL;
-	char args[1024];
-	char *libname = "";
-	struct uftrace_mmap *map = NULL;
+	struct fstack_arguments task_args = task->args;
 
-	if (task == NULL)
-		return 0;
+	/* get_argspec_string() reads the data from the task */
+	task->rstack = rec;
+	task->args = *args;
 
-	if (rstack->type == UFTRACE_LOST)
-		goto lost;
+	get_argspec_string(task, buf, len, str_mode);
 
-	sym = task_find_sym(sessions, task, rstack);
-	symname = symbol_getname(sym, rstack->addr);
+	task->rstack = rstack;
+	task->args = task_args;
+}
 
-	if (rstack->type == UFTRACE_ENTRY) {
-		if(symname[strlen(symname) - 1] != ')' || rstack->more)
-			str_mode |= NEEDS_PAREN;
-	}
+static void print_func_line(struct replay_line *line, struct opts *opts)
+{
+	struct ftrace_task_handle *task = line->task;
+	struct uftrace_session_link *sessions = &task->h->sessions;
+	struct uftrace_record *rec = &line->rec;
+	enum argspec_string_bits str_mode = 0;
+	struct sym *sym;
+	char *symname;
+	char args[1024];
+	char retval[1024];
+	char *libname = "";
+	struct uftrace_mmap *map = NULL;
+	int depth = line->depth;
 
-	task->timestamp_last = task->timestamp;
-	task->timestamp = rstack->time;
+	sym = task_find_sym(sessions, task, rec);
+	symname = symbol_getname(sym, rec->addr);
 
 	if (opts->libname && sym && sym->type == ST_PLT) {
 		struct uftrace_session *s;
 
-		s = find_task_session(sessions, task->tid, rstack->time);
+		s = find_task_session(sessions, task->tid, rec->time);
 		if (s) {
 			map = find_symbol_map(&s->symtabs, symname);
 			if (map && map != MAP_MAIN)
@@ -713,11 +785,174 @@ static int print_graph_rstack(struct ftrace_file_handle *handle,
 		}
 	}
 
+	if (line->type == REPLAY_LINE_EXIT) {
+		str_mode = IS_RETVAL;
+		if (rec->more) {
+			str_mode |= HAS_MORE;
+			str_mode |= NEEDS_ASSIGNMENT;
+			str_mode |= NEEDS_SEMI_COLON;
+		}
+		get_line_argspec(line, rec, &line->retval,
+				 retval, sizeof(retval), str_mode);
+
+		print_field(task, line->fstack, NULL);
+		pr_out_space(depth * 2);
+		pr_out_str("}");
+		pr_out_str(retval);
+
+		pr_color_start(COLOR_CODE_GRAY);
+		if (opts->comment) {
+			pr_out_str(" /* ");
+			pr_out_str(symname);
+			if (*libname) {
+				pr_out_str("@");
+				pr_out_str(libname);
+			}
+			pr_out_str(" */");
+		}
+		pr_out_str("\n");
+		pr_color_end();
+		goto out;
+	}
+
+	if (symname[strlen(symname) - 1] != ')' || rec->more)
+		str_mode |= NEEDS_PAREN;
+	if (rec->more)
+		str_mode |= HAS_MORE;
+	get_line_argspec(line, rec, &line->args, args, sizeof(args), str_mode);
+
+	if (line->type == REPLAY_LINE_LEAF) {
+		str_mode = IS_RETVAL | NEEDS_SEMI_COLON;
+		if (line->exit.more) {
+			str_mode |= HAS_MORE;
+			str_mode |= NEEDS_ASSIGNMENT;
+		}
+		get_line_argspec(line, &line->exit, &line->retval,
+				 retval, sizeof(retval), str_mode);
+	}
+	else {
+		/* function entry */
+		strcpy(retval, " {");
+	}
+
+	print_field(task, line->fstack, line->field_arg);
+	pr_out_space(depth * 2);
+	if (line->has_color) {
+		pr_color(line->color, "%s", symname);
+		if (*libname)
+			pr_color(line->color, "@%s", libname);
+	}
+	else {
+		pr_out_str(symname);
+		if (*libname) {
+			pr_out_str("@");
+			pr_out_str(libname);
+		}
+	}
+	pr_out_str(args);
+	pr_out_str(retval);
+	pr_out_str("\n");
+
+out:
+	symbol_putname(sym, symname);
+}
+
+static void print_replay_line(struct replay_line *line, struct opts *opts)
+{
+	struct ftrace_task_handle *task = line->task;
+	struct fstack_arguments task_args;
+	int depth = line->depth;
+	int losts;
+
+	switch (line->type) {
+	case REPLAY_LINE_NEWLINE:
+		if (print_empty_field(&output_fields, 1))
+			pr_out(" | ");
+		pr_out("\n");
+		break;
+
+	case REPLAY_LINE_BACKTRACE:
+		print_backtrace(task, line->backtrace, line->nr_backtrace);
+		break;
+
+	case REPLAY_LINE_ENTRY:
+	case REPLAY_LINE_LEAF:
+	case REPLAY_LINE_EXIT:
+		print_func_line(line, opts);
+		break;
+
+	case REPLAY_LINE_LOST:
+		losts = (int)line->rec.addr;
+
+		print_field(task, NULL, NO_TIME);
+
+		if (losts > 0)
+			pr_red("%*s/* LOST %d records!! */\n",
+			       depth * 2, "", losts);
+		else /* kernel sometimes have unknown count */
+			pr_red("%*s/* LOST some records!! */\n",
+			       depth * 2, "");
+		break;
+
+	case REPLAY_LINE_EVENT:
+		print_field(task, line->fstack, line->field_arg);
+
+		/* print_event() reads the data from the task */
+		task_args = task->args;
+		task->args = line->args;
+
+		pr_color(task->event_color, "%*s/* ", depth * 2, "");
+		print_event(task, &line->rec, task->event_color);
+		pr_color(task->event_color, " */\n");
+
+		task->args = task_args;
+		break;
+
+	case REPLAY_LINE_WARNING:
+		if (print_empty_field(&output_fields, 1))
+			pr_out(" | ");
+		pr_red(" %*s/* inverted time: broken data? */\n",
+		       depth * 2, "");
+		break;
+	}
+}
+
+static void print_task_newline(struct ftrace_task_handle *task,
+			       struct opts *opts)
+{
+	struct replay_line line = {
+		.type = REPLAY_LINE_NEWLINE,
+		.task = task,
+	};
+
+	if (prev_tid != -1 && task->tid != prev_tid)
+		emit_replay_line(&line, opts);
+
+	prev_tid = task->tid;
+}
+
+static int print_graph_rstack(struct ftrace_file_handle *handle,
+			      struct ftrace_task_handle *task,
+			      struct opts *opts)
+{
+	struct uftrace_record *rstack = task->rstack;
+	struct replay_line line = {
+		.task = task,
+		.rec = *rstack,
+	};
+
+	if (task == NULL)
+		return 0;
+
+	if (rstack->type == UFTRACE_LOST)
+		goto lost;
+
+	task->timestamp_last = task->timestamp;
+	task->timestamp = rstack->time;
+
 	if (rstack->type == UFTRACE_ENTRY) {
 		struct ftrace_task_handle *next = NULL;
-		struct fstack *fstack;
 		int rstack_depth = rstack->depth;
-		int depth;
 		struct uftrace_trigger tr = {
 			.flags = 0,
 		};
@@ -725,30 +960,40 @@ static int print_graph_rstack(struct ftrace_file_handle *handle,
 
 		ret = fstack_entry(task, rstack, &tr);
 		if (ret < 0)
-			goto out;
+			return 0;
 
 		/* display depth is set in fstack_entry() */
-		depth = task->display_depth;
+		line.depth = task->display_depth;
 
 		/* give a new line when tid is changed */
 		if (opts->task_newline)
-			print_task_newline(task->tid);
+			print_task_newline(task, opts);
 
-		if (tr.flags & TRIGGER_FL_BACKTRACE)
-			print_backtrace(task);
+		if (tr.flags & TRIGGER_FL_BACKTRACE) {
+			struct replay_line bt = {
+				.type = REPLAY_LINE_BACKTRACE,
+				.task = task,
+				.backtrace = task->func_stack,
+				.nr_backtrace = task->stack_count - 1,
+			};
 
-		if (tr.flags & TRIGGER_FL_COLOR)
+			emit_replay_line(&bt, opts);
+		}
+
+		if (tr.flags & TRIGGER_FL_COLOR) {
 			task->event_color = tr.color;
+			line.has_color = true;
+			line.color = tr.color;
+		}
 		else
 			task->event_color = DEFAULT_EVENT_COLOR;
 
-		depth += task_column_depth(task, opts);
+		line.depth += task_column_depth(task, opts);
 
 		if (rstack->more)
-			str_mode |= HAS_MORE;
-		get_argspec_string(task, args, sizeof(args), str_mode);
+			save_line_args(&line.args, &task->args);
 
-		fstack = &task->func_stack[task->stack_count - 1];
+		line.fstack = &task->func_stack[task->stack_count - 1];
 
 		if (!opts->no_merge)
 			next = fstack_skip(handle, task, rstack_depth,
@@ -757,31 +1002,13 @@ static int print_graph_rstack(struct ftrace_file_handle *handle,
 		if (task == next &&
 		    next->rstack->depth == rstack_depth &&
 		    next->rstack->type == UFTRACE_EXIT) {
-			char retval[1024];
-
 			/* leaf function - also consume return record */
 			fstack_consume(handle, next);
 
-			str_mode = IS_RETVAL | NEEDS_SEMI_COLON;
-			if (next->rstack->more) {
-				str_mode |= HAS_MORE;
-				str_mode |= NEEDS_ASSIGNMENT;
-			}
-			get_argspec_string(task, retval, sizeof(retval), str_mode);
-
-			print_field(task, fstack, NULL);
-			pr_out("%*s", depth * 2, "");
-			if (tr.flags & TRIGGER_FL_COLOR) {
-				pr_color(tr.color, "%s", symname);
-				if (*libname)
-					pr_color(tr.color, "@%s", libname);
-				pr_out("%s%s\n", args, retval);
-			}
-			else {
-				pr_out("%s%s%s%s%s\n", symname,
-				       *libname ? "@" : "",
-				       libname, args, retval);
-			}
+			line.type = REPLAY_LINE_LEAF;
+			line.exit = *next->rstack;
+			line.retval = task->args;
+			emit_replay_line(&line, opts);
 
 			/* fstack_update() is not needed here */
 
@@ -789,20 +1016,11 @@ static int print_graph_rstack(struct ftrace_file_handle *handle,
 		}
 		else {
 			/* function entry */
-			print_field(task, fstack, NO_TIME);
-			pr_out("%*s", depth * 2, "");
-			if (tr.flags & TRIGGER_FL_COLOR) {
-				pr_color(tr.color, "%s", symname);
-				if (*libname)
-					pr_color(tr.color, "@%s", libname);
-				pr_out("%s {\n", args);
-			}
-			else {
-				pr_out("%s%s%s%s {\n", symname,
-				       *libname ? "@" : "", libname, args);
-			}
+			line.type = REPLAY_LINE_ENTRY;
+			line.field_arg = NO_TIME;
+			emit_replay_line(&line, opts);
 
-			fstack_update(UFTRACE_ENTRY, task, fstack);
+			fstack_update(UFTRACE_ENTRY, task, line.fstack);
 		}
 	}
 	else if (rstack->type == UFTRACE_EXIT) {
@@ -812,39 +1030,24 @@ static int print_graph_rstack(struct ftrace_file_handle *handle,
 		fstack = &task->func_stack[task->stack_count];
 
 		if (!(fstack->flags & FSTACK_FL_NORECORD) && fstack_enabled) {
-			int depth = fstack_update(UFTRACE_EXIT, task, fstack);
-			char *retval = args;
-
-			depth += task_column_depth(task, opts);
-
-			str_mode = IS_RETVAL;
-			if (rstack->more) {
-				str_mode |= HAS_MORE;
-				str_mode |= NEEDS_ASSIGNMENT;
-				str_mode |= NEEDS_SEMI_COLON;
-			}
-			get_argspec_string(task, retval, sizeof(args), str_mode);
+			line.depth = fstack_update(UFTRACE_EXIT, task, fstack);
+			line.depth += task_column_depth(task, opts);
 
 			/* give a new line when tid is changed */
 			if (opts->task_newline)
-				print_task_newline(task->tid);
+				print_task_newline(task, opts);
 
-			print_field(task, fstack, NULL);
-			pr_out("%*s}%s", depth * 2, "", retval);
-			if (opts->comment)
-				pr_gray(" /* %s%s%s */\n", symname,
-					*libname ? "@" : "", libname);
-			else
-				pr_gray("\n");
+			line.type = REPLAY_LINE_EXIT;
+			line.fstack = fstack;
+			line.retval = task->args;
+			emit_replay_line(&line, opts);
 		}
 
 		fstack_exit(task);
 	}
 	else if (rstack->type == UFTRACE_LOST) {
-		int depth, losts;
 lost:
-		depth = task->display_depth + 1;
-		losts = (int)rstack->addr;
+		line.depth = task->display_depth + 1;
 
 		/* skip kernel lost messages outside of user functions */
 		if (opts->kernel_skip_out && task->user_stack_count == 0)
@@ -852,25 +1055,17 @@ lost:
 
 		/* give a new line when tid is changed */
 		if (opts->task_newline)
-			print_task_newline(task->tid);
-
-		print_field(task, NULL, NO_TIME);
+			print_task_newline(task, opts);
 
-		if (losts > 0)
-			pr_red("%*s/* LOST %d records!! */\n",
-			       depth * 2, "", losts);
-		else /* kernel sometimes have unknown count */
-			pr_red("%*s/* LOST some records!! */\n",
-			       depth * 2, "");
+		line.type = REPLAY_LINE_LOST;
+		emit_replay_line(&line, opts);
 	}
 	else if (rstack->type == UFTRACE_EVENT) {
-		int depth;
 		struct fstack *fstack;
 		struct ftrace_task_handle *next = NULL;
-		struct uftrace_record rec = *rstack;
 		uint64_t evt_id = rstack->addr;
 
-		depth = task->display_depth;
+		line.depth = task->display_depth;
 
 		/* skip kernel event messages outside of user functions */
 		if (opts->kernel_skip_out && task->user_stack_count == 0 &&
@@ -879,9 +1074,9 @@ lost:
 
 		/* give a new line when tid is changed */
 		if (opts->task_newline)
-			print_task_newline(task->tid);
+			print_task_newline(task, opts);
 
-		depth += task_column_depth(task, opts);
+		line.depth += task_column_depth(task, opts);
 
 		/*
 		 * try to merge a subsequent sched-in event:
@@ -895,7 +1090,7 @@ lost:
 			/* consume the matching sched-in record */
 			fstack_consume(handle, next);
 
-			rec.addr = EVENT_ID_PERF_SCHED_BOTH;
+			line.rec.addr = EVENT_ID_PERF_SCHED_BOTH;
 			evt_id = EVENT_ID_PERF_SCHED_IN;
 		}
 
@@ -904,25 +1099,361 @@ lost:
 
 		if (evt_id == EVENT_ID_PERF_SCHED_IN &&
 		    fstack->total_time)
-			print_field(task, fstack, NULL);
+			line.fstack = fstack;
 		else
-			print_field(task, NULL, NO_TIME);
+			line.field_arg = NO_TIME;
 
-		pr_color(task->event_color, "%*s/* ", depth * 2, "");
-		print_event(task, &rec, task->event_color);
-		pr_color(task->event_color, " */\n");
+		line.type = REPLAY_LINE_EVENT;
+		line.args = task->args;
+		emit_replay_line(&line, opts);
 	}
-out:
-	symbol_putname(sym, symname);
 	return 0;
 }
 
-static void print_warning(struct ftrace_task_handle *task)
+static void print_warning(struct ftrace_task_handle *task,
+			  struct opts *opts)
+{
+	struct replay_line line = {
+		.type = REPLAY_LINE_WARNING,
+		.task = task,
+		.depth = task->display_depth + 1,
+	};
+
+	emit_replay_line(&line, opts);
+}
+
+/*
+ * replay pipeline (with --num-thread): the main thread reads records and
+ * updates the function stacks in order and saves the output lines into
+ * batches.  Worker threads format the batches in parallel and a writer
+ * thread writes the result in the original order.
+ */
+#define REPLAY_BATCH_LINES  512
+
+struct replay_batch_line {
+	struct replay_line		line;
+	/* snapshot of the task at the time */
+	struct ftrace_task_handle	task;
+	struct uftrace_task		utask;
+	struct fstack			fstack;
+};
+
+struct replay_batch {
+	/* in the work or free list */
+	struct list_head		list;
+	/* in the write list */
+	struct list_head		order;
+	struct replay_batch_line	*lines;
+	int				nr_lines;
+	bool				done;
+	/* argument data and backtrace of the lines */
+	struct arena			arena;
+	/* formatted output */
+	char				*buf;
+	size_t				len;
+};
+
+static struct replay_pipeline {
+	struct opts			*opts;
+	pthread_mutex_t			lock;
+	pthread_cond_t			work_cond;
+	pthread_cond_t			done_cond;
+	pthread_cond_t			free_cond;
+	/* batches to format (by workers) and to write (in order) */
+	struct list_head		work_list;
+	struct list_head		write_list;
+	struct list_head		free_list;
+	struct replay_batch		*curr;
+	struct replay_batch		*batches;
+	int				nr_batches;
+	bool				finished;
+	int				nr_workers;
+	pthread_t			*workers;
+	pthread_t			writer;
+} replay_pipeline = {
+	.lock		= PTHREAD_MUTEX_INITIALIZER,
+	.work_cond	= PTHREAD_COND_INITIALIZER,
+	.done_cond	= PTHREAD_COND_INITIALIZER,
+	.free_cond	= PTHREAD_COND_INITIALIZER,
+	.work_list	= LIST_HEAD_INIT(replay_pipeline.work_list),
+	.write_list	= LIST_HEAD_INIT(replay_pipeline.write_list),
+	.free_list	= LIST_HEAD_INIT(replay_pipeline.free_list),
+};
+
+static void copy_line_args(struct replay_batch *batch,
+			   struct fstack_arguments *args)
+{
+	void *data;
+
+	if (args->len == 0)
+		return;
+
+	data = arena_alloc(&batch->arena, args->len);
+	memcpy(data, args->data, args->len);
+	args->data = data;
+}
+
+static void format_batch(struct replay_batch *batch, struct opts *opts)
+{
+	int i;
+
+	for (i = 0; i < batch->nr_lines; i++)
+		print_replay_line(&batch->lines[i].line, opts);
+
+	batch->buf = take_output_buffer(&batch->len);
+}
+
+static void *replay_worker_main(void *arg)
+{
+	struct replay_pipeline *rp = arg;
+	struct replay_batch *batch;
+
+	/* the symbol cache in sessions is not thread-safe */
+	session_setup_thread_cache();
+	/* keep the output in memory */
+	setup_output_buffer(NULL);
+
+	pthread_mutex_lock(&rp->lock);
+	while (true) {
+		while (list_empty(&rp->work_list) && !rp->finished)
+			pthread_cond_wait(&rp->work_cond, &rp->lock);
+
+		if (list_empty(&rp->work_list))
+			break;
+
+		batch = list_first_entry(&rp->work_list, struct replay_batch,
+					 list);
+		list_del_init(&batch->list);
+		pthread_mutex_unlock(&rp->lock);
+
+		format_batch(batch, rp->opts);
+
+		pthread_mutex_lock(&rp->lock);
+		batch->done = true;
+		pthread_cond_broadcast(&rp->done_cond);
+	}
+	pthread_mutex_unlock(&rp->lock);
+
+	finish_output_buffer();
+	session_finish_thread_cache();
+	return NULL;
+}
+
+static void *replay_writer_main(void *arg)
+{
+	struct replay_pipeline *rp = arg;
+	struct replay_batch *batch, *tmp;
+	struct iovec *iov;
+	LIST_HEAD(write_list);
+	int nr_iov;
+
+	iov = xcalloc(rp->nr_batches, sizeof(*iov));
+
+	pthread_mutex_lock(&rp->lock);
+	while (true) {
+		/* write batches in the order of submission */
+		while (true) {
+			batch = list_first_entry_or_null(&rp->write_list,
+							 struct replay_batch,
+							 order);
+			if (batch && batch->done)
+				break;
+			if (batch == NULL && rp->finished)
+				break;
+
+			pthread_cond_wait(&rp->done_cond, &rp->lock);
+		}
+
+		if (batch == NULL)
+			break;
+
+		/* write all the finished batches at once */
+		nr_iov = 0;
+		list_for_each_entry_safe(batch, tmp, &rp->write_list, order) {
+			if (!batch->done)
+				break;
+
+			list_move_tail(&batch->order, &write_list);
+			iov[nr_iov].iov_base = batch->buf;
+			iov[nr_iov].iov_len  = batch->len;
+			nr_iov++;
+		}
+		pthread_mutex_unlock(&rp->lock);
+
+		if (writev_all(fileno(outfp), iov, nr_iov) < 0)
+			pr_dbg("writing output failed: %m\n");
+
+		list_for_each_entry(batch, &write_list, order) {
+			free(batch->buf);
+			batch->buf = NULL;
+			batch->len = 0;
+			batch->nr_lines = 0;
+			batch->done = false;
+			arena_free(&batch->arena);
+		}
+
+		pthread_mutex_lock(&rp->lock);
+		list_for_each_entry_safe(batch, tmp, &write_list, order) {
+			list_del_init(&batch->order);
+			list_add_tail(&batch->list, &rp->free_list);
+		}
+		pthread_cond_signal(&rp->free_cond);
+	}
+	pthread_mutex_unlock(&rp->lock);
+
+	free(iov);
+	return NULL;
+}
+
+static void submit_batch(struct replay_pipeline *rp)
+{
+	struct replay_batch *batch = rp->curr;
+
+	if (batch == NULL)
+		return;
+
+	pthread_mutex_lock(&rp->lock);
+	list_add_tail(&batch->list, &rp->work_list);
+	list_add_tail(&batch->order, &rp->write_list);
+	pthread_cond_signal(&rp->work_cond);
+	pthread_mutex_unlock(&rp->lock);
+
+	rp->curr = NULL;
+}
+
+static struct replay_batch *get_batch(struct replay_pipeline *rp)
+{
+	struct replay_batch *batch;
+
+	pthread_mutex_lock(&rp->lock);
+	while (list_empty(&rp->free_list))
+		pthread_cond_wait(&rp->free_cond, &rp->lock);
+
+	batch = list_first_entry(&rp->free_list, struct replay_batch, list);
+	list_del_init(&batch->list);
+	pthread_mutex_unlock(&rp->lock);
+
+	return batch;
+}
+
+static void add_batch_line(struct replay_pipeline *rp,
+			   struct replay_line *line)
+{
+	struct replay_batch *batch = rp->curr;
+	struct replay_batch_line *bl;
+	struct ftrace_task_handle *task = line->task;
+
+	if (batch == NULL)
+		batch = rp->curr = get_batch(rp);
+
+	bl = &batch->lines[batch->nr_lines++];
+	bl->line = *line;
+
+	/* the task will be changed by next records */
+	bl->task = *task;
+	bl->line.task = &bl->task;
+
+	if (task->t) {
+		bl->utask = *task->t;
+		bl->task.t = &bl->utask;
+	}
+
+	if (line->fstack) {
+		bl->fstack = *line->fstack;
+		bl->line.fstack = &bl->fstack;
+	}
+
+	copy_line_args(batch, &bl->line.args);
+	copy_line_args(batch, &bl->line.retval);
+
+	if (line->nr_backtrace > 0) {
+		size_t size = line->nr_backtrace * sizeof(*line->backtrace);
+
+		bl->line.backtrace = arena_alloc(&batch->arena, size);
+		memcpy(bl->line.backtrace, line->backtrace, size);
+	}
+
+	if (batch->nr_lines == REPLAY_BATCH_LINES)
+		submit_batch(rp);
+}
+
+static void emit_replay_line(struct replay_line *line, struct opts *opts)
 {
-	if (print_empty_field(&output_fields, 1))
-		pr_out(" | ");
-	pr_red(" %*s/* inverted time: broken data? */\n",
-	       (task->display_depth + 1) * 2, "");
+	if (replay_pipeline.nr_workers)
+		add_batch_line(&replay_pipeline, line);
+	else
+		print_replay_line(line, opts);
+}
+
+static void setup_replay_pipeline(struct opts *opts)
+{
+	struct replay_pipeline *rp = &replay_pipeline;
+	int nr_workers = opts->nr_thread;
+	int i;
+
+	if (nr_workers < 2 || opts->flat)
+		return;
+
+	rp->opts = opts;
+	rp->nr_workers = nr_workers;
+
+	/* the writer thread writes to the file directly */
+	flush_output_buffer();
+	fflush(outfp);
+
+	/* limit number of batches in flight */
+	rp->nr_batches = nr_workers * 2 + 2;
+	rp->batches = xcalloc(rp->nr_batches, sizeof(*rp->batches));
+
+	for (i = 0; i < rp->nr_batches; i++) {
+		struct replay_batch *batch = &rp->batches[i];
+
+		batch->lines = xcalloc(REPLAY_BATCH_LINES,
+				       sizeof(*batch->lines));
+		batch->arena = ARENA_INIT;
+		INIT_LIST_HEAD(&batch->order);
+		list_add_tail(&batch->list, &rp->free_list);
+	}
+
+	rp->workers = xcalloc(nr_workers, sizeof(*rp->workers));
+	for (i = 0; i < nr_workers; i++) {
+		if (pthread_create(&rp->workers[i], NULL,
+				   replay_worker_main, rp))
+			pr_err("cannot create replay thread");
+	}
+
+	if (pthread_create(&rp->writer, NULL, replay_writer_main, rp))
+		pr_err("cannot create replay writer thread");
+
+	pr_dbg("replay using %d threads\n", rp->nr_workers);
+}
+
+static void finish_replay_pipeline(void)
+{
+	struct replay_pipeline *rp = &replay_pipeline;
+	int i;
+
+	if (rp->nr_workers == 0)
+		return;
+
+	submit_batch(rp);
+
+	pthread_mutex_lock(&rp->lock);
+	rp->finished = true;
+	pthread_cond_broadcast(&rp->work_cond);
+	pthread_cond_broadcast(&rp->done_cond);
+	pthread_mutex_unlock(&rp->lock);
+
+	for (i = 0; i < rp->nr_workers; i++)
+		pthread_join(rp->workers[i], NULL);
+	pthread_join(rp->writer, NULL);
+
+	for (i = 0; i < rp->nr_batches; i++)
+		free(rp->batches[i].lines);
+
+	free(rp->batches);
+	free(rp->workers);
+	rp->nr_workers = 0;
 }
 
 static bool skip_sys_exit(struct opts *opts, struct ftrace_task_handle *task)
@@ -1021,6 +1552,47 @@ static void print_remaining_stack(struct opts *opts,
 	}
 }
 
+/* print a record just read, @prev_time is for sanity check (if not NULL) */
+static int replay_rstack(struct ftrace_file_handle *handle,
+			 struct ftrace_task_handle *task,
+			 struct opts *opts, uint64_t *prev_time)
+{
+	struct uftrace_record *rstack = task->rstack;
+	uint64_t curr_time = rstack->time;
+
+	/* skip user functions if --kernel-only is set */
+	if (opts->kernel_only && !is_kernel_record(task, rstack))
+		return 0;
+
+	if (opts->kernel_skip_out) {
+		/* skip kernel functions outside user functions */
+		if (!task->user_stack_count && is_kernel_record(task, rstack))
+			return 0;
+	}
+
+	if (opts->event_skip_out) {
+		/* skip event outside of user functions */
+		if (!task->user_stack_count && rstack->type == UFTRACE_EVENT)
+			return 0;
+	}
+
+	/*
+	 * data sanity check: timestamp should be ordered.
+	 * But print_graph_rstack() may change task->rstack
+	 * during fstack_skip().  So check the timestamp here.
+	 */
+	if (curr_time && prev_time) {
+		if (*prev_time > curr_time)
+			print_warning(task, opts);
+		*prev_time = rstack->time;
+	}
+
+	if (opts->flat)
+		return print_flat_rstack(handle, task, opts);
+	else
+		return print_graph_rstack(handle, task, opts);
+}
+
 int command_replay(int argc, char *argv[], struct opts *opts)
 {
 	int ret;
@@ -1029,7 +1601,9 @@ int command_replay(int argc, char *argv[], struct opts *opts)
 	struct ftrace_task_handle *task;
 
 	__fsetlocking(outfp, FSETLOCKING_BYCALLER);
-	__fsetlocking(logfp, FSETLOCKING_BYCALLER);
+	/* worker threads might print debug messages */
+	if (opts->nr_thread < 2)
+		__fsetlocking(logfp, FSETLOCKING_BYCALLER);
 
 	ret = open_data_file(opts, &handle);
 	if (ret < 0) {
@@ -1041,52 +1615,75 @@ int command_replay(int argc, char *argv[], struct opts *opts)
 	setup_field(&output_fields, opts, &setup_default_field,
 		    field_table, ARRAY_SIZE(field_table));
 
+	setup_output_buffer(outfp);
+
 	if (!opts->flat && peek_rstack(&handle, &task) == 0)
 		print_header(&output_fields, "#", 1);
 
+	setup_replay_pipeline(opts);
+
 	while (read_rstack(&handle, &task) == 0 && !uftrace_done) {
-		struct uftrace_record *rstack = task->rstack;
-		uint64_t curr_time = rstack->time;
+		ret = replay_rstack(&handle, task, opts, &prev_time);
+		if (ret)
+			break;
+	}
 
-		/* skip user functions if --kernel-only is set */
-		if (opts->kernel_only && !is_kernel_record(task, rstack))
-			continue;
+	finish_replay_pipeline();
 
-		if (opts->kernel_skip_out) {
-			/* skip kernel functions outside user functions */
-			if (!task->user_stack_count && is_kernel_record(task, rstack))
-				continue;
-		}
+	print_remaining_stack(opts, &handle);
 
-		if (opts->event_skip_out) {
-			/* skip event outside of user functions */
-			if (!task->user_stack_count && rstack->type == UFTRACE_EVENT)
-				continue;
-		}
+	finish_output_buffer();
 
-		/*
-		 * data sanity check: timestamp should be ordered.
-		 * But print_graph_rstack() may change task->rstack
-		 * during fstack_skip().  So check the timestamp here.
-		 */
-		if (curr_time) {
-			if (prev_time > curr_time)
-				print_warning(task);
-			prev_time = rstack->time;
-		}
+	close_data_file(opts, &handle);
 
-		if (opts->flat)
-			ret = print_flat_rstack(&handle, task, opts);
-		else
-			ret = print_graph_rstack(&handle, task, opts);
+	return ret;
+}
 
-		if (ret)
-			break;
-	}
+/**
+ * replay_stream - replay data while it's being recorded
+ * @opts: uftrace options
+ * @handle: handle for the data (see open_stream_data)
+ *
+ * This is for the streaming live mode.  It merges and prints records
+ * received so far whenever new data arrives.  A record is printed only
+ * if other tasks cannot have an older record that is not received yet
+ * (or they didn't send data for a while).  So records are not strictly
+ * ordered across tasks and the timestamp is not checked.
+ */
+int replay_stream(struct opts *opts, struct ftrace_file_handle *handle)
+{
+	int ret = 0;
+	bool header = opts->flat;
+	struct ftrace_task_handle *task;
 
-	print_remaining_stack(opts, &handle);
+	setup_field(&output_fields, opts, &setup_default_field,
+		    field_table, ARRAY_SIZE(field_table));
 
-	close_data_file(opts, &handle);
+	setup_output_buffer(outfp);
+
+	while (ret == 0 && live_stream_update(handle)) {
+		while (peek_rstack(handle, &task) == 0 && !uftrace_done) {
+			if (!live_stream_ready(handle, task))
+				break;
+
+			if (!header) {
+				print_header(&output_fields, "#", 1);
+				header = true;
+			}
+
+			read_rstack(handle, &task);
+
+			ret = replay_rstack(handle, task, opts, NULL);
+			if (ret)
+				break;
+		}
+
+		flush_output_buffer();
+		fflush(outfp);
+	}
+
+	print_remaining_stack(opts, handle);
 
+	finish_output_buffer();
 	return ret;
 }
@@ -1,6 +1,9 @@
 #include <stdio.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "uftrace.h"
 #include "utils/utils.h"
@@ -8,6 +11,8 @@
 #include "utils/symbol.h"
 #include "utils/list.h"
 #include "utils/fstack.h"
+#include "utils/kernel.h"
+#include "utils/histogram.h"
 
 
 enum {
@@ -27,7 +32,18 @@ struct trace_entry {
 	uint64_t time_avg;
 	uint64_t time_min;
 	uint64_t time_max;
+	/* min/max of total and self time regardless of avg_mode */
+	uint64_t total_min;
+	uint64_t total_max;
+	uint64_t self_min;
+	uint64_t self_max;
+	/* percentiles of total (or self with --avg-self) time */
+	uint64_t time_p50;
+	uint64_t time_p90;
+	uint64_t time_p99;
+	uint64_t time_p999;
 	unsigned long nr_called;
+	struct histogram hist;
 	struct trace_entry *pair;
 	struct rb_node link;
 };
@@ -47,17 +63,147 @@ static bool diff_full = false;
 /* maximum length of symbol */
 static int maxlen = 20;
 
+/* show percentile columns */
+static bool show_percentile = false;
+
+/* keep histogram of function time for percentiles */
+static bool need_histogram = false;
+
+/* add time of a single record (in @te) to the histogram of @entry */
+static void add_entry_histogram(struct trace_entry *entry,
+				struct trace_entry *te)
+{
+	if (!need_histogram || te->nr_called == 0)
+		return;
+
+	if (avg_mode == AVG_SELF)
+		histogram_add(&entry->hist, te->time_self);
+	else
+		histogram_add(&entry->hist, te->time_total);
+}
+
+static void update_percentile(struct trace_entry *entry)
+{
+	if (!need_histogram)
+		return;
+
+	entry->time_p50  = histogram_percentile(&entry->hist, 50);
+	entry->time_p90  = histogram_percentile(&entry->hist, 90);
+	entry->time_p99  = histogram_percentile(&entry->hist, 99);
+	entry->time_p999 = histogram_percentile(&entry->hist, 99.9);
+}
+
+static void init_entry(struct trace_entry *entry, struct trace_entry *te)
+{
+	uint64_t entry_time = 0;
+
+	entry->pid = te->pid;
+	entry->sym = te->sym;
+	entry->addr = te->addr;
+	entry->time_total = te->time_total;
+	entry->time_self  = te->time_self;
+	entry->nr_called  = te->nr_called;
+	entry->pair = NULL;
+
+	if (avg_mode == AVG_TOTAL)
+		entry_time = te->time_total;
+	else if (avg_mode == AVG_SELF)
+		entry_time = te->time_self;
+
+	entry->time_min = entry_time;
+	entry->time_max = entry_time;
+	entry->time_recursive = te->time_recursive;
+
+	entry->total_min = entry->total_max = te->time_total;
+	entry->self_min  = entry->self_max  = te->time_self;
+
+	entry->hist = HISTOGRAM_INIT;
+	add_entry_histogram(entry, te);
+}
+
+/* add a single record (in @te) to the @entry */
+static void update_entry(struct trace_entry *entry, struct trace_entry *te)
+{
+	uint64_t entry_time = 0;
+
+	entry->time_total += te->time_total;
+	entry->time_self  += te->time_self;
+	entry->nr_called  += te->nr_called;
+
+	if (avg_mode == AVG_TOTAL)
+		entry_time = te->time_total;
+	else if (avg_mode == AVG_SELF)
+		entry_time = te->time_self;
+
+	if (entry->time_min > entry_time)
+		entry->time_min = entry_time;
+	if (entry->time_max < entry_time)
+		entry->time_max = entry_time;
+
+	if (entry->total_min > te->time_total)
+		entry->total_min = te->time_total;
+	if (entry->total_max < te->time_total)
+		entry->total_max = te->time_total;
+	if (entry->self_min > te->time_self)
+		entry->self_min = te->time_self;
+	if (entry->self_max < te->time_self)
+		entry->self_max = te->time_self;
+
+	entry->time_recursive += te->time_recursive;
+	add_entry_histogram(entry, te);
+
+	if (entry->sym == NULL && te->sym)
+		entry->sym = te->sym;
+}
+
+/* merge an aggregated entry @te to the @entry */
+static void merge_entry(struct trace_entry *entry, struct trace_entry *te)
+{
+	entry->time_total += te->time_total;
+	entry->time_self  += te->time_self;
+	entry->nr_called  += te->nr_called;
+
+	if (entry->time_min > te->time_min)
+		entry->time_min = te->time_min;
+	if (entry->time_max < te->time_max)
+		entry->time_max = te->time_max;
+
+	if (entry->total_min > te->total_min)
+		entry->total_min = te->total_min;
+	if (entry->total_max < te->total_max)
+		entry->total_max = te->total_max;
+	if (entry->self_min > te->self_min)
+		entry->self_min = te->self_min;
+	if (entry->self_max < te->self_max)
+		entry->self_max = te->self_max;
+
+	entry->time_recursive += te->time_recursive;
+	histogram_merge(&entry->hist, &te->hist);
+
+	if (entry->sym == NULL && te->sym)
+		entry->sym = te->sym;
+}
+
+/*
+ * insert an aggregated entry @te to the @root sorted by name (or pid).
+ * entries of a same name in different sessions are merged.
+ * the histogram of @te is moved (or merged) to the tree entry.
+ */
 static void insert_entry(struct rb_root *root, struct trace_entry *te, bool thread)
 {
 	struct trace_entry *entry;
 	struct rb_node *parent = NULL;
 	struct rb_node **p = &root->rb_node;
-	uint64_t entry_time = 0;
 	int len = 0;
 
 	pr_dbg3("%s: [%5d] %"PRIu64"/%"PRIu64" (%lu) %-s\n",
 		__func__, te->pid, te->time_total, te->time_self, te->nr_called,
-		te->sym ? te->sym->name : "<unknown>");
+		te->sym ? symbol_getname(te->sym, te->addr) : "<unknown>");
+
+	if (te->sym)
+		len = strlen(symbol_getname(te->sym, te->addr));
+	if (maxlen < len)
+		maxlen = len;
 
 	while (*p) {
 		int cmp;
@@ -68,36 +214,14 @@ static void insert_entry(struct rb_root *root, struct trace_entry *te, bool thre
 		if (thread)
 			cmp = te->pid - entry->pid;
 		else if (te->sym && entry->sym)
-			cmp = strcmp(te->sym->name, entry->sym->name);
+			cmp = strcmp(symbol_getname(te->sym, te->addr),
+				     symbol_getname(entry->sym, entry->addr));
 		else
 			cmp = te->addr - entry->addr;
 
 		if (cmp == 0) {
-			entry->time_total += te->time_total;
-			entry->time_self  += te->time_self;
-			entry->nr_called  += te->nr_called;
-
-			if (avg_mode == AVG_TOTAL)
-				entry_time = te->time_total;
-			else if (avg_mode == AVG_SELF)
-				entry_time = te->time_self;
-
-			if (entry->time_min > entry_time)
-				entry->time_min = entry_time;
-			if (entry->time_max < entry_time)
-				entry->time_max = entry_time;
-
-			entry->time_recursive += te->time_recursive;
-
-			if (entry->sym == NULL && te->sym) {
-				entry->sym = te->sym;
-
-				if (entry->sym)
-					len = strlen(entry->sym->name);
-				if (maxlen < len)
-					maxlen = len;
-			}
-
+			merge_entry(entry, te);
+			histogram_free(&te->hist);
 			return;
 		}
 
@@ -108,30 +232,170 @@ static void insert_entry(struct rb_root *root, struct trace_entry *te, bool thre
 	}
 
 	entry = xmalloc(sizeof(*entry));
-	entry->pid = te->pid;
-	entry->sym = te->sym;
-	entry->addr = te->addr;
-	entry->time_total = te->time_total;
-	entry->time_self  = te->time_self;
-	entry->nr_called  = te->nr_called;
+	*entry = *te;
 	entry->pair = NULL;
 
-	if (avg_mode == AVG_TOTAL)
-		entry_time = te->time_total;
-	else if (avg_mode == AVG_SELF)
-		entry_time = te->time_self;
+	rb_link_node(&entry->link, parent, p);
+	rb_insert_color(&entry->link, root);
+}
 
-	entry->time_min = entry_time;
-	entry->time_max = entry_time;
-	entry->time_recursive = te->time_recursive;
+#define ENTRY_CHUNK_SIZE  1024
 
-	if (entry->sym)
-		len = strlen(entry->sym->name);
-	if (maxlen < len)
-		maxlen = len;
+struct entry_chunk {
+	struct entry_chunk *next;
+	int nr_used;
+	struct trace_entry entries[ENTRY_CHUNK_SIZE];
+};
 
-	rb_link_node(&entry->link, parent, p);
-	rb_insert_color(&entry->link, root);
+/*
+ * hash table to aggregate records.  It's keyed by the symbol (or the
+ * address for unknown functions) or pid (for threads) so that it
+ * doesn't need to compare names for each record.  The entries are
+ * allocated from chunks which are released at once.
+ */
+struct entry_hash {
+	struct trace_entry **table;
+	unsigned size;
+	unsigned nr_entries;
+	bool thread;
+	struct entry_chunk *chunks;
+	struct entry_chunk *last;
+};
+
+static void setup_entry_hash(struct entry_hash *hash, bool thread)
+{
+	hash->size = 1024;
+	hash->nr_entries = 0;
+	hash->thread = thread;
+	hash->table = xcalloc(hash->size, sizeof(*hash->table));
+	hash->chunks = hash->last = NULL;
+}
+
+static unsigned entry_hash_slot(struct entry_hash *hash, struct trace_entry *te)
+{
+	uint64_t key;
+
+	if (hash->thread)
+		key = te->pid;
+	else if (te->sym)
+		key = (uintptr_t)te->sym;
+	else
+		key = te->addr;
+
+	/* multiplicative hashing: size is a power of 2 */
+	return (key * 0x9e37fffffffc0001ULL) >> 32 & (hash->size - 1);
+}
+
+static bool entry_hash_match(struct entry_hash *hash, struct trace_entry *a,
+			     struct trace_entry *b)
+{
+	if (hash->thread)
+		return a->pid == b->pid;
+	if (a->sym || b->sym)
+		return a->sym == b->sym;
+	return a->addr == b->addr;
+}
+
+static struct trace_entry * alloc_hash_entry(struct entry_hash *hash)
+{
+	struct entry_chunk *chunk = hash->last;
+
+	if (chunk == NULL || chunk->nr_used == ENTRY_CHUNK_SIZE) {
+		chunk = xmalloc(sizeof(*chunk));
+		chunk->nr_used = 0;
+		chunk->next = NULL;
+
+		if (hash->last)
+			hash->last->next = chunk;
+		else
+			hash->chunks = chunk;
+		hash->last = chunk;
+	}
+
+	return &chunk->entries[chunk->nr_used++];
+}
+
+static void grow_entry_hash(struct entry_hash *hash)
+{
+	struct trace_entry **old_table = hash->table;
+	unsigned old_size = hash->size;
+	unsigned i, slot;
+
+	hash->size *= 2;
+	hash->table = xcalloc(hash->size, sizeof(*hash->table));
+
+	for (i = 0; i < old_size; i++) {
+		if (old_table[i] == NULL)
+			continue;
+
+		slot = entry_hash_slot(hash, old_table[i]);
+		while (hash->table[slot])
+			slot = (slot + 1) & (hash->size - 1);
+		hash->table[slot] = old_table[i];
+	}
+	free(old_table);
+}
+
+/* add a single record (in @te) to the @hash */
+static void add_entry(struct entry_hash *hash, struct trace_entry *te)
+{
+	struct trace_entry *entry;
+	unsigned slot;
+
+	pr_dbg3("%s: [%5d] %"PRIu64"/%"PRIu64" (%lu) %-s\n",
+		__func__, te->pid, te->time_total, te->time_self, te->nr_called,
+		te->sym ? symbol_getname(te->sym, te->addr) : "<unknown>");
+
+	slot = entry_hash_slot(hash, te);
+	while ((entry = hash->table[slot]) != NULL) {
+		if (entry_hash_match(hash, entry, te)) {
+			update_entry(entry, te);
+			return;
+		}
+		slot = (slot + 1) & (hash->size - 1);
+	}
+
+	entry = alloc_hash_entry(hash);
+	init_entry(entry, te);
+	hash->table[slot] = entry;
+
+	/* keep load factor under 50% */
+	if (++hash->nr_entries * 2 > hash->size)
+		grow_entry_hash(hash);
+}
+
+/* call @fn for each aggregated entry in the @hash and release the @hash */
+static void flush_entry_hash(struct entry_hash *hash,
+			     void (*fn)(struct trace_entry *te, void *arg),
+			     void *arg)
+{
+	struct entry_chunk *chunk, *next;
+	int i;
+
+	free(hash->table);
+	hash->table = NULL;
+
+	/* in the order of appearance */
+	chunk = hash->chunks;
+	while (chunk) {
+		for (i = 0; i < chunk->nr_used; i++)
+			fn(&chunk->entries[i], arg);
+
+		next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	hash->chunks = hash->last = NULL;
+}
+
+static void insert_name_entry(struct trace_entry *te, void *arg)
+{
+	insert_entry(arg, te, false);
+}
+
+static void insert_thread_entry(struct trace_entry *te, void *arg)
+{
+	insert_entry(arg, te, true);
 }
 
 static void fill_entry_sym(struct trace_entry *te,
@@ -189,73 +453,74 @@ static bool fill_entry(struct trace_entry *te, struct ftrace_task_handle *task,
 	return true;
 }
 
-static void build_function_tree(struct ftrace_file_handle *handle,
-				struct rb_root *root, struct opts *opts)
+/* add the current record of @task to the function @hash */
+static void add_function_record(struct entry_hash *hash,
+				struct ftrace_task_handle *task,
+				struct opts *opts)
 {
 	struct trace_entry te;
-	struct uftrace_record *rstack;
-	struct ftrace_task_handle *task;
+	struct uftrace_record *rstack = task->rstack;
 	struct fstack *fstack;
-	int i;
 
-	while (read_rstack(handle, &task) >= 0 && !uftrace_done) {
-		rstack = task->rstack;
+	if (rstack->type != UFTRACE_LOST)
+		task->timestamp_last = rstack->time;
 
-		if (rstack->type != UFTRACE_LOST)
-			task->timestamp_last = rstack->time;
+	if (!fstack_check_filter(task))
+		return;
 
-		if (!fstack_check_filter(task))
-			continue;
+	if (rstack->type == UFTRACE_ENTRY)
+		return;
 
-		if (rstack->type == UFTRACE_ENTRY)
-			continue;
+	if (rstack->type == UFTRACE_EVENT) {
+		if (!task->user_stack_count && opts->event_skip_out)
+			return;
 
-		if (rstack->type == UFTRACE_EVENT) {
-			if (!task->user_stack_count && opts->event_skip_out)
-				continue;
+		if (rstack->addr == EVENT_ID_PERF_SCHED_IN) {
+			static struct sym sched_sym = {
+				.addr = EVENT_ID_PERF_SCHED_IN,
+				.size = 1,
+				.type = ST_LOCAL,
+				.name = "linux:schedule",
+			};
 
-			if (rstack->addr == EVENT_ID_PERF_SCHED_IN) {
-				static struct sym sched_sym = {
-					.addr = EVENT_ID_PERF_SCHED_IN,
-					.size = 1,
-					.type = ST_LOCAL,
-					.name = "linux:schedule",
-				};
-
-				fill_entry_sym(&te, task, &sched_sym,
-					       sched_sym.addr);
-				insert_entry(root, &te, false);
-			}
-			continue;
+			fill_entry_sym(&te, task, &sched_sym, sched_sym.addr);
+			add_entry(hash, &te);
 		}
+		return;
+	}
 
-		if (rstack->type == UFTRACE_LOST) {
-			/* add partial duration of functions before LOST */
-			while (task->stack_count >= task->user_stack_count) {
-				fstack = &task->func_stack[task->stack_count];
-
-				if (fstack_enabled && fstack->valid &&
-				    !(fstack->flags & FSTACK_FL_NORECORD) &&
-				    fill_entry(&te, task, task->timestamp_last,
-					       fstack->addr, opts)) {
-					insert_entry(root, &te, false);
-				}
+	if (rstack->type == UFTRACE_LOST) {
+		/* add partial duration of functions before LOST */
+		while (task->stack_count >= task->user_stack_count) {
+			fstack = &task->func_stack[task->stack_count];
 
-				fstack_exit(task);
-				task->stack_count--;
+			if (fstack_enabled && fstack->valid &&
+			    !(fstack->flags & FSTACK_FL_NORECORD) &&
+			    fill_entry(&te, task, task->timestamp_last,
+				       fstack->addr, opts)) {
+				add_entry(hash, &te);
 			}
-			continue;
-		}
 
-		/* rstack->type == UFTRACE_EXIT */
-		if (fill_entry(&te, task, rstack->time, rstack->addr, opts))
-			insert_entry(root, &te, false);
+			fstack_exit(task);
+			task->stack_count--;
+		}
+		return;
 	}
 
-	if (uftrace_done)
-		return;
+	/* rstack->type == UFTRACE_EXIT */
+	if (fill_entry(&te, task, rstack->time, rstack->addr, opts))
+		add_entry(hash, &te);
+}
+
+/* add duration of functions not returned at the end of the data */
+static void add_remaining_functions(struct ftrace_file_handle *handle,
+				    struct entry_hash *hash, struct opts *opts)
+{
+	struct trace_entry te;
+	struct ftrace_task_handle *task;
+	struct fstack *fstack;
+	int i;
 
-	/* add duration of remaining functions */
 	for (i = 0; i < handle->nr_tasks; i++) {
 		uint64_t last_time;
 
@@ -286,9 +551,663 @@ static void build_function_tree(struct ftrace_file_handle *handle,
 				fstack[-1].child_time += fstack->total_time;
 
 			if (fill_entry(&te, task, last_time, fstack->addr, opts))
-				insert_entry(root, &te, false);
+				add_entry(hash, &te);
+		}
+	}
+}
+
+
+static struct sym * find_task_sym(struct ftrace_file_handle *handle,
+				  struct ftrace_task_handle *task,
+				  struct uftrace_record *rstack)
+{
+	struct sym *sym;
+	struct ftrace_task_handle *main_task = &handle->tasks[0];
+	struct uftrace_session *sess = find_task_session(&handle->sessions,
+							 task->tid, rstack->time);
+	struct symtabs *symtabs = &sess->symtabs;
+
+	if (task->func)
+		return task->func;
+
+	if (sess == NULL) {
+		pr_dbg("cannot find session for tid %d\n", task->tid);
+		return NULL;
+	}
+
+	if (task == main_task) {
+		/* This is the main thread */
+		task->func = sym = find_symname(&symtabs->symtab, "main");
+		if (sym)
+			return sym;
+
+		pr_dbg("no main thread???\n");
+		/* fall through */
+	}
+
+	task->func = sym = find_symtabs(symtabs, rstack->addr);
+	if (sym == NULL)
+		pr_dbg("cannot find symbol for %lx\n", rstack->addr);
+
+	return sym;
+}
+
+/* add the current record of @task to the thread @hash */
+static void add_thread_record(struct ftrace_file_handle *handle,
+			      struct entry_hash *hash,
+			      struct ftrace_task_handle *task,
+			      struct opts *opts)
+{
+	struct trace_entry te;
+	struct uftrace_record *rstack = task->rstack;
+	struct fstack *fstack;
+
+	/* skip perf events of tasks filtered out by --tid */
+	if (task->func_stack == NULL)
+		return;
+
+	if (rstack->type == UFTRACE_ENTRY && task->func)
+		return;
+	if (rstack->type == UFTRACE_LOST)
+		return;
+
+	/* skip user functions if --kernel-only is set */
+	if (opts->kernel_only && !is_kernel_record(task, rstack))
+		return;
+
+	if (opts->kernel_skip_out) {
+		/* skip kernel functions outside user functions */
+		if (task->user_stack_count == 0 &&
+		    is_kernel_record(task, rstack))
+			return;
+	}
+
+	fstack = &task->func_stack[task->stack_count];
+
+	te.pid = task->tid;
+	te.sym = find_task_sym(handle, task, rstack);
+	te.addr = rstack->addr;
+	te.time_recursive = 0;
+
+	if (rstack->type == UFTRACE_ENTRY) {
+		te.time_total = te.time_self = 0;
+		te.nr_called = 0;
+	}
+	else {
+		te.time_total = fstack->total_time;
+		te.time_self = te.time_total - fstack->child_time;
+		te.nr_called = 1;
+	}
+
+	add_entry(hash, &te);
+}
+
+/*
+ * Read the data once and aggregate records to the function and/or
+ * thread hash.  Either of @func_hash or @thread_hash can be NULL.
+ * The thread record is added first as the function record can
+ * change the stack for LOST records.
+ */
+static void build_report_hash(struct ftrace_file_handle *handle,
+			      struct entry_hash *func_hash,
+			      struct entry_hash *thread_hash,
+			      struct opts *opts)
+{
+	struct ftrace_task_handle *task;
+
+	while (read_rstack(handle, &task) >= 0 && !uftrace_done) {
+		if (thread_hash)
+			add_thread_record(handle, thread_hash, task, opts);
+		if (func_hash)
+			add_function_record(func_hash, task, opts);
+	}
+
+	if (func_hash && !uftrace_done)
+		add_remaining_functions(handle, func_hash, opts);
+}
+
+static void build_function_tree(struct ftrace_file_handle *handle,
+				struct rb_root *root, struct opts *opts)
+{
+	struct entry_hash hash;
+
+	setup_entry_hash(&hash, false);
+	build_report_hash(handle, &hash, NULL, opts);
+	flush_entry_hash(&hash, insert_name_entry, root);
+}
+
+struct report_task {
+	int tid;
+	off_t size;
+};
+
+/*
+ * A worker reads the data files of a subset of tasks using its own
+ * file handle and aggregates the records in its own hash table.
+ * The sessions and symbol tables are shared with the main handle.
+ */
+struct report_worker {
+	pthread_t thread;
+	struct opts opts;
+	struct ftrace_file_handle handle;
+	struct entry_hash func_hash;
+	struct entry_hash thread_hash;
+	bool has_func;
+	bool has_thread;
+	struct strv tids;
+	off_t size;
+};
+
+static struct report_worker *report_workers;
+static int nr_report_workers;
+
+static bool can_report_parallel(struct ftrace_file_handle *handle,
+				struct opts *opts)
+{
+	if (opts->nr_thread < 2)
+		return false;
+
+	/*
+	 * kernel data is not divided by tasks so each worker should read
+	 * all of them.  perf data is usually small so it's ok.
+	 */
+	if (has_kernel_data(handle->kernel))
+		return false;
+
+	/* triggers (and --disabled) change the tracing state globally */
+	if (opts->trigger || opts->disabled)
+		return false;
+
+	return true;
+}
+
+static int report_task_cmp(const void *a, const void *b)
+{
+	const struct report_task *ta = a;
+	const struct report_task *tb = b;
+
+	/* larger task comes first */
+	if (ta->size > tb->size)
+		return -1;
+	if (ta->size < tb->size)
+		return 1;
+	return ta->tid - tb->tid;
+}
+
+static void *report_worker_main(void *arg)
+{
+	struct report_worker *w = arg;
+
+	build_report_hash(&w->handle, w->has_func ? &w->func_hash : NULL,
+			  w->has_thread ? &w->thread_hash : NULL, &w->opts);
+
+	return NULL;
+}
+
+/*
+ * Assign tasks to workers based on the size of the data files and
+ * open a separate data file handle for each worker.  It returns the
+ * number of workers or 0 if the report should be done serially.
+ */
+static int setup_report_workers(struct ftrace_file_handle *handle,
+				struct opts *opts, bool func, bool thread)
+{
+	struct report_task *tasks;
+	struct strv tid_list = STRV_INIT;
+	char buf[PATH_MAX];
+	struct stat stbuf;
+	char *tid;
+	int nr_tasks;
+	int i, k;
+
+	if (!can_report_parallel(handle, opts))
+		return 0;
+
+	if (opts->tid) {
+		strv_split(&tid_list, opts->tid, ",;");
+		nr_tasks = tid_list.nr;
+	}
+	else
+		nr_tasks = handle->info.nr_tid;
+
+	if (nr_tasks < 2) {
+		strv_free(&tid_list);
+		return 0;
+	}
+
+	tasks = xcalloc(nr_tasks, sizeof(*tasks));
+	for (i = 0; i < nr_tasks; i++) {
+		if (opts->tid)
+			tasks[i].tid = strtol(tid_list.p[i], NULL, 10);
+		else
+			tasks[i].tid = handle->info.tids[i];
+
+		snprintf(buf, sizeof(buf), "%s/%d.dat",
+			 handle->dirname, tasks[i].tid);
+		if (stat(buf, &stbuf) == 0)
+			tasks[i].size = stbuf.st_size;
+	}
+	strv_free(&tid_list);
+
+	qsort(tasks, nr_tasks, sizeof(*tasks), report_task_cmp);
+
+	nr_report_workers = opts->nr_thread;
+	if (nr_report_workers > nr_tasks)
+		nr_report_workers = nr_tasks;
+
+	report_workers = xcalloc(nr_report_workers, sizeof(*report_workers));
+
+	/* give the next largest task to the least loaded worker */
+	for (i = 0; i < nr_tasks; i++) {
+		struct report_worker *w = &report_workers[0];
+
+		for (k = 1; k < nr_report_workers; k++) {
+			if (report_workers[k].size < w->size)
+				w = &report_workers[k];
 		}
+
+		snprintf(buf, sizeof(buf), "%d", tasks[i].tid);
+		strv_append(&w->tids, buf);
+		w->size += tasks[i].size;
 	}
+	free(tasks);
+
+	for (i = 0; i < nr_report_workers; i++) {
+		struct report_worker *w = &report_workers[i];
+
+		w->opts = *opts;
+		w->opts.tid = strv_join(&w->tids, ",");
+
+		if (open_shared_data_file(&w->opts, &w->handle, handle) < 0)
+			pr_err("cannot open record data: %s", opts->dirname);
+
+		fstack_setup_tasks(&w->opts, &w->handle);
+
+		w->has_func = func;
+		w->has_thread = thread;
+		if (func)
+			setup_entry_hash(&w->func_hash, false);
+		if (thread)
+			setup_entry_hash(&w->thread_hash, true);
+
+		strv_for_each(&w->tids, tid, k)
+			pr_dbg2("report worker %d: tid %s\n", i, tid);
+	}
+
+	return nr_report_workers;
+}
+
+static void finish_report_workers(void)
+{
+	int i;
+
+	for (i = 0; i < nr_report_workers; i++) {
+		struct report_worker *w = &report_workers[i];
+
+		close_shared_data_file(&w->handle);
+		free(w->opts.tid);
+		strv_free(&w->tids);
+	}
+
+	free(report_workers);
+	report_workers = NULL;
+	nr_report_workers = 0;
+}
+
+/*
+ * Aggregate records in the data and pass the results of functions to
+ * @func_fn and threads to @thread_fn.  Either of them can be NULL and
+ * the data is read only once for both.  It runs multiple workers in
+ * parallel if --num-thread is given, and passes the partial results
+ * of each worker in turn (all functions first and then threads).
+ */
+static void build_report(struct ftrace_file_handle *handle, struct opts *opts,
+			 void (*func_fn)(struct trace_entry *te, void *arg),
+			 void (*thread_fn)(struct trace_entry *te, void *arg),
+			 void *arg)
+{
+	struct entry_hash func_hash;
+	struct entry_hash thread_hash;
+	int i, nr;
+
+	nr = setup_report_workers(handle, opts, func_fn != NULL,
+				  thread_fn != NULL);
+	if (nr == 0) {
+		if (func_fn)
+			setup_entry_hash(&func_hash, false);
+		if (thread_fn)
+			setup_entry_hash(&thread_hash, true);
+
+		build_report_hash(handle, func_fn ? &func_hash : NULL,
+				  thread_fn ? &thread_hash : NULL, opts);
+
+		if (func_fn)
+			flush_entry_hash(&func_hash, func_fn, arg);
+		if (thread_fn)
+			flush_entry_hash(&thread_hash, thread_fn, arg);
+		return;
+	}
+
+	pr_dbg("build report using %d threads\n", nr);
+
+	for (i = 0; i < nr; i++) {
+		if (pthread_create(&report_workers[i].thread, NULL,
+				   report_worker_main, &report_workers[i]))
+			pr_err("cannot create report thread");
+	}
+
+	for (i = 0; i < nr; i++)
+		pthread_join(report_workers[i].thread, NULL);
+
+	if (func_fn) {
+		for (i = 0; i < nr; i++)
+			flush_entry_hash(&report_workers[i].func_hash,
+					 func_fn, arg);
+	}
+	if (thread_fn) {
+		for (i = 0; i < nr; i++)
+			flush_entry_hash(&report_workers[i].thread_hash,
+					 thread_fn, arg);
+	}
+}
+
+#define SUMMARY_FILE_NAME  "summary"
+#define SUMMARY_VERSION    2
+
+/* symbols for entries read from the summary file */
+static struct sym **summary_syms;
+static int nr_summary_syms;
+
+/* save non-empty buckets of the histogram as "hist=INDEX:COUNT,..." */
+static void write_summary_histogram(FILE *fp, struct histogram *hist)
+{
+	const char *sep = " hist=";
+	int i;
+
+	for (i = 0; i < hist->nr_buckets; i++) {
+		if (hist->counts[i] == 0)
+			continue;
+
+		fprintf(fp, "%s%d:%"PRIu64, sep, hist->first + i,
+			hist->counts[i]);
+		sep = ",";
+	}
+}
+
+static void write_summary_entry(FILE *fp, const char *type,
+				struct trace_entry *te)
+{
+	fprintf(fp, "%s tid=%d addr=%"PRIx64" total=%"PRIu64" self=%"PRIu64" "
+		"recursive=%"PRIu64" calls=%lu total_min=%"PRIu64" "
+		"total_max=%"PRIu64" self_min=%"PRIu64" self_max=%"PRIu64,
+		type, te->pid, te->addr, te->time_total,
+		te->time_self, te->time_recursive, te->nr_called,
+		te->total_min, te->total_max, te->self_min, te->self_max);
+	write_summary_histogram(fp, &te->hist);
+	fprintf(fp, " name=\"%s\"\n",
+		te->sym ? symbol_getname(te->sym, te->addr) : "");
+}
+
+static void write_func_entry(struct trace_entry *te, void *arg)
+{
+	write_summary_entry(arg, "FUNC", te);
+	histogram_free(&te->hist);
+}
+
+static void write_task_entry(struct trace_entry *te, void *arg)
+{
+	/* histograms are not used for threads */
+	histogram_free(&te->hist);
+	write_summary_entry(arg, "TASK", te);
+}
+
+/**
+ * save_report_summary - save the default report result to the data
+ * @opts: options of the record command
+ *
+ * This function reads the recorded data once and saves the aggregated
+ * result of functions and threads to the 'summary' file so that
+ * later report commands without any filters don't need to read the
+ * whole data again.  The entries are saved in the order they were
+ * aggregated to get the exactly same output.  It also saves the
+ * histogram of total time of each function for percentiles.  Nothing
+ * is saved if the user interrupted the record.
+ */
+void save_report_summary(struct opts *opts)
+{
+	struct opts ropts = {
+		.dirname	= opts->dirname,
+		.depth		= OPT_DEPTH_DEFAULT,
+		.max_stack	= OPT_RSTACK_DEFAULT,
+		.nr_thread	= opts->nr_thread,
+		.kernel_skip_out= true,
+		.event_skip_out = true,
+		.patt_type	= opts->patt_type,
+	};
+	struct ftrace_file_handle handle;
+	char *filename, *tmpname;
+	bool done = false;
+	bool saved_histogram = need_histogram;
+	FILE *fp;
+
+	if (uftrace_done)
+		return;
+
+	xasprintf(&filename, "%s/%s", opts->dirname, SUMMARY_FILE_NAME);
+	xasprintf(&tmpname, "%s.tmp", filename);
+
+	fp = fopen(tmpname, "w");
+	if (fp == NULL) {
+		pr_dbg("cannot create summary file: %m\n");
+		goto out;
+	}
+
+	pr_dbg("saving report summary\n");
+	fprintf(fp, "# uftrace report summary\n");
+	fprintf(fp, "VERS version=%d demangle=%d\n", SUMMARY_VERSION, demangler);
+
+	if (open_data_file(&ropts, &handle) < 0)
+		goto close;
+
+	/* kernel data might need different options */
+	if (!has_kernel_data(handle.kernel)) {
+		fstack_setup_filters(&ropts, &handle);
+
+		need_histogram = true;
+		build_report(&handle, &ropts, write_func_entry,
+			     write_task_entry, fp);
+		need_histogram = saved_histogram;
+
+		finish_report_workers();
+		done = !uftrace_done;
+	}
+	close_data_file(&ropts, &handle);
+
+close:
+	fclose(fp);
+
+	/* don't leave a partial summary if failed or interrupted */
+	if (!done || rename(tmpname, filename) < 0)
+		unlink(tmpname);
+
+out:
+	free(tmpname);
+	free(filename);
+}
+
+/* the summary only has the result with the default options */
+static bool can_use_summary(struct opts *opts)
+{
+	if (opts->filter || opts->trigger || opts->tid || opts->disabled)
+		return false;
+	if (opts->depth != OPT_DEPTH_DEFAULT || opts->threshold)
+		return false;
+	if (opts->range.start || opts->range.stop)
+		return false;
+	if (!opts->kernel_skip_out || opts->kernel_only || !opts->event_skip_out)
+		return false;
+	/* it only has histograms of total time */
+	if (need_histogram && avg_mode == AVG_SELF)
+		return false;
+
+	return true;
+}
+
+static struct sym * summary_sym(char *name, uint64_t addr)
+{
+	struct sym *sym;
+
+	if (*name == '\0')
+		return NULL;
+
+	sym = xzalloc(sizeof(*sym));
+	sym->addr = addr;
+	sym->name = xstrdup(name);
+
+	summary_syms = xrealloc(summary_syms,
+				(nr_summary_syms + 1) * sizeof(*summary_syms));
+	summary_syms[nr_summary_syms++] = sym;
+
+	return sym;
+}
+
+/* restore the histogram of total time saved as "INDEX:COUNT,..." */
+static void read_summary_histogram(char *str, struct trace_entry *te)
+{
+	int idx;
+
+	do {
+		idx = strtol(str, &str, 10);
+		if (*str++ != ':')
+			break;
+
+		histogram_add_bucket(&te->hist, idx, strtoull(str, &str, 10));
+	} while (*str++ == ',');
+
+	/* the actual min and max are known */
+	if (te->hist.nr_samples) {
+		te->hist.min = te->total_min;
+		te->hist.max = te->total_max;
+	}
+}
+
+/*
+ * Read the summary file saved at record time and build the report
+ * tree.  It returns 0 on success, or -1 if the summary cannot be used
+ * so that the caller reads the data instead.
+ */
+static int read_report_summary(struct opts *opts, struct rb_root *root,
+			       bool thread)
+{
+	const char *type = thread ? "TASK" : "FUNC";
+	struct trace_entry te = {};
+	char *filename;
+	char *line = NULL;
+	size_t sz = 0;
+	char *name, *pos, *hist;
+	int version = 0;
+	int mode = -1;
+	FILE *fp;
+
+	if (!can_use_summary(opts))
+		return -1;
+
+	xasprintf(&filename, "%s/%s", opts->dirname, SUMMARY_FILE_NAME);
+	fp = fopen(filename, "r");
+	free(filename);
+
+	if (fp == NULL)
+		return -1;
+
+	while (getline(&line, &sz, fp) >= 0) {
+		if (line[0] == '#')
+			continue;
+
+		if (!strncmp(line, "VERS", 4)) {
+			sscanf(line + 5, "version=%d demangle=%d",
+			       &version, &mode);
+			continue;
+		}
+
+		/* the version line should come first */
+		if (version != SUMMARY_VERSION || mode != (int)demangler)
+			break;
+
+		if (strncmp(line, type, 4))
+			continue;
+
+		sscanf(line + 5, "tid=%d addr=%"SCNx64" total=%"SCNu64" "
+		       "self=%"SCNu64" recursive=%"SCNu64" calls=%lu "
+		       "total_min=%"SCNu64" total_max=%"SCNu64" "
+		       "self_min=%"SCNu64" self_max=%"SCNu64,
+		       &te.pid, &te.addr, &te.time_total, &te.time_self,
+		       &te.time_recursive, &te.nr_called,
+		       &te.total_min, &te.total_max,
+		       &te.self_min, &te.self_max);
+
+		pos = strstr(line, "name=");
+		if (pos == NULL)
+			pr_err_ns("invalid summary file format");
+
+		hist = strstr(line, " hist=");
+		if (need_histogram && hist && hist < pos)
+			read_summary_histogram(hist + 6, &te);
+		name = pos + 5 + 1;  // skip double-quote
+		pos = strrchr(name, '\"');
+		if (pos)
+			*pos = '\0';
+
+		if (avg_mode == AVG_TOTAL) {
+			te.time_min = te.total_min;
+			te.time_max = te.total_max;
+		}
+		else if (avg_mode == AVG_SELF) {
+			te.time_min = te.self_min;
+			te.time_max = te.self_max;
+		}
+
+		te.sym = summary_sym(name, te.addr);
+		insert_entry(root, &te, thread);
+
+		/* the histogram was moved to the tree */
+		te.hist = HISTOGRAM_INIT;
+	}
+
+	free(line);
+	fclose(fp);
+
+	if (version != SUMMARY_VERSION || mode != (int)demangler)
+		return -1;
+
+	pr_dbg("build report from the summary file\n");
+	return 0;
+}
+
+static void release_summary_syms(void)
+{
+	int i;
+
+	for (i = 0; i < nr_summary_syms; i++) {
+		free(summary_syms[i]->name);
+		free(summary_syms[i]);
+	}
+	free(summary_syms);
+	summary_syms = NULL;
+	nr_summary_syms = 0;
+}
+
+/* build the report tree (sorted by name or tid) */
+static void build_report_tree(struct ftrace_file_handle *handle,
+			      struct rb_root *root, struct opts *opts,
+			      bool thread)
+{
+	if (read_report_summary(opts, root, thread) == 0)
+		return;
+
+	if (thread)
+		build_report(handle, opts, NULL, insert_thread_entry, root);
+	else
+		build_report(handle, opts, insert_name_entry, NULL, root);
 }
 
 struct sort_item {
@@ -484,7 +1403,13 @@ static struct sort_item sort_diff_time_total = {
 static int cmp_func_name(struct trace_entry *a, struct trace_entry *b,
 			       int sort_column)
 {
-	return strcmp(b->sym->name, a->sym->name);
+	char *name_a = symbol_getname(a->sym, a->addr);
+	char *name_b = symbol_getname(b->sym, b->addr);
+	int ret = strcmp(name_b, name_a);
+
+	symbol_putname(a->sym, name_a);
+	symbol_putname(b->sym, name_b);
+	return ret;
 }
 
 static struct sort_item sort_func = {
@@ -507,6 +1432,10 @@ SORT_ITEM_BASE("call", nr_called, AVG_NONE);
 SORT_ITEM("avg", time_avg, AVG_TOTAL);
 SORT_ITEM("min", time_min, AVG_TOTAL);
 SORT_ITEM("max", time_max, AVG_TOTAL);
+SORT_ITEM("p50", time_p50, AVG_ANY);
+SORT_ITEM("p90", time_p90, AVG_ANY);
+SORT_ITEM("p99", time_p99, AVG_ANY);
+SORT_ITEM("p999", time_p999, AVG_ANY);
 
 struct sort_item *all_sort_items[] = {
 	&sort_time_total,
@@ -515,6 +1444,10 @@ struct sort_item *all_sort_items[] = {
 	&sort_time_avg,
 	&sort_time_min,
 	&sort_time_max,
+	&sort_time_p50,
+	&sort_time_p90,
+	&sort_time_p99,
+	&sort_time_p999,
 	&sort_func,
 };
 
@@ -525,12 +1458,23 @@ struct sort_item *diff_sort_items[] = {
 	&sort_diff_time_avg,
 	&sort_diff_time_min,
 	&sort_diff_time_max,
+	&sort_diff_time_p50,
+	&sort_diff_time_p90,
+	&sort_diff_time_p99,
+	&sort_diff_time_p999,
 	&sort_diff_func,
 };
 
 static LIST_HEAD(sort_list);
 static LIST_HEAD(diff_sort_list);
 
+/* percentile keys need histograms */
+static bool is_percentile_sort(struct sort_item *item)
+{
+	return item == &sort_time_p50 || item == &sort_time_p90 ||
+		item == &sort_time_p99 || item == &sort_time_p999;
+}
+
 static int cmp_entry(struct trace_entry *a, struct trace_entry *b)
 {
 	int ret;
@@ -649,6 +1593,9 @@ static void setup_sort(char *sort_keys)
 
 			list_add_tail(&all_sort_items[i]->list, &sort_list);
 			list_add_tail(&diff_sort_items[i]->list, &diff_sort_list);
+
+			if (is_percentile_sort(all_sort_items[i]))
+				need_histogram = true;
 			break;
 		}
 
@@ -675,10 +1622,14 @@ static void print_and_delete(struct rb_root *root,
 		rb_erase(node, root);
 
 		entry = rb_entry(node, struct trace_entry, link);
-		print_func(entry);
+		if (print_func)
+			print_func(entry);
 
-		if (entry->pair && entry->pair != &dummy_entry)
+		if (entry->pair && entry->pair != &dummy_entry) {
+			histogram_free(&entry->pair->hist);
 			free(entry->pair);
+		}
+		histogram_free(&entry->hist);
 		free(entry);
 	}
 }
@@ -692,7 +1643,7 @@ static void print_function(struct trace_entry *entry)
 		print_time_unit(entry->time_total - entry->time_recursive);
 		pr_out("  ");
 		print_time_unit(entry->time_self);
-		pr_out("  %10lu  %-s\n", entry->nr_called, symname);
+		pr_out("  %10lu", entry->nr_called);
 	} else {
 		pr_out("  ");
 		print_time_unit(entry->time_avg);
@@ -700,9 +1651,21 @@ static void print_function(struct trace_entry *entry)
 		print_time_unit(entry->time_min);
 		pr_out("  ");
 		print_time_unit(entry->time_max);
-		pr_out("  %-s\n", symname);
 	}
 
+	if (show_percentile) {
+		pr_out("  ");
+		print_time_unit(entry->time_p50);
+		pr_out("  ");
+		print_time_unit(entry->time_p90);
+		pr_out("  ");
+		print_time_unit(entry->time_p99);
+		pr_out("  ");
+		print_time_unit(entry->time_p999);
+	}
+
+	pr_out("  %-s\n", symname);
+
 	symbol_putname(entry->sym, symname);
 }
 
@@ -710,10 +1673,12 @@ static void report_functions(struct ftrace_file_handle *handle, struct opts *opt
 {
 	struct rb_root name_tree = RB_ROOT;
 	struct rb_root sort_tree = RB_ROOT;
-	const char f_format[] = "  %10.10s  %10.10s  %10.10s  %-.*s\n";
+	const char f_format[] = "  %10.10s  %10.10s  %10.10s";
+	const char p_format[] = "  %10.10s  %10.10s  %10.10s  %10.10s";
+	const char n_format[] = "  %-.*s\n";
 	const char line[] = "=================================================";
 
-	build_function_tree(handle, &name_tree, opts);
+	build_report_tree(handle, &name_tree, opts, false);
 
 	while (!RB_EMPTY_ROOT(&name_tree) && !uftrace_done) {
 		struct rb_node *node;
@@ -727,6 +1692,7 @@ static void report_functions(struct ftrace_file_handle *handle, struct opts *opt
 			entry->time_avg = entry->time_total / entry->nr_called;
 		else if (avg_mode == AVG_SELF)
 			entry->time_avg = entry->time_self / entry->nr_called;
+		update_percentile(entry);
 
 		sort_entries(&sort_tree, entry);
 	}
@@ -735,118 +1701,462 @@ static void report_functions(struct ftrace_file_handle *handle, struct opts *opt
 		return;
 
 	if (avg_mode == AVG_NONE)
-		pr_out(f_format, "Total time", "Self time", "Calls", maxlen, "Function");
+		pr_out(f_format, "Total time", "Self time", "Calls");
 	else if (avg_mode == AVG_TOTAL)
-		pr_out(f_format, "Avg total", "Min total", "Max total", maxlen, "Function");
+		pr_out(f_format, "Avg total", "Min total", "Max total");
 	else if (avg_mode == AVG_SELF)
-		pr_out(f_format, "Avg self", "Min self", "Max self", maxlen, "Function");
+		pr_out(f_format, "Avg self", "Min self", "Max self");
+	if (show_percentile)
+		pr_out(p_format, "p50", "p90", "p99", "p99.9");
+	pr_out(n_format, maxlen, "Function");
 
-	pr_out(f_format, line, line, line, maxlen, line);
+	pr_out(f_format, line, line, line);
+	if (show_percentile)
+		pr_out(p_format, line, line, line, line);
+	pr_out(n_format, maxlen, line);
 
 	print_and_delete(&sort_tree, print_function);
 }
 
-static struct sym * find_task_sym(struct ftrace_file_handle *handle,
-				  struct ftrace_task_handle *task,
-				  struct uftrace_record *rstack)
+static void print_thread(struct trace_entry *entry)
+{
+	char *symname = symbol_getname(entry->sym, entry->addr);
+
+	pr_out("  %5d  ", entry->pid);
+	print_time_unit(entry->time_self);
+	pr_out("  %10lu  %-s\n", entry->nr_called, symname);
+
+	symbol_putname(entry->sym, symname);
+}
+
+static void report_threads(struct ftrace_file_handle *handle, struct opts *opts)
+{
+	struct rb_root name_tree = RB_ROOT;
+	const char t_format[] = "  %5.5s  %10.10s  %10.10s  %-.*s\n";
+	const char line[] = "=================================================";
+
+	build_report_tree(handle, &name_tree, opts, true);
+
+	if (uftrace_done)
+		return;
+
+	pr_out(t_format, "TID", "Run time", "Num funcs", maxlen, "Start function");
+	pr_out(t_format, line, line, line, maxlen, line);
+
+	print_and_delete(&name_tree, print_thread);
+}
+
+#define HIST_BAR_WIDTH  40
+
+/* print the histogram of @entry in power of 2 ranges */
+static void print_histogram(struct trace_entry *entry)
+{
+	struct histogram *hist = &entry->hist;
+	uint64_t counts[65] = {};
+	uint64_t max_count = 0;
+	int first = -1, last = -1;
+	char bar[HIST_BAR_WIDTH + 1];
+	char *symname;
+	int i, len;
+
+	for (i = 0; i < hist->nr_buckets; i++) {
+		uint64_t lower = histogram_lower(hist->first + i);
+		int row = lower ? 64 - __builtin_clzll(lower) : 0;
+
+		counts[row] += hist->counts[i];
+	}
+
+	for (i = 0; i < 65; i++) {
+		if (counts[i] == 0)
+			continue;
+
+		if (first < 0)
+			first = i;
+		last = i;
+
+		if (max_count < counts[i])
+			max_count = counts[i];
+	}
+
+	symname = symbol_getname(entry->sym, entry->addr);
+	pr_out("#\n");
+	pr_out("# Histogram of %s time: %s (%lu calls)\n",
+	       avg_mode == AVG_SELF ? "self" : "total", symname, entry->nr_called);
+	symbol_putname(entry->sym, symname);
+
+	pr_out("#   p50: ");
+	print_time_unit(entry->time_p50);
+	pr_out("  p90: ");
+	print_time_unit(entry->time_p90);
+	pr_out("  p99: ");
+	print_time_unit(entry->time_p99);
+	pr_out("  p99.9: ");
+	print_time_unit(entry->time_p999);
+	pr_out("\n#\n");
+
+	pr_out("  %23.23s  %10.10s  %-s\n", "Time range", "Calls", "Distribution");
+	pr_out("  %23.23s  %10.10s  %-.*s\n", "=========================",
+	       "==========", HIST_BAR_WIDTH + 2,
+	       "==============================================");
+
+	for (i = first; i <= last && first >= 0; i++) {
+		uint64_t lower = i ? 1ULL << (i - 1) : 0;
+		uint64_t upper = i < 64 ? 1ULL << i : UINT64_MAX;
+
+		len = (counts[i] * HIST_BAR_WIDTH + max_count - 1) / max_count;
+		memset(bar, '#', len);
+		bar[len] = '\0';
+
+		pr_out("  ");
+		if (lower)
+			print_time_unit(lower);
+		else
+			pr_out("%10s", "0 us");
+		pr_out(" - ");
+		print_time_unit(upper);
+		pr_out("  %10"PRIu64"  |%-*s|\n", counts[i], HIST_BAR_WIDTH, bar);
+	}
+}
+
+static struct trace_entry * find_entry_name(struct rb_root *root, char *name)
+{
+	struct rb_node *node;
+	struct trace_entry *entry;
+	char *symname;
+	int ret;
+
+	/* entries without symbol are sorted by address */
+	for (node = rb_first(root); node; node = rb_next(node)) {
+		entry = rb_entry(node, struct trace_entry, link);
+		if (entry->sym == NULL)
+			continue;
+
+		symname = symbol_getname(entry->sym, entry->addr);
+		ret = strcmp(symname, name);
+		symbol_putname(entry->sym, symname);
+
+		if (ret == 0)
+			return entry;
+	}
+	return NULL;
+}
+
+static void report_histogram(struct ftrace_file_handle *handle,
+			     struct opts *opts)
 {
+	struct rb_root name_tree = RB_ROOT;
+	struct trace_entry *entry;
+	struct strv funcs = STRV_INIT;
+	char *name;
+	int i;
+
+	build_report_tree(handle, &name_tree, opts, false);
+
+	if (uftrace_done)
+		return;
+
+	strv_split(&funcs, opts->histogram, ";");
+	strv_for_each(&funcs, name, i) {
+		entry = find_entry_name(&name_tree, name);
+		if (entry == NULL) {
+			pr_warn("cannot find function: %s\n", name);
+			continue;
+		}
+
+		update_percentile(entry);
+		print_histogram(entry);
+	}
+	strv_free(&funcs);
+
+	print_and_delete(&name_tree, NULL);
+}
+
+/* a function in the call path of a slow call */
+struct slow_frame {
 	struct sym *sym;
-	struct ftrace_task_handle *main_task = &handle->tasks[0];
-	struct uftrace_session *sess = find_task_session(&handle->sessions,
-							 task->tid, rstack->time);
-	struct symtabs *symtabs = &sess->symtabs;
+	uint64_t addr;
+};
 
-	if (task->func)
-		return task->func;
+/* a single invocation of a function for --slowest */
+struct slow_call {
+	uint64_t duration;
+	uint64_t start;
+	int tid;
+	int nr_frames;
+	struct slow_frame *frames;  /* from the outermost caller to itself */
+};
 
-	if (sess == NULL) {
-		pr_dbg("cannot find session for tid %d\n", task->tid);
-		return NULL;
+/* the slowest calls of a function kept in a min-heap of duration */
+struct slow_func {
+	struct sym *sym;
+	uint64_t addr;
+	int nr_calls;
+	struct slow_call *calls;
+	struct rb_node link;
+};
+
+static int nr_slow_funcs;
+
+static struct slow_func * find_slow_func(struct rb_root *root,
+					 struct sym *sym, uint64_t addr,
+					 int max_calls)
+{
+	struct slow_func *sf;
+	struct rb_node *parent = NULL;
+	struct rb_node **p = &root->rb_node;
+
+	while (*p) {
+		parent = *p;
+		sf = rb_entry(parent, struct slow_func, link);
+
+		if (sf->sym == sym && sf->addr == addr)
+			return sf;
+
+		if (sf->sym > sym || (sf->sym == sym && sf->addr > addr))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
 	}
 
-	if (task == main_task) {
-		/* This is the main thread */
-		task->func = sym = find_symname(&symtabs->symtab, "main");
-		if (sym)
-			return sym;
+	sf = xzalloc(sizeof(*sf));
+	sf->sym = sym;
+	sf->addr = addr;
+	sf->calls = xcalloc(max_calls, sizeof(*sf->calls));
 
-		pr_dbg("no main thread???\n");
-		/* fall through */
+	rb_link_node(&sf->link, parent, p);
+	rb_insert_color(&sf->link, root);
+
+	nr_slow_funcs++;
+	return sf;
+}
+
+static void swap_slow_call(struct slow_call *a, struct slow_call *b)
+{
+	struct slow_call tmp = *a;
+
+	*a = *b;
+	*b = tmp;
+}
+
+static void slow_heap_up(struct slow_call *heap, int idx)
+{
+	int parent;
+
+	while (idx > 0) {
+		parent = (idx - 1) / 2;
+		if (heap[parent].duration <= heap[idx].duration)
+			break;
+
+		swap_slow_call(&heap[parent], &heap[idx]);
+		idx = parent;
 	}
+}
 
-	task->func = sym = find_symtabs(symtabs, rstack->addr);
-	if (sym == NULL)
-		pr_dbg("cannot find symbol for %lx\n", rstack->addr);
+static void slow_heap_down(struct slow_call *heap, int nr, int idx)
+{
+	int child;
 
-	return sym;
+	while ((child = idx * 2 + 1) < nr) {
+		if (child + 1 < nr &&
+		    heap[child + 1].duration < heap[child].duration)
+			child++;
+
+		if (heap[idx].duration <= heap[child].duration)
+			break;
+
+		swap_slow_call(&heap[idx], &heap[child]);
+		idx = child;
+	}
 }
 
-static void print_thread(struct trace_entry *entry)
+/*
+ * add the call in @te if it's one of the @max_calls slowest calls of
+ * the function.  The call path is copied from the task's func_stack.
+ */
+static void add_slow_call(struct slow_func *sf, int max_calls,
+			  struct ftrace_task_handle *task,
+			  struct trace_entry *te, uint64_t time)
 {
-	char *symname = symbol_getname(entry->sym, entry->addr);
+	struct uftrace_session_link *sessions = &task->h->sessions;
+	struct slow_call *call;
+	struct fstack *fstack;
+	bool replace = false;
+	int i, n = 0;
 
-	pr_out("  %5d  ", entry->pid);
-	print_time_unit(entry->time_self);
-	pr_out("  %10lu  %-s\n", entry->nr_called, symname);
+	if (sf->nr_calls == max_calls) {
+		/* the root has the fastest one */
+		if (te->time_total <= sf->calls[0].duration)
+			return;
 
-	symbol_putname(entry->sym, symname);
+		call = &sf->calls[0];
+		free(call->frames);
+		replace = true;
+	}
+	else
+		call = &sf->calls[sf->nr_calls++];
+
+	call->duration = te->time_total;
+	call->start = time - te->time_total;
+	call->tid = te->pid;
+	call->frames = xmalloc((task->stack_count + 1) * sizeof(*call->frames));
+
+	for (i = 0; i < task->stack_count; i++) {
+		fstack = &task->func_stack[i];
+		if (fstack->addr == 0)
+			continue;
+
+		call->frames[n].sym = task_find_sym_addr(sessions, task, time,
+							 fstack->addr);
+		call->frames[n].addr = fstack->addr;
+		n++;
+	}
+	call->frames[n].sym = te->sym;
+	call->frames[n].addr = te->addr;
+	call->nr_frames = n + 1;
+
+	if (replace)
+		slow_heap_down(sf->calls, sf->nr_calls, 0);
+	else
+		slow_heap_up(sf->calls, sf->nr_calls - 1);
 }
 
-static void report_threads(struct ftrace_file_handle *handle, struct opts *opts)
+static void build_slowest_tree(struct ftrace_file_handle *handle,
+			       struct rb_root *root, struct opts *opts)
 {
 	struct trace_entry te;
 	struct uftrace_record *rstack;
-	struct rb_root name_tree = RB_ROOT;
 	struct ftrace_task_handle *task;
 	struct fstack *fstack;
-	const char t_format[] = "  %5.5s  %10.10s  %10.10s  %-.*s\n";
-	const char line[] = "=================================================";
+	struct slow_func *sf;
+	bool filtered;
 
 	while (read_rstack(handle, &task) >= 0 && !uftrace_done) {
 		rstack = task->rstack;
-		if (rstack->type == UFTRACE_ENTRY && task->func)
+
+		if (rstack->type == UFTRACE_LOST) {
+			/* durations of functions before LOST are unknown */
+			while (task->stack_count >= task->user_stack_count) {
+				fstack_exit(task);
+				task->stack_count--;
+			}
 			continue;
-		if (rstack->type == UFTRACE_LOST)
+		}
+
+		/* the flag is cleared by fstack_check_filter() */
+		filtered = false;
+		if (rstack->type == UFTRACE_EXIT) {
+			fstack = &task->func_stack[task->stack_count];
+			filtered = fstack->flags & FSTACK_FL_FILTERED;
+		}
+
+		if (!fstack_check_filter(task))
 			continue;
 
-		/* skip user functions if --kernel-only is set */
-		if (opts->kernel_only && !is_kernel_record(task, rstack))
+		if (rstack->type != UFTRACE_EXIT)
 			continue;
 
-		if (opts->kernel_skip_out) {
-			/* skip kernel functions outside user functions */
-			if (task->user_stack_count == 0 &&
-			    is_kernel_record(task, rstack))
-				continue;
-		}
+		/* show the functions given by -F only (not their children) */
+		if (fstack_filter_mode == FILTER_MODE_IN && !filtered)
+			continue;
 
-		fstack = &task->func_stack[task->stack_count];
+		if (!fill_entry(&te, task, rstack->time, rstack->addr, opts))
+			continue;
 
-		te.pid = task->tid;
-		te.sym = find_task_sym(handle, task, rstack);
-		te.addr = rstack->addr;
-		te.time_recursive = 0;
+		sf = find_slow_func(root, te.sym, te.addr, opts->nr_slowest);
+		add_slow_call(sf, opts->nr_slowest, task, &te, rstack->time);
+	}
+}
 
-		if (rstack->type == UFTRACE_ENTRY) {
-			te.time_total = te.time_self = 0;
-			te.nr_called = 0;
-		}
-		else {
-			te.time_total = fstack->total_time;
-			te.time_self = te.time_total - fstack->child_time;
-			te.nr_called = 1;
-		}
+/* slower call comes first */
+static int cmp_slow_call(const void *a, const void *b)
+{
+	const struct slow_call *ca = a;
+	const struct slow_call *cb = b;
 
-		insert_entry(&name_tree, &te, true);
+	if (ca->duration == cb->duration)
+		return ca->start > cb->start ? 1 : -1;
+	return ca->duration > cb->duration ? -1 : 1;
+}
+
+/* function has the slower call comes first */
+static int cmp_slow_func(const void *a, const void *b)
+{
+	struct slow_func * const *fa = a;
+	struct slow_func * const *fb = b;
+
+	return cmp_slow_call((*fa)->calls, (*fb)->calls);
+}
+
+static void print_slow_call(struct slow_call *call)
+{
+	uint64_t end = call->start + call->duration;
+	char range[64];
+	char *name;
+	int i;
+
+	/* it can be used for --time-range directly */
+	snprintf(range, sizeof(range),
+		 "%"PRIu64".%09"PRIu64"~%"PRIu64".%09"PRIu64,
+		 call->start / NSEC_PER_SEC, call->start % NSEC_PER_SEC,
+		 end / NSEC_PER_SEC, end % NSEC_PER_SEC);
+
+	pr_out("  ");
+	print_time_unit(call->duration);
+	pr_out("  %6d  %-33s  ", call->tid, range);
+
+	for (i = 0; i < call->nr_frames; i++) {
+		struct slow_frame *frame = &call->frames[i];
+
+		name = symbol_getname(frame->sym, frame->addr);
+		pr_out("%s%s", i ? " > " : "", name);
+		symbol_putname(frame->sym, name);
 	}
+	pr_out("\n");
+}
 
-	if (uftrace_done)
-		return;
+static void report_slowest(struct ftrace_file_handle *handle,
+			   struct opts *opts)
+{
+	struct rb_root root = RB_ROOT;
+	struct slow_func **funcs;
+	struct slow_func *sf;
+	const char s_format[] = "  %10.10s  %6.6s  %-33.33s  %-s\n";
+	const char line[] = "=================================================";
+	int i, k;
 
-	pr_out(t_format, "TID", "Run time", "Num funcs", maxlen, "Start function");
-	pr_out(t_format, line, line, line, maxlen, line);
+	build_slowest_tree(handle, &root, opts);
 
-	print_and_delete(&name_tree, print_thread);
+	funcs = xcalloc(nr_slow_funcs, sizeof(*funcs));
+	for (i = 0; !RB_EMPTY_ROOT(&root); i++) {
+		struct rb_node *node = rb_first(&root);
+
+		rb_erase(node, &root);
+		sf = rb_entry(node, struct slow_func, link);
+
+		qsort(sf->calls, sf->nr_calls, sizeof(*sf->calls),
+		      cmp_slow_call);
+		funcs[i] = sf;
+	}
+	qsort(funcs, nr_slow_funcs, sizeof(*funcs), cmp_slow_func);
+
+	if (!uftrace_done) {
+		pr_out(s_format, "Duration", "TID", "Time range", "Call path");
+		pr_out(s_format, line, line, line, "====================");
+
+		for (i = 0; i < nr_slow_funcs; i++) {
+			for (k = 0; k < funcs[i]->nr_calls; k++)
+				print_slow_call(&funcs[i]->calls[k]);
+		}
+	}
+
+	for (i = 0; i < nr_slow_funcs; i++) {
+		for (k = 0; k < funcs[i]->nr_calls; k++)
+			free(funcs[i]->calls[k].frames);
+		free(funcs[i]->calls);
+		free(funcs[i]);
+	}
+	free(funcs);
+	nr_slow_funcs = 0;
 }
 
 struct diff_data {
@@ -874,7 +2184,8 @@ static void sort_by_name(struct rb_root *root, struct trace_entry *te)
 			continue;
 		}
 
-		ret = strcmp(entry->sym->name, te->sym->name);
+		ret = strcmp(symbol_getname(entry->sym, entry->addr),
+			     symbol_getname(te->sym, te->addr));
 		if (ret == 0) {
 			entry->time_total += te->time_total;
 			entry->time_self  += te->time_self;
@@ -890,6 +2201,10 @@ static void sort_by_name(struct rb_root *root, struct trace_entry *te)
 			if (entry->time_max < te->time_max)
 				entry->time_max = te->time_max;
 
+			histogram_merge(&entry->hist, &te->hist);
+			update_percentile(entry);
+
+			histogram_free(&te->hist);
 			free(te);
 			return;
 		};
@@ -911,11 +2226,12 @@ static struct trace_entry * find_by_name(struct rb_root *root,
 	struct rb_node *parent = NULL;
 	struct rb_node **p = &root->rb_node;
 	char *name;
+	int ret;
 
 	if (base->sym == NULL)
 		return NULL;
 
-	name = base->sym->name;
+	name = symbol_getname(base->sym, base->addr);
 	while (*p) {
 		parent = *p;
 		entry = rb_entry(parent, struct trace_entry, link);
@@ -928,10 +2244,11 @@ static struct trace_entry * find_by_name(struct rb_root *root,
 			continue;
 		}
 
-		if (strcmp(entry->sym->name, name) == 0)
+		ret = strcmp(symbol_getname(entry->sym, entry->addr), name);
+		if (ret == 0)
 			return entry;
 
-		if (strcmp(entry->sym->name, name) < 0)
+		if (ret < 0)
 			p = &parent->rb_left;
 		else
 			p = &parent->rb_right;
@@ -957,11 +2274,14 @@ static void sort_function_name(struct rb_root *root_in,
 			entry->time_avg = entry->time_total / entry->nr_called;
 		else if (avg_mode == AVG_SELF)
 			entry->time_avg = entry->time_self / entry->nr_called;
+		update_percentile(entry);
 
 		if (entry->sym)
 			sort_by_name(root_out, entry);
-		else
+		else {
 			insert_entry(&no_name, entry, false);
+			free(entry);
+		}
 	}
 
 	*root_in = no_name;
@@ -1126,6 +2446,40 @@ static void print_function_diff(struct trace_entry *entry)
 	symbol_putname(entry->sym, symname);
 }
 
+static void print_diff_column(uint64_t base, uint64_t pair)
+{
+	if (diff_full) {
+		print_time_or_dash(base);
+		pr_out("  ");
+		print_time_or_dash(pair);
+		pr_out("  ");
+	}
+	else if (diff_percent)
+		pr_out("   ");
+
+	if (diff_percent)
+		print_diff_percent(base, pair);
+	else
+		print_diff_time_unit(base, pair);
+
+	pr_out("   ");
+}
+
+static void print_percentile_diff(struct trace_entry *entry)
+{
+	char *symname = symbol_getname(entry->sym, entry->addr);
+	struct trace_entry *pair = entry->pair;
+
+	pr_out("  ");
+	print_diff_column(entry->time_p50, pair->time_p50);
+	print_diff_column(entry->time_p90, pair->time_p90);
+	print_diff_column(entry->time_p99, pair->time_p99);
+	print_diff_column(entry->time_p999, pair->time_p999);
+	pr_out("%-s\n", symname);
+
+	symbol_putname(entry->sym, symname);
+}
+
 static void report_diff(struct ftrace_file_handle *handle, struct opts *opts)
 {
 	struct opts dummy_opts = {
@@ -1155,6 +2509,16 @@ static void report_diff(struct ftrace_file_handle *handle, struct opts *opts)
 		{ "Avg total", "Min total", "Max total" },
 		{ "Avg self", "Min self", "Max self" },
 	};
+	const char *p_formats[] = {
+		"  %35.35s   %35.35s   %35.35s   %35.35s   %-.*s\n",
+		"  %32.32s   %32.32s   %32.32s   %32.32s   %-.*s\n",
+		"  %35.35s   %35.35s   %35.35s   %35.35s   %-.*s\n",
+		"  %11.11s   %11.11s   %11.11s   %11.11s   %-.*s\n",
+	};
+	const char *p_headers[][4] = {
+		{ "p50 (diff)", "p90 (diff)", "p99 (diff)", "p99.9 (diff)" },
+		{ "p50", "p90", "p99", "p99.9" },
+	};
 	int h_idx = (avg_mode == AVG_NONE) ? 0 : (avg_mode == AVG_TOTAL) ? 1 : 2;
 	int f_idx = diff_percent ? 1 : (avg_mode == AVG_NONE) ? 0 : 2;
 
@@ -1187,6 +2551,19 @@ static void report_diff(struct ftrace_file_handle *handle, struct opts *opts)
 	pr_out("#  [%d] base: %s\t(from %s)\n", 0, handle->dirname, handle->info.cmdline);
 	pr_out("#  [%d] diff: %s\t(from %s)\n", 1, opts->diff, data.handle.info.cmdline);
 	pr_out("#\n");
+
+	/* compare percentiles instead of the usual columns */
+	if (show_percentile) {
+		int p_idx = diff_full ? 0 : 1;
+
+		pr_out(p_formats[f_idx], p_headers[p_idx][0], p_headers[p_idx][1],
+		       p_headers[p_idx][2], p_headers[p_idx][3], maxlen, "Function");
+		pr_out(p_formats[f_idx], line, line, line, line, maxlen, line);
+
+		print_and_delete(&diff_tree, print_percentile_diff);
+		goto out;
+	}
+
 	pr_out(formats[f_idx], headers[h_idx][0], headers[h_idx][1], headers[h_idx][2],
 	       maxlen, "Function");
 	pr_out(formats[f_idx], line, line, line, maxlen, line);
@@ -1249,6 +2626,12 @@ int command_report(int argc, char *argv[], struct opts *opts)
 	if (opts->sort_keys)
 		setup_sort(opts->sort_keys);
 
+	show_percentile = opts->percentile;
+	if (show_percentile || opts->histogram)
+		need_histogram = true;
+	if (opts->report_thread)
+		need_histogram = show_percentile = false;
+
 	/* default: sort by total time */
 	if (list_empty(&sort_list)) {
 		if (avg_mode == AVG_NONE) {
@@ -1266,12 +2649,18 @@ int command_report(int argc, char *argv[], struct opts *opts)
 
 	if (opts->report_thread)
 		report_threads(&handle, opts);
+	else if (opts->histogram)
+		report_histogram(&handle, opts);
+	else if (opts->nr_slowest)
+		report_slowest(&handle, opts);
 	else if (opts->diff)
 		report_diff(&handle, opts);
 	else
 		report_functions(&handle, opts);
 
+	finish_report_workers();
 	close_data_file(opts, &handle);
+	release_summary_syms();
 
 	return ret;
 }
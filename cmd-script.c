@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdio_ext.h>
+#include <pthread.h>
 
 #include "uftrace.h"
 #include "utils/utils.h"
@@ -20,9 +21,29 @@
 #include "libtraceevent/event-parse.h"
 
 
+/* number of batches passed from the reader thread at once */
+#define SCRIPT_NR_BATCHES  4
+
+struct script_reader {
+	struct ftrace_file_handle	*handle;
+	struct opts			*opts;
+	struct script_batch		batches[SCRIPT_NR_BATCHES];
+	/* index and number of batches ready to run */
+	int				head;
+	int				nr;
+	bool				done;
+	pthread_mutex_t			lock;
+	pthread_cond_t			cond;
+};
+
+/*
+ * if @batch is not NULL, records are saved to it instead of calling
+ * script for each record.
+ */
 static int run_script_for_rstack(struct ftrace_file_handle *handle,
 				 struct ftrace_task_handle *task,
-				 struct opts *opts)
+				 struct opts *opts,
+				 struct script_batch *batch)
 {
 	struct uftrace_record *rstack = task->rstack;
 	struct uftrace_session_link *sessions = &handle->sessions;
@@ -72,7 +93,10 @@ static int run_script_for_rstack(struct ftrace_file_handle *handle,
 		}
 
 		/* script hooking for function entry */
-		script_uftrace_entry(&sc_ctx);
+		if (batch)
+			script_add_batch(batch, &sc_ctx, UFTRACE_ENTRY);
+		else
+			script_uftrace_entry(&sc_ctx);
 	}
 	else if (rstack->type == UFTRACE_EXIT) {
 		struct fstack *fstack;
@@ -108,7 +132,10 @@ static int run_script_for_rstack(struct ftrace_file_handle *handle,
 			}
 
 			/* script hooking for function exit */
-			script_uftrace_exit(&sc_ctx);
+			if (batch)
+				script_add_batch(batch, &sc_ctx, UFTRACE_EXIT);
+			else
+				script_uftrace_exit(&sc_ctx);
 		}
 
 		fstack_exit(task);
@@ -124,6 +151,136 @@ out:
 	return 0;
 }
 
+static bool skip_script_record(struct ftrace_task_handle *task,
+			       struct opts *opts)
+{
+	struct uftrace_record *rstack = task->rstack;
+
+	/* skip user functions if --kernel-only is set */
+	if (opts->kernel_only && !is_kernel_record(task, rstack))
+		return true;
+
+	if (opts->kernel_skip_out) {
+		/* skip kernel functions outside user functions */
+		if (!task->user_stack_count &&
+		    is_kernel_record(task, rstack))
+			return true;
+	}
+
+	return false;
+}
+
+static void *script_reader_thread(void *arg)
+{
+	struct script_reader *reader = arg;
+	struct ftrace_task_handle *task;
+	struct script_batch *batch = NULL;
+
+	while (true) {
+		if (batch == NULL) {
+			/* wait for a free batch */
+			pthread_mutex_lock(&reader->lock);
+			while (reader->nr == SCRIPT_NR_BATCHES)
+				pthread_cond_wait(&reader->cond, &reader->lock);
+
+			batch = &reader->batches[(reader->head + reader->nr) %
+						 SCRIPT_NR_BATCHES];
+			pthread_mutex_unlock(&reader->lock);
+		}
+
+		if (uftrace_done || read_rstack(reader->handle, &task) < 0)
+			break;
+
+		if (skip_script_record(task, reader->opts))
+			continue;
+
+		run_script_for_rstack(reader->handle, task, reader->opts, batch);
+		if (batch->nr < SCRIPT_BATCH_SIZE)
+			continue;
+
+		pthread_mutex_lock(&reader->lock);
+		reader->nr++;
+		pthread_cond_signal(&reader->cond);
+		pthread_mutex_unlock(&reader->lock);
+
+		batch = NULL;
+	}
+
+	/* pass the last (partial) batch too */
+	pthread_mutex_lock(&reader->lock);
+	if (batch->nr)
+		reader->nr++;
+	reader->done = true;
+	pthread_cond_signal(&reader->cond);
+	pthread_mutex_unlock(&reader->lock);
+
+	return NULL;
+}
+
+/*
+ * The reader thread reads the data and saves records in batches while
+ * the main thread runs the script for them.
+ */
+static void run_script_batches(struct ftrace_file_handle *handle,
+			       struct opts *opts)
+{
+	struct script_reader reader = {
+		.handle = handle,
+		.opts   = opts,
+		.lock   = PTHREAD_MUTEX_INITIALIZER,
+		.cond   = PTHREAD_COND_INITIALIZER,
+	};
+	pthread_t thread;
+	int i;
+
+	if (pthread_create(&thread, NULL, script_reader_thread, &reader) != 0) {
+		struct ftrace_task_handle *task;
+		struct script_batch *batch = &reader.batches[0];
+
+		pr_dbg("cannot create reader thread, read records inline\n");
+
+		while (read_rstack(handle, &task) == 0 && !uftrace_done) {
+			if (skip_script_record(task, opts))
+				continue;
+
+			run_script_for_rstack(handle, task, opts, batch);
+			if (batch->nr == SCRIPT_BATCH_SIZE)
+				script_flush_batch(batch);
+		}
+
+		script_finish_batch(batch);
+		return;
+	}
+
+	while (true) {
+		struct script_batch *batch;
+
+		pthread_mutex_lock(&reader.lock);
+		while (reader.nr == 0 && !reader.done)
+			pthread_cond_wait(&reader.cond, &reader.lock);
+
+		if (reader.nr == 0) {
+			pthread_mutex_unlock(&reader.lock);
+			break;
+		}
+		batch = &reader.batches[reader.head];
+		pthread_mutex_unlock(&reader.lock);
+
+		script_flush_batch(batch);
+
+		pthread_mutex_lock(&reader.lock);
+		reader.head = (reader.head + 1) % SCRIPT_NR_BATCHES;
+		reader.nr--;
+		pthread_cond_signal(&reader.cond);
+		pthread_mutex_unlock(&reader.lock);
+	}
+
+	pthread_join(thread, NULL);
+
+	for (i = 0; i < SCRIPT_NR_BATCHES; i++)
+		script_finish_batch(&reader.batches[i]);
+}
+
 int command_script(int argc, char *argv[], struct opts *opts)
 {
 	int ret;
@@ -172,26 +329,24 @@ int command_script(int argc, char *argv[], struct opts *opts)
 	if (script_init(opts->script_file, opts->patt_type) < 0)
 		return -1;
 
-	while (read_rstack(&handle, &task) == 0 && !uftrace_done) {
-		struct uftrace_record *rstack = task->rstack;
+	if (script_uftrace_batch) {
+		run_script_batches(&handle, opts);
+		ret = 0;
+		goto out;
+	}
 
-		/* skip user functions if --kernel-only is set */
-		if (opts->kernel_only && !is_kernel_record(task, rstack))
+	while (read_rstack(&handle, &task) == 0 && !uftrace_done) {
+		if (skip_script_record(task, opts))
 			continue;
 
-		if (opts->kernel_skip_out) {
-			/* skip kernel functions outside user functions */
-			if (!task->user_stack_count &&
-			    is_kernel_record(task, rstack))
-				continue;
-		}
-
-		ret = run_script_for_rstack(&handle, task, opts);
+		ret = run_script_for_rstack(&handle, task, opts, NULL);
 
 		if (ret)
 			break;
 	}
 
+out:
+
 	/* dtor for script support */
 	script_uftrace_end();
 
@@ -0,0 +1,792 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/ioctl.h>
+
+#include "uftrace.h"
+#include "utils/utils.h"
+#include "utils/rbtree.h"
+#include "utils/symbol.h"
+#include "utils/kernel.h"
+
+/* refresh interval of the view (in msec) */
+#define TOP_REFRESH_MSEC  1000
+
+/* depth in a record has 10 bits */
+#define TOP_STACK_MAX  1024
+
+#define TOP_CACHE_SIZE  64
+
+/* aggregated stat of a function in a task */
+struct top_func {
+	struct rb_node		node;
+	uint64_t		addr;
+	/* timestamp of the first call (to find the symbol) */
+	uint64_t		time;
+	uint64_t		nr_called;
+	uint64_t		prev_called;
+	uint64_t		time_total;
+	uint64_t		time_self;
+	uint64_t		time_max;
+	/* number of active (recursive) calls */
+	int			active;
+	bool			sym_found;
+	struct sym		*sym;
+};
+
+struct top_frame {
+	struct top_func		*func;
+	uint64_t		time;
+	uint64_t		child_time;
+};
+
+/*
+ * per-task stat, it's updated by a writer thread which handles the task
+ * and read by the main thread every second.  So the lock is rarely
+ * contended.
+ */
+struct top_task {
+	struct rb_node		node;
+	pthread_mutex_t		lock;
+	int			tid;
+	int			depth;
+	struct top_frame	*stack;
+	struct rb_root		funcs;
+	struct top_func		*cache[TOP_CACHE_SIZE];
+	uint64_t		nr_called;
+	uint64_t		prev_called;
+	uint64_t		time_self;
+};
+
+/* merged stat of a function (or a task) for display */
+struct top_entry {
+	struct rb_node		link;
+	struct sym		*sym;
+	uint64_t		addr;
+	int			tid;
+	uint64_t		nr_called;
+	uint64_t		nr_recent;
+	uint64_t		time_total;
+	uint64_t		time_self;
+	uint64_t		time_max;
+};
+
+typedef int (*top_cmp_t)(struct top_entry *a, struct top_entry *b);
+
+static struct top_view {
+	pthread_mutex_t			lock;
+	struct rb_root			tasks;
+	/* below are accessed by the main thread only */
+	struct uftrace_session_link	sessions;
+	struct opts			*opts;
+	top_cmp_t			cmp;
+	uint64_t			start;
+	uint64_t			last_update;
+	bool				tty;
+} top_view = {
+	.lock		= PTHREAD_MUTEX_INITIALIZER,
+	.tasks		= RB_ROOT,
+	.sessions	= {
+		.root	= RB_ROOT,
+		.tasks	= RB_ROOT,
+	},
+};
+
+static char *tmp_dirname;
+
+static void cleanup_top_dir(void)
+{
+	if (tmp_dirname == NULL)
+		return;
+
+	remove_directory(tmp_dirname);
+	tmp_dirname = NULL;
+}
+
+static uint64_t top_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+#define TOP_CMP(_name, _field)						\
+static int cmp_##_name(struct top_entry *a, struct top_entry *b)	\
+{									\
+	if (a->_field == b->_field)					\
+		return 0;						\
+	return a->_field > b->_field ? 1 : -1;				\
+}
+
+TOP_CMP(total, time_total)
+TOP_CMP(self, time_self)
+TOP_CMP(call, nr_called)
+TOP_CMP(max, time_max)
+
+static const struct {
+	const char	*name;
+	top_cmp_t	cmp;
+} top_sort_keys[] = {
+	{ "total",	cmp_total },
+	{ "self",	cmp_self },
+	{ "call",	cmp_call },
+	{ "max",	cmp_max },
+};
+
+static int setup_top_sort(char *sort_keys)
+{
+	unsigned i;
+
+	top_view.cmp = cmp_total;
+	if (sort_keys == NULL)
+		return 0;
+
+	/* only the first key is used */
+	for (i = 0; i < ARRAY_SIZE(top_sort_keys); i++) {
+		size_t len = strlen(top_sort_keys[i].name);
+
+		if (!strncmp(sort_keys, top_sort_keys[i].name, len) &&
+		    (sort_keys[len] == '\0' || sort_keys[len] == ',')) {
+			top_view.cmp = top_sort_keys[i].cmp;
+			return 0;
+		}
+	}
+
+	pr_out("uftrace: Unknown sort key '%s'\n", sort_keys);
+	pr_out("uftrace:   Possible keys:");
+	for (i = 0; i < ARRAY_SIZE(top_sort_keys); i++)
+		pr_out(" %s", top_sort_keys[i].name);
+	pr_out("\n");
+	return -1;
+}
+
+static struct top_task *get_top_task(int tid)
+{
+	struct top_view *tv = &top_view;
+	struct top_task *tt;
+	struct rb_node *parent = NULL;
+	struct rb_node **p;
+
+	pthread_mutex_lock(&tv->lock);
+
+	p = &tv->tasks.rb_node;
+	while (*p) {
+		parent = *p;
+		tt = rb_entry(parent, struct top_task, node);
+
+		if (tt->tid == tid)
+			goto out;
+
+		if (tt->tid > tid)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	tt = xzalloc(sizeof(*tt));
+	tt->tid = tid;
+	tt->funcs = RB_ROOT;
+	tt->stack = xcalloc(TOP_STACK_MAX, sizeof(*tt->stack));
+	pthread_mutex_init(&tt->lock, NULL);
+
+	rb_link_node(&tt->node, parent, p);
+	rb_insert_color(&tt->node, &tv->tasks);
+
+out:
+	pthread_mutex_unlock(&tv->lock);
+	return tt;
+}
+
+static struct top_func *get_top_func(struct top_task *tt,
+				     struct uftrace_record *rec)
+{
+	struct top_func *func;
+	struct rb_node *parent = NULL;
+	struct rb_node **p = &tt->funcs.rb_node;
+	unsigned idx = (rec->addr >> 2) % TOP_CACHE_SIZE;
+
+	func = tt->cache[idx];
+	if (func && func->addr == rec->addr)
+		return func;
+
+	while (*p) {
+		parent = *p;
+		func = rb_entry(parent, struct top_func, node);
+
+		if (func->addr == rec->addr)
+			goto out;
+
+		if (func->addr > rec->addr)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	func = xzalloc(sizeof(*func));
+	func->addr = rec->addr;
+	func->time = rec->time;
+
+	rb_link_node(&func->node, parent, p);
+	rb_insert_color(&func->node, &tt->funcs);
+
+out:
+	tt->cache[idx] = func;
+	return func;
+}
+
+/* discard frames at @depth or deeper (due to missing exit records) */
+static void pop_top_frames(struct top_task *tt, int depth)
+{
+	while (tt->depth > depth) {
+		struct top_frame *frame = &tt->stack[--tt->depth];
+
+		if (frame->func)
+			frame->func->active--;
+		frame->func = NULL;
+	}
+}
+
+static void top_func_entry(struct top_task *tt, struct uftrace_record *rec)
+{
+	struct top_frame *frame = &tt->stack[rec->depth];
+
+	pop_top_frames(tt, rec->depth);
+
+	frame->func = get_top_func(tt, rec);
+	frame->time = rec->time;
+	frame->child_time = 0;
+	frame->func->active++;
+
+	tt->depth = rec->depth + 1;
+}
+
+static void top_func_exit(struct top_task *tt, struct uftrace_record *rec)
+{
+	struct top_frame *frame = &tt->stack[rec->depth];
+	struct top_func *func = frame->func;
+	uint64_t total, self;
+
+	if (rec->depth >= tt->depth || func == NULL || func->addr != rec->addr)
+		return;
+
+	pop_top_frames(tt, rec->depth + 1);
+
+	total = rec->time - frame->time;
+	self = total > frame->child_time ? total - frame->child_time : 0;
+
+	func->nr_called++;
+	/* do not add time of recursive calls twice */
+	if (--func->active == 0)
+		func->time_total += total;
+	func->time_self += self;
+	if (func->time_max < total)
+		func->time_max = total;
+
+	if (rec->depth > 0)
+		tt->stack[rec->depth - 1].child_time += total;
+
+	tt->nr_called++;
+	tt->time_self += self;
+
+	frame->func = NULL;
+	tt->depth = rec->depth;
+}
+
+/**
+ * top_view_data - aggregate trace data of a task
+ * @tid: task id
+ * @data: trace data in a shmem buffer
+ * @len: length of @data
+ *
+ * This function is called by the writer threads in the recorder.
+ * Buffers of a task are passed in order and only one thread handles
+ * a task at a time.
+ */
+void top_view_data(int tid, void *data, size_t len)
+{
+	struct top_task *tt = get_top_task(tid);
+	struct uftrace_record *rec = data;
+	void *end = data + len;
+
+	pthread_mutex_lock(&tt->lock);
+
+	for (; (void *)rec < end; rec++) {
+		if (rec->magic != RECORD_MAGIC ||
+		    (rec->more && rec->type != UFTRACE_EVENT)) {
+			/* arguments are not recorded, it must be broken */
+			pr_dbg("invalid record in task %d\n", tid);
+			pop_top_frames(tt, 0);
+			break;
+		}
+
+		if (rec->more) {
+			uint16_t size;
+
+			/* skip event data like read trigger, aligned to 8 */
+			memcpy(&size, rec + 1, sizeof(size));
+			rec = (void *)rec + ALIGN(size + sizeof(size), 8);
+			continue;
+		}
+
+		switch (rec->type) {
+		case UFTRACE_ENTRY:
+			top_func_entry(tt, rec);
+			break;
+		case UFTRACE_EXIT:
+			top_func_exit(tt, rec);
+			break;
+		case UFTRACE_LOST:
+			pop_top_frames(tt, 0);
+			break;
+		default:
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&tt->lock);
+}
+
+/**
+ * top_view_message - handle a record message for symbol lookup
+ * @type: message type (UFTRACE_MSG_*)
+ * @msg: message data
+ * @len: length of @msg
+ * @name: (optional) exe or library name of the message
+ */
+void top_view_message(int type, void *msg, size_t len, char *name)
+{
+	struct uftrace_session_link *sessions = &top_view.sessions;
+	struct uftrace_msg_task *tmsg = msg;
+	struct uftrace_msg_sess *smsg = msg;
+	struct uftrace_msg_dlopen *dmsg = msg;
+	struct uftrace_session *s;
+
+	switch (type) {
+	case UFTRACE_MSG_SESSION:
+		create_session(sessions, smsg, top_view.opts->dirname, name, true);
+		break;
+	case UFTRACE_MSG_TASK_START:
+		create_task(sessions, tmsg, false, true);
+		break;
+	case UFTRACE_MSG_FORK_END:
+		create_task(sessions, tmsg, true, true);
+		break;
+	case UFTRACE_MSG_DLOPEN:
+		s = get_session_from_sid(sessions, dmsg->sid);
+		if (s)
+			session_add_dlopen(s, dmsg->task.time, dmsg->base_addr, name);
+		break;
+	default:
+		break;
+	}
+}
+
+static void insert_top_entry(struct rb_root *root, struct top_entry *te)
+{
+	struct rb_node *parent = NULL;
+	struct rb_node **p = &root->rb_node;
+	struct top_entry *iter;
+
+	while (*p) {
+		parent = *p;
+		iter = rb_entry(parent, struct top_entry, link);
+
+		if (top_view.cmp(te, iter) > 0)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	rb_link_node(&te->link, parent, p);
+	rb_insert_color(&te->link, root);
+}
+
+/* merge stats of the same function in different tasks */
+static void merge_top_func(struct rb_root *root, struct top_func *func)
+{
+	struct rb_node *parent = NULL;
+	struct rb_node **p = &root->rb_node;
+	struct top_entry *te;
+
+	while (*p) {
+		parent = *p;
+		te = rb_entry(parent, struct top_entry, link);
+
+		/* use the address only if it has no symbol */
+		if (te->sym == func->sym && (te->sym || te->addr == func->addr))
+			goto update;
+
+		if (te->sym != func->sym) {
+			if ((unsigned long)te->sym > (unsigned long)func->sym)
+				p = &parent->rb_left;
+			else
+				p = &parent->rb_right;
+		}
+		else if (te->addr > func->addr)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	te = xzalloc(sizeof(*te));
+	te->sym = func->sym;
+	te->addr = func->addr;
+
+	rb_link_node(&te->link, parent, p);
+	rb_insert_color(&te->link, root);
+
+update:
+	te->nr_called  += func->nr_called;
+	te->nr_recent  += func->nr_called - func->prev_called;
+	te->time_total += func->time_total;
+	te->time_self  += func->time_self;
+	if (te->time_max < func->time_max)
+		te->time_max = func->time_max;
+}
+
+static void collect_top_task(struct top_task *tt, struct rb_root *funcs,
+			     struct rb_root *tasks)
+{
+	struct uftrace_session_link *sessions = &top_view.sessions;
+	struct uftrace_session *s;
+	struct top_func *func;
+	struct top_entry *te;
+	struct rb_node *node;
+
+	pthread_mutex_lock(&tt->lock);
+
+	for (node = rb_first(&tt->funcs); node; node = rb_next(node)) {
+		func = rb_entry(node, struct top_func, node);
+
+		if (func->nr_called == 0)
+			continue;
+
+		if (!func->sym_found) {
+			s = find_task_session(sessions, tt->tid, func->time);
+			if (s)
+				func->sym = session_find_sym(s, func->time, func->addr);
+			func->sym_found = true;
+		}
+
+		merge_top_func(funcs, func);
+		func->prev_called = func->nr_called;
+	}
+
+	te = xzalloc(sizeof(*te));
+	te->tid = tt->tid;
+	te->nr_called = tt->nr_called;
+	te->nr_recent = tt->nr_called - tt->prev_called;
+	te->time_self = tt->time_self;
+	tt->prev_called = tt->nr_called;
+
+	pthread_mutex_unlock(&tt->lock);
+
+	/* tasks are always sorted by the time */
+	te->time_total = te->time_self;
+	insert_top_entry(tasks, te);
+}
+
+static void print_top_rate(uint64_t count, uint64_t duration)
+{
+	if (duration == 0)
+		duration = 1;
+
+	pr_out("  %9"PRIu64, count * NSEC_PER_SEC / duration);
+}
+
+static void print_top_funcs(struct rb_root *root, uint64_t duration,
+			    int rows)
+{
+	const char f_format[] = "  %9.9s  %10.10s  %10.10s  %10.10s  %10.10s  %-.20s\n";
+	const char line[] = "=================================================";
+	struct top_entry *te;
+	struct rb_node *node;
+	char *name;
+
+	pr_out(f_format, "Calls/s", "Calls", "Total time", "Self time",
+	       "Max time", "Function");
+	pr_out(f_format, line, line, line, line, line, line);
+
+	while (!RB_EMPTY_ROOT(root)) {
+		node = rb_first(root);
+		rb_erase(node, root);
+		te = rb_entry(node, struct top_entry, link);
+
+		if (rows < 0 || rows-- > 0) {
+			name = symbol_getname(te->sym, te->addr);
+
+			print_top_rate(te->nr_recent, duration);
+			pr_out("  %10"PRIu64"  ", te->nr_called);
+			print_time_unit(te->time_total);
+			pr_out("  ");
+			print_time_unit(te->time_self);
+			pr_out("  ");
+			print_time_unit(te->time_max);
+			pr_out("  %-s\n", name);
+
+			symbol_putname(te->sym, name);
+		}
+		free(te);
+	}
+}
+
+static void print_top_tasks(struct rb_root *root, uint64_t duration,
+			    int rows)
+{
+	const char t_format[] = "  %9.9s  %10.10s  %10.10s  %6.6s  %-.20s\n";
+	const char line[] = "=================================================";
+	struct uftrace_task *t;
+	struct top_entry *te;
+	struct rb_node *node;
+
+	pr_out(t_format, "Calls/s", "Calls", "Total time", "TID", "Command");
+	pr_out(t_format, line, line, line, line, line);
+
+	while (!RB_EMPTY_ROOT(root)) {
+		node = rb_first(root);
+		rb_erase(node, root);
+		te = rb_entry(node, struct top_entry, link);
+
+		if (rows < 0 || rows-- > 0) {
+			t = find_task(&top_view.sessions, te->tid);
+
+			print_top_rate(te->nr_recent, duration);
+			pr_out("  %10"PRIu64"  ", te->nr_called);
+			print_time_unit(te->time_self);
+			pr_out("  %6d  %-s\n", te->tid, t ? t->comm : "");
+		}
+		free(te);
+	}
+}
+
+/**
+ * update_top_view - refresh the view if needed
+ * @final: whether the program was finished
+ *
+ * This function is called by the main thread of the recorder.  It
+ * merges the stats of all tasks and shows them every second.  The
+ * rate (calls/sec) is for the last interval, or for the whole
+ * execution when @final is %true.
+ */
+void update_top_view(bool final)
+{
+	struct top_view *tv = &top_view;
+	struct rb_root funcs = RB_ROOT;
+	struct rb_root sorted = RB_ROOT;
+	struct rb_root tasks = RB_ROOT;
+	struct top_task *tt;
+	struct top_entry *te;
+	struct rb_node *node;
+	uint64_t now = top_clock();
+	uint64_t duration = now - tv->last_update;
+	int func_rows = -1;
+	int task_rows = -1;
+	int nr_tasks = 0;
+
+	if (!final && duration < TOP_REFRESH_MSEC * NSEC_PER_MSEC)
+		return;
+
+	pthread_mutex_lock(&tv->lock);
+	for (node = rb_first(&tv->tasks); node; node = rb_next(node)) {
+		tt = rb_entry(node, struct top_task, node);
+		collect_top_task(tt, &funcs, &tasks);
+		nr_tasks++;
+	}
+	pthread_mutex_unlock(&tv->lock);
+
+	/* the functions were sorted by symbol, sort them by the key now */
+	while (!RB_EMPTY_ROOT(&funcs)) {
+		node = rb_first(&funcs);
+		rb_erase(node, &funcs);
+		te = rb_entry(node, struct top_entry, link);
+
+		if (final)
+			te->nr_recent = te->nr_called;
+		insert_top_entry(&sorted, te);
+	}
+
+	if (final) {
+		duration = now - tv->start;
+
+		/* tasks have the same rate too */
+		for (node = rb_first(&tasks); node; node = rb_next(node)) {
+			te = rb_entry(node, struct top_entry, link);
+			te->nr_recent = te->nr_called;
+		}
+	}
+
+	if (tv->tty) {
+		struct winsize ws;
+
+		/* fit in the screen: 6 lines for headers */
+		if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 16) {
+			task_rows = (ws.ws_row - 6) / 4;
+			if (task_rows > nr_tasks)
+				task_rows = nr_tasks;
+			func_rows = ws.ws_row - 6 - task_rows;
+		}
+
+		/* clear the screen */
+		pr_out("\033[H\033[J");
+	}
+
+	pr_out("# uftrace top: %s (%d tasks, %"PRIu64" sec%s)\n",
+	       tv->opts->exename, nr_tasks, (now - tv->start) / NSEC_PER_SEC,
+	       final ? ", finished" : "");
+	pr_out("\n");
+	print_top_funcs(&sorted, duration, func_rows);
+	pr_out("\n");
+	print_top_tasks(&tasks, duration, task_rows);
+
+	if (!tv->tty)
+		pr_out("\n");
+	fflush(outfp);
+
+	tv->last_update = now;
+}
+
+/**
+ * start_top_view - start to aggregate trace data
+ * @opts: uftrace command line options
+ */
+void start_top_view(struct opts *opts)
+{
+	top_view.opts = opts;
+	top_view.tty = isatty(fileno(outfp));
+	top_view.start = top_clock();
+	top_view.last_update = top_view.start;
+}
+
+/**
+ * finish_top_view - show the final result and release resources
+ */
+void finish_top_view(void)
+{
+	struct top_view *tv = &top_view;
+	struct top_task *tt;
+	struct top_func *func;
+	struct rb_node *node;
+
+	update_top_view(true);
+
+	while (!RB_EMPTY_ROOT(&tv->tasks)) {
+		node = rb_first(&tv->tasks);
+		rb_erase(node, &tv->tasks);
+		tt = rb_entry(node, struct top_task, node);
+
+		while (!RB_EMPTY_ROOT(&tt->funcs)) {
+			node = rb_first(&tt->funcs);
+			rb_erase(node, &tt->funcs);
+			func = rb_entry(node, struct top_func, node);
+			free(func);
+		}
+
+		pthread_mutex_destroy(&tt->lock);
+		free(tt->stack);
+		free(tt);
+	}
+
+	delete_sessions(&tv->sessions);
+}
+
+/* remove trigger actions which save arguments or return values */
+static char *strip_arg_triggers(char *trigger, bool *stripped)
+{
+	struct strv specs = STRV_INIT;
+	char *spec, *ret = NULL;
+	int i, j;
+
+	strv_split_quoted(&specs, trigger, ';');
+
+	strv_for_each(&specs, spec, i) {
+		struct strv acts = STRV_INIT;
+		char *act, *name = spec;
+		char *kept = NULL;
+
+		act = strchr(name, '@');
+		if (act == NULL)
+			continue;
+
+		*act++ = '\0';
+		strv_split_quoted(&acts, act, ',');
+
+		strv_for_each(&acts, act, j) {
+			if (!strncasecmp(act, "arg", 3) ||
+			    !strncasecmp(act, "fparg", 5) ||
+			    !strncasecmp(act, "retval", 6) ||
+			    !strncasecmp(act, "auto-args", 9)) {
+				*stripped = true;
+				continue;
+			}
+			kept = strjoin(kept, act, ",");
+		}
+		strv_free(&acts);
+
+		if (kept) {
+			xasprintf(&act, "%s@%s", name, kept);
+			ret = strjoin(ret, act, ";");
+			free(act);
+			free(kept);
+		}
+	}
+	strv_free(&specs);
+
+	return ret;
+}
+
+int command_top(int argc, char *argv[], struct opts *opts)
+{
+	char template[32] = "/tmp/uftrace-top-XXXXXX";
+	int fd;
+	int ret;
+
+	if (setup_top_sort(opts->sort_keys) < 0)
+		return -1;
+
+	if (opts->kernel || has_kernel_event(opts->event)) {
+		pr_warn("kernel tracing is not supported in top\n");
+		opts->kernel = false;
+	}
+
+	/* it only needs function entry and exit */
+	if (opts->args || opts->retval || opts->auto_args || opts->event) {
+		pr_warn("arguments and events are ignored in top\n");
+		opts->args = NULL;
+		opts->retval = NULL;
+		opts->auto_args = false;
+		opts->event = NULL;
+	}
+	if (opts->trigger) {
+		bool stripped = false;
+		char *trigger = strip_arg_triggers(opts->trigger, &stripped);
+
+		if (stripped)
+			pr_warn("arguments in triggers are ignored in top\n");
+
+		free(opts->trigger);
+		opts->trigger = trigger;
+	}
+
+	fd = mkstemp(template);
+	if (fd < 0)
+		pr_err("cannot create temp name");
+
+	close(fd);
+	unlink(template);
+
+	/* keep small metadata (like maps) there, but no trace data */
+	tmp_dirname = template;
+	atexit(cleanup_top_dir);
+
+	opts->dirname = template;
+
+	ret = command_record(argc, argv, opts);
+
+	cleanup_top_dir();
+	return ret;
+}
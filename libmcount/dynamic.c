@@ -115,7 +115,7 @@ static int do_dynamic_update(struct symtabs *symtabs, char *patch_funcs,
 		for (i = 0; i < symtab->nr_sym; i++) {
 			sym = &symtab->sym[i];
 
-			if (!match_filter_pattern(&patt, sym->name))
+			if (!match_filter_symbol(&patt, sym))
 				continue;
 
 			found = true;
@@ -41,11 +41,95 @@ static LIST_HEAD(events);
 /* event id which is allocated dynamically */
 static unsigned event_id = EVENT_ID_USER;
 
+/* hash table of events keyed by the probe address */
+static struct mcount_event_info **event_hash;
+static unsigned event_hash_size;
+
 __weak int mcount_arch_enable_event(struct mcount_event_info *mei)
 {
 	return 0;
 }
 
+__weak int mcount_arch_parse_sdt_arg(struct mcount_sdt_arg *arg, char *desc)
+{
+	return -1;
+}
+
+/*
+ * SDT arguments are separated by space and each has a form of
+ * "<size>@<operand>" where the operand is in the assembler syntax.
+ * Parse them once here so that the handler can read the values quickly.
+ */
+static void parse_sdt_args(struct mcount_event_info *mei)
+{
+	struct strv strv = STRV_INIT;
+	char *desc;
+	int i;
+
+	if (mei->arguments[0] == '\0')
+		return;
+
+	strv_split(&strv, mei->arguments, " ");
+	mei->args = xcalloc(strv.nr, sizeof(*mei->args));
+
+	strv_for_each(&strv, desc, i) {
+		struct mcount_sdt_arg *arg;
+		char *pos;
+
+		if (*desc == '\0')
+			continue;
+		if (mei->nr_args == EVENT_MAX_ARGS)
+			break;
+
+		arg = &mei->args[mei->nr_args++];
+		arg->size = sizeof(long);
+
+		pos = strchr(desc, '@');
+		if (pos) {
+			arg->size = strtol(desc, NULL, 0);
+			desc = pos + 1;
+		}
+
+		if (arg->size == 0 || arg->size > 8 || arg->size < -8 ||
+		    mcount_arch_parse_sdt_arg(arg, desc) < 0) {
+			pr_dbg("unsupported SDT argument: %s\n", desc);
+			arg->type = SDT_ARG_NONE;
+		}
+	}
+	strv_free(&strv);
+}
+
+static unsigned hash_event_addr(unsigned long addr)
+{
+	return (addr >> 2) * 2654435761U;
+}
+
+static void build_event_hash(void)
+{
+	struct mcount_event_info *mei;
+	unsigned nr = 0;
+	unsigned mask;
+
+	list_for_each_entry(mei, &events, list)
+		nr++;
+
+	/* keep the load factor under 0.5 */
+	event_hash_size = 16;
+	while (event_hash_size < nr * 2)
+		event_hash_size *= 2;
+
+	event_hash = xcalloc(event_hash_size, sizeof(*event_hash));
+	mask = event_hash_size - 1;
+
+	list_for_each_entry(mei, &events, list) {
+		unsigned slot = hash_event_addr(mei->addr) & mask;
+
+		while (event_hash[slot])
+			slot = (slot + 1) & mask;
+		event_hash[slot] = mei;
+	}
+}
+
 static int search_sdt_event(struct dl_phdr_info *info, size_t sz, void *data)
 {
 	const char *name = info->dlpi_name;
@@ -147,6 +231,10 @@ static int search_sdt_event(struct dl_phdr_info *info, size_t sz, void *data)
 		mei->provider  = xstrdup(vendor);
 		mei->event     = xstrdup(event);
 		mei->arguments = xstrdup(args);
+		mei->nr_args   = 0;
+		mei->args      = NULL;
+
+		parse_sdt_args(mei);
 
 		pr_dbg("adding SDT event (%s:%s) from %s at %#lx\n",
 		       mei->provider, mei->event, mei->module, mei->addr);
@@ -226,13 +314,18 @@ int mcount_setup_events(char *dirname, char *event_str,
 		pr_err("cannot open file: %s", filename);
 
 	list_for_each_entry(mei, &events, list) {
-		fprintf(fp, "EVENT: %u %s:%s\n",
-			mei->id, mei->provider, mei->event);
+		fprintf(fp, "EVENT: %u %s:%s", mei->id, mei->provider,
+			mei->event);
+		if (mei->nr_args)
+			fprintf(fp, " %s", mei->arguments);
+		fputc('\n', fp);
 	}
 
 	fclose(fp);
 	free(filename);
 
+	build_event_hash();
+
 	list_for_each_entry(mei, &events, list) {
 		/* ignore failures */
 		mcount_arch_enable_event(mei);
@@ -244,10 +337,17 @@ out:
 struct mcount_event_info * mcount_lookup_event(unsigned long addr)
 {
 	struct mcount_event_info *mei;
+	unsigned mask = event_hash_size - 1;
+	unsigned slot;
 
-	list_for_each_entry(mei, &events, list) {
+	if (event_hash == NULL)
+		return NULL;
+
+	slot = hash_event_addr(addr) & mask;
+	while ((mei = event_hash[slot]) != NULL) {
 		if (mei->addr == addr)
 			return mei;
+		slot = (slot + 1) & mask;
 	}
 	return NULL;
 }
@@ -263,8 +363,13 @@ void mcount_finish_events(void)
 {
 	struct mcount_event_info *mei, *tmp;
 
+	free(event_hash);
+	event_hash = NULL;
+	event_hash_size = 0;
+
 	list_for_each_entry_safe(mei, tmp, &events, list) {
 		list_del(&mei->list);
+		free(mei->args);
 		free(mei->module);
 		free(mei->provider);
 		free(mei->event);
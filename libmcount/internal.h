@@ -59,6 +59,8 @@ struct mcount_shmem {
 #define EVTBUF_SIZE  (ARGBUF_SIZE - 16)
 #define EVTBUF_HDR   (offsetof(struct mcount_event, data))
 
+struct script_batch;
+
 struct mcount_event {
 	uint64_t	time;
 	uint32_t	id;
@@ -96,6 +98,8 @@ struct mcount_thread_data {
 	struct mcount_event		event[MAX_EVENT];
 	int				nr_events;
 	struct mcount_arch_context	arch;
+	/* records for script (only if it supports batch) */
+	struct script_batch		*script_batch;
 };
 
 #ifdef HAVE_MCOUNT_ARCH_CONTEXT
@@ -290,7 +294,9 @@ extern void mcount_arch_get_retval(struct mcount_arg_context *ctx,
 
 extern enum filter_result mcount_entry_filter_check(struct mcount_thread_data *mtdp,
 						    unsigned long child,
-						    struct uftrace_trigger *tr);
+						    struct uftrace_trigger *tr,
+						    struct mcount_regs *regs,
+						    unsigned long *stack_base);
 extern void mcount_entry_filter_record(struct mcount_thread_data *mtdp,
 				       struct mcount_ret_stack *rstack,
 				       struct uftrace_trigger *tr,
@@ -332,6 +338,24 @@ int mcount_setup_trampoline(struct mcount_dynamic_info *adi);
 void mcount_cleanup_trampoline(struct mcount_dynamic_info *mdi);
 int mcount_patch_func(struct mcount_dynamic_info *mdi, struct sym *sym);
 
+enum mcount_sdt_arg_type {
+	SDT_ARG_NONE,		/* not supported, saved as 0 */
+	SDT_ARG_IMM,
+	SDT_ARG_REG,
+	SDT_ARG_MEM,
+};
+
+/* pre-parsed SDT argument like "-4@%edx" or "8@-16(%rbp)" */
+struct mcount_sdt_arg {
+	signed char		size;	/* negative for signed */
+	unsigned char		type;
+	signed char		reg;	/* arch-specific register index */
+	signed char		index;	/* index register for SDT_ARG_MEM */
+	unsigned char		scale;
+	unsigned char		shift;	/* for high byte registers */
+	long			val;	/* immediate value or offset */
+};
+
 struct mcount_event_info {
 	char *module;
 	char *provider;
@@ -341,16 +365,21 @@ struct mcount_event_info {
 	unsigned id;
 	unsigned long addr;
 	struct list_head list;
+
+	int nr_args;
+	struct mcount_sdt_arg *args;
 };
 
 int mcount_setup_events(char *dirname, char *event_str,
 			enum uftrace_pattern_type ptype);
 struct mcount_event_info * mcount_lookup_event(unsigned long addr);
-int mcount_save_event(struct mcount_event_info *mei);
+int mcount_save_event(struct mcount_event_info *mei, void *data,
+		      unsigned size);
 void mcount_finish_events(void);
 void mcount_list_events(void);
 
 int mcount_arch_enable_event(struct mcount_event_info *mei);
+int mcount_arch_parse_sdt_arg(struct mcount_sdt_arg *arg, char *desc);
 
 void mcount_hook_functions(void);
 
@@ -34,7 +34,7 @@ uint64_t mcount_threshold;
 
 /* symbol table of main executable */
 struct symtabs symtabs = {
-	.flags = SYMTAB_FL_DEMANGLE | SYMTAB_FL_ADJ_OFFSET,
+	.flags = SYMTAB_FL_ADJ_OFFSET,
 };
 
 /* size of shmem buffer to save uftrace_record */
@@ -130,10 +130,10 @@ static void mcount_filter_init(enum uftrace_pattern_type ptype)
 			     false, ptype);
 
 	if (autoargs_str) {
-		uftrace_setup_argument(get_auto_argspec_str(), &symtabs,
-				       &mcount_triggers, true, ptype);
-		uftrace_setup_retval(get_auto_retspec_str(), &symtabs,
-				     &mcount_triggers, true, ptype);
+		uftrace_setup_auto_args(&symtabs, &mcount_triggers,
+					TRIGGER_FL_ARGUMENT);
+		uftrace_setup_auto_args(&symtabs, &mcount_triggers,
+					TRIGGER_FL_RETVAL);
 	}
 
 	if (getenv("UFTRACE_DEPTH"))
@@ -213,6 +213,12 @@ static void mtd_dtor(void *arg)
 	mcount_filter_release(mtdp);
 	shmem_finish(mtdp);
 
+	if (mtdp->script_batch) {
+		script_finish_batch(mtdp->script_batch);
+		free(mtdp->script_batch);
+		mtdp->script_batch = NULL;
+	}
+
 	tmsg.pid = getpid(),
 	tmsg.tid = mcount_gettid(mtdp),
 	tmsg.time = mcount_gettime();
@@ -438,10 +444,50 @@ static bool mcount_check_rstack(struct mcount_thread_data *mtdp)
 #ifndef DISABLE_MCOUNT_FILTER
 extern void * get_argbuf(struct mcount_thread_data *, struct mcount_ret_stack *);
 
+/* read arguments and evaluate the predicate of the trigger */
+static bool mcount_check_predicate(struct uftrace_trigger *tr,
+				   struct mcount_regs *regs,
+				   unsigned long *stack_base)
+{
+	struct filter_predicate *pred = tr->pred;
+	unsigned long args[PRED_MAX_ARGS];
+	struct uftrace_arg_spec spec = {
+		.type = ARG_TYPE_INDEX,
+		.fmt  = ARG_FMT_AUTO,
+		.size = sizeof(long),
+	};
+	struct mcount_arg_context ctx = {
+		.regs       = regs,
+		.stack_base = stack_base,
+	};
+	int i;
+
+	/* cannot read arguments (e.g. -finstrument-functions) */
+	if (regs == NULL)
+		return true;
+
+	for (i = 0; i < pred->nr_args; i++) {
+		args[i] = 0;
+
+		/* no stack arguments for XRay */
+		if (stack_base == NULL && i >= ARCH_MAX_REG_ARGS)
+			continue;
+
+		spec.idx = i + 1;
+		ctx.val.i = 0;
+		mcount_arch_get_arg(&ctx, &spec);
+		args[i] = ctx.val.i;
+	}
+
+	return filter_predicate_match(pred, args);
+}
+
 /* update filter state from trigger result */
 enum filter_result mcount_entry_filter_check(struct mcount_thread_data *mtdp,
 					     unsigned long child,
-					     struct uftrace_trigger *tr)
+					     struct uftrace_trigger *tr,
+					     struct mcount_regs *regs,
+					     unsigned long *stack_base)
 {
 	pr_dbg3("<%d> enter %lx\n", mtdp->idx, child);
 
@@ -458,6 +504,22 @@ enum filter_result mcount_entry_filter_check(struct mcount_thread_data *mtdp,
 
 	uftrace_match_filter(child, &mcount_triggers, tr);
 
+	/*
+	 * A call failing the predicate is skipped like filtered-out ones,
+	 * but for notrace it just doesn't apply the filter.  Check it
+	 * before updating the filter counters so that they're balanced
+	 * at exit.
+	 */
+	if (unlikely(tr->flags & TRIGGER_FL_PREDICATE) &&
+	    !mcount_check_predicate(tr, regs, stack_base)) {
+		if (!(tr->flags & TRIGGER_FL_FILTER) ||
+		    tr->fmode != FILTER_MODE_OUT) {
+			tr->flags = 0;
+			return FILTER_OUT;
+		}
+		tr->flags &= ~(TRIGGER_FL_FILTER | TRIGGER_FL_PREDICATE);
+	}
+
 	pr_dbg3(" tr->flags: %lx, filter mode, count: [%d] %d/%d\n",
 		tr->flags, mcount_filter_mode, mtdp->filter.in_count,
 		mtdp->filter.out_count);
@@ -536,6 +598,22 @@ static int script_save_context(struct script_context *sc_ctx,
 	return 0;
 }
 
+/* save the record in a batch and pass it to script when it's full */
+static void script_hook_batch(struct mcount_thread_data *mtdp,
+			      struct script_context *sc_ctx, int type)
+{
+	if (mtdp->script_batch == NULL)
+		mtdp->script_batch = xzalloc(sizeof(*mtdp->script_batch));
+
+	if (!script_add_batch(mtdp->script_batch, sc_ctx, type))
+		return;
+
+	/* running script might change arch-context */
+	mcount_save_arch_context(&mtdp->arch);
+	script_flush_batch(mtdp->script_batch);
+	mcount_restore_arch_context(&mtdp->arch);
+}
+
 static void script_hook_entry(struct mcount_thread_data *mtdp,
 			      struct mcount_ret_stack *rstack,
 			      struct uftrace_trigger *tr)
@@ -550,6 +628,11 @@ static void script_hook_entry(struct mcount_thread_data *mtdp,
 				tr->pargs) < 0)
 		goto skip;
 
+	if (script_uftrace_batch) {
+		script_hook_batch(mtdp, &sc_ctx, UFTRACE_ENTRY);
+		goto skip;
+	}
+
 	/* accessing argument in script might change arch-context */
 	mcount_save_arch_context(&mtdp->arch);
 	script_uftrace_entry(&sc_ctx);
@@ -572,6 +655,11 @@ static void script_hook_exit(struct mcount_thread_data *mtdp,
 				rstack->pargs) < 0)
 		goto skip;
 
+	if (script_uftrace_batch) {
+		script_hook_batch(mtdp, &sc_ctx, UFTRACE_EXIT);
+		goto skip;
+	}
+
 	/* accessing argument in script might change arch-context */
 	mcount_save_arch_context(&mtdp->arch);
 	script_uftrace_exit(&sc_ctx);
@@ -763,7 +851,9 @@ void mcount_exit_filter_record(struct mcount_thread_data *mtdp,
 #else /* DISABLE_MCOUNT_FILTER */
 enum filter_result mcount_entry_filter_check(struct mcount_thread_data *mtdp,
 					     unsigned long child,
-					     struct uftrace_trigger *tr)
+					     struct uftrace_trigger *tr,
+					     struct mcount_regs *regs,
+					     unsigned long *stack_base)
 {
 	if (mcount_check_rstack(mtdp))
 		return FILTER_RSTACK;
@@ -824,7 +914,7 @@ int mcount_entry(unsigned long *parent_loc, unsigned long child,
 	}
 
 	tr.flags = 0;
-	filtered = mcount_entry_filter_check(mtdp, child, &tr);
+	filtered = mcount_entry_filter_check(mtdp, child, &tr, regs, parent_loc);
 	if (filtered != FILTER_IN) {
 		mcount_unguard_recursion(mtdp);
 		return -1;
@@ -919,7 +1009,7 @@ static int cygprof_entry(unsigned long parent, unsigned long child)
 			return -1;
 	}
 
-	filtered = mcount_entry_filter_check(mtdp, child, &tr);
+	filtered = mcount_entry_filter_check(mtdp, child, &tr, NULL, NULL);
 
 	if (unlikely(mtdp->in_exception)) {
 		unsigned long *frame_ptr;
@@ -1032,7 +1122,7 @@ void xray_entry(unsigned long parent, unsigned long child,
 			return;
 	}
 
-	filtered = mcount_entry_filter_check(mtdp, child, &tr);
+	filtered = mcount_entry_filter_check(mtdp, child, &tr, regs, NULL);
 
 	if (unlikely(mtdp->in_exception)) {
 		unsigned long *frame_ptr;
@@ -1110,8 +1200,9 @@ out:
 	mcount_unguard_recursion(mtdp);
 }
 
-/* save an asynchronous event */
-int mcount_save_event(struct mcount_event_info *mei)
+/* save an asynchronous event with optional data (i.e. arguments) */
+int mcount_save_event(struct mcount_event_info *mei, void *data,
+		      unsigned size)
 {
 	struct mcount_thread_data *mtdp;
 
@@ -1127,8 +1218,11 @@ int mcount_save_event(struct mcount_event_info *mei)
 
 		mtdp->event[i].id   = mei->id;
 		mtdp->event[i].time = mcount_gettime();
-		mtdp->event[i].dsize = 0;
+		mtdp->event[i].dsize = size;
 		mtdp->event[i].idx   = ASYNC_IDX;
+
+		if (size)
+			memcpy(mtdp->event[i].data, data, size);
 	}
 
 	return 0;
@@ -1142,8 +1236,15 @@ static void atfork_prepare_handler(void)
 	};
 
 	/* call script atfork preparation routine */
-	if (SCRIPT_ENABLED && script_str)
+	if (SCRIPT_ENABLED && script_str) {
+		struct mcount_thread_data *mtdp = get_thread_data();
+
+		/* pass pending records not to be duplicated in the child */
+		if (!check_thread_data(mtdp) && mtdp->script_batch)
+			script_flush_batch(mtdp->script_batch);
+
 		script_atfork_prepare();
+	}
 
 	uftrace_send_message(UFTRACE_MSG_FORK_START, &tmsg, sizeof(tmsg));
 }
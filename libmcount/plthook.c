@@ -232,7 +232,7 @@ static int find_got(Elf *elf, const char *modname,
 		pd->mod_name, pd->module_id, pd->base_addr ,pd->pltgot_ptr);
 
 	memset(&pd->dsymtab, 0, sizeof(pd->dsymtab));
-	load_elf_dynsymtab(&pd->dsymtab, elf, pd->base_addr, SYMTAB_FL_DEMANGLE);
+	load_elf_dynsymtab(&pd->dsymtab, elf, pd->base_addr, 0);
 
 	pd->resolved_addr = xcalloc(pd->dsymtab.nr_sym, sizeof(long));
 	pd->special_funcs = NULL;
@@ -789,7 +789,8 @@ unsigned long plthook_entry(unsigned long *ret_addr, unsigned long child_idx,
 	if (pd->dsymtab.nr_sym && child_idx < pd->dsymtab.nr_sym) {
 		sym = &pd->dsymtab.sym[child_idx];
 		pr_dbg2("[mod: %lx, idx: %d] enter %lx: %s\n",
-			module_id, child_idx, sym->addr, sym->name);
+			module_id, child_idx, sym->addr,
+			symbol_getname(sym, sym->addr));
 	}
 	else {
 		sym = NULL;
@@ -797,7 +798,8 @@ unsigned long plthook_entry(unsigned long *ret_addr, unsigned long child_idx,
 			  child_idx, pd->dsymtab.nr_sym, pd->mod_name);
 	}
 
-	filtered = mcount_entry_filter_check(mtdp, sym->addr, &tr);
+	filtered = mcount_entry_filter_check(mtdp, sym->addr, &tr,
+					     regs, ret_addr);
 	if (filtered != FILTER_IN) {
 		/*
 		 * Skip recording but still hook the return address,
@@ -895,10 +895,7 @@ void record_proc_maps(char *dirname, const char *sess_id,
 		map->end = end;
 		map->len = namelen;
 		mcount_memcpy1(map->prot, prot, 4);
-		map->symtab.sym = NULL;
-		map->symtab.sym_names = NULL;
-		map->symtab.nr_sym = 0;
-		map->symtab.nr_alloc = 0;
+		mcount_memset1(&map->symtab, 0, sizeof(map->symtab));
 		mcount_memcpy1(map->libname, path, namelen);
 		map->libname[strlen(path)] = '\0';
 		last_libname = map->libname;
@@ -226,6 +226,187 @@ def make_uftrace_args_format(args, funcname):
     return args_format
 
 
+# argspec suffix => (format, size) of the argspec record (size 0 = long)
+arg_formats = {
+    "":    ("ARG_FMT_AUTO", 0),
+    "c":   ("ARG_FMT_CHAR", 1),
+    "s":   ("ARG_FMT_STR", 0),
+    "S":   ("ARG_FMT_STD_STRING", 0),
+    "x":   ("ARG_FMT_HEX", 0),
+    "u":   ("ARG_FMT_UINT", 0),
+    "p":   ("ARG_FMT_FUNC_PTR", 0),
+    "d64": ("ARG_FMT_AUTO", 8),
+}
+
+def make_arg_records(spec):
+    # convert "func@arg1/x,arg2" or "func@retval/s" into argspec records
+    records = []
+    for arg in spec.split('@', 1)[1].split(','):
+        (name, _, suffix) = arg.partition('/')
+        if name == "retval":
+            idx = 0
+        else:
+            idx = int(name[3:])
+
+        if suffix.startswith("e:"):
+            records.append((idx, "ARG_FMT_ENUM", 0, suffix[2:]))
+        else:
+            (fmt, size) = arg_formats[suffix]
+            records.append((idx, fmt, size, None))
+    return records
+
+
+def strtol(s):
+    # same as strtol(s, NULL, 0) in C
+    s = s.strip()
+    sign = 1
+    if s.startswith('-'):
+        sign = -1
+        s = s[1:]
+    if s.lower().startswith("0x"):
+        return sign * int(s[2:], 16)
+    if len(s) > 1 and s.startswith('0'):
+        return sign * int(s[1:], 8)
+    return sign * int(s)
+
+
+def parse_enum_def(enum_str):
+    # "enum name { A, B = 2, };" => (name, [(str, val), ...])
+    m = re.match(r'enum\s+(\w+)\s*\{(.*)\}', enum_str)
+    name = m.group(1)
+    vals = []
+    val = 0
+    for item in m.group(2).split(','):
+        if item.strip() == "":
+            continue
+        (key, eq, num) = item.partition('=')
+        if eq:
+            val = strtol(num)
+        vals.append((key.strip(), val))
+        val += 1
+
+    # sort by value (descending) like parse_enum_string() does,
+    # later definition comes first for the same value
+    order = sorted(range(len(vals)), key=lambda i: (-vals[i][1], -i))
+    return (name, [vals[i] for i in order])
+
+
+FNV_OFFSET = 2166136261
+FNV_PRIME = 16777619
+MASK32 = 0xffffffff
+
+def auto_func_hash(name, seed):
+    # keep in sync with auto_func_hash() in utils/auto-args.c
+    h = (FNV_OFFSET ^ seed) & MASK32
+    for c in bytearray(name.encode()):
+        h = ((h ^ c) * FNV_PRIME) & MASK32
+    h ^= h >> 16
+    h = (h * 0x85ebca6b) & MASK32
+    h ^= h >> 13
+    h = (h * 0xc2b2ae35) & MASK32
+    h ^= h >> 16
+    return h
+
+
+def build_perfect_hash(names):
+    # hash-and-displace: returns per-bucket seeds and name for each slot
+    n = len(names)
+    buckets = [[] for i in range(n)]
+    for name in names:
+        buckets[auto_func_hash(name, 0) % n].append(name)
+
+    seeds = [0] * n
+    slots = [None] * n
+    order = sorted(range(n), key=lambda b: -len(buckets[b]))
+
+    for b in order:
+        keys = buckets[b]
+        if len(keys) <= 1:
+            break
+
+        seed = 1
+        while True:
+            pos = [auto_func_hash(k, seed) % n for k in keys]
+            if len(set(pos)) == len(pos) and \
+                    all(slots[p] is None for p in pos):
+                break
+            seed += 1
+
+        seeds[b] = seed
+        for (k, p) in zip(keys, pos):
+            slots[p] = k
+
+    # single-entry buckets use the free slot directly (as negative seed)
+    free_slots = [i for i in range(n) if slots[i] is None]
+    for b in order:
+        if len(buckets[b]) != 1:
+            continue
+        p = free_slots.pop()
+        seeds[b] = -(p + 1)
+        slots[p] = buckets[b][0]
+
+    return (seeds, slots)
+
+
+def write_tables(fout, enums, funcs):
+    # enum value tables (sorted by name for binary search)
+    enums = sorted(enums)
+
+    fout.write("static struct enum_val auto_enum_vals[] = {\n")
+    for (name, vals) in enums:
+        fout.write("\t/* %s */\n" % name)
+        for (key, val) in vals:
+            fout.write('\t{ "%s", %dL },\n' % (key, val))
+    fout.write("};\n\n")
+
+    fout.write("static struct enum_def auto_enum_defs[] = {\n")
+    i = 0
+    for (name, vals) in enums:
+        fout.write('\t{ "%s", &auto_enum_vals[%d], %d },\n' % (name, i, len(vals)))
+        i += len(vals)
+    fout.write("};\n\n")
+
+    # argspec records and function table indexed by the perfect hash
+    names = list(funcs)
+    (seeds, slots) = build_perfect_hash(names)
+
+    fout.write("static const struct auto_arg_rec auto_arg_recs[] = {\n")
+    func_recs = []
+    i = 0
+    for name in slots:
+        (args, retval) = funcs[name]
+        fout.write("\t/* %s */\n" % name)
+        for (idx, fmt, size, enum) in args + retval:
+            if enum:
+                enum = '"%s"' % enum
+            else:
+                enum = "NULL"
+            fout.write("\t{ %d, %s, %d, %s },\n" % (idx, fmt, size, enum))
+
+        if retval:
+            ret_idx = i + len(args)
+        else:
+            ret_idx = -1
+        func_recs.append((name, i, len(args), ret_idx))
+        i += len(args) + len(retval)
+    fout.write("};\n\n")
+
+    fout.write("static const struct auto_func_rec auto_func_recs[] = {\n")
+    for rec in func_recs:
+        fout.write('\t{ "%s", %d, %d, %d },\n' % rec)
+    fout.write("};\n\n")
+
+    fout.write("/* seeds of the minimal perfect hash for auto_func_recs */\n")
+    fout.write("static const int auto_func_seeds[] = {")
+    for i in range(len(seeds)):
+        if i % 8 == 0:
+            fout.write("\n\t")
+        else:
+            fout.write(" ")
+        fout.write("%d," % seeds[i])
+    fout.write("\n};\n")
+
+
 def parse_enum(line):
     # is this the final line (including semi-colon)
     if line.find(';') >= 0:
@@ -261,6 +442,8 @@ if __name__ == "__main__":
     enum_list = ""
     args_list = ""
     retvals_list = ""
+    enums = []
+    funcs = {}
 
     t = DECL_TYPE_NONE
     with open(prototype_file) as fin:
@@ -277,6 +460,7 @@ if __name__ == "__main__":
                 enum_format += curr
                 if t == DECL_TYPE_NONE:
                     enum_list += '\t"' + enum_format + '"\n'
+                    enums.append(parse_enum_def(enum_format))
                 continue
 
             t = get_decl_type(line)
@@ -286,6 +470,7 @@ if __name__ == "__main__":
                 (t, enum_format) = parse_enum(line)
                 if t == DECL_TYPE_NONE:
                     enum_list += '\t"' + enum_format + '"\n'
+                    enums.append(parse_enum_def(enum_format))
                 continue
 
             (return_type, funcname, args) = parse_func_decl(line)
@@ -305,6 +490,13 @@ if __name__ == "__main__":
             if args_format:
                 args_list += '\t"' + args_format + ';"\n'
 
+            if retval_format or args_format:
+                funcs[funcname] = ([], [])
+            if args_format:
+                funcs[funcname][0].extend(make_arg_records(args_format))
+            if retval_format:
+                funcs[funcname][1].extend(make_arg_records(retval_format))
+
     if verbose:
         print(enum_list)
         print(args_list)
@@ -332,5 +524,7 @@ if __name__ == "__main__":
     fout.write(retvals_list)
     fout.write(";\n\n")
 
+    write_tables(fout, enums, funcs)
+
     if argspec_file != "-":
         fout.close()
@@ -5,9 +5,10 @@
 //
 // Released under the GPL v2.
 //
-// This file is processed by gen-autoargs.py and it generates autoargs.h to be
-// used for --auto-args option.  Due to the limitation of space, it cannot
-// contain more function prototypes as of now.
+// This file is processed by gen-autoargs.py and it generates auto-args.h to
+// be used for --auto-args option.  The functions are kept in a (minimal)
+// perfect hash table which is looked up for each function to trace rather
+// than parsing all the prototypes at startup.
 //
 
 #include <sys/types.h>
@@ -0,0 +1,18 @@
+#include <stdlib.h>
+#include <sys/sdt.h>
+
+void foo(int n, unsigned char c, long l)
+{
+	STAP_PROBE3(uftrace, args, n, c, l);
+}
+
+int main(int argc, char *argv[])
+{
+	int n = -1;
+
+	if (argc > 1)
+		n = atoi(argv[1]);
+
+	foo(n, 200, 1000000000000L);
+	return 0;
+}
@@ -0,0 +1,32 @@
+#!/usr/bin/env python
+
+from runtest import TestBase
+import subprocess as sp
+
+TDIR='xxx'
+
+class TestCase(TestBase):
+    def __init__(self):
+        TestBase.__init__(self, 'thread', """
+  Total time   Self time       Calls  Function
+  ==========  ==========  ==========  ====================================
+   11.082 us    3.538 us           4  a
+    7.544 us    4.312 us           4  b
+    3.232 us    3.232 us           4  c
+    7.916 us    3.184 us           4  foo
+  101.335 us  101.335 us           4  pthread_create
+  289.624 us  289.624 us           4  pthread_join
+  415.712 us   16.753 us           1  main
+""", sort='report', ldflags='-pthread')
+
+    def pre(self):
+        record_cmd = '%s record -d %s %s' % (TestBase.uftrace_cmd, TDIR, 't-' + self.name)
+        sp.call(record_cmd.split())
+        return TestBase.TEST_SUCCESS
+
+    def runcmd(self):
+        return '%s report -d %s -s call,func --num-thread=2' % (TestBase.uftrace_cmd, TDIR)
+
+    def post(self, ret):
+        sp.call(['rm', '-rf', TDIR])
+        return ret
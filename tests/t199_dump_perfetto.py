@@ -0,0 +1,118 @@
+#!/usr/bin/env python
+
+import sys
+from runtest import TestBase
+import subprocess as sp
+
+TDIR='xxx'
+
+class TestCase(TestBase):
+    def __init__(self):
+        TestBase.__init__(self, 'abc', """
+process t-abc
+thread t-abc
+B main
+B a
+B b
+B c
+E c
+E b
+E a
+E main
+""", sort='simple')
+
+    def pre(self):
+        record_cmd = '%s record -d %s %s' % (TestBase.uftrace_cmd, TDIR, 't-' + self.name)
+        sp.call(record_cmd.split())
+        return TestBase.TEST_SUCCESS
+
+    def runcmd(self):
+        # decode the binary output using this script
+        return '%s dump -d %s -F main -D 4 --perfetto | %s %s' % \
+            (TestBase.uftrace_cmd, TDIR, sys.executable, __file__)
+
+    def post(self, ret):
+        sp.call(['rm', '-rf', TDIR])
+        return ret
+
+def read_varint(buf, pos):
+    val = 0
+    shift = 0
+    while True:
+        b = buf[pos]
+        pos += 1
+        val |= (b & 0x7f) << shift
+        shift += 7
+        if b < 0x80:
+            return val, pos
+
+def parse_message(buf):
+    """ returns a dict of field number to list of values """
+    fields = {}
+    pos = 0
+    while pos < len(buf):
+        key, pos = read_varint(buf, pos)
+        if key & 7 == 0:
+            val, pos = read_varint(buf, pos)
+        elif key & 7 == 2:
+            size, pos = read_varint(buf, pos)
+            val = buf[pos:pos+size]
+            pos += size
+        else:
+            raise ValueError('unknown wire type: %d' % (key & 7))
+        fields.setdefault(key >> 3, []).append(val)
+    return fields
+
+def decode_perfetto(buf):
+    names = {}
+    stacks = {}
+    default_track = 0
+    last_time = 0
+    prev_time = 0
+
+    for data in parse_message(buf).get(1, []):
+        pkt = parse_message(data)
+        if pkt.get(13, [0])[0] & 1:
+            names = {}
+        for snapshot in pkt.get(6, []):
+            for clock in parse_message(snapshot).get(1, []):
+                clock = parse_message(clock)
+                if clock.get(3):
+                    last_time = clock[2][0]
+        for defaults in pkt.get(59, []):
+            for ev in parse_message(defaults).get(11, []):
+                default_track = parse_message(ev)[11][0]
+        for interned in pkt.get(12, []):
+            for ev in parse_message(interned).get(2, []):
+                ev = parse_message(ev)
+                names[ev[1][0]] = ev[2][0].decode()
+        for desc in pkt.get(60, []):
+            desc = parse_message(desc)
+            if 3 in desc:
+                print('process %s' % parse_message(desc[3][0])[6][0].decode())
+            if 4 in desc:
+                print('thread %s' % parse_message(desc[4][0])[5][0].decode())
+        for event in pkt.get(11, []):
+            event = parse_message(event)
+            if 58 in pkt:
+                time = pkt[8][0]
+            else:
+                last_time += pkt[8][0]
+                time = last_time
+            if time < prev_time:
+                print('time goes backward')
+            prev_time = time
+
+            track = event.get(11, [default_track])[0]
+            stack = stacks.setdefault(track, [])
+            if event[9][0] == 1:
+                stack.append(names[event[10][0]])
+                print('B %s' % stack[-1])
+            elif stack:
+                print('E %s' % stack.pop())
+            else:
+                # forked child can return without entry
+                print('E')
+
+if __name__ == '__main__':
+    decode_perfetto(bytearray(getattr(sys.stdin, 'buffer', sys.stdin).read()))
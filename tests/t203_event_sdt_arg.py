@@ -0,0 +1,19 @@
+#!/usr/bin/env python
+
+from runtest import TestBase
+
+class TestCase(TestBase):
+    def __init__(self):
+        TestBase.__init__(self, 'sdt-arg', """
+# DURATION    TID     FUNCTION
+   9.392 us [28141] | __monstartup();
+  12.912 us [28141] | __cxa_atexit();
+            [28141] | main() {
+            [28141] |   foo() {
+            [28141] |     /* uftrace:args (-1, 200, 1000000000000) */
+   2.896 us [28141] |   } /* foo */
+   3.017 us [28141] | } /* main */
+""")
+
+    def runcmd(self):
+        return '%s -E uftrace:args %s' % (TestBase.uftrace_cmd, 't-' + self.name)
@@ -0,0 +1,63 @@
+#!/usr/bin/env python
+
+from runtest import TestBase
+import subprocess as sp
+import os.path
+import time
+
+TDIR  = 'xxx'
+PORT  = '8094'
+NR_CLIENT = 4
+
+class TestCase(TestBase):
+    def __init__(self):
+        TestBase.__init__(self, 'abc', """
+# DURATION    TID     FUNCTION
+  62.202 us [28141] | __cxa_atexit();
+            [28141] | main() {
+            [28141] |   a() {
+            [28141] |     b() {
+            [28141] |       c() {
+   0.753 us [28141] |         getpid();
+   1.430 us [28141] |       } /* c */
+   1.915 us [28141] |     } /* b */
+   2.405 us [28141] |   } /* a */
+   3.005 us [28141] | } /* main */
+""")
+
+    recv_p = None
+
+    def pre(self):
+        recv_cmd = '%s recv -d %s --port %s --num-thread 2' % \
+                   (TestBase.uftrace_cmd, TDIR, PORT)
+        self.recv_p = sp.Popen(recv_cmd.split())
+        time.sleep(0.1)
+
+        # send data from multiple clients at the same time
+        clients = []
+        for i in range(NR_CLIENT):
+            record_cmd = '%s record -H localhost --port %s -d data%d %s' % \
+                         (TestBase.uftrace_cmd, PORT, i, 't-' + self.name)
+            clients.append(sp.Popen(record_cmd.split()))
+
+        for p in clients:
+            if p.wait() != 0:
+                return TestBase.TEST_NONZERO_RETURN
+
+        # wait for the recv threads to write all data
+        time.sleep(0.5)
+
+        for i in range(NR_CLIENT):
+            if not os.path.exists(os.path.join(TDIR, 'data%d' % i, 'info')):
+                return TestBase.TEST_DIFF_RESULT
+
+        return TestBase.TEST_SUCCESS
+
+    def runcmd(self):
+        return '%s replay -d %s' % (TestBase.uftrace_cmd,
+                                    os.path.join(TDIR, 'data%d' % (NR_CLIENT - 1)))
+
+    def post(self, ret):
+        self.recv_p.terminate()
+        sp.call(['rm', '-rf', TDIR])
+        return ret
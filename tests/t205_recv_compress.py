@@ -0,0 +1,46 @@
+#!/usr/bin/env python
+
+from runtest import TestBase
+import subprocess as sp
+import time
+
+TDIR  = 'xxx'
+TDIR2 = 'xxx/uftrace.data'
+PORT  = '8095'
+
+class TestCase(TestBase):
+    def __init__(self):
+        TestBase.__init__(self, 'abc', """
+# DURATION    TID     FUNCTION
+  62.202 us [28141] | __cxa_atexit();
+            [28141] | main() {
+            [28141] |   a() {
+            [28141] |     b() {
+            [28141] |       c() {
+   0.753 us [28141] |         getpid();
+   1.430 us [28141] |       } /* c */
+   1.915 us [28141] |     } /* b */
+   2.405 us [28141] |   } /* a */
+   3.005 us [28141] | } /* main */
+""")
+
+    recv_p = None
+
+    def pre(self):
+        recv_cmd = '%s recv -d %s --port %s' % (TestBase.uftrace_cmd, TDIR, PORT)
+        self.recv_p = sp.Popen(recv_cmd.split())
+        time.sleep(0.1)
+
+        record_cmd = '%s record -H %s --port %s --compress %s' % \
+                     (TestBase.uftrace_cmd, 'localhost', PORT, 't-' + self.name)
+        if sp.call(record_cmd.split()) != 0:
+            return TestBase.TEST_NONZERO_RETURN
+        return TestBase.TEST_SUCCESS
+
+    def runcmd(self):
+        return '%s replay -d %s' % (TestBase.uftrace_cmd, TDIR2)
+
+    def post(self, ret):
+        self.recv_p.terminate()
+        sp.call(['rm', '-rf', TDIR])
+        return ret
@@ -0,0 +1,43 @@
+#!/usr/bin/env python
+
+from runtest import TestBase
+
+class TestCase(TestBase):
+    def __init__(self):
+        TestBase.__init__(self, 'abc', """
+# uftrace top: t-abc (1 tasks, 0 sec, finished)
+
+    Calls/s       Calls  Total time   Self time    Max time  Function
+  =========  ==========  ==========  ==========  ==========  ====================
+         60           1    2.147 us    0.205 us    2.147 us  main
+         60           1    1.942 us    0.282 us    1.942 us  a
+         60           1    1.660 us    0.251 us    1.660 us  b
+         60           1    1.409 us    0.581 us    1.409 us  c
+         60           1    1.048 us    1.048 us    1.048 us  __cxa_atexit
+         60           1    0.828 us    0.828 us    0.828 us  getpid
+
+    Calls/s       Calls  Total time     TID  Command
+  =========  ==========  ==========  ======  ====================
+        424           6    5.482 us   24524  t-abc
+""")
+
+    def runcmd(self):
+        return '%s top %s' % (TestBase.uftrace_cmd, 't-' + self.name)
+
+    def sort(self, output):
+        """ This function post-processes output of the test to be compared .
+            It only checks function names and calls in the final result.  """
+        result = []
+        final = output.split('finished)')[-1]
+        for ln in final.split('\n'):
+            line = ln.split()
+            # A function line consists of following data
+            # [0]   [1]    [2]         [3]   [4]        [5]   [6]       [7]   [8]
+            # rate  calls  total_time  unit  self_time  unit  max_time  unit  function
+            if len(line) != 9 or not line[0].isdigit():
+                continue
+            if line[8].startswith('__'):
+                continue
+            result.append('%s %s' % (line[1], line[8]))
+
+        return '\n'.join(sorted(result))
@@ -0,0 +1,52 @@
+#!/usr/bin/env python
+
+from runtest import TestBase
+import subprocess as sp
+
+TDIR='xxx'
+
+UNITS = { 'us': 1000, 'ms': 1000000, 's': 1000000000 }
+
+class TestCase(TestBase):
+    def __init__(self):
+        TestBase.__init__(self, 'thread', """
+  Total time   Self time       Calls         p50         p90         p99       p99.9  Function
+  ==========  ==========  ==========  ==========  ==========  ==========  ==========  ====================
+   11.082 us    3.538 us           4    2.771 us    2.912 us    2.912 us    2.912 us  a
+    7.544 us    4.312 us           4    1.886 us    1.987 us    1.987 us    1.987 us  b
+    3.232 us    3.232 us           4    0.808 us    0.842 us    0.842 us    0.842 us  c
+    7.916 us    3.184 us           4    1.979 us    2.079 us    2.079 us    2.079 us  foo
+  101.335 us  101.335 us           4   25.333 us   31.817 us   31.817 us   31.817 us  pthread_create
+  289.624 us  289.624 us           4   72.406 us   99.150 us   99.150 us   99.150 us  pthread_join
+  415.712 us   16.753 us           1  415.712 us  415.712 us  415.712 us  415.712 us  main
+""", ldflags='-pthread')
+
+    def pre(self):
+        record_cmd = '%s record -d %s %s' % (TestBase.uftrace_cmd, TDIR, 't-' + self.name)
+        sp.call(record_cmd.split())
+        return TestBase.TEST_SUCCESS
+
+    def runcmd(self):
+        return '%s report -d %s --percentile -s call,func --num-thread=2' % (TestBase.uftrace_cmd, TDIR)
+
+    def post(self, ret):
+        sp.call(['rm', '-rf', TDIR])
+        return ret
+
+    def sort(self, output, ignore_children=False):
+        """ This function checks percentiles are in order and
+            returns call count and name of each function.  """
+        result = []
+        for ln in output.split('\n'):
+            line = ln.split()
+            if len(line) != 14 or line[0] == 'Total':
+                continue
+            if line[13].startswith('__'):
+                continue
+            # [0]/[1] total, [2]/[3] self, [4] calls,
+            # [5]/[6] p50, ... [11]/[12] p99.9, [13] function
+            times = [float(line[i]) * UNITS.get(line[i+1], 1) for i in range(5, 13, 2)]
+            status = 'ok' if times == sorted(times) else 'unordered'
+            result.append('%s %s %s' % (line[4], line[13], status))
+
+        return '\n'.join(result)
@@ -0,0 +1,47 @@
+#!/usr/bin/env python
+
+import re
+from runtest import TestBase
+import subprocess as sp
+
+TDIR='xxx'
+
+class TestCase(TestBase):
+    def __init__(self):
+        TestBase.__init__(self, 'thread', """
+    Duration     TID  Time range                         Call path
+  ==========  ======  =================================  ====================
+    0.930 us    9406  18057.332346065~18057.332346995    foo > a
+    0.613 us    9408  18057.332660749~18057.332661362    foo > a
+""", ldflags='-pthread')
+
+    def pre(self):
+        record_cmd = '%s record -d %s %s' % (TestBase.uftrace_cmd, TDIR, 't-' + self.name)
+        sp.call(record_cmd.split())
+        return TestBase.TEST_SUCCESS
+
+    def runcmd(self):
+        return '%s report -d %s --slowest=2 -F a' % (TestBase.uftrace_cmd, TDIR)
+
+    def post(self, ret):
+        sp.call(['rm', '-rf', TDIR])
+        return ret
+
+    def sort(self, output, ignore_children=False):
+        """ This function checks time range of each call and
+            returns the call path.  """
+        result = []
+        for ln in output.split('\n'):
+            line = ln.split(None, 4)
+            if len(line) < 5 or line[0] == 'Duration':
+                continue
+            m = re.match(r'^(\d+)\.(\d{9})~(\d+)\.(\d{9})$', line[3])
+            if m is None:
+                result.append('invalid range: %s' % line[3])
+                continue
+            start = int(m.group(1)) * 1000000000 + int(m.group(2))
+            end = int(m.group(3)) * 1000000000 + int(m.group(4))
+            status = 'ok' if start < end else 'invalid'
+            result.append('%s %s' % (line[4], status))
+
+        return '\n'.join(result)
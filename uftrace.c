@@ -72,6 +72,7 @@ enum options {
 	OPT_bind_not,
 	OPT_task_newline,
 	OPT_chrome_trace,
+	OPT_perfetto_trace,
 	OPT_flame_graph,
 	OPT_sample_time,
 	OPT_diff,
@@ -96,6 +97,14 @@ enum options {
 	OPT_auto_args,
 	OPT_libname,
 	OPT_match_type,
+	OPT_max_open_files,
+	OPT_compress,
+	OPT_frame,
+	OPT_stream,
+	OPT_percentile,
+	OPT_histogram,
+	OPT_slowest,
+	OPT_report_summary,
 };
 
 static struct argp_option uftrace_options[] = {
@@ -122,15 +131,22 @@ static struct argp_option uftrace_options[] = {
 	{ "kernel", 'k', 0, 0, "Trace kernel functions also (if supported)" },
 	{ "host", 'H', "HOST", 0, "Send trace data to HOST instead of write to file" },
 	{ "port", OPT_port, "PORT", 0, "Use PORT for network connection (default: 8090)" },
+	{ "compress", OPT_compress, 0, 0, "Compress trace data sent to the network" },
+	{ "frame", OPT_frame, 0, 0, "Send trace data in frames without blocking" },
+	{ "stream", OPT_stream, 0, 0, "Show output while the program is running (live)" },
 	{ "no-pager", OPT_nopager, 0, 0, "Do not use pager" },
 	{ "sort", 's', "KEY[,KEY,...]", 0, "Sort reported functions by KEYs (default: total)" },
 	{ "avg-total", OPT_avg_total, 0, 0, "Show average/min/max of total function time" },
 	{ "avg-self", OPT_avg_self, 0, 0, "Show average/min/max of self function time" },
+	{ "percentile", OPT_percentile, 0, 0, "Show percentiles (p50/p90/p99/p99.9) of function time" },
+	{ "histogram", OPT_histogram, "FUNC", 0, "Show histogram of FUNC time" },
+	{ "slowest", OPT_slowest, "NUM", 0, "Show NUM slowest calls of each function" },
 	{ "color", OPT_color, "SET", 0, "Use color for output: yes, no, auto (default: auto)" },
 	{ "disable", OPT_disabled, 0, 0, "Start with tracing disabled" },
 	{ "demangle", OPT_demangle, "TYPE", 0, "C++ symbol demangling: full, simple, no (default: simple)" },
 	{ "debug-domain", OPT_dbg_domain, "DOMAIN", 0, "Filter debugging domain" },
 	{ "report", OPT_report, 0, 0, "Show live report" },
+	{ "report-summary", OPT_report_summary, 0, 0, "Save report summary after recording" },
 	{ "column-view", OPT_column_view, 0, 0, "Print tasks in separate columns" },
 	{ "column-offset", OPT_column_offset, "DEPTH", 0, "Offset of each column (default: 8)" },
 	{ "no-pltbind", OPT_bind_not, 0, 0, "Do not bind dynamic symbols (LD_BIND_NOT)" },
@@ -139,9 +155,10 @@ static struct argp_option uftrace_options[] = {
 	{ "argument", 'A', "FUNC@arg[,arg,...]", 0, "Show function arguments" },
 	{ "retval", 'R', "FUNC@retval", 0, "Show function return value" },
 	{ "chrome", OPT_chrome_trace, 0, 0, "Dump recorded data in chrome trace format" },
+	{ "perfetto", OPT_perfetto_trace, 0, 0, "Dump recorded data in perfetto trace format" },
 	{ "diff", OPT_diff, "DATA", 0, "Report differences" },
 	{ "sort-column", OPT_sort_column, "INDEX", 0, "Sort diff report on column INDEX (default: 2)" },
-	{ "num-thread", OPT_num_thread, "NUM", 0, "Create NUM recorder threads" },
+	{ "num-thread", OPT_num_thread, "NUM", 0, "Create NUM recorder (or report, replay, recv) threads" },
 	{ "no-comment", OPT_no_comment, 0, 0, "Don't show comments of returned functions" },
 	{ "libmcount-single", OPT_libmcount_single, 0, 0, "Use single thread version of libmcount" },
 	{ "rt-prio", OPT_rt_prio, "PRIO", 0, "Record with real-time (FIFO) priority" },
@@ -168,6 +185,7 @@ static struct argp_option uftrace_options[] = {
 	{ "auto-args", OPT_auto_args, 0, 0, "Show arguments and return value of known functions" },
 	{ "libname", OPT_libname, 0, 0, "Show libname name with symbol name" },
 	{ "match", OPT_match_type, "TYPE", 0, "Support pattern match: regex, glob (default: regex)" },
+	{ "max-open-files", OPT_max_open_files, "NUM", 0, "Open at most NUM task data files at once" },
 	{ "help", 'h', 0, 0, "Give this help list" },
 	{ 0 }
 };
@@ -549,6 +567,22 @@ static error_t parse_option(int key, char *arg, struct argp_state *state)
 		opts->avg_self = true;
 		break;
 
+	case OPT_percentile:
+		opts->percentile = true;
+		break;
+
+	case OPT_histogram:
+		opts->histogram = opt_add_string(opts->histogram, arg);
+		break;
+
+	case OPT_slowest:
+		opts->nr_slowest = strtol(arg, NULL, 0);
+		if (opts->nr_slowest <= 0) {
+			pr_use("invalid number of slowest calls: %s\n", arg);
+			opts->nr_slowest = 0;
+		}
+		break;
+
 	case OPT_color:
 		opts->color = parse_color(arg);
 		if (opts->color == COLOR_UNKNOWN) {
@@ -601,6 +635,10 @@ static error_t parse_option(int key, char *arg, struct argp_state *state)
 		opts->chrome_trace = true;
 		break;
 
+	case OPT_perfetto_trace:
+		opts->perfetto_trace = true;
+		break;
+
 	case OPT_flame_graph:
 		opts->flame_graph = true;
 		break;
@@ -723,6 +761,30 @@ static error_t parse_option(int key, char *arg, struct argp_state *state)
 		}
 		break;
 
+	case OPT_max_open_files:
+		opts->max_open_files = strtol(arg, NULL, 0);
+		if (opts->max_open_files < 0) {
+			pr_use("invalid max open files: %s (ignoring...)\n", arg);
+			opts->max_open_files = 0;
+		}
+		break;
+
+	case OPT_compress:
+		opts->compress = true;
+		break;
+
+	case OPT_frame:
+		opts->frame = true;
+		break;
+
+	case OPT_report_summary:
+		opts->report_summary = true;
+		break;
+
+	case OPT_stream:
+		opts->stream = true;
+		break;
+
 	case ARGP_KEY_ARG:
 		if (state->arg_num) {
 			/*
@@ -750,6 +812,8 @@ static error_t parse_option(int key, char *arg, struct argp_state *state)
 			opts->mode = UFTRACE_MODE_GRAPH;
 		else if (!strcmp("script", arg))
 			opts->mode = UFTRACE_MODE_SCRIPT;
+		else if (!strcmp("top", arg))
+			opts->mode = UFTRACE_MODE_TOP;
 		else
 			return ARGP_ERR_UNKNOWN; /* almost same as fall through */
 		break;
@@ -777,6 +841,7 @@ static error_t parse_option(int key, char *arg, struct argp_state *state)
 			switch (opts->mode) {
 			case UFTRACE_MODE_RECORD:
 			case UFTRACE_MODE_LIVE:
+			case UFTRACE_MODE_TOP:
 				argp_usage(state);
 				break;
 			default:
@@ -802,7 +867,7 @@ static void parse_opt_file(int *argc, char ***argv, char *filename, struct opts
 	struct argp file_argp = {
 		.options = uftrace_options,
 		.parser = parse_option,
-		.args_doc = "[record|replay|live|report|info|dump|recv|graph|script] [<program>]",
+		.args_doc = "[record|replay|live|report|info|dump|recv|graph|script|top] [<program>]",
 		.doc = "uftrace -- function (graph) tracer for userspace",
 	};
 	char *orig_exename = NULL;
@@ -875,7 +940,7 @@ void parse_script_opt(struct opts *opts)
 	struct argp opt_argp = {
 		.options = uftrace_options,
 		.parser = parse_option,
-		.args_doc = "[record|replay|live|report|info|dump|recv|graph|script] [<program>]",
+		.args_doc = "[record|replay|live|report|info|dump|recv|graph|script|top] [<program>]",
 		.doc = "uftrace -- function (graph) tracer for userspace",
 	};
 
@@ -931,6 +996,7 @@ static void free_opts(struct opts *opts)
 	free(opts->retval);
 	free(opts->tid);
 	free(opts->event);
+	free(opts->histogram);
 }
 
 #ifndef UNIT_TEST
@@ -957,7 +1023,7 @@ int main(int argc, char *argv[])
 	struct argp argp = {
 		.options = uftrace_options,
 		.parser = parse_option,
-		.args_doc = "[record|replay|live|report|info|dump|recv|graph|script] [<program>]",
+		.args_doc = "[record|replay|live|report|info|dump|recv|graph|script|top] [<program>]",
 		.doc = "uftrace -- function (graph) tracer for userspace",
 	};
 	int ret = -1;
@@ -1002,10 +1068,13 @@ int main(int argc, char *argv[])
 	setup_color(opts.color);
 	setup_signal();
 
-	if (opts.mode == UFTRACE_MODE_RECORD || opts.mode == UFTRACE_MODE_RECV)
+	if (opts.mode == UFTRACE_MODE_RECORD || opts.mode == UFTRACE_MODE_RECV ||
+	    opts.mode == UFTRACE_MODE_TOP)
 		opts.use_pager = false;
 	if (opts.nop)
 		opts.use_pager = false;
+	if (opts.perfetto_trace)
+		opts.use_pager = false;
 
 	if (opts.use_pager)
 		start_pager();
@@ -1038,6 +1107,9 @@ int main(int argc, char *argv[])
 	case UFTRACE_MODE_SCRIPT:
 		ret = command_script(argc, argv, &opts);
 		break;
+	case UFTRACE_MODE_TOP:
+		ret = command_top(argc, argv, &opts);
+		break;
 	case UFTRACE_MODE_INVALID:
 		ret = 1;
 		break;
@@ -55,6 +55,7 @@ enum uftrace_feat_bits {
 	EVENT_BIT,
 	PERF_EVENT_BIT,
 	AUTO_ARGS_BIT,
+	EVENT_ARGS_BIT,
 
 	FEAT_BIT_MAX,
 
@@ -69,6 +70,7 @@ enum uftrace_feat_bits {
 	EVENT			= (1U << EVENT_BIT),
 	PERF_EVENT		= (1U << PERF_EVENT_BIT),
 	AUTO_ARGS		= (1U << AUTO_ARGS_BIT),
+	EVENT_ARGS		= (1U << EVENT_ARGS_BIT),
 };
 
 enum uftrace_info_bits {
@@ -145,6 +147,14 @@ struct uftrace_session_link {
 	struct uftrace_session *first;
 };
 
+/* min-heap of stream (task or cpu) indices ordered by next timestamp */
+struct uftrace_rstack_heap {
+	int		nr;
+	int		*idx;
+	uint64_t	*time;
+	bool		ready;
+};
+
 struct ftrace_file_handle {
 	FILE *fp;
 	int sock;
@@ -155,7 +165,14 @@ struct ftrace_file_handle {
 	struct uftrace_perf_reader *perf;
 	struct ftrace_task_handle *tasks;
 	struct uftrace_session_link sessions;
+	struct uftrace_rstack_heap task_heap;
+	struct uftrace_rstack_heap perf_heap;
+	int *task_hash;
 	int nr_tasks;
+	int task_hash_size;
+	struct list_head open_files;
+	int nr_open_files;
+	int max_open_files;
 	int nr_perf;
 	int last_perf_idx;
 	int depth;
@@ -176,6 +193,7 @@ struct ftrace_file_handle {
 #define UFTRACE_MODE_DUMP    7
 #define UFTRACE_MODE_GRAPH   8
 #define UFTRACE_MODE_SCRIPT  9
+#define UFTRACE_MODE_TOP     10
 
 #define UFTRACE_MODE_DEFAULT  UFTRACE_MODE_LIVE
 
@@ -199,15 +217,18 @@ struct opts {
 	char *opt_file;
 	char *script_file;
 	char *diff_policy;
+	char *histogram;
 	int mode;
 	int idx;
 	int depth;
 	int kernel_depth;
 	int max_stack;
+	int max_open_files;
 	int port;
 	int color;
 	int column_offset;
 	int sort_column;
+	int nr_slowest;
 	int nr_thread;
 	int rt_prio;
 	unsigned long bufsize;
@@ -226,12 +247,14 @@ struct opts {
 	bool use_pager;
 	bool avg_total;
 	bool avg_self;
+	bool percentile;
 	bool disabled;
 	bool report;
 	bool column_view;
 	bool want_bind_not;
 	bool task_newline;
 	bool chrome_trace;
+	bool perfetto_trace;
 	bool comment;
 	bool flame_graph;
 	bool libmcount_single;
@@ -245,6 +268,10 @@ struct opts {
 	bool record;
 	bool auto_args;
 	bool libname;
+	bool compress;
+	bool frame;
+	bool stream;
+	bool report_summary;
 	struct uftrace_time_range range;
 	enum uftrace_pattern_type patt_type;
 };
@@ -266,18 +293,36 @@ int command_recv(int argc, char *argv[], struct opts *opts);
 int command_dump(int argc, char *argv[], struct opts *opts);
 int command_graph(int argc, char *argv[], struct opts *opts);
 int command_script(int argc, char *argv[], struct opts *opts);
+int command_top(int argc, char *argv[], struct opts *opts);
+
+void save_report_summary(struct opts *opts);
 
 extern volatile bool uftrace_done;
 
 int open_data_file(struct opts *opts, struct ftrace_file_handle *handle);
+int open_stream_data(struct opts *opts, struct ftrace_file_handle *handle);
 void close_data_file(struct opts *opts, struct ftrace_file_handle *handle);
+int open_shared_data_file(struct opts *opts, struct ftrace_file_handle *handle,
+			  struct ftrace_file_handle *orig);
+void close_shared_data_file(struct ftrace_file_handle *handle);
 int read_task_file(struct uftrace_session_link *sess, char *dirname,
 		   bool needs_session, bool sym_rel_addr);
 int read_task_txt_file(struct uftrace_session_link *sess, char *dirname,
 		       bool needs_session, bool sym_rel_addr);
+int read_events_file(struct ftrace_file_handle *handle);
 
 #define SESSION_ID_LEN  16
 
+/* direct-mapped cache of symbol lookup in a session (addr -> sym) */
+#define SESSION_SYM_CACHE_BITS  12
+#define SESSION_SYM_CACHE_SIZE  (1 << SESSION_SYM_CACHE_BITS)
+
+struct uftrace_sym_cache {
+	uint64_t		 addr;
+	struct uftrace_session	*sess;
+	struct sym		*sym;
+};
+
 struct uftrace_session {
 	struct rb_node		 node;
 	char			 sid[SESSION_ID_LEN];
@@ -287,6 +332,7 @@ struct uftrace_session {
 	struct rb_root		 filters;
 	struct rb_root		 fixups;
 	struct list_head	 dlopen_libs;
+	struct uftrace_sym_cache *sym_cache;
 	int 			 namelen;
 	char 			 exename[];
 };
@@ -335,6 +381,7 @@ enum uftrace_msg_type {
 	UFTRACE_MSG_SEND_INFO,
 	UFTRACE_MSG_SEND_META_DATA,
 	UFTRACE_MSG_SEND_END,
+	UFTRACE_MSG_SEND_FRAME,
 };
 
 /* msg format for communicating by pipe */
@@ -345,6 +392,17 @@ struct uftrace_msg {
 	unsigned char data[];
 };
 
+/* a frame contains a number of UFTRACE_MSG_SEND_* messages */
+struct uftrace_msg_frame {
+	uint32_t size;     /* total size of messages (before compression) */
+	uint32_t csum;     /* adler32 checksum of the payload (after compression) */
+	uint32_t flags;    /* UFTRACE_MSG_FRAME_* */
+	uint32_t nr_msgs;
+	unsigned char data[];
+};
+
+#define UFTRACE_MSG_FRAME_ZLIB  (1U << 0)
+
 struct uftrace_msg_task {
 	uint64_t time;
 	int32_t  pid;
@@ -386,9 +444,16 @@ void session_add_dlopen(struct uftrace_session *sess, uint64_t timestamp,
 			unsigned long base_addr, const char *libname);
 struct sym * session_find_dlsym(struct uftrace_session *sess, uint64_t timestamp,
 				unsigned long addr);
+struct sym * session_find_sym(struct uftrace_session *sess, uint64_t timestamp,
+			      uint64_t addr);
+void session_setup_thread_cache(void);
+void session_finish_thread_cache(void);
 void delete_sessions(struct uftrace_session_link *sess);
 
 struct uftrace_record;
+struct uftrace_session * task_find_session(struct uftrace_session_link *sess,
+					   struct ftrace_task_handle *task,
+					   uint64_t timestamp);
 struct sym * task_find_sym(struct uftrace_session_link *sess,
 			   struct ftrace_task_handle *task,
 			   struct uftrace_record *rec);
@@ -407,7 +472,8 @@ int setup_client_socket(struct opts *opts);
 void send_trace_dir_name(int sock, char *name);
 void send_trace_data(int sock, int tid, void *data, size_t len);
 void send_trace_kernel_data(int sock, int cpu, void *data, size_t len);
-void send_trace_perf_data(int sock, int cpu, void *data, size_t len);
+struct iovec;
+void send_trace_perf_data(int sock, int cpu, struct iovec *data, int count);
 void send_trace_metadata(int sock, const char *dirname, char *filename);
 void send_trace_info(int sock, struct uftrace_file_header *hdr,
 		     void *info, int len);
@@ -420,6 +486,21 @@ void write_session_info(const char *dirname, struct uftrace_msg_sess *smsg,
 void write_dlopen_info(const char *dirname, struct uftrace_msg_dlopen *dmsg,
 		       const char *libname);
 
+void start_live_stream(struct opts *opts);
+void live_stream_message(int type, void *msg, size_t len, char *name);
+void live_stream_data(int tid, void *data, size_t len);
+int finish_live_stream(void);
+bool live_stream_update(struct ftrace_file_handle *handle);
+bool live_stream_ready(struct ftrace_file_handle *handle,
+		       struct ftrace_task_handle *task);
+int replay_stream(struct opts *opts, struct ftrace_file_handle *handle);
+
+void start_top_view(struct opts *opts);
+void top_view_message(int type, void *msg, size_t len, char *name);
+void top_view_data(int tid, void *data, size_t len);
+void update_top_view(bool final);
+void finish_top_view(void);
+
 enum uftrace_record_type {
 	UFTRACE_ENTRY,
 	UFTRACE_EXIT,
@@ -453,16 +534,26 @@ struct fstack_arguments {
 	void			*data;
 };
 
-struct uftrace_rstack_list {
-	struct list_head read;
-	struct list_head unused;
-	int count;
-};
-
 struct uftrace_rstack_list_node {
-	struct list_head list;
 	struct uftrace_record rstack;
-	struct fstack_arguments args;
+	struct list_head *args;
+	unsigned args_len;
+	/* position of argument data in the arena (if rstack.more) */
+	uint64_t args_pos;
+};
+
+/* ring buffer of records with an arena for argument data */
+struct uftrace_rstack_list {
+	struct uftrace_rstack_list_node *nodes;
+	unsigned head;
+	unsigned size;
+	int count;
+	char *arena;
+	size_t arena_size;
+	/* positions of arena[0], the first and the next argument data */
+	uint64_t arena_base;
+	uint64_t arena_head;
+	uint64_t arena_tail;
 };
 
 void setup_rstack_list(struct uftrace_rstack_list *list);
@@ -470,10 +561,23 @@ void add_to_rstack_list(struct uftrace_rstack_list *list,
 			struct uftrace_record *rstack,
 			struct fstack_arguments *args);
 struct uftrace_record * get_first_rstack_list(struct uftrace_rstack_list *);
+struct uftrace_record * get_last_rstack_list(struct uftrace_rstack_list *list,
+					     int n);
+void restore_first_rstack_list_args(struct uftrace_rstack_list *list,
+				    struct fstack_arguments *args);
 void consume_first_rstack_list(struct uftrace_rstack_list *list);
 void delete_last_rstack_list(struct uftrace_rstack_list *list);
 void reset_rstack_list(struct uftrace_rstack_list *list);
 
+void setup_rstack_heap(struct uftrace_rstack_heap *heap, int nr_streams);
+void add_to_rstack_heap(struct uftrace_rstack_heap *heap, int idx,
+			uint64_t time);
+int get_first_rstack_heap(struct uftrace_rstack_heap *heap);
+void update_first_rstack_heap(struct uftrace_rstack_heap *heap,
+			      uint64_t time);
+void delete_first_rstack_heap(struct uftrace_rstack_heap *heap);
+void reset_rstack_heap(struct uftrace_rstack_heap *heap);
+
 enum ftrace_ext_type {
 	FTRACE_ARGUMENT		= 1,
 };
@@ -521,11 +625,17 @@ enum uftrace_event_id {
 	EVENT_ID_USER	= 1000000U,
 };
 
+/* max number of arguments in a (SDT) user event */
+#define EVENT_MAX_ARGS  12
+
 struct uftrace_event {
 	struct list_head	list;
 	enum uftrace_event_id	id;
 	char			*provider;
 	char			*event;
+	int			nr_args;
+	/* argument size in byte (negative for signed) */
+	signed char		arg_size[EVENT_MAX_ARGS];
 };
 
 #endif /* UFTRACE_H */
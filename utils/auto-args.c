@@ -11,6 +11,36 @@
 #include "utils/symbol.h"
 #include "utils/rbtree.h"
 #include "utils/list.h"
+
+struct enum_val {
+	char *str;
+	long val;
+};
+
+struct enum_def {
+	char *name;
+	/* sorted by value in descending order */
+	struct enum_val *vals;
+	int nr_vals;
+	struct rb_node node;
+};
+
+/* constant argspec record: size 0 means sizeof(long) */
+struct auto_arg_rec {
+	unsigned char		idx;
+	unsigned char		fmt;
+	unsigned char		size;
+	const char		*enum_name;
+};
+
+/* auto_arg_recs[args .. args + nr_args - 1] are for arguments */
+struct auto_func_rec {
+	const char		*name;
+	unsigned short		args;
+	unsigned short		nr_args;
+	short			retval;
+};
+
 #include "utils/auto-args.h"
 
 /* RB-tree maintaining automatic arguments and return value */
@@ -18,13 +48,17 @@ static struct rb_root auto_argspec = RB_ROOT;
 static struct rb_root auto_retspec = RB_ROOT;
 static struct rb_root enum_root = RB_ROOT;
 
+/* whether the pre-built tables in auto-args.h are used */
+static bool auto_args_builtin;
+
 extern void add_trigger(struct uftrace_filter *filter, struct uftrace_trigger *tr,
 			bool exact_match);
 extern int setup_trigger_action(char *str, struct uftrace_trigger *tr,
 				char **module, unsigned long orig_flags);
 
-static void add_auto_args(struct rb_root *root, struct uftrace_filter *entry,
-			  struct uftrace_trigger *tr)
+static struct uftrace_filter * add_auto_args(struct rb_root *root,
+					     struct uftrace_filter *entry,
+					     struct uftrace_trigger *tr)
 {
 	struct rb_node *parent = NULL;
 	struct rb_node **p = &root->rb_node;
@@ -40,7 +74,7 @@ static void add_auto_args(struct rb_root *root, struct uftrace_filter *entry,
 		cmp = strcmp(iter->name, entry->name);
 		if (cmp == 0) {
 			add_trigger(iter, tr, true);
-			return;
+			return iter;
 		}
 
 		if (cmp < 0)
@@ -59,6 +93,7 @@ static void add_auto_args(struct rb_root *root, struct uftrace_filter *entry,
 
 	rb_link_node(&new->node, parent, p);
 	rb_insert_color(&new->node, root);
+	return new;
 }
 
 static void build_auto_args(const char *args_str, struct rb_root *root,
@@ -138,14 +173,154 @@ static struct uftrace_filter * find_auto_args(struct rb_root *root, char *name)
 	return NULL;
 }
 
+/* should be same as auto_func_hash() in misc/gen-autoargs.py */
+static unsigned auto_func_hash(const char *name, unsigned seed)
+{
+	unsigned h = 2166136261U ^ seed;
+
+	while (*name) {
+		h ^= (unsigned char)*name++;
+		h *= 16777619U;
+	}
+
+	h ^= h >> 16;
+	h *= 0x85ebca6bU;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35U;
+	h ^= h >> 16;
+	return h;
+}
+
+static const struct auto_func_rec * find_auto_func(const char *name)
+{
+	unsigned nr = ARRAY_SIZE(auto_func_recs);
+	int seed = auto_func_seeds[auto_func_hash(name, 0) % nr];
+	unsigned idx;
+
+	if (seed < 0)
+		idx = -seed - 1;
+	else
+		idx = auto_func_hash(name, seed) % nr;
+
+	if (strcmp(auto_func_recs[idx].name, name))
+		return NULL;
+
+	return &auto_func_recs[idx];
+}
+
+/* convert the pre-built records to a filter entry in the @root */
+static struct uftrace_filter * add_builtin_auto_args(struct rb_root *root,
+						     const struct auto_func_rec *func,
+						     unsigned long flag)
+{
+	LIST_HEAD(args);
+	struct uftrace_arg_spec *arg;
+	struct uftrace_trigger tr = {
+		.flags = flag,
+		.pargs = &args,
+	};
+	struct uftrace_filter entry = {
+		.name = NULL,
+	};
+	struct uftrace_filter *ret = NULL;
+	const struct auto_arg_rec *rec;
+	int i, nr;
+
+	if (flag == TRIGGER_FL_ARGUMENT) {
+		rec = &auto_arg_recs[func->args];
+		nr = func->nr_args;
+	}
+	else {
+		rec = &auto_arg_recs[func->retval];
+		nr = func->retval >= 0;
+	}
+
+	if (nr == 0)
+		return NULL;
+
+	for (i = 0; i < nr; i++, rec++) {
+		if (rec->fmt == ARG_FMT_STD_STRING && !std_string_supported())
+			goto out;
+
+		arg = xzalloc(sizeof(*arg));
+		arg->idx  = rec->idx;
+		arg->fmt  = rec->fmt;
+		arg->size = rec->size ?: sizeof(long);
+		arg->type = ARG_TYPE_INDEX;
+		if (rec->fmt == ARG_FMT_ENUM)
+			arg->enum_str = (char *)rec->enum_name;
+
+		list_add_tail(&arg->list, &args);
+	}
+
+	entry.name = xstrdup(func->name);
+	ret = add_auto_args(root, &entry, &tr);
+
+out:
+	while (!list_empty(&args)) {
+		arg = list_first_entry(&args, struct uftrace_arg_spec, list);
+		list_del(&arg->list);
+		free(arg);
+	}
+	return ret;
+}
+
 struct uftrace_filter * find_auto_argspec(char *name)
 {
-	return find_auto_args(&auto_argspec, name);
+	struct uftrace_filter *entry;
+	const struct auto_func_rec *func;
+
+	entry = find_auto_args(&auto_argspec, name);
+	if (entry || !auto_args_builtin)
+		return entry;
+
+	func = find_auto_func(name);
+	if (func == NULL)
+		return NULL;
+
+	return add_builtin_auto_args(&auto_argspec, func, TRIGGER_FL_ARGUMENT);
 }
 
 struct uftrace_filter * find_auto_retspec(char *name)
 {
-	return find_auto_args(&auto_retspec, name);
+	struct uftrace_filter *entry;
+	const struct auto_func_rec *func;
+
+	entry = find_auto_args(&auto_retspec, name);
+	if (entry || !auto_args_builtin)
+		return entry;
+
+	func = find_auto_func(name);
+	if (func == NULL)
+		return NULL;
+
+	return add_builtin_auto_args(&auto_retspec, func, TRIGGER_FL_RETVAL);
+}
+
+int get_auto_func_count(void)
+{
+	return ARRAY_SIZE(auto_func_recs);
+}
+
+/**
+ * get_auto_func_name - get a function name in the pre-built table
+ * @idx: index of the table (less than get_auto_func_count())
+ * @flag: TRIGGER_FL_ARGUMENT or TRIGGER_FL_RETVAL
+ *
+ * This function returns the name of @idx-th function in the table if
+ * it has arguments or return value (depends on @flag) to display.
+ * Otherwise it returns NULL.
+ */
+const char * get_auto_func_name(int idx, unsigned long flag)
+{
+	const struct auto_func_rec *func = &auto_func_recs[idx];
+
+	if (flag == TRIGGER_FL_ARGUMENT && func->nr_args == 0)
+		return NULL;
+	if (flag == TRIGGER_FL_RETVAL && func->retval < 0)
+		return NULL;
+
+	return func->name;
 }
 
 char *get_auto_argspec_str(void)
@@ -158,15 +333,30 @@ char *get_auto_retspec_str(void)
 	return auto_retvals_list;
 }
 
+/*
+ * The pre-built tables are looked up on demand, so nothing needs to be
+ * parsed or allocated here.
+ */
 void setup_auto_args(void)
 {
-	parse_enum_string(auto_enum_list);
-	build_auto_args(auto_args_list, &auto_argspec, TRIGGER_FL_ARGUMENT);
-	build_auto_args(auto_retvals_list, &auto_retspec, TRIGGER_FL_RETVAL);
+	auto_args_builtin = true;
+}
+
+static bool is_builtin_str(char *str, char *builtin)
+{
+	return str && !strcmp(str, builtin);
 }
 
 void setup_auto_args_str(char *args, char *rets, char *enums)
 {
+	/* data recorded by the same version can use the tables too */
+	if (is_builtin_str(args, auto_args_list) &&
+	    is_builtin_str(rets, auto_retvals_list) &&
+	    is_builtin_str(enums, auto_enum_list)) {
+		setup_auto_args();
+		return;
+	}
+
 	parse_enum_string(enums);
 	build_auto_args(args, &auto_argspec, TRIGGER_FL_ARGUMENT);
 	build_auto_args(rets, &auto_retspec, TRIGGER_FL_RETVAL);
@@ -202,6 +392,7 @@ void finish_auto_args(void)
 	release_enum_def(&enum_root);
 	release_auto_args(&auto_argspec);
 	release_auto_args(&auto_retspec);
+	auto_args_builtin = false;
 }
 
 /**
@@ -337,18 +528,6 @@ static enum enum_token_ret enum_next_token(char **str)
 	return ret;
 }
 
-struct enum_def {
-	char *name;
-	struct list_head vals;
-	struct rb_node node;
-};
-
-struct enum_val {
-	struct list_head list;
-	char *str;
-	long val;
-};
-
 static void add_enum_tree(struct rb_root *root, struct enum_def *e_def)
 {
 	struct rb_node *parent = NULL;
@@ -378,6 +557,13 @@ static void add_enum_tree(struct rb_root *root, struct enum_def *e_def)
 	rb_insert_color(&e_def->node, root);
 }
 
+static int cmp_enum_def(const void *a, const void *b)
+{
+	const struct enum_def *e_def = b;
+
+	return strcmp(a, e_def->name);
+}
+
 struct enum_def * find_enum_def(char *name)
 {
 	struct rb_node *parent = NULL;
@@ -398,22 +584,31 @@ struct enum_def * find_enum_def(char *name)
 		else
 			p = &parent->rb_right;
 	}
-	return NULL;
+
+	if (!auto_args_builtin)
+		return NULL;
+
+	/* the pre-built enum table is sorted by name */
+	return bsearch(name, auto_enum_defs, ARRAY_SIZE(auto_enum_defs),
+		       sizeof(*auto_enum_defs), cmp_enum_def);
 }
 
 char * convert_enum_val(struct enum_def *e_def, long val)
 {
 	struct enum_val *e_val;
 	char *str = NULL;
+	int i;
 
 	/* exact match? */
-	list_for_each_entry(e_val, &e_def->vals, list) {
+	for (i = 0; i < e_def->nr_vals; i++) {
+		e_val = &e_def->vals[i];
 		if (e_val->val == val)
 			return xstrdup(e_val->str);
 	}
 
 	/* if not, try OR-ing bit flags */
-	list_for_each_entry(e_val, &e_def->vals, list) {
+	for (i = 0; i < e_def->nr_vals; i++) {
+		e_val = &e_def->vals[i];
 		if (e_val->val <= val) {
 			val -= e_val->val;
 			str = strjoin(str, e_val->str, "|");
@@ -452,21 +647,39 @@ char *get_enum_string(char *name, long val)
 
 static void free_enum_def(struct enum_def *e_def)
 {
-	struct enum_val *e_val;
+	int i;
 
 	if (e_def == NULL)
 		return;
 
-	while (!list_empty(&e_def->vals)) {
-		e_val = list_first_entry(&e_def->vals, struct enum_val, list);
+	for (i = 0; i < e_def->nr_vals; i++)
+		free(e_def->vals[i].str);
 
-		list_del(&e_val->list);
-		free(e_val->str);
-		free(e_val);
-	}
+	free(e_def->vals);
+	free(e_def->name);
 	free(e_def);
 }
 
+static void add_enum_val(struct enum_def *e_def, char *name, long val)
+{
+	int i;
+
+	/* sort by value, just in case */
+	for (i = 0; i < e_def->nr_vals; i++) {
+		if (e_def->vals[i].val <= val)
+			break;
+	}
+
+	e_def->vals = xrealloc(e_def->vals,
+			       (e_def->nr_vals + 1) * sizeof(*e_def->vals));
+	memmove(&e_def->vals[i + 1], &e_def->vals[i],
+		(e_def->nr_vals - i) * sizeof(*e_def->vals));
+
+	e_def->vals[i].str = name;
+	e_def->vals[i].val = val;
+	e_def->nr_vals++;
+}
+
 /**
  * parse_enum_string - parse enum and add it to a tree
  * @enum_str: string presentation of enum
@@ -489,7 +702,6 @@ int parse_enum_string(char *enum_str)
 {
 	char *pos;
 	struct enum_def *e_def = NULL;
-	struct enum_val *e_val, *e;
 	enum enum_token_ret ret;
 	struct strv strv = STRV_INIT;
 	int err = -1;
@@ -521,9 +733,8 @@ int parse_enum_string(char *enum_str)
 			goto out;
 		}
 
-		e_def = xmalloc(sizeof(*e_def));
+		e_def = xzalloc(sizeof(*e_def));
 		e_def->name = xstrdup(enum_token);
-		INIT_LIST_HEAD(&e_def->vals);
 
 		ret = enum_next_token(&pos);
 		if (ret != TOKEN_SIGN || strcmp(enum_token, "{")) {
@@ -558,18 +769,8 @@ int parse_enum_string(char *enum_str)
 				}
 			}
 
-			e_val = xmalloc(sizeof(*e_val));
-			e_val->str = name;
-			e_val->val = val;
-
 			pr_dbg3("  %s = %ld\n", name, val);
-
-			/* sort by value, just in case */
-			list_for_each_entry(e, &e_def->vals, list) {
-				if (e->val <= val)
-					break;
-			}
-			list_add_tail(&e_val->list, &e->list);
+			add_enum_val(e_def, name, val);
 
 			val++;
 
@@ -654,6 +855,69 @@ TEST_CASE(argspec_auto_args)
 	return TEST_OK;
 }
 
+TEST_CASE(argspec_auto_args_builtin)
+{
+	struct uftrace_filter *entry;
+	struct uftrace_arg_spec *spec;
+	unsigned i;
+	char *str;
+
+	/* every function should be found by the perfect hash */
+	for (i = 0; i < ARRAY_SIZE(auto_func_recs); i++)
+		TEST_EQ(find_auto_func(auto_func_recs[i].name), &auto_func_recs[i]);
+	TEST_EQ(find_auto_func("xxx"), NULL);
+
+	/* enum table should be sorted by name for bsearch */
+	for (i = 1; i < ARRAY_SIZE(auto_enum_defs); i++)
+		TEST_LT(strcmp(auto_enum_defs[i-1].name, auto_enum_defs[i].name), 0);
+
+	TEST_EQ(find_auto_argspec("mmap"), NULL);
+
+	setup_auto_args();
+
+	entry = find_auto_argspec("mmap");
+	TEST_NE(entry, NULL);
+	TEST_EQ(entry->trigger.flags, TRIGGER_FL_ARGUMENT);
+
+	i = 1;
+	list_for_each_entry(spec, &entry->args, list) {
+		TEST_EQ(spec->idx, (int)i);
+		TEST_EQ(spec->type, ARG_TYPE_INDEX);
+		if (i == 3) {
+			TEST_EQ(spec->fmt, ARG_FMT_ENUM);
+			TEST_STREQ(spec->enum_str, "uft_mmap_prot");
+		}
+		i++;
+	}
+	TEST_EQ(i, 7U);
+
+	/* it should return the same entry */
+	TEST_EQ(find_auto_argspec("mmap"), entry);
+
+	entry = find_auto_retspec("malloc");
+	TEST_NE(entry, NULL);
+	TEST_EQ(entry->trigger.flags, TRIGGER_FL_RETVAL);
+
+	spec = list_first_entry(&entry->args, struct uftrace_arg_spec, list);
+	TEST_EQ(spec->idx, RETVAL_IDX);
+	TEST_EQ(spec->fmt, ARG_FMT_HEX);
+	TEST_EQ(spec->size, (int)sizeof(long));
+
+	TEST_EQ(find_auto_retspec("free"), NULL);
+	TEST_EQ(find_auto_argspec("xxx"), NULL);
+
+	str = get_enum_string("uft_mmap_prot", 3);
+	TEST_STREQ(str, "PROT_WRITE|PROT_READ");
+	free(str);
+
+	finish_auto_args();
+
+	TEST_EQ(find_auto_argspec("mmap"), NULL);
+	TEST_EQ(find_enum_def("uft_mmap_prot"), NULL);
+
+	return TEST_OK;
+}
+
 TEST_CASE(argspec_extract)
 {
 	char test_trigger_str1[] = "foo@arg1,retval";
@@ -698,7 +962,7 @@ TEST_CASE(argspec_parse_enum)
 	char test_enum_str3[] = ";enum uftrace{record=100,replay=-23,report}";
 	struct rb_node *node;
 	struct enum_def *e_def;
-	struct enum_val *e_val, *e_next;
+	struct enum_val *e_val;
 	char *str;
 
 	TEST_EQ(parse_enum_string(test_enum_str1), 0);
@@ -709,13 +973,9 @@ TEST_CASE(argspec_parse_enum)
 	while (node) {
 		e_def = rb_entry(node, struct enum_def, node);
 
-		e_val  = list_first_entry(&e_def->vals, struct enum_val, list);
-		e_next = list_next_entry(e_val, list);
-		TEST_GE(e_val->val, e_next->val);
-
-		e_val  = list_next_entry(e_val, list);
-		e_next = list_next_entry(e_next, list);
-		TEST_GE(e_val->val, e_next->val);
+		TEST_EQ(e_def->nr_vals, 3);
+		TEST_GE(e_def->vals[0].val, e_def->vals[1].val);
+		TEST_GE(e_def->vals[1].val, e_def->vals[2].val);
 
 		node = rb_next(node);
 	}
@@ -723,11 +983,11 @@ TEST_CASE(argspec_parse_enum)
 	e_def = find_enum_def("xxx");
 	TEST_NE(e_def, NULL);
 
-	e_val = list_last_entry(&e_def->vals, struct enum_val, list);
+	e_val = &e_def->vals[e_def->nr_vals - 1];
 	TEST_STREQ(e_val->str, "ZERO");
 	TEST_EQ(e_val->val, 0L);
 
-	e_val = list_first_entry(&e_def->vals, struct enum_val, list);
+	e_val = &e_def->vals[0];
 	TEST_STREQ(e_val->str, "TWO");
 	TEST_EQ(e_val->val, 112L);
 
@@ -293,3 +293,985 @@ static char *auto_retvals_list =
 	"ioctl@retval;"
 ;
 
+static struct enum_val auto_enum_vals[] = {
+	/* uft_access_flag */
+	{ "R_OK", 4L },
+	{ "W_OK", 2L },
+	{ "X_OK", 1L },
+	{ "F_OK", 0L },
+	/* uft_dlopen_flag */
+	{ "RTLD_NODELETE", 4096L },
+	{ "RTLD_GLOBAL", 256L },
+	{ "RTLD_DEEPBIND", 8L },
+	{ "RTLD_NOLOAD", 4L },
+	{ "RTLD_NOW", 2L },
+	{ "RTLD_LAZY", 1L },
+	{ "RTLD_LOCAL", 0L },
+	/* uft_madvise */
+	{ "MADV_HWPOISON", 100L },
+	{ "MADV_DODUMP", 17L },
+	{ "MADV_DONTDUMP", 16L },
+	{ "MADV_NOHUGEPAGE", 15L },
+	{ "MADV_HUGEPAGE", 14L },
+	{ "MADV_UNMERGEABLE", 13L },
+	{ "MADV_MERGEABLE", 12L },
+	{ "MADV_DOFORK", 11L },
+	{ "MADV_DONTFORK", 10L },
+	{ "MADV_REMOVE", 9L },
+	{ "MADV_FREE", 8L },
+	{ "MADV_DONTNEED", 4L },
+	{ "MADV_WILLNEED", 3L },
+	{ "MADV_SEQUENTIAL", 2L },
+	{ "MADV_RANDOM", 1L },
+	{ "MADV_NORMAL", 0L },
+	/* uft_mmap_flag */
+	{ "MAP_HUGETLB", 262144L },
+	{ "MAP_STACK", 131072L },
+	{ "MAP_NONBLOCK", 65536L },
+	{ "MAP_POPULATE", 32768L },
+	{ "MAP_NORESERVE", 16384L },
+	{ "MAP_LOCKED", 8192L },
+	{ "MAP_EXECUTABLE", 4096L },
+	{ "MAP_DENYWRITE", 2048L },
+	{ "MAP_GROWSDOWN", 256L },
+	{ "MAP_ANON", 32L },
+	{ "MAP_FIXED", 16L },
+	{ "MAP_PRIVATE", 2L },
+	{ "MAP_SHARED", 1L },
+	/* uft_mmap_prot */
+	{ "PROT_EXEC", 4L },
+	{ "PROT_WRITE", 2L },
+	{ "PROT_READ", 1L },
+	{ "PROT_NONE", 0L },
+	/* uft_open_flag */
+	{ "O_PATH", 2097152L },
+	{ "O_SYNC", 1052672L },
+	{ "O_CLOEXEC", 524288L },
+	{ "O_NOATIME", 262144L },
+	{ "O_DIRECTORY", 65536L },
+	{ "O_LARGEFILE", 32768L },
+	{ "O_DIRECT", 16384L },
+	{ "O_ASYNC", 8192L },
+	{ "O_DSYNC", 4096L },
+	{ "O_NONBLOCK", 2048L },
+	{ "O_APPEND", 1024L },
+	{ "O_TRUNC", 512L },
+	{ "O_NOCTTY", 256L },
+	{ "O_EXCL", 128L },
+	{ "O_CREAT", 64L },
+	{ "O_RDWR", 2L },
+	{ "O_WRONLY", 1L },
+	{ "O_RDONLY", 0L },
+	/* uft_posix_fadvise */
+	{ "POSIX_FADV_NOREUSE", 5L },
+	{ "POSIX_FADV_DONTNEED", 4L },
+	{ "POSIX_FADV_WILLNEED", 3L },
+	{ "POSIX_FADV_SEQUENTIAL", 2L },
+	{ "POSIX_FADV_RANDOM", 1L },
+	{ "POSIX_FADV_NORMAL", 0L },
+	/* uft_posix_madvise */
+	{ "POSIX_MADV_DONTNEED", 4L },
+	{ "POSIX_MADV_WILLNEED", 3L },
+	{ "POSIX_MADV_SEQUENTIAL", 2L },
+	{ "POSIX_MADV_RANDOM", 1L },
+	{ "POSIX_MADV_NORMAL", 0L },
+	/* uft_prctl_op */
+	{ "PR_CAP_AMBIENT", 47L },
+	{ "PR_GET_FP_MODE", 46L },
+	{ "PR_SET_FP_MODE", 45L },
+	{ "PR_MPX_DISABLE_MANAGEMENT", 44L },
+	{ "PR_MPX_ENABLE_MANAGEMENT", 43L },
+	{ "PR_GET_THP_DISABLE", 42L },
+	{ "PR_SET_THP_DISABLE", 41L },
+	{ "PR_GET_TID_ADDRESS", 40L },
+	{ "PR_GET_NO_NEW_PRIVS", 39L },
+	{ "PR_SET_NO_NEW_PRIVS", 38L },
+	{ "PR_GET_CHILD_SUBREAPER", 37L },
+	{ "PR_SET_CHILD_SUBREAPER", 36L },
+	{ "PR_SET_MM", 35L },
+	{ "PR_MCE_KILL_GET", 34L },
+	{ "PR_MCE_KILL", 33L },
+	{ "PR_TASK_PERF_EVENTS_ENABLE", 32L },
+	{ "PR_TASK_PERF_EVENTS_DISABLE", 31L },
+	{ "PR_GET_TIMERSLACK", 30L },
+	{ "PR_SET_TIMERSLACK", 29L },
+	{ "PR_SET_SECUREBITS", 28L },
+	{ "PR_GET_SECUREBITS", 27L },
+	{ "PR_SET_TSC", 26L },
+	{ "PR_GET_TSC", 25L },
+	{ "PR_CAPBSET_DROP", 24L },
+	{ "PR_CAPBSET_READ", 23L },
+	{ "PR_SET_SECCOMP", 22L },
+	{ "PR_GET_SECCOMP", 21L },
+	{ "PR_SET_ENDIAN", 20L },
+	{ "PR_GET_ENDIAN", 19L },
+	{ "PR_GET_NAME", 16L },
+	{ "PR_SET_NAME", 15L },
+	{ "PR_SET_TIMING", 14L },
+	{ "PR_GET_TIMING", 13L },
+	{ "PR_SET_FPEXC", 12L },
+	{ "PR_GET_FPEXC", 11L },
+	{ "PR_SET_FPEMU", 10L },
+	{ "PR_GET_FPEMU", 9L },
+	{ "PR_SET_KEEPCAPS", 8L },
+	{ "PR_GET_KEEPCAPS", 7L },
+	{ "PR_SET_UNALIGN", 6L },
+	{ "PR_GET_UNALIGN", 5L },
+	{ "PR_SET_DUMPABLE", 4L },
+	{ "PR_GET_DUMPABLE", 3L },
+	{ "PR_GET_PDEATHSIG", 2L },
+	{ "PR_SET_PDEATHSIG", 1L },
+	/* uft_seek_whence */
+	{ "SEEK_HOLE", 4L },
+	{ "SEEK_DATA", 3L },
+	{ "SEEK_END", 2L },
+	{ "SEEK_CUR", 1L },
+	{ "SEEK_SET", 0L },
+	/* uft_signal */
+	{ "SIGRTMAX", 64L },
+	{ "SIGRTMIN", 32L },
+	{ "SIGSYS", 31L },
+	{ "SIGPWR", 30L },
+	{ "SIGPOLL", 29L },
+	{ "SIGWINCH", 28L },
+	{ "SIGPROF", 27L },
+	{ "SIGVTALRM", 26L },
+	{ "SIGXFSZ", 25L },
+	{ "SIGXCPU", 24L },
+	{ "SIGURG", 23L },
+	{ "SIGTTOU", 22L },
+	{ "SIGTTIN", 21L },
+	{ "SIGTSTP", 20L },
+	{ "SIGSTOP", 19L },
+	{ "SIGCONT", 18L },
+	{ "SIGCHLD", 17L },
+	{ "SIGSTKFLT", 16L },
+	{ "SIGTERM", 15L },
+	{ "SIGALRM", 14L },
+	{ "SIGPIPE", 13L },
+	{ "SIGUSR2", 12L },
+	{ "SIGSEGV", 11L },
+	{ "SIGUSR1", 10L },
+	{ "SIGKILL", 9L },
+	{ "SIGFPE", 8L },
+	{ "SIGBUS", 7L },
+	{ "SIGABRT", 6L },
+	{ "SIGTRAP", 5L },
+	{ "SIGILL", 4L },
+	{ "SIGQUIT", 3L },
+	{ "SIGINT", 2L },
+	{ "SIGHUP", 1L },
+	/* uft_socket_domain */
+	{ "AF_SMC", 43L },
+	{ "AF_QIPCRTR", 42L },
+	{ "AF_KCM", 41L },
+	{ "AF_VSOCK", 40L },
+	{ "AF_NFC", 39L },
+	{ "AF_ALG", 38L },
+	{ "AF_CAIF", 37L },
+	{ "AF_IEEE802154", 36L },
+	{ "AF_PHONET", 35L },
+	{ "AF_ISDN", 34L },
+	{ "AF_RXRPC", 33L },
+	{ "AF_IUCV", 32L },
+	{ "AF_BLUETOOTH", 31L },
+	{ "AF_TPIC", 30L },
+	{ "AF_CAN", 29L },
+	{ "AF_MPLS", 28L },
+	{ "AF_IB", 27L },
+	{ "AF_LLC", 26L },
+	{ "AF_WANPIPE", 25L },
+	{ "AF_PPPOX", 24L },
+	{ "AF_IRDA", 23L },
+	{ "AF_SNA", 22L },
+	{ "AF_RDS", 21L },
+	{ "AF_ATMSVC", 20L },
+	{ "AF_ECONET", 19L },
+	{ "AF_ASH", 18L },
+	{ "AF_PACKET", 17L },
+	{ "AF_NETLINK", 16L },
+	{ "AF_KEY", 15L },
+	{ "AF_SECURITY", 14L },
+	{ "AF_NETBEUI", 13L },
+	{ "AF_DECnet", 12L },
+	{ "AF_ROSE", 11L },
+	{ "AF_INET6", 10L },
+	{ "AF_X25", 9L },
+	{ "AF_ATMPVC", 8L },
+	{ "AF_BRIDGE", 7L },
+	{ "AF_NETROM", 6L },
+	{ "AF_APPLETALK", 5L },
+	{ "AF_IPX", 4L },
+	{ "AF_AX25", 3L },
+	{ "AF_INET", 2L },
+	{ "AF_UNIX", 1L },
+	{ "AF_UNSPEC", 0L },
+	/* uft_socket_flag */
+	{ "SOCK_CLOEXEC", 524288L },
+	{ "SOCK_NONBLOCK", 2048L },
+	/* uft_socket_type */
+	{ "SOCK_PACKET", 10L },
+	{ "SOCK_DCCP", 6L },
+	{ "SOCK_SEQPACKET", 5L },
+	{ "SOCK_RDM", 4L },
+	{ "SOCK_RAW", 3L },
+	{ "SOCK_DGRAM", 2L },
+	{ "SOCK_STREAM", 1L },
+};
+
+static struct enum_def auto_enum_defs[] = {
+	{ "uft_access_flag", &auto_enum_vals[0], 4 },
+	{ "uft_dlopen_flag", &auto_enum_vals[4], 7 },
+	{ "uft_madvise", &auto_enum_vals[11], 16 },
+	{ "uft_mmap_flag", &auto_enum_vals[27], 13 },
+	{ "uft_mmap_prot", &auto_enum_vals[40], 4 },
+	{ "uft_open_flag", &auto_enum_vals[44], 18 },
+	{ "uft_posix_fadvise", &auto_enum_vals[62], 6 },
+	{ "uft_posix_madvise", &auto_enum_vals[68], 5 },
+	{ "uft_prctl_op", &auto_enum_vals[73], 45 },
+	{ "uft_seek_whence", &auto_enum_vals[118], 5 },
+	{ "uft_signal", &auto_enum_vals[123], 33 },
+	{ "uft_socket_domain", &auto_enum_vals[156], 44 },
+	{ "uft_socket_flag", &auto_enum_vals[200], 2 },
+	{ "uft_socket_type", &auto_enum_vals[202], 7 },
+};
+
+static const struct auto_arg_rec auto_arg_recs[] = {
+	/* mprotect */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 3, ARG_FMT_ENUM, 0, "uft_mmap_prot" },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* fdopen */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* sigemptyset */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* mmap */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 3, ARG_FMT_ENUM, 0, "uft_mmap_prot" },
+	{ 4, ARG_FMT_ENUM, 0, "uft_mmap_flag" },
+	{ 5, ARG_FMT_AUTO, 0, NULL },
+	{ 6, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* accept4 */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 3, ARG_FMT_HEX, 0, NULL },
+	{ 4, ARG_FMT_ENUM, 0, "uft_socket_flag" },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* write */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* sbrk */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* strrchr */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_CHAR, 1, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* getpid */
+	{ 0, ARG_FMT_UINT, 0, NULL },
+	/* strsep */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* memset */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_AUTO, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* pthread_mutex_lock */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* qsort_r */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 4, ARG_FMT_FUNC_PTR, 0, NULL },
+	{ 5, ARG_FMT_HEX, 0, NULL },
+	/* pthread_create */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 3, ARG_FMT_FUNC_PTR, 0, NULL },
+	{ 4, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* sigaction */
+	{ 1, ARG_FMT_ENUM, 0, "uft_signal" },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 3, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* poll */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_AUTO, 0, NULL },
+	{ 3, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* fopen64 */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* prctl */
+	{ 1, ARG_FMT_ENUM, 0, "uft_prctl_op" },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 3, ARG_FMT_AUTO, 0, NULL },
+	{ 4, ARG_FMT_UINT, 0, NULL },
+	{ 5, ARG_FMT_AUTO, 0, NULL },
+	{ 6, ARG_FMT_UINT, 0, NULL },
+	{ 7, ARG_FMT_AUTO, 0, NULL },
+	{ 8, ARG_FMT_UINT, 0, NULL },
+	{ 9, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* freopen */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 3, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* close */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* strncat */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* bsearch */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 4, ARG_FMT_UINT, 0, NULL },
+	{ 5, ARG_FMT_FUNC_PTR, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* fputs */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* freeaddrinfo */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	/* pthread_kill */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 2, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* realloc */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* unsetenv */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* memcmp */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* strnlen */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_UINT, 0, NULL },
+	/* read */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* strlen */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_UINT, 0, NULL },
+	/* sigismember */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_ENUM, 0, "uft_signal" },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* strcmp */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* brk */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* sprintf */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* signal */
+	{ 1, ARG_FMT_ENUM, 0, "uft_signal" },
+	{ 2, ARG_FMT_FUNC_PTR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* pthread_join */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* waitpid */
+	{ 1, ARG_FMT_UINT, 0, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 3, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_UINT, 0, NULL },
+	/* rawmemchr */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* strncasecmp */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* open */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_ENUM, 0, "uft_open_flag" },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* fwrite */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 4, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_UINT, 0, NULL },
+	/* strspn */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_UINT, 0, NULL },
+	/* pthread_cancel */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* vfork */
+	{ 0, ARG_FMT_UINT, 0, NULL },
+	/* gethostbyname */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* dlvsym */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 3, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* strndup */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* strcasecmp */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* strcpy */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	/* fseek */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_AUTO, 0, NULL },
+	{ 3, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* getenv */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* memrchr */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_AUTO, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* valloc */
+	{ 1, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* memalign */
+	{ 1, ARG_FMT_UINT, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* strtok */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* strcspn */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_UINT, 0, NULL },
+	/* printf */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* execle */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* getppid */
+	{ 0, ARG_FMT_UINT, 0, NULL },
+	/* qsort */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 4, ARG_FMT_FUNC_PTR, 0, NULL },
+	/* madvise */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 3, ARG_FMT_ENUM, 0, "uft_madvise" },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* pthread_once */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_FUNC_PTR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* getchar */
+	{ 0, ARG_FMT_CHAR, 1, NULL },
+	/* strndupa */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* dprintf */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* pthread_detach */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* pvalloc */
+	{ 1, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* mmap64 */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 3, ARG_FMT_ENUM, 0, "uft_mmap_prot" },
+	{ 4, ARG_FMT_ENUM, 0, "uft_mmap_flag" },
+	{ 5, ARG_FMT_AUTO, 0, NULL },
+	{ 6, ARG_FMT_AUTO, 8, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* strcasestr */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* ungetc */
+	{ 1, ARG_FMT_CHAR, 1, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_CHAR, 1, NULL },
+	/* fork */
+	{ 0, ARG_FMT_UINT, 0, NULL },
+	/* execl */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* strcat */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* execv */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* setenv */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 3, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* lseek */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 2, ARG_FMT_AUTO, 0, NULL },
+	{ 3, ARG_FMT_ENUM, 0, "uft_seek_whence" },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* posix_memalign */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* posix_fadvise */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 2, ARG_FMT_AUTO, 0, NULL },
+	{ 3, ARG_FMT_AUTO, 0, NULL },
+	{ 4, ARG_FMT_ENUM, 0, "uft_posix_fadvise" },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* putc */
+	{ 1, ARG_FMT_CHAR, 1, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* strdupa */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* socket */
+	{ 1, ARG_FMT_ENUM, 0, "uft_socket_domain" },
+	{ 2, ARG_FMT_ENUM, 0, "eft_socket_type" },
+	{ 3, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* dlopen */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_ENUM, 0, "uft_dlopen_flag" },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* strchrnul */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_CHAR, 1, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* strstr */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* execlp */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* getc */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_CHAR, 1, NULL },
+	/* fread */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 4, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_UINT, 0, NULL },
+	/* sigfillset */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* gettid */
+	{ 0, ARG_FMT_UINT, 0, NULL },
+	/* connect */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 3, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* strtok_r */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 3, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* access */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_ENUM, 0, "uft_access_flag" },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* fopen */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* snprintf */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 3, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* memchr */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_AUTO, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* sigaddset */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_ENUM, 0, "uft_signal" },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* fputc */
+	{ 1, ARG_FMT_CHAR, 1, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* open64 */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_ENUM, 0, "uft_open_flag" },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* malloc */
+	{ 1, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* fprintf */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* aligned_alloc */
+	{ 1, ARG_FMT_UINT, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* strcoll */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* fgetc */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_CHAR, 1, NULL },
+	/* puts */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* syscall */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* execvp */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* execvpe */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* pthread_mutex_destroy */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* dlmopen */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 3, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* strncmp */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* pthread_mutex_trylock */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* dlerror */
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* dlclose */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* ioctl */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 3, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* putchar */
+	{ 1, ARG_FMT_CHAR, 1, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* dlsym */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* memmove */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* gethostbyaddr */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_AUTO, 0, NULL },
+	{ 3, ARG_FMT_ENUM, 0, "uft_socket_domain" },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* memcpy */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* calloc */
+	{ 1, ARG_FMT_UINT, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_HEX, 0, NULL },
+	/* bind */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 3, ARG_FMT_AUTO, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* getaddrinfo */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 3, ARG_FMT_HEX, 0, NULL },
+	{ 4, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* kill */
+	{ 1, ARG_FMT_UINT, 0, NULL },
+	{ 2, ARG_FMT_ENUM, 0, "uft_signal" },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* pthread_mutex_unlock */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* wait */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_UINT, 0, NULL },
+	/* fclose */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* strchr */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_CHAR, 1, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* sigdelset */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_ENUM, 0, "uft_signal" },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* pthread_exit */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	/* posix_madvise */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 3, ARG_FMT_ENUM, 0, "uft_posix_madvise" },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* ftell */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* free */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	/* accept */
+	{ 1, ARG_FMT_AUTO, 0, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 3, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* strdup */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* strpbrk */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* munmap */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_UINT, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* pthread_mutex_init */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_AUTO, 0, NULL },
+	/* fgets */
+	{ 1, ARG_FMT_STR, 0, NULL },
+	{ 2, ARG_FMT_AUTO, 0, NULL },
+	{ 3, ARG_FMT_HEX, 0, NULL },
+	{ 0, ARG_FMT_STR, 0, NULL },
+	/* strncpy */
+	{ 1, ARG_FMT_HEX, 0, NULL },
+	{ 2, ARG_FMT_STR, 0, NULL },
+	{ 3, ARG_FMT_UINT, 0, NULL },
+};
+
+static const struct auto_func_rec auto_func_recs[] = {
+	{ "mprotect", 0, 3, 3 },
+	{ "fdopen", 4, 2, 6 },
+	{ "sigemptyset", 7, 1, 8 },
+	{ "mmap", 9, 6, 15 },
+	{ "accept4", 16, 4, 20 },
+	{ "write", 21, 3, 24 },
+	{ "sbrk", 25, 1, 26 },
+	{ "strrchr", 27, 2, 29 },
+	{ "getpid", 30, 0, 30 },
+	{ "strsep", 31, 2, 33 },
+	{ "memset", 34, 3, 37 },
+	{ "pthread_mutex_lock", 38, 1, 39 },
+	{ "qsort_r", 40, 5, -1 },
+	{ "pthread_create", 45, 4, 49 },
+	{ "sigaction", 50, 3, 53 },
+	{ "poll", 54, 3, 57 },
+	{ "fopen64", 58, 2, 60 },
+	{ "prctl", 61, 9, 70 },
+	{ "freopen", 71, 3, 74 },
+	{ "close", 75, 1, 76 },
+	{ "strncat", 77, 3, 80 },
+	{ "bsearch", 81, 5, 86 },
+	{ "fputs", 87, 2, 89 },
+	{ "freeaddrinfo", 90, 1, -1 },
+	{ "pthread_kill", 91, 2, 93 },
+	{ "realloc", 94, 2, 96 },
+	{ "unsetenv", 97, 1, 98 },
+	{ "memcmp", 99, 3, 102 },
+	{ "strnlen", 103, 2, 105 },
+	{ "read", 106, 3, 109 },
+	{ "strlen", 110, 1, 111 },
+	{ "sigismember", 112, 2, 114 },
+	{ "strcmp", 115, 2, 117 },
+	{ "brk", 118, 1, 119 },
+	{ "sprintf", 120, 2, 122 },
+	{ "signal", 123, 2, 125 },
+	{ "pthread_join", 126, 2, 128 },
+	{ "waitpid", 129, 3, 132 },
+	{ "rawmemchr", 133, 2, 135 },
+	{ "strncasecmp", 136, 3, 139 },
+	{ "open", 140, 2, 142 },
+	{ "fwrite", 143, 4, 147 },
+	{ "strspn", 148, 2, 150 },
+	{ "pthread_cancel", 151, 1, 152 },
+	{ "vfork", 153, 0, 153 },
+	{ "gethostbyname", 154, 1, 155 },
+	{ "dlvsym", 156, 3, 159 },
+	{ "strndup", 160, 2, 162 },
+	{ "strcasecmp", 163, 2, 165 },
+	{ "strcpy", 166, 2, -1 },
+	{ "fseek", 168, 3, 171 },
+	{ "getenv", 172, 1, 173 },
+	{ "memrchr", 174, 3, 177 },
+	{ "valloc", 178, 1, 179 },
+	{ "memalign", 180, 2, 182 },
+	{ "strtok", 183, 2, 185 },
+	{ "strcspn", 186, 2, 188 },
+	{ "printf", 189, 1, 190 },
+	{ "execle", 191, 2, 193 },
+	{ "getppid", 194, 0, 194 },
+	{ "qsort", 195, 4, -1 },
+	{ "madvise", 199, 3, 202 },
+	{ "pthread_once", 203, 2, 205 },
+	{ "getchar", 206, 0, 206 },
+	{ "strndupa", 207, 2, 209 },
+	{ "dprintf", 210, 2, 212 },
+	{ "pthread_detach", 213, 1, 214 },
+	{ "pvalloc", 215, 1, 216 },
+	{ "mmap64", 217, 6, 223 },
+	{ "strcasestr", 224, 2, 226 },
+	{ "ungetc", 227, 2, 229 },
+	{ "fork", 230, 0, 230 },
+	{ "execl", 231, 2, 233 },
+	{ "strcat", 234, 2, 236 },
+	{ "execv", 237, 1, 238 },
+	{ "setenv", 239, 3, 242 },
+	{ "lseek", 243, 3, 246 },
+	{ "posix_memalign", 247, 3, 250 },
+	{ "posix_fadvise", 251, 4, 255 },
+	{ "putc", 256, 2, 258 },
+	{ "strdupa", 259, 1, 260 },
+	{ "socket", 261, 3, 264 },
+	{ "dlopen", 265, 2, 267 },
+	{ "strchrnul", 268, 2, 270 },
+	{ "strstr", 271, 2, 273 },
+	{ "execlp", 274, 2, 276 },
+	{ "getc", 277, 1, 278 },
+	{ "fread", 279, 4, 283 },
+	{ "sigfillset", 284, 1, 285 },
+	{ "gettid", 286, 0, 286 },
+	{ "connect", 287, 3, 290 },
+	{ "strtok_r", 291, 3, 294 },
+	{ "access", 295, 2, 297 },
+	{ "fopen", 298, 2, 300 },
+	{ "snprintf", 301, 3, 304 },
+	{ "memchr", 305, 3, 308 },
+	{ "sigaddset", 309, 2, 311 },
+	{ "fputc", 312, 2, 314 },
+	{ "open64", 315, 2, 317 },
+	{ "malloc", 318, 1, 319 },
+	{ "fprintf", 320, 2, 322 },
+	{ "aligned_alloc", 323, 2, 325 },
+	{ "strcoll", 326, 2, 328 },
+	{ "fgetc", 329, 1, 330 },
+	{ "puts", 331, 1, 332 },
+	{ "syscall", 333, 1, 334 },
+	{ "execvp", 335, 1, 336 },
+	{ "execvpe", 337, 1, 338 },
+	{ "pthread_mutex_destroy", 339, 1, 340 },
+	{ "dlmopen", 341, 3, 344 },
+	{ "strncmp", 345, 3, 348 },
+	{ "pthread_mutex_trylock", 349, 1, 350 },
+	{ "dlerror", 351, 0, 351 },
+	{ "dlclose", 352, 1, 353 },
+	{ "ioctl", 354, 3, 357 },
+	{ "putchar", 358, 1, 359 },
+	{ "dlsym", 360, 2, 362 },
+	{ "memmove", 363, 3, 366 },
+	{ "gethostbyaddr", 367, 3, 370 },
+	{ "memcpy", 371, 3, 374 },
+	{ "calloc", 375, 2, 377 },
+	{ "bind", 378, 3, 381 },
+	{ "getaddrinfo", 382, 4, 386 },
+	{ "kill", 387, 2, 389 },
+	{ "pthread_mutex_unlock", 390, 1, 391 },
+	{ "wait", 392, 1, 393 },
+	{ "fclose", 394, 1, 395 },
+	{ "strchr", 396, 2, 398 },
+	{ "sigdelset", 399, 2, 401 },
+	{ "pthread_exit", 402, 1, -1 },
+	{ "posix_madvise", 403, 3, 406 },
+	{ "ftell", 407, 1, 408 },
+	{ "free", 409, 1, -1 },
+	{ "accept", 410, 3, 413 },
+	{ "strdup", 414, 1, 415 },
+	{ "strpbrk", 416, 2, 418 },
+	{ "munmap", 419, 2, 421 },
+	{ "pthread_mutex_init", 422, 2, 424 },
+	{ "fgets", 425, 3, 428 },
+	{ "strncpy", 429, 3, -1 },
+};
+
+/* seeds of the minimal perfect hash for auto_func_recs */
+static const int auto_func_seeds[] = {
+	1, 0, 0, 0, -138, -136, 1, 1,
+	-134, -133, 2, 0, -132, -131, -128, 0,
+	0, 0, 2, -122, -120, -117, -115, 0,
+	-114, -113, -108, 1, -106, -104, -103, 0,
+	2, 3, 0, -98, -93, 0, 0, -87,
+	0, -85, -84, 1, 0, 1, 0, -82,
+	0, 0, -79, 0, -78, -74, 1, 2,
+	-73, 0, -68, 0, 0, 1, -58, -57,
+	0, 0, -54, 3, 7, -52, -51, 0,
+	-50, 0, -48, 0, 0, 3, 0, -47,
+	1, -45, -42, 0, 3, -40, 0, 0,
+	3, 0, 0, -34, 4, -29, 1, -28,
+	0, 3, -26, 2, 0, 0, -25, -24,
+	0, 0, 0, -21, 0, 1, 1, -20,
+	1, -16, -15, -14, 2, 0, -12, 1,
+	3, 8, 0, 0, 2, -8, -7, 0,
+	-6, -5, -3, 2, 0, 0, 0, 0,
+	-2, 4, 0, 1,
+};
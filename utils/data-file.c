@@ -198,6 +198,38 @@ int read_task_txt_file(struct uftrace_session_link *sess, char *dirname,
 	return 0;
 }
 
+/*
+ * parse argument sizes from SDT argument spec like "-4@%edx 8@-16(%rbp)".
+ * a negative size means it's a signed integer.
+ */
+static void parse_event_args(struct uftrace_event *ev, char *args)
+{
+	struct strv strv = STRV_INIT;
+	char *arg;
+	int i;
+
+	arg = strchr(args, '\n');
+	if (arg)
+		*arg = '\0';
+
+	strv_split(&strv, args, " ");
+
+	strv_for_each(&strv, arg, i) {
+		int size = sizeof(long);
+
+		if (*arg == '\0')
+			continue;
+		if (ev->nr_args == EVENT_MAX_ARGS)
+			break;
+
+		if (strchr(arg, '@'))
+			size = strtol(arg, NULL, 0);
+
+		ev->arg_size[ev->nr_args++] = size;
+	}
+	strv_free(&strv);
+}
+
 /**
  * read_events_file - read 'events.txt' file from data directory
  * @dirname: name of the data directory
@@ -232,16 +264,22 @@ int read_events_file(struct ftrace_file_handle *handle)
 		char event[512];
 		unsigned evt_id;
 		struct uftrace_event *ev;
+		char *pos;
 
 		if (!strncmp(line, "EVENT", 5)) {
 			sscanf(line + 7, "%u %[^:]:%s",
 			       &evt_id, provider, event);
 
-			ev = xmalloc(sizeof(*ev));
+			ev = xzalloc(sizeof(*ev));
 			ev->id = evt_id;
 			ev->provider = xstrdup(provider);
 			ev->event = xstrdup(event);
 
+			/* SDT argument spec (if any) follows the name */
+			pos = strpbrk(strchr(line + 7, ':'), " \n");
+			if (pos && *pos == ' ')
+				parse_event_args(ev, pos + 1);
+
 			list_add_tail(&ev->list, &handle->events);
 		}
 	}
@@ -358,52 +396,21 @@ static void check_data_order(struct ftrace_file_handle *handle)
 		pr_dbg("bitfield order is different!\n");
 }
 
-int open_data_file(struct opts *opts, struct ftrace_file_handle *handle)
+static void init_data_handle(struct opts *opts,
+			     struct ftrace_file_handle *handle)
 {
-	int ret = -1;
-	FILE *fp;
-	char buf[PATH_MAX];
-	int saved_errno = 0;
-
-	snprintf(buf, sizeof(buf), "%s/info", opts->dirname);
-
-	fp = fopen(buf, "rb");
-	if (fp != NULL)
-		goto ok;
-
-	/* if default dirname is failed */
-	if (!strcmp(opts->dirname, UFTRACE_DIR_NAME)) {
-		/* try again inside the current directory */
-		fp = fopen("./info", "rb");
-		if (fp != NULL) {
-			opts->dirname = "./";
-			goto ok;
-		}
-
-		/* retry with old default dirname */
-		snprintf(buf, sizeof(buf), "%s/info", UFTRACE_DIR_OLD_NAME);
-		fp = fopen(buf, "rb");
-		if (fp != NULL) {
-			opts->dirname = UFTRACE_DIR_OLD_NAME;
-			goto ok;
-		}
-
-		saved_errno = errno;
-
-		/* restore original file name for error reporting */
-		snprintf(buf, sizeof(buf), "%s/info", opts->dirname);
-	}
-
-	/* data file loading is failed */
-	pr_dbg("cannot open %s file\n", buf);
-	goto out;
-
-ok:
-	handle->fp = fp;
+	handle->fp = NULL;
 	handle->dirname = opts->dirname;
 	handle->depth = opts->depth;
 	handle->nr_tasks = 0;
 	handle->tasks = NULL;
+	handle->task_hash = NULL;
+	handle->task_hash_size = 0;
+	handle->nr_open_files = 0;
+	handle->max_open_files = opts->max_open_files;
+	INIT_LIST_HEAD(&handle->open_files);
+	memset(&handle->task_heap, 0, sizeof(handle->task_heap));
+	memset(&handle->perf_heap, 0, sizeof(handle->perf_heap));
 	handle->time_filter = opts->threshold;
 	handle->time_range = opts->range;
 	handle->sessions.root  = RB_ROOT;
@@ -414,6 +421,14 @@ ok:
 	handle->perf = NULL;
 	handle->last_perf_idx = -1;
 	INIT_LIST_HEAD(&handle->events);
+}
+
+/* initialize @handle and read the header and info using @fp */
+static void read_data_header(struct opts *opts,
+			     struct ftrace_file_handle *handle, FILE *fp)
+{
+	init_data_handle(opts, handle);
+	handle->fp = fp;
 
 	if (fread(&handle->hdr, sizeof(handle->hdr), 1, fp) != 1)
 		pr_err("cannot read header data");
@@ -441,6 +456,50 @@ ok:
 
 	if (opts->exename == NULL)
 		opts->exename = handle->info.exename;
+}
+
+int open_data_file(struct opts *opts, struct ftrace_file_handle *handle)
+{
+	int ret = -1;
+	FILE *fp;
+	char buf[PATH_MAX];
+	int saved_errno = 0;
+
+	snprintf(buf, sizeof(buf), "%s/info", opts->dirname);
+
+	fp = fopen(buf, "rb");
+	if (fp != NULL)
+		goto ok;
+
+	/* if default dirname is failed */
+	if (!strcmp(opts->dirname, UFTRACE_DIR_NAME)) {
+		/* try again inside the current directory */
+		fp = fopen("./info", "rb");
+		if (fp != NULL) {
+			opts->dirname = "./";
+			goto ok;
+		}
+
+		/* retry with old default dirname */
+		snprintf(buf, sizeof(buf), "%s/info", UFTRACE_DIR_OLD_NAME);
+		fp = fopen(buf, "rb");
+		if (fp != NULL) {
+			opts->dirname = UFTRACE_DIR_OLD_NAME;
+			goto ok;
+		}
+
+		saved_errno = errno;
+
+		/* restore original file name for error reporting */
+		snprintf(buf, sizeof(buf), "%s/info", opts->dirname);
+	}
+
+	/* data file loading is failed */
+	pr_dbg("cannot open %s file\n", buf);
+	goto out;
+
+ok:
+	read_data_header(opts, handle, fp);
 
 	if (handle->hdr.feat_mask & TASK_SESSION) {
 		bool sym_rel = false;
@@ -512,6 +571,95 @@ out:
 	return ret;
 }
 
+/**
+ * open_stream_data - open data while it's being recorded
+ * @opts: uftrace options
+ * @handle: file handle to be set up
+ *
+ * This function is similar to open_data_file() but only reads the info
+ * file in the data directory.  The sessions and tasks are added later
+ * as the record messages arrive (see cmd-live.c).  Note that it doesn't
+ * support kernel and perf data.
+ *
+ * It returns 0 for success, -1 for error.
+ */
+int open_stream_data(struct opts *opts, struct ftrace_file_handle *handle)
+{
+	FILE *fp;
+	char buf[PATH_MAX];
+
+	snprintf(buf, sizeof(buf), "%s/info", opts->dirname);
+
+	fp = fopen(buf, "rb");
+	if (fp == NULL) {
+		pr_dbg("cannot open %s file\n", buf);
+		return -1;
+	}
+
+	read_data_header(opts, handle, fp);
+
+	if ((handle->hdr.info_mask & ARG_SPEC) &&
+	    (handle->hdr.feat_mask & AUTO_ARGS)) {
+		setup_auto_args_str(handle->info.autoarg,
+				    handle->info.autoret,
+				    handle->info.autoenum);
+	}
+
+	if (!(handle->hdr.feat_mask & MAX_STACK))
+		handle->hdr.max_stack = MCOUNT_RSTACK_MAX;
+
+	/* no kernel or perf data in the stream */
+	handle->hdr.feat_mask &= ~(KERNEL | PERF_EVENT);
+
+	return 0;
+}
+
+/**
+ * open_shared_data_file - open data sharing sessions with another handle
+ * @opts: uftrace options
+ * @handle: file handle to be set up
+ * @orig: handle opened by open_data_file() already
+ *
+ * This function sets up @handle to read the same data as @orig without
+ * reading the info, sessions and symbol tables again.  They're shared
+ * with @orig (read-only) so @orig should be closed after @handle.  The
+ * task handles (and perf data) are owned by each handle so that they
+ * can be read in different threads.  Kernel data is not supported.
+ *
+ * It returns 0 for success, -1 for error.
+ */
+int open_shared_data_file(struct opts *opts, struct ftrace_file_handle *handle,
+			  struct ftrace_file_handle *orig)
+{
+	init_data_handle(opts, handle);
+
+	handle->hdr             = orig->hdr;
+	handle->info            = orig->info;
+	handle->sessions        = orig->sessions;
+	handle->needs_byte_swap = orig->needs_byte_swap;
+	handle->needs_bit_swap  = orig->needs_bit_swap;
+
+	if (has_kernel_data(orig->kernel))
+		return -1;
+
+	if (handle->hdr.feat_mask & EVENT)
+		read_events_file(handle);
+
+	if (handle->hdr.feat_mask & PERF_EVENT)
+		setup_perf_data(handle);
+
+	return 0;
+}
+
+/* release the data opened by open_shared_data_file() */
+void close_shared_data_file(struct ftrace_file_handle *handle)
+{
+	if (has_perf_data(handle))
+		finish_perf_data(handle);
+
+	reset_task_handle(handle);
+}
+
 void close_data_file(struct opts *opts, struct ftrace_file_handle *handle)
 {
 	if (opts->exename == handle->info.exename)
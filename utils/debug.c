@@ -34,28 +34,143 @@ enum color_setting log_color;
 enum color_setting out_color;
 int dbg_domain[DBG_DOMAIN_MAX];
 
+#define COLOR(c, s)  { c, s, sizeof(s) - 1 }
+
 static const struct color_code {
 	char		code;
 	const char	*color;
+	size_t		len;
 } colors[] = {
-	{ COLOR_CODE_RED,	TERM_COLOR_RED },
-	{ COLOR_CODE_GREEN,	TERM_COLOR_GREEN },
-	{ COLOR_CODE_BLUE,	TERM_COLOR_BLUE },
-	{ COLOR_CODE_YELLOW,	TERM_COLOR_YELLOW },
-	{ COLOR_CODE_MAGENTA,	TERM_COLOR_MAGENTA },
-	{ COLOR_CODE_CYAN,	TERM_COLOR_CYAN },
-	{ COLOR_CODE_GRAY,	TERM_COLOR_GRAY },
-	{ COLOR_CODE_BOLD,	TERM_COLOR_BOLD },
+	COLOR(COLOR_CODE_RED,		TERM_COLOR_RED),
+	COLOR(COLOR_CODE_GREEN,		TERM_COLOR_GREEN),
+	COLOR(COLOR_CODE_BLUE,		TERM_COLOR_BLUE),
+	COLOR(COLOR_CODE_YELLOW,	TERM_COLOR_YELLOW),
+	COLOR(COLOR_CODE_MAGENTA,	TERM_COLOR_MAGENTA),
+	COLOR(COLOR_CODE_CYAN,		TERM_COLOR_CYAN),
+	COLOR(COLOR_CODE_GRAY,		TERM_COLOR_GRAY),
+	COLOR(COLOR_CODE_BOLD,		TERM_COLOR_BOLD),
 };
 
-static void color(const char *code, FILE *fp)
+/*
+ * Output buffer of the current thread.  Commands printing lots of lines
+ * (replay and dump) use it to bypass stdio and write the output in a
+ * large chunk.  If the file is not set, it's kept in memory until
+ * take_output_buffer() is called.  It's active when size is not 0.
+ */
+#define OUTPUT_BUFFER_SIZE  (1024 * 1024)
+
+static __thread struct output_buffer {
+	char	*data;
+	size_t	len;
+	size_t	size;
+	FILE	*fp;
+} outbuf;
+
+static void reserve_output(size_t len)
+{
+	if (outbuf.data && outbuf.len + len <= outbuf.size)
+		return;
+
+	if (outbuf.fp) {
+		flush_output_buffer();
+		if (len <= outbuf.size)
+			return;
+	}
+
+	while (outbuf.len + len > outbuf.size)
+		outbuf.size *= 2;
+
+	outbuf.data = xrealloc(outbuf.data, outbuf.size);
+}
+
+static void write_output(const char *str, size_t len)
+{
+	reserve_output(len);
+
+	memcpy(outbuf.data + outbuf.len, str, len);
+	outbuf.len += len;
+}
+
+static void vprintf_output(const char *fmt, va_list ap)
+{
+	va_list aq;
+	size_t len;
+
+	reserve_output(0);
+
+	va_copy(aq, ap);
+	len = vsnprintf(outbuf.data + outbuf.len, outbuf.size - outbuf.len,
+			fmt, aq);
+	va_end(aq);
+
+	if (outbuf.len + len >= outbuf.size) {
+		reserve_output(len + 1);
+		len = vsnprintf(outbuf.data + outbuf.len,
+				outbuf.size - outbuf.len, fmt, ap);
+	}
+	outbuf.len += len;
+}
+
+/**
+ * setup_output_buffer - buffer normal output in the current thread
+ * @fp: file to flush the output, or %NULL to keep it in memory
+ *
+ * The output is not buffered for a terminal or in debug mode to keep
+ * it in sync with other messages.
+ */
+void setup_output_buffer(FILE *fp)
+{
+	if (fp && (debug || isatty(fileno(fp))))
+		return;
+
+	outbuf.data = xmalloc(OUTPUT_BUFFER_SIZE);
+	outbuf.size = OUTPUT_BUFFER_SIZE;
+	outbuf.len  = 0;
+	outbuf.fp   = fp;
+}
+
+void flush_output_buffer(void)
 {
-	size_t len = strlen(code);
+	if (outbuf.fp == NULL || outbuf.len == 0)
+		return;
+
+	if (fwrite(outbuf.data, 1, outbuf.len, outbuf.fp) != outbuf.len)
+		pr_dbg("writing output failed: %m\n");
 
+	outbuf.len = 0;
+}
+
+/* returns the (unflushed) output in the buffer, the caller should free it */
+char * take_output_buffer(size_t *len)
+{
+	char *data = outbuf.data;
+
+	*len = outbuf.len;
+
+	outbuf.data = NULL;
+	outbuf.len  = 0;
+	return data;
+}
+
+void finish_output_buffer(void)
+{
+	flush_output_buffer();
+
+	free(outbuf.data);
+	memset(&outbuf, 0, sizeof(outbuf));
+}
+
+static void __color(const char *code, size_t len, FILE *fp)
+{
 	if ((fp == logfp && log_color == COLOR_OFF) ||
 	    (fp == outfp && out_color == COLOR_OFF))
 		return;
 
+	if (fp == outfp && outbuf.size) {
+		write_output(code, len);
+		return;
+	}
+
 	if (fwrite(code, 1, len, fp) == len)
 		return;  /* ok */
 
@@ -68,6 +183,11 @@ static void color(const char *code, FILE *fp)
 		pr_dbg("resetting terminal color failed");
 }
 
+static void color(const char *code, FILE *fp)
+{
+	__color(code, strlen(code), fp);
+}
+
 void setup_color(enum color_setting color)
 {
 	if (likely(color == COLOR_AUTO)) {
@@ -97,6 +217,9 @@ void __pr_err(const char *fmt, ...)
 {
 	va_list ap;
 
+	/* do not lose the output before the error */
+	flush_output_buffer();
+
 	color(TERM_COLOR_RED, logfp);
 
 	va_start(ap, fmt);
@@ -114,6 +237,9 @@ void __pr_err_s(const char *fmt, ...)
 	int saved_errno = errno;
 	char buf[512];
 
+	/* do not lose the output before the error */
+	flush_output_buffer();
+
 	color(TERM_COLOR_RED, logfp);
 
 	va_start(ap, fmt);
@@ -145,28 +271,102 @@ void __pr_out(const char *fmt, ...)
 	va_list ap;
 
 	va_start(ap, fmt);
-	vfprintf(outfp, fmt, ap);
+	if (outbuf.size)
+		vprintf_output(fmt, ap);
+	else
+		vfprintf(outfp, fmt, ap);
 	va_end(ap);
 }
 
-void __pr_color(char code, const char *fmt, ...)
+void __pr_out_str(const char *str, size_t len)
+{
+	if (outbuf.size)
+		write_output(str, len);
+	else
+		fwrite(str, 1, len, outfp);
+}
+
+/* same as pr_out("%*s", width, "") */
+void pr_out_space(int width)
+{
+	static const char spaces[] = "                                ";
+	int len;
+
+	/* negative width means left-justified */
+	if (width < 0)
+		width = -width;
+
+	while (width > 0) {
+		len = width;
+		if (len > (int)sizeof(spaces) - 1)
+			len = sizeof(spaces) - 1;
+
+		__pr_out_str(spaces, len);
+		width -= len;
+	}
+}
+
+/**
+ * pr_out_num - print a decimal number without printf
+ * @num: number to print
+ * @width: minimum width of the output
+ * @pad: character to fill the width (usually ' ' or '0')
+ */
+void pr_out_num(uint64_t num, int width, char pad)
+{
+	char buf[64];
+	char *p = buf + sizeof(buf);
+	int len;
+
+	do {
+		*--p = '0' + num % 10;
+		num /= 10;
+	}
+	while (num);
+
+	len = buf + sizeof(buf) - p;
+	if (width > (int)sizeof(buf))
+		width = sizeof(buf);
+
+	while (len < width) {
+		*--p = pad;
+		len++;
+	}
+
+	__pr_out_str(p, len);
+}
+
+void pr_color_start(char code)
 {
 	size_t i;
-	va_list ap;
-	const char *cs = TERM_COLOR_NORMAL;
 
 	for (i = 0; i < ARRAY_SIZE(colors); i++) {
-		if (code == colors[i].code)
-			cs = colors[i].color;
+		if (code == colors[i].code) {
+			__color(colors[i].color, colors[i].len, outfp);
+			return;
+		}
 	}
+}
 
-	color(cs, outfp);
+void pr_color_end(void)
+{
+	__color(TERM_COLOR_RESET, sizeof(TERM_COLOR_RESET) - 1, outfp);
+}
+
+void __pr_color(char code, const char *fmt, ...)
+{
+	va_list ap;
+
+	pr_color_start(code);
 
 	va_start(ap, fmt);
-	vfprintf(outfp, fmt, ap);
+	if (outbuf.size)
+		vprintf_output(fmt, ap);
+	else
+		vfprintf(outfp, fmt, ap);
 	va_end(ap);
 
-	color(TERM_COLOR_RESET, outfp);
+	pr_color_end();
 }
 
 static void __print_time_unit(int64_t delta_nsec, bool needs_sign)
@@ -186,9 +386,7 @@ static void __print_time_unit(int64_t delta_nsec, bool needs_sign)
 	unsigned idx;
 
 	if (delta_nsec == 0UL) {
-		if (needs_sign)
-			pr_out(" ");
-		pr_out("%7s %2s", "", "");
+		pr_out_space(needs_sign ? 11 : 10);
 		return;
 	}
 
@@ -247,8 +445,13 @@ static void __print_time_unit(int64_t delta_nsec, bool needs_sign)
 		pr_out("%*s%s%"PRId64".%03"PRIu64"%s %s", indent, "",
 		       sign, delta, delta_small, ends, unit);
 	}
-	else
-		pr_out("%3"PRIu64".%03"PRIu64" %s", delta, delta_small, unit);
+	else {
+		pr_out_num(delta, 3, ' ');
+		pr_out_str(".");
+		pr_out_num(delta_small, 3, '0');
+		pr_out_str(" ");
+		pr_out_str(unit);
+	}
 }
 
 void print_time_unit(uint64_t delta_nsec)
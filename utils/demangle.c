@@ -1507,6 +1507,87 @@ char *demangle(char *str)
 	}
 }
 
+/*
+ * identifiers in demangled names which don't come from the source names
+ * in the mangled names: builtin types, std abbreviations, special names
+ * and keywords.  See also the types and std_abbrevs tables above.
+ */
+static const char * const non_source_names[] = {
+	"void", "wchar_t", "bool", "char", "signed", "unsigned", "short",
+	"int", "long", "__int128", "float", "double", "__float128",
+	"char8_t", "char16_t", "char32_t", "decltype", "auto", "const",
+	"volatile", "restrict", "__restrict", "true", "false", "sizeof",
+	"alignof", "noexcept", "throw", "operator", "new", "delete", "cast",
+	"std", "allocator", "basic_string", "string", "char_traits",
+	"basic_istream", "basic_ostream", "basic_iostream", "istream",
+	"ostream", "iostream", "anonymous", "namespace", "lambda", "unnamed",
+	"type", "clone", "abi", "vtable", "typeinfo", "name", "VTT", "for",
+	"construction", "guard", "variable", "virtual", "non", "thunk", "to",
+	"covariant", "return", "reference", "temporary", "transaction",
+	"TLS", "init", "function", "wrapper", "hidden", "alias", "in",
+};
+
+static bool is_ident_char(char c)
+{
+	return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+		(c >= '0' && c <= '9');
+}
+
+static bool is_source_name(const char *str, size_t len)
+{
+	size_t i;
+
+	/* numbers can be encoded differently (e.g. 1u) */
+	if (str[0] >= '0' && str[0] <= '9')
+		return false;
+
+	for (i = 0; i < ARRAY_SIZE(non_source_names); i++) {
+		if (strlen(non_source_names[i]) == len &&
+		    !strncmp(non_source_names[i], str, len))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * demangle_hint - find a keyword to check mangled names
+ * @str: (a part of) demangled name
+ *
+ * This function returns the longest identifier in @str which should be
+ * found in the mangled name as is.  So callers can check the mangled
+ * name with it before demangling.  Identifiers in @str are separated by
+ * non-identifier characters.  It returns %NULL if no such identifier
+ * was found.  The returned string should be freed by the caller.
+ */
+char *demangle_hint(const char *str)
+{
+	const char *best = NULL;
+	size_t best_len = 0;
+
+	while (*str) {
+		const char *pos = str;
+
+		if (!is_ident_char(*str)) {
+			str++;
+			continue;
+		}
+
+		while (is_ident_char(*str))
+			str++;
+
+		if ((size_t)(str - pos) > best_len &&
+		    is_source_name(pos, str - pos)) {
+			best = pos;
+			best_len = str - pos;
+		}
+	}
+
+	if (best == NULL)
+		return NULL;
+
+	return xstrndup(best, best_len);
+}
+
 #ifdef UNIT_TEST
 TEST_CASE(demangle_simple1)
 {
@@ -1682,4 +1763,26 @@ TEST_CASE(demangle_simple5)
 
 	return TEST_OK;
 }
+
+TEST_CASE(demangle_hint)
+{
+	char *hint;
+
+	hint = demangle_hint("ns::foo(int)");
+	TEST_STREQ("foo", hint);
+	free(hint);
+
+	hint = demangle_hint("std::vector<unsigned int>::push_back");
+	TEST_STREQ("push_back", hint);
+	free(hint);
+
+	hint = demangle_hint("operator new");
+	TEST_EQ(hint, NULL);
+
+	hint = demangle_hint("Foo<1u>");
+	TEST_STREQ("Foo", hint);
+	free(hint);
+
+	return TEST_OK;
+}
 #endif /* UNIT_TEST */
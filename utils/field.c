@@ -30,7 +30,7 @@ int print_field_data(struct list_head *output_fields, struct field_data *fd,
 		return 0;
 
 	list_for_each_entry(field, output_fields, list) {
-		pr_out("%*s", space, "");
+		pr_out_space(space);
 		field->print(fd);
 	}
 	return 1;
@@ -44,7 +44,7 @@ int print_empty_field(struct list_head *output_fields, int space)
 		return 0;
 
 	list_for_each_entry(field, output_fields, list)
-		pr_out("%*s", field->length + space, "");
+		pr_out_space(field->length + space);
 
 	return 1;
 }
@@ -4,6 +4,7 @@
 #include <fnmatch.h>
 #include <sys/utsname.h>
 #include <link.h>
+#include <time.h>
 
 /* This should be defined before #include "utils.h" */
 #define PR_FMT     "filter"
@@ -88,6 +89,10 @@ static void print_trigger(struct uftrace_trigger *tr)
 		snprintf_trigger_read(buf, sizeof(buf), tr->read);
 		pr_dbg("\ttrigger: read (%s)\n", buf);
 	}
+	if (tr->flags & TRIGGER_FL_PREDICATE) {
+		pr_dbg("\ttrigger: predicate (%d terms, %d args)\n",
+		       tr->pred->nr_insns, tr->pred->nr_args);
+	}
 }
 
 static bool match_ip(struct uftrace_filter *filter, unsigned long ip)
@@ -129,6 +134,90 @@ struct uftrace_filter *uftrace_match_filter(uint64_t ip, struct rb_root *root,
 	return NULL;
 }
 
+/* compare strings without calling libc (which may clobber registers) */
+static bool match_pred_string(const char *str, struct filter_pred_insn *insn,
+			      bool prefix)
+{
+	unsigned i;
+
+	if (str == NULL)
+		return false;
+
+	for (i = 0; i < insn->len; i++) {
+		if (str[i] != insn->str[i])
+			return false;
+	}
+	return prefix || str[i] == '\0';
+}
+
+/**
+ * filter_predicate_match - check if arguments satisfy the predicate
+ * @pred - predicate of a trigger
+ * @args - argument values (args[0] is the first argument)
+ *
+ * This function returns %true if any group of instructions (separated
+ * by the @or flag) is all true.  The @args should have values up to
+ * @pred->nr_args.  Integers are compared as signed long values.
+ */
+bool filter_predicate_match(struct filter_predicate *pred,
+			    unsigned long *args)
+{
+	bool match = true;
+	int i;
+
+	for (i = 0; i < pred->nr_insns; i++) {
+		struct filter_pred_insn *insn = &pred->insns[i];
+		long val = args[insn->idx - 1];
+
+		if (insn->or) {
+			if (match)
+				return true;
+			match = true;
+		}
+		else if (!match) {
+			/* skip the rest of the group */
+			continue;
+		}
+
+		switch (insn->op) {
+		case PRED_OP_EQ:
+			match = val == insn->val;
+			break;
+		case PRED_OP_NE:
+			match = val != insn->val;
+			break;
+		case PRED_OP_LT:
+			match = val < insn->val;
+			break;
+		case PRED_OP_LE:
+			match = val <= insn->val;
+			break;
+		case PRED_OP_GT:
+			match = val > insn->val;
+			break;
+		case PRED_OP_GE:
+			match = val >= insn->val;
+			break;
+		case PRED_OP_BIT:
+			match = (val & insn->val) != 0;
+			break;
+		case PRED_OP_STR_EQ:
+			match = match_pred_string((void *)val, insn, false);
+			break;
+		case PRED_OP_STR_NE:
+			match = !match_pred_string((void *)val, insn, false);
+			break;
+		case PRED_OP_STR_PREFIX:
+			match = match_pred_string((void *)val, insn, true);
+			break;
+		default:
+			match = false;
+			break;
+		}
+	}
+	return match;
+}
+
 static void add_arg_spec(struct list_head *arg_list, struct uftrace_arg_spec *arg,
 			 bool exact_match)
 {
@@ -186,6 +275,37 @@ static void add_arg_spec(struct list_head *arg_list, struct uftrace_arg_spec *ar
 	}
 }
 
+static void free_filter_predicate(struct filter_predicate *pred)
+{
+	int i;
+
+	if (pred == NULL)
+		return;
+
+	for (i = 0; i < pred->nr_insns; i++) {
+		if (pred->insns[i].op >= PRED_OP_STR_EQ)
+			free(pred->insns[i].str);
+	}
+	free(pred);
+}
+
+static struct filter_predicate *copy_filter_predicate(struct filter_predicate *pred)
+{
+	struct filter_predicate *copy;
+	size_t size;
+	int i;
+
+	size = sizeof(*pred) + pred->nr_insns * sizeof(*pred->insns);
+	copy = xmalloc(size);
+	memcpy(copy, pred, size);
+
+	for (i = 0; i < copy->nr_insns; i++) {
+		if (copy->insns[i].op >= PRED_OP_STR_EQ)
+			copy->insns[i].str = xstrdup(pred->insns[i].str);
+	}
+	return copy;
+}
+
 void add_trigger(struct uftrace_filter *filter, struct uftrace_trigger *tr,
 		 bool exact_match)
 {
@@ -214,6 +334,10 @@ void add_trigger(struct uftrace_filter *filter, struct uftrace_trigger *tr,
 		filter->trigger.time = tr->time;
 	if (tr->flags & TRIGGER_FL_READ)
 		filter->trigger.read |= tr->read;
+	if (tr->flags & TRIGGER_FL_PREDICATE) {
+		free_filter_predicate(filter->trigger.pred);
+		filter->trigger.pred = copy_filter_predicate(tr->pred);
+	}
 }
 
 static int add_filter(struct rb_root *root, struct uftrace_filter *filter,
@@ -282,6 +406,7 @@ static int add_filter(struct rb_root *root, struct uftrace_filter *filter,
 	memcpy(new, filter, sizeof(*new));
 	new->trigger.flags = 0;
 	new->trigger.read  = 0;
+	new->trigger.pred  = NULL;
 	INIT_LIST_HEAD(&new->args);
 	new->trigger.pargs = &new->args;
 
@@ -306,6 +431,146 @@ struct {
 	{ PATT_GLOB,	"glob" },
 };
 
+/* replace glob meta characters with space */
+static void strip_glob_chars(char *str)
+{
+	char *p = str;
+
+	while (*p) {
+		switch (*p) {
+		case '[':
+			/* a bracket expression matches a single char */
+			*p++ = ' ';
+			if (*p == '!' || *p == '^')
+				*p++ = ' ';
+			if (*p == ']')
+				*p++ = ' ';
+			while (*p && *p != ']')
+				*p++ = ' ';
+			if (*p)
+				*p++ = ' ';
+			break;
+		case '\\':
+			*p++ = ' ';
+			if (*p)
+				p++;
+			break;
+		case '*':
+		case '?':
+			*p++ = ' ';
+			break;
+		default:
+			p++;
+			break;
+		}
+	}
+}
+
+/* replace regex meta characters with space, returns false if cannot */
+static bool strip_regex_chars(char *str)
+{
+	char *p = str;
+	char *group[32];
+	int nr_group = 0;
+
+	/* any part of the pattern can be optional */
+	if (strchr(str, '|'))
+		return false;
+
+	while (*p) {
+		switch (*p) {
+		case '[':
+			*p++ = ' ';
+			if (*p == '^')
+				*p++ = ' ';
+			if (*p == ']')
+				*p++ = ' ';
+			while (*p && *p != ']')
+				*p++ = ' ';
+			if (*p)
+				*p++ = ' ';
+			break;
+		case '\\':
+			/* it might be a character class like \w */
+			*p++ = ' ';
+			if (*p)
+				*p++ = ' ';
+			break;
+		case '(':
+			if (nr_group == ARRAY_SIZE(group))
+				return false;
+			group[nr_group++] = p;
+			*p++ = ' ';
+			break;
+		case ')':
+			*p = ' ';
+			if (nr_group && (p[1] == '*' || p[1] == '?' || p[1] == '{')) {
+				/* the whole group is optional */
+				char *q = group[nr_group - 1];
+
+				while (q < p)
+					*q++ = ' ';
+			}
+			if (nr_group)
+				nr_group--;
+			p++;
+			break;
+		case '*':
+		case '?':
+		case '{':
+			/* the previous char is optional */
+			if (p > str)
+				p[-1] = ' ';
+			if (*p == '{') {
+				while (*p && *p != '}')
+					*p++ = ' ';
+			}
+			if (*p)
+				*p++ = ' ';
+			break;
+		case '.':
+		case '+':
+		case '^':
+		case '$':
+			*p++ = ' ';
+			break;
+		default:
+			p++;
+			break;
+		}
+	}
+	return true;
+}
+
+/*
+ * find a keyword which should be in the mangled name of the matching
+ * C++ symbol.  It can be used to skip demangling unrelated symbols.
+ */
+static char * get_pattern_hint(struct uftrace_pattern *p)
+{
+	char *str = xstrdup(p->patt);
+	char *hint = NULL;
+
+	switch (p->type) {
+	case PATT_SIMPLE:
+		hint = demangle_hint(str);
+		break;
+	case PATT_GLOB:
+		strip_glob_chars(str);
+		hint = demangle_hint(str);
+		break;
+	case PATT_REGEX:
+		if (strip_regex_chars(str))
+			hint = demangle_hint(str);
+		break;
+	default:
+		break;
+	}
+
+	free(str);
+	return hint;
+}
+
 void init_filter_pattern(enum uftrace_pattern_type type,
 			 struct uftrace_pattern *p, char *str)
 {
@@ -321,6 +586,8 @@ void init_filter_pattern(enum uftrace_pattern_type type,
 			p->type = PATT_SIMPLE;
 		}
 	}
+
+	p->hint = get_pattern_hint(p);
 }
 
 bool match_filter_pattern(struct uftrace_pattern *p, char *name)
@@ -337,10 +604,30 @@ bool match_filter_pattern(struct uftrace_pattern *p, char *name)
 	}
 }
 
+/**
+ * match_filter_symbol - check if a symbol matches to the pattern
+ * @p: filter pattern
+ * @sym: symbol to check
+ *
+ * This function is same as match_filter_pattern() but it checks the
+ * mangled name of a C++ symbol with the hint first so that it can
+ * avoid demangling (most) symbols which don't match.
+ */
+bool match_filter_symbol(struct uftrace_pattern *p, struct sym *sym)
+{
+	if (is_mangled_name(sym->name) && p->hint &&
+	    !strstr(sym->name, p->hint))
+		return false;
+
+	return match_filter_pattern(p, symbol_getname(sym, sym->addr));
+}
+
 void free_filter_pattern(struct uftrace_pattern *p)
 {
 	free(p->patt);
 	p->patt = NULL;
+	free(p->hint);
+	p->hint = NULL;
 
 	if (p->type == PATT_REGEX)
 		regfree(&p->re);
@@ -372,48 +659,6 @@ const char * get_filter_pattern(enum uftrace_pattern_type ptype)
 	return "none";
 }
 
-static int add_exact_filter(struct rb_root *root, struct symtab *symtab,
-			    struct uftrace_pattern *p, struct uftrace_trigger *tr)
-{
-	struct uftrace_filter filter;
-	struct sym *sym;
-
-	sym = find_symname(symtab, p->patt);
-	if (sym == NULL)
-		return 0;
-
-	filter.name = sym->name;
-	filter.start = sym->addr;
-	filter.end = sym->addr + sym->size;
-
-	return add_filter(root, &filter, tr, true);
-}
-
-static int add_pattern_filter(struct rb_root *root, struct symtab *symtab,
-			      struct uftrace_pattern *patt,
-			      struct uftrace_trigger *tr)
-{
-	struct uftrace_filter filter;
-	struct sym *sym;
-	unsigned i;
-	int ret = 0;
-
-	for (i = 0; i < symtab->nr_sym; i++) {
-		sym = &symtab->sym[i];
-
-		if (!match_filter_pattern(patt, sym->name))
-			continue;
-
-		filter.name = sym->name;
-		filter.start = sym->addr;
-		filter.end = sym->addr + sym->size;
-
-		ret += add_filter(root, &filter, tr, false);
-	}
-
-	return ret;
-}
-
 static bool is_arm_machine(void)
 {
 	static char *mach = NULL;
@@ -452,6 +697,21 @@ static int has_shared_object(const char *soname)
 	return so_used;
 }
 
+/* std::string display is not supported for libc++ */
+bool std_string_supported(void)
+{
+	static bool warned = false;
+
+	if (!has_shared_object("libc++.so"))
+		return true;
+
+	if (!warned) {
+		pr_warn("std::string display for libc++.so is not supported.\n");
+		warned = true;
+	}
+	return false;
+}
+
 /* argument_spec = arg1/i32,arg2/x64,... */
 static int parse_spec(char *str, struct uftrace_arg_spec *arg, char *suffix)
 {
@@ -493,15 +753,8 @@ static int parse_spec(char *str, struct uftrace_arg_spec *arg, char *suffix)
 		size = sizeof(double);
 		break;
 	case 'S':
-		if (has_shared_object("libc++.so")) {
-			static bool warned = false;
-			if (!warned) {
-				pr_warn("std::string display for libc++.so is "
-					"not supported.\n");
-				warned = true;
-			}
+		if (!std_string_supported())
 			return -1;
-		}
 		fmt = ARG_FMT_STD_STRING;
 		break;
 	case 'p':
@@ -811,6 +1064,129 @@ static int parse_auto_args_action(char *action, struct uftrace_trigger *tr)
 	return 0;
 }
 
+static const struct {
+	const char		*str;
+	enum filter_pred_op	op;
+} pred_ops[] = {
+	/* longer operators should come first */
+	{ "==", PRED_OP_EQ },
+	{ "!=", PRED_OP_NE },
+	{ "<=", PRED_OP_LE },
+	{ ">=", PRED_OP_GE },
+	{ "^=", PRED_OP_STR_PREFIX },
+	{ "<",  PRED_OP_LT },
+	{ ">",  PRED_OP_GT },
+	{ "&",  PRED_OP_BIT },
+};
+
+/* parse a term like 'arg1>4096', 'arg2&0x10' or 'arg3=="str"' */
+static char *parse_pred_term(char *pos, struct filter_pred_insn *insn)
+{
+	char *end;
+	size_t i;
+
+	if (strncmp(pos, "arg", 3))
+		return NULL;
+
+	insn->idx = strtoul(pos + 3, &end, 10);
+	if (end == pos + 3 || insn->idx < 1 || insn->idx > PRED_MAX_ARGS)
+		return NULL;
+	pos = end;
+
+	/* bare 'argN' is same as 'argN!=0' */
+	if (*pos == '\0' || !strncmp(pos, "&&", 2) || !strncmp(pos, "||", 2)) {
+		insn->op  = PRED_OP_NE;
+		insn->val = 0;
+		return pos;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(pred_ops); i++) {
+		if (!strncmp(pos, pred_ops[i].str, strlen(pred_ops[i].str)))
+			break;
+	}
+	if (i == ARRAY_SIZE(pred_ops))
+		return NULL;
+
+	insn->op = pred_ops[i].op;
+	pos += strlen(pred_ops[i].str);
+
+	if (*pos == '"') {
+		end = strchr(++pos, '"');
+		if (end == NULL || end == pos)
+			return NULL;
+
+		if (insn->op == PRED_OP_EQ)
+			insn->op = PRED_OP_STR_EQ;
+		else if (insn->op == PRED_OP_NE)
+			insn->op = PRED_OP_STR_NE;
+		else if (insn->op != PRED_OP_STR_PREFIX)
+			return NULL;
+
+		insn->len = end - pos;
+		insn->str = xstrndup(pos, insn->len);
+		return end + 1;
+	}
+
+	if (insn->op == PRED_OP_STR_PREFIX)
+		return NULL;
+
+	insn->val = strtol(pos, &end, 0);
+	if (end == pos)
+		return NULL;
+	return end;
+}
+
+/*
+ * parse 'if:' action into a list of instructions.  The predicate is
+ * terms joined by '&&' and '||' where '&&' has higher precedence.
+ */
+static int parse_predicate_action(char *action, struct uftrace_trigger *tr)
+{
+	struct filter_predicate *pred;
+	struct filter_pred_insn *insn;
+	char *pos = action + 3;
+	bool or = false;
+	int nr = 0;
+
+	pred = xzalloc(sizeof(*pred));
+
+	while (true) {
+		pred = xrealloc(pred, sizeof(*pred) + (nr + 1) * sizeof(*insn));
+		insn = &pred->insns[nr];
+		memset(insn, 0, sizeof(*insn));
+		insn->or = or;
+
+		pos = parse_pred_term(pos, insn);
+		if (pos == NULL)
+			goto err;
+
+		pred->nr_insns = ++nr;
+		if (insn->idx > pred->nr_args)
+			pred->nr_args = insn->idx;
+
+		if (*pos == '\0')
+			break;
+
+		if (!strncmp(pos, "&&", 2))
+			or = false;
+		else if (!strncmp(pos, "||", 2))
+			or = true;
+		else
+			goto err;
+		pos += 2;
+	}
+
+	free_filter_predicate(tr->pred);
+	tr->pred = pred;
+	tr->flags |= TRIGGER_FL_PREDICATE;
+	return 0;
+
+err:
+	pr_use("skipping invalid predicate: %s\n", action);
+	free_filter_predicate(pred);
+	return -1;
+}
+
 struct trigger_action_parser {
 	const char *name;
 	int (*parse)(char *action, struct uftrace_trigger *tr);
@@ -832,6 +1208,7 @@ static const struct trigger_action_parser actions[] = {
 	{ "recover",   parse_recover_action, },
 	{ "finish",    parse_finish_action, },
 	{ "auto-args", parse_auto_args_action, },
+	{ "if:",       parse_predicate_action,    TRIGGER_FL_FILTER, },
 };
 
 int setup_trigger_action(char *str, struct uftrace_trigger *tr,
@@ -847,7 +1224,7 @@ int setup_trigger_action(char *str, struct uftrace_trigger *tr,
 		return 0;
 
 	*pos++ = '\0';
-	strv_split(&acts, pos, ",");
+	strv_split_quoted(&acts, pos, ',');
 
 	strv_for_each(&acts, pos, j) {
 		for (i = 0; i < ARRAY_SIZE(actions); i++) {
@@ -880,131 +1257,563 @@ out:
 	return ret;
 }
 
-static int add_trigger_entry(struct rb_root *root, struct symtab *symtab,
-			     struct uftrace_pattern *patt,
-			     struct uftrace_trigger *tr)
+/*
+ * Filter (and trigger) specs are compiled together so that it can find
+ * the matching symbols in a single pass for each symbol table:
+ *
+ *  - simple names are looked up using the name-sorted index
+ *  - literal prefixes of patterns are saved in a trie
+ *  - the remaining regex patterns are combined into an alternation
+ *
+ * Candidates from the trie and the alternation are checked with the
+ * original pattern later.  C++ symbols are demangled only if one of
+ * the patterns has its hint in the mangled name.
+ */
+struct filter_spec {
+	struct uftrace_pattern	patt;
+	struct uftrace_trigger	tr;
+	struct list_head	args;
+	/* symbol tables for the module (or NULL for all modules) */
+	struct symtab		*symtab[2];
+	/* simple name was not found in the name index */
+	bool			pending;
+	int			nr_added;
+};
+
+struct filter_trie_spec {
+	struct filter_trie_spec	*next;
+	int			idx;
+};
+
+struct filter_trie {
+	struct filter_trie	*child;
+	struct filter_trie	*next;
+	struct filter_trie_spec	*specs;
+	char			ch;
+};
+
+struct filter_hit {
+	int			idx;
+	unsigned		seq;
+	struct sym		*sym;
+};
+
+struct filter_compiler {
+	struct filter_spec	*specs;
+	int			nr_specs;
+	int			nr_exact;
+	int			nr_prefix;
+	/* patterns without literal prefix */
+	int			*others;
+	int			nr_others;
+	regex_t			combined;
+	bool			has_combined;
+	struct filter_trie	trie;
+	struct arena		arena;
+	struct filter_hit	*hits;
+	unsigned		nr_hits;
+	unsigned		nr_alloc;
+};
+
+static uint64_t filter_time(void)
 {
-	if (patt->type == PATT_SIMPLE)
-		return add_exact_filter(root, symtab, patt, tr);
-	else
-		return add_pattern_filter(root, symtab, patt, tr);
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
 }
 
-static void setup_trigger(char *filter_str, struct symtabs *symtabs,
-			  struct rb_root *root, unsigned long flags,
-			  enum filter_mode *fmode, bool allow_kernel,
-			  enum uftrace_pattern_type ptype)
+/* returns length of the literal prefix in @p (and @start of it) */
+static size_t get_literal_prefix(struct uftrace_pattern *p, char **start)
 {
-	struct strv filters = STRV_INIT;
-	char *name;
-	int j;
+	char *str = p->patt;
+	size_t len;
 
-	if (filter_str == NULL)
+	if (p->type == PATT_GLOB) {
+		*start = str;
+		return strcspn(str, "*?[\\");
+	}
+
+	if (p->type != PATT_REGEX)
+		return 0;
+
+	/* regex should be anchored and has no alternation */
+	if (str[0] != '^' || strchr(str, '|'))
+		return 0;
+
+	*start = ++str;
+	len = strcspn(str, ".[]()*+?{}|\\$^");
+
+	/* the last char is optional */
+	if (len && (str[len] == '*' || str[len] == '?' || str[len] == '{'))
+		len--;
+
+	return len;
+}
+
+static void add_trie_prefix(struct filter_compiler *fc, char *prefix,
+			    size_t len, int idx)
+{
+	struct filter_trie *node = &fc->trie;
+	struct filter_trie *child;
+	struct filter_trie_spec *ts;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		for (child = node->child; child; child = child->next) {
+			if (child->ch == prefix[i])
+				break;
+		}
+
+		if (child == NULL) {
+			child = arena_alloc(&fc->arena, sizeof(*child));
+			child->ch = prefix[i];
+			child->child = NULL;
+			child->specs = NULL;
+			child->next = node->child;
+			node->child = child;
+		}
+		node = child;
+	}
+
+	ts = arena_alloc(&fc->arena, sizeof(*ts));
+	ts->idx = idx;
+	ts->next = node->specs;
+	node->specs = ts;
+}
+
+static bool has_backref(char *str)
+{
+	while ((str = strchr(str, '\\')) != NULL) {
+		if (str[1] >= '1' && str[1] <= '9')
+			return true;
+		if (str[1] == '\0')
+			break;
+		str += 2;
+	}
+	return false;
+}
+
+static void compile_filter_specs(struct filter_compiler *fc)
+{
+	struct strv combined = STRV_INIT;
+	char *str;
+	int i;
+
+	fc->others = xcalloc(fc->nr_specs, sizeof(*fc->others));
+
+	for (i = 0; i < fc->nr_specs; i++) {
+		struct uftrace_pattern *p = &fc->specs[i].patt;
+		char *prefix;
+		size_t len;
+
+		if (p->type == PATT_SIMPLE) {
+			/* it'd be used only if the name was not found */
+			add_trie_prefix(fc, p->patt, strlen(p->patt), i);
+			fc->nr_exact++;
+			continue;
+		}
+
+		len = get_literal_prefix(p, &prefix);
+		if (len) {
+			add_trie_prefix(fc, prefix, len, i);
+			fc->nr_prefix++;
+			continue;
+		}
+
+		fc->others[fc->nr_others++] = i;
+
+		if (p->type == PATT_REGEX && !has_backref(p->patt)) {
+			xasprintf(&str, "(%s)", p->patt);
+			strv_append(&combined, str);
+			free(str);
+		}
+	}
+
+	/* a single regex doesn't need to be combined */
+	if (combined.nr > 1) {
+		str = strv_join(&combined, "|");
+		if (regcomp(&fc->combined, str, REG_NOSUB | REG_EXTENDED) == 0)
+			fc->has_combined = true;
+		else
+			pr_dbg("combining regex failed: %s\n", str);
+		free(str);
+	}
+	strv_free(&combined);
+}
+
+static bool spec_has_symtab(struct filter_spec *spec, struct symtab *symtab)
+{
+	if (spec->symtab[0] == NULL)
+		return true;
+
+	return spec->symtab[0] == symtab || spec->symtab[1] == symtab;
+}
+
+/* check if the spec can match to a symbol in the current symtab */
+static bool spec_is_active(struct filter_spec *spec, struct symtab *symtab)
+{
+	if (!spec_has_symtab(spec, symtab))
+		return false;
+
+	return spec->patt.type != PATT_SIMPLE || spec->pending;
+}
+
+static void add_filter_hit(struct filter_compiler *fc, int idx,
+			   struct sym *sym)
+{
+	struct filter_hit *hit;
+
+	if (fc->nr_hits == fc->nr_alloc) {
+		fc->nr_alloc = fc->nr_alloc ? fc->nr_alloc * 2 : 64;
+		fc->hits = xrealloc(fc->hits, fc->nr_alloc * sizeof(*fc->hits));
+	}
+
+	hit = &fc->hits[fc->nr_hits];
+	hit->idx = idx;
+	hit->seq = fc->nr_hits++;
+	hit->sym = sym;
+}
+
+static void check_filter_spec(struct filter_compiler *fc, int idx,
+			      struct symtab *symtab, struct sym *sym,
+			      char *name)
+{
+	struct filter_spec *spec = &fc->specs[idx];
+
+	if (!spec_is_active(spec, symtab))
 		return;
 
-	strv_split(&filters, filter_str, ";");
+	if (!match_filter_pattern(&spec->patt, name))
+		return;
 
-	strv_for_each(&filters, name, j) {
-		LIST_HEAD(args);
-		struct uftrace_trigger tr = {
-			.flags = flags,
-			.pargs = &args,
-		};
-		int ret = 0;
-		char *module = NULL;
-		struct uftrace_arg_spec *arg;
-		struct uftrace_mmap *map;
-		struct uftrace_pattern patt = {
-			.type = PATT_NONE,
-		};
-
-		if (setup_trigger_action(name, &tr, &module, flags) < 0)
-			goto next;
-
-		/* skip unintended kernel symbols */
-		if (module && !strcasecmp(module, "kernel") && !allow_kernel)
-			goto next;
-
-		if (flags & TRIGGER_FL_FILTER) {
-			if (name[0] == '!') {
-				tr.fmode = FILTER_MODE_OUT;
-				name++;
-			}
-			else
-				tr.fmode = FILTER_MODE_IN;
+	/* exact match adds the first symbol only */
+	if (spec->patt.type == PATT_SIMPLE)
+		spec->pending = false;
+
+	add_filter_hit(fc, idx, sym);
+}
+
+/* whether the (mangled) symbol should be demangled to check the specs */
+static bool need_demangle(struct filter_compiler *fc, struct symtab *symtab,
+			  struct sym *sym)
+{
+	int i;
+
+	for (i = 0; i < fc->nr_specs; i++) {
+		struct filter_spec *spec = &fc->specs[i];
+
+		if (!spec_is_active(spec, symtab))
+			continue;
+
+		if (spec->patt.hint == NULL || strstr(sym->name, spec->patt.hint))
+			return true;
+	}
+	return false;
+}
+
+static void match_filter_specs(struct filter_compiler *fc,
+			       struct symtab *symtab, struct sym *sym)
+{
+	struct filter_trie *node = &fc->trie;
+	struct filter_trie_spec *ts;
+	char *name = sym->name;
+	char *p;
+	int i;
+
+	if (is_mangled_name(name)) {
+		if (!need_demangle(fc, symtab, sym))
+			return;
+		name = symbol_getname(sym, sym->addr);
+	}
+
+	/* follow the trie as long as the name matches to the prefix */
+	for (p = name; *p && node; p++) {
+		for (node = node->child; node; node = node->next) {
+			if (node->ch == *p)
+				break;
 		}
+		if (node == NULL)
+			break;
 
-		init_filter_pattern(ptype, &patt, name);
+		for (ts = node->specs; ts; ts = ts->next)
+			check_filter_spec(fc, ts->idx, symtab, sym, name);
+	}
 
-		if (module) {
-			map = find_map_by_name(symtabs, module);
-			if (map == NULL) {
-				if (strcasecmp(module, "PLT") &&
-				    strcasecmp(module, "kernel")) {
-					free(module);
-					goto next;
-				}
-			}
+	if (fc->has_combined &&
+	    regexec(&fc->combined, name, 0, NULL, 0) != 0) {
+		/* no regex matches, check globs only */
+		for (i = 0; i < fc->nr_others; i++) {
+			int idx = fc->others[i];
 
-			/* is it the main executable? */
-			if (!strncmp(module, basename(symtabs->filename),
-				     strlen(module))) {
-				ret += add_trigger_entry(root, &symtabs->symtab,
-							 &patt, &tr);
-				ret += add_trigger_entry(root, &symtabs->dsymtab,
-							 &patt, &tr);
-			}
-			else if (!strcasecmp(module, "PLT")) {
-				ret = add_trigger_entry(root, &symtabs->dsymtab,
-							&patt, &tr);
-			}
-			else if (!strcasecmp(module, "kernel")) {
-				ret = add_trigger_entry(root, get_kernel_symtab(),
-							&patt, &tr);
-			}
-			else {
-				ret = add_trigger_entry(root, &map->symtab,
-							&patt, &tr);
-			}
+			if (fc->specs[idx].patt.type == PATT_GLOB)
+				check_filter_spec(fc, idx, symtab, sym, name);
+		}
+		return;
+	}
+
+	for (i = 0; i < fc->nr_others; i++)
+		check_filter_spec(fc, fc->others[i], symtab, sym, name);
+}
 
-			free(module);
+static void scan_filter_symtab(struct filter_compiler *fc,
+			       struct symtab *symtab, uint64_t *lookup_time)
+{
+	bool need_scan = false;
+	uint64_t start;
+	size_t i;
+	int k;
+
+	if (symtab == NULL || symtab->nr_sym == 0)
+		return;
+
+	start = filter_time();
+	for (k = 0; k < fc->nr_specs; k++) {
+		struct filter_spec *spec = &fc->specs[k];
+		struct sym *sym;
+
+		if (!spec_has_symtab(spec, symtab))
+			continue;
+
+		if (spec->patt.type != PATT_SIMPLE) {
+			need_scan = true;
+			continue;
 		}
-		else {
-			/* check main executable's symtab first */
-			ret += add_trigger_entry(root, &symtabs->symtab,
-						 &patt, &tr);
-			ret += add_trigger_entry(root, &symtabs->dsymtab,
-						 &patt, &tr);
-
-			/* and then find all module's symtabs */
-			map = symtabs->maps;
-			while (map) {
-				ret += add_trigger_entry(root, &map->symtab,
-							 &patt, &tr);
-				map = map->next;
-			}
+
+		sym = find_raw_symname(symtab, spec->patt.patt);
+		if (sym) {
+			add_filter_hit(fc, k, sym);
+			continue;
 		}
 
-		if (ret > 0 && (tr.flags & TRIGGER_FL_FILTER) && fmode) {
-			if (tr.fmode == FILTER_MODE_IN)
+		/* it might be a demangled name */
+		spec->pending = true;
+		need_scan = true;
+	}
+	*lookup_time += filter_time() - start;
+
+	if (!need_scan)
+		return;
+
+	for (i = 0; i < symtab->nr_sym; i++)
+		match_filter_specs(fc, symtab, &symtab->sym[i]);
+
+	for (k = 0; k < fc->nr_specs; k++)
+		fc->specs[k].pending = false;
+}
+
+static int cmp_filter_hit(const void *a, const void *b)
+{
+	const struct filter_hit *ha = a;
+	const struct filter_hit *hb = b;
+
+	if (ha->idx != hb->idx)
+		return ha->idx - hb->idx;
+	return ha->seq < hb->seq ? -1 : 1;
+}
+
+static void add_filter_hits(struct filter_compiler *fc, struct rb_root *root)
+{
+	unsigned i;
+
+	/* add filters in the same order as given */
+	qsort(fc->hits, fc->nr_hits, sizeof(*fc->hits), cmp_filter_hit);
+
+	for (i = 0; i < fc->nr_hits; i++) {
+		struct filter_hit *hit = &fc->hits[i];
+		struct filter_spec *spec = &fc->specs[hit->idx];
+		struct uftrace_filter filter;
+
+		filter.name = symbol_getname(hit->sym, hit->sym->addr);
+		filter.start = hit->sym->addr;
+		filter.end = hit->sym->addr + hit->sym->size;
+
+		spec->nr_added += add_filter(root, &filter, &spec->tr,
+					     spec->patt.type == PATT_SIMPLE);
+	}
+}
+
+static void release_filter_spec(struct filter_spec *spec)
+{
+	struct uftrace_arg_spec *arg;
+
+	free_filter_pattern(&spec->patt);
+
+	while (!list_empty(&spec->args)) {
+		arg = list_first_entry(&spec->args, typeof(*arg), list);
+		list_del(&arg->list);
+
+		if (arg->fmt == ARG_FMT_ENUM)
+			free(arg->enum_str);
+		free(arg);
+	}
+
+	free_filter_predicate(spec->tr.pred);
+	spec->tr.pred = NULL;
+}
+
+static void release_filter_compiler(struct filter_compiler *fc)
+{
+	int i;
+
+	for (i = 0; i < fc->nr_specs; i++)
+		release_filter_spec(&fc->specs[i]);
+
+	if (fc->has_combined)
+		regfree(&fc->combined);
+
+	arena_free(&fc->arena);
+	free(fc->others);
+	free(fc->hits);
+	free(fc->specs);
+}
+
+/* parse a filter string and set up the module (symtab) for it */
+static bool parse_filter_spec(struct filter_spec *spec, char *name,
+			      struct symtabs *symtabs, unsigned long flags,
+			      bool allow_kernel, enum uftrace_pattern_type ptype)
+{
+	char *module = NULL;
+	struct uftrace_mmap *map;
+	bool ret = false;
+
+	INIT_LIST_HEAD(&spec->args);
+	spec->tr.flags = flags;
+	spec->tr.pargs = &spec->args;
+
+	if (setup_trigger_action(name, &spec->tr, &module, flags) < 0)
+		goto out;
+
+	/* skip unintended kernel symbols */
+	if (module && !strcasecmp(module, "kernel") && !allow_kernel)
+		goto out;
+
+	if (flags & TRIGGER_FL_FILTER) {
+		if (name[0] == '!') {
+			spec->tr.fmode = FILTER_MODE_OUT;
+			name++;
+		}
+		else
+			spec->tr.fmode = FILTER_MODE_IN;
+	}
+
+	if (module) {
+		map = find_map_by_name(symtabs, module);
+		if (map == NULL && strcasecmp(module, "PLT") &&
+		    strcasecmp(module, "kernel"))
+			goto out;
+
+		/* is it the main executable? */
+		if (!strncmp(module, basename(symtabs->filename),
+			     strlen(module))) {
+			spec->symtab[0] = &symtabs->symtab;
+			spec->symtab[1] = &symtabs->dsymtab;
+		}
+		else if (!strcasecmp(module, "PLT"))
+			spec->symtab[0] = &symtabs->dsymtab;
+		else if (!strcasecmp(module, "kernel"))
+			spec->symtab[0] = get_kernel_symtab();
+		else
+			spec->symtab[0] = &map->symtab;
+
+		/* the symbol table is not available */
+		if (spec->symtab[0] == NULL)
+			goto out;
+	}
+
+	init_filter_pattern(ptype, &spec->patt, name);
+	ret = true;
+
+out:
+	free(module);
+	return ret;
+}
+
+/* find symbols matching to the specs and add filters for them */
+static void apply_filter_specs(struct filter_compiler *fc,
+			       struct symtabs *symtabs, struct symtab *ktab,
+			       struct rb_root *root, enum filter_mode *fmode,
+			       uint64_t t0)
+{
+	struct uftrace_mmap *map;
+	uint64_t t1, t2, t3;
+	uint64_t lookup_time = 0;
+	int j;
+
+	compile_filter_specs(fc);
+	t1 = filter_time();
+
+	scan_filter_symtab(fc, &symtabs->symtab, &lookup_time);
+	scan_filter_symtab(fc, &symtabs->dsymtab, &lookup_time);
+	for (map = symtabs->maps; map; map = map->next)
+		scan_filter_symtab(fc, &map->symtab, &lookup_time);
+	scan_filter_symtab(fc, ktab, &lookup_time);
+	t2 = filter_time();
+
+	add_filter_hits(fc, root);
+
+	for (j = 0; j < fc->nr_specs; j++) {
+		struct filter_spec *spec = &fc->specs[j];
+
+		if (spec->nr_added > 0 && (spec->tr.flags & TRIGGER_FL_FILTER) &&
+		    fmode) {
+			if (spec->tr.fmode == FILTER_MODE_IN)
 				*fmode = FILTER_MODE_IN;
 			else if (*fmode == FILTER_MODE_NONE)
 				*fmode = FILTER_MODE_OUT;
 		}
-next:
-		free_filter_pattern(&patt);
+	}
+	t3 = filter_time();
 
-		while (!list_empty(&args)) {
-			arg = list_first_entry(&args, typeof(*arg), list);
-			list_del(&arg->list);
+	pr_dbg("%d patterns: %d exact, %d prefix, %d others (%s)\n",
+	       fc->nr_specs, fc->nr_exact, fc->nr_prefix, fc->nr_others,
+	       fc->has_combined ? "combined" : "separate");
+	pr_dbg("setup time: compile %.3f ms, lookup %.3f ms, "
+	       "match %.3f ms, add %.3f ms (%u hits)\n",
+	       (t1 - t0) / 1e6, lookup_time / 1e6,
+	       (t2 - t1 - lookup_time) / 1e6, (t3 - t2) / 1e6, fc->nr_hits);
 
-			if (arg->fmt == ARG_FMT_ENUM)
-				free(arg->enum_str);
-			free(arg);
+	release_filter_compiler(fc);
+}
+
+static void setup_trigger(char *filter_str, struct symtabs *symtabs,
+			  struct rb_root *root, unsigned long flags,
+			  enum filter_mode *fmode, bool allow_kernel,
+			  enum uftrace_pattern_type ptype)
+{
+	struct strv filters = STRV_INIT;
+	struct filter_compiler fc = {
+		.arena = ARENA_INIT,
+	};
+	struct symtab *ktab = NULL;
+	uint64_t t0;
+	char *name;
+	int j;
+
+	if (filter_str == NULL)
+		return;
+
+	t0 = filter_time();
+
+	strv_split_quoted(&filters, filter_str, ';');
+	fc.specs = xcalloc(filters.nr, sizeof(*fc.specs));
+
+	strv_for_each(&filters, name, j) {
+		struct filter_spec *spec = &fc.specs[fc.nr_specs];
+
+		if (!parse_filter_spec(spec, name, symtabs, flags,
+				       allow_kernel, ptype)) {
+			release_filter_spec(spec);
+			memset(spec, 0, sizeof(*spec));
+			continue;
 		}
 
+		if (spec->symtab[0] && spec->symtab[0] == get_kernel_symtab())
+			ktab = spec->symtab[0];
+		fc.nr_specs++;
 	}
 
+	apply_filter_specs(&fc, symtabs, ktab, root, fmode, t0);
 	strv_free(&filters);
 }
 
@@ -1084,6 +1893,44 @@ void uftrace_setup_retval(char *retval_str, struct symtabs *symtabs,
 	setup_trigger(retval_str, symtabs, root, flags, NULL, false, patt_type);
 }
 
+/**
+ * uftrace_setup_auto_args - construct rbtree of auto-args
+ * @symtabs    - symbol tables to find symbol address
+ * @root       - root of resulting rbtree
+ * @flags      - TRIGGER_FL_ARGUMENT or TRIGGER_FL_RETVAL
+ *
+ * This is same as calling uftrace_setup_argument() or uftrace_setup_retval()
+ * with the auto-args string but it takes the function names from the
+ * pre-built table directly so that it doesn't need to parse the string.
+ */
+void uftrace_setup_auto_args(struct symtabs *symtabs, struct rb_root *root,
+			     unsigned long flags)
+{
+	struct filter_compiler fc = {
+		.arena = ARENA_INIT,
+	};
+	int i, nr = get_auto_func_count();
+	uint64_t t0 = filter_time();
+
+	fc.specs = xcalloc(nr, sizeof(*fc.specs));
+
+	for (i = 0; i < nr; i++) {
+		struct filter_spec *spec = &fc.specs[fc.nr_specs];
+		const char *name = get_auto_func_name(i, flags);
+
+		if (name == NULL)
+			continue;
+
+		INIT_LIST_HEAD(&spec->args);
+		spec->tr.flags = flags | TRIGGER_FL_AUTO_ARGS;
+		spec->tr.pargs = &spec->args;
+		init_filter_pattern(PATT_SIMPLE, &spec->patt, (char *)name);
+		fc.nr_specs++;
+	}
+
+	apply_filter_specs(&fc, symtabs, NULL, root, NULL, t0);
+}
+
 /**
  * uftrace_cleanup_filter - delete filters in rbtree
  * @root - root of the filter rbtree
@@ -1104,6 +1951,7 @@ void uftrace_cleanup_filter(struct rb_root *root)
 			list_del(&arg->list);
 			free(arg);
 		}
+		free_filter_predicate(filter->trigger.pred);
 		free(filter);
 	}
 }
@@ -1140,7 +1988,7 @@ char * uftrace_clear_kernel(char *filter_str)
 	if (strstr(filter_str, "@kernel") == NULL)
 		return xstrdup(filter_str);
 
-	strv_split(&filters, filter_str, ";");
+	strv_split_quoted(&filters, filter_str, ';');
 
 	strv_for_each(&filters, pos, j) {
 		if (strstr(pos, "@kernel") == NULL)
@@ -1220,6 +2068,67 @@ TEST_CASE(filter_setup_simple)
 	return TEST_OK;
 }
 
+TEST_CASE(filter_setup_mangled)
+{
+	static struct sym syms[] = {
+		{ 0x1000, 0x1000, ST_GLOBAL, "_ZN3foo3barEv" },
+		{ 0x2000, 0x1000, ST_GLOBAL, "_ZN3foo4baz1Ev" },
+		{ 0x3000, 0x1000, ST_GLOBAL, "_ZN3fooD1Ev" },
+		{ 0x4000, 0x1000, ST_GLOBAL, "_ZN3qux3barEv" },
+	};
+	struct symtabs stabs = {
+		.loaded = true,
+	};
+	struct uftrace_pattern patt;
+	struct rb_root root = RB_ROOT;
+	struct rb_node *node;
+	struct uftrace_filter *filter;
+
+	stabs.symtab.sym = syms;
+	stabs.symtab.nr_sym = ARRAY_SIZE(syms);
+
+	init_filter_pattern(PATT_REGEX, &patt, "^foo::ba(r|z)");
+	TEST_EQ(patt.hint, NULL);
+	free_filter_pattern(&patt);
+
+	init_filter_pattern(PATT_GLOB, &patt, "qux::[bB]ar*");
+	TEST_STREQ(patt.hint, "qux");
+	TEST_EQ(match_filter_symbol(&patt, &syms[0]), false);
+	TEST_EQ(match_filter_symbol(&patt, &syms[3]), true);
+	free_filter_pattern(&patt);
+
+	/* exact match should find the demangled name */
+	uftrace_setup_filter("foo::~foo", &stabs, &root, NULL, false, PATT_SIMPLE);
+	TEST_EQ(RB_EMPTY_ROOT(&root), false);
+
+	node = rb_first(&root);
+	filter = rb_entry(node, struct uftrace_filter, node);
+	TEST_STREQ(filter->name, "foo::~foo");
+	TEST_EQ(filter->start, 0x3000UL);
+
+	uftrace_cleanup_filter(&root);
+
+	uftrace_setup_filter("^foo::ba", &stabs, &root, NULL, false, PATT_REGEX);
+	TEST_EQ(RB_EMPTY_ROOT(&root), false);
+
+	node = rb_first(&root);
+	filter = rb_entry(node, struct uftrace_filter, node);
+	TEST_STREQ(filter->name, "foo::bar");
+	TEST_EQ(filter->start, 0x1000UL);
+
+	node = rb_next(node);
+	filter = rb_entry(node, struct uftrace_filter, node);
+	TEST_STREQ(filter->name, "foo::baz1");
+	TEST_EQ(filter->start, 0x2000UL);
+
+	TEST_EQ(rb_next(node), NULL);
+
+	uftrace_cleanup_filter(&root);
+	TEST_EQ(RB_EMPTY_ROOT(&root), true);
+
+	return TEST_OK;
+}
+
 TEST_CASE(filter_setup_regex)
 {
 	struct symtabs stabs = {
@@ -1310,6 +2219,50 @@ TEST_CASE(filter_setup_glob)
 	return TEST_OK;
 }
 
+TEST_CASE(filter_setup_multi)
+{
+	struct symtabs stabs = {
+		.loaded = false,
+	};
+	struct rb_root root = RB_ROOT;
+	struct rb_node *node;
+	struct uftrace_filter *filter;
+	struct uftrace_pattern patt;
+	char *prefix;
+	unsigned long addrs[] = { 0x3000, 0x5000, 0x6000, 0x21000, 0x22000 };
+	unsigned i;
+
+	filter_test_load_symtabs(&stabs);
+
+	init_filter_pattern(PATT_REGEX, &patt, "^foo::ba*r");
+	TEST_EQ(get_literal_prefix(&patt, &prefix), strlen("foo::b"));
+	free_filter_pattern(&patt);
+
+	init_filter_pattern(PATT_GLOB, &patt, "foo::[bB]ar");
+	TEST_EQ(get_literal_prefix(&patt, &prefix), strlen("foo::"));
+	free_filter_pattern(&patt);
+
+	/* mix of exact names, literal prefixes and combined regex */
+	uftrace_setup_filter("^foo::baz1;baz3$;fo+::~;^fre;malloc;nothing",
+			     &stabs, &root, NULL, false, PATT_REGEX);
+	TEST_EQ(RB_EMPTY_ROOT(&root), false);
+
+	node = rb_first(&root);
+	for (i = 0; i < ARRAY_SIZE(addrs); i++) {
+		TEST_NE(node, NULL);
+
+		filter = rb_entry(node, struct uftrace_filter, node);
+		TEST_EQ(filter->start, addrs[i]);
+		node = rb_next(node);
+	}
+	TEST_EQ(node, NULL);
+
+	uftrace_cleanup_filter(&root);
+	TEST_EQ(RB_EMPTY_ROOT(&root), true);
+
+	return TEST_OK;
+}
+
 TEST_CASE(filter_setup_notrace)
 {
 	struct symtabs stabs = {
@@ -1626,4 +2579,94 @@ TEST_CASE(trigger_setup_args)
 	return TEST_OK;
 }
 
+TEST_CASE(trigger_setup_predicate)
+{
+	struct symtabs stabs = {
+		.loaded = false,
+	};;
+	struct rb_root root = RB_ROOT;
+	struct uftrace_trigger tr;
+	enum filter_mode fmode = FILTER_MODE_NONE;
+	enum uftrace_pattern_type ptype = PATT_REGEX;
+	char str[] = "/tmp/foo";
+	unsigned long args[PRED_MAX_ARGS] = { 4096, 0x12, };
+
+	filter_test_load_symtabs(&stabs);
+
+	uftrace_setup_trigger("foo::bar@if:arg1>4096||arg2&0x10", &stabs,
+			      &root, NULL, false, ptype);
+	TEST_EQ(RB_EMPTY_ROOT(&root), false);
+
+	memset(&tr, 0, sizeof(tr));
+	TEST_NE(uftrace_match_filter(0x2500, &root, &tr), NULL);
+	TEST_EQ(tr.flags, TRIGGER_FL_PREDICATE);
+	TEST_NE(tr.pred, NULL);
+	TEST_EQ(tr.pred->nr_insns, 2);
+	TEST_EQ(tr.pred->nr_args, 2);
+
+	TEST_EQ(filter_predicate_match(tr.pred, args), true);
+	args[1] = 0x2;
+	TEST_EQ(filter_predicate_match(tr.pred, args), false);
+	args[0] = 4097;
+	TEST_EQ(filter_predicate_match(tr.pred, args), true);
+
+	uftrace_setup_filter("foo::baz1@if:arg3^=\"/tmp/\"&&arg1<=-1",
+			     &stabs, &root, &fmode, false, ptype);
+	TEST_EQ(fmode, FILTER_MODE_IN);
+
+	memset(&tr, 0, sizeof(tr));
+	TEST_NE(uftrace_match_filter(0x3000, &root, &tr), NULL);
+	TEST_EQ(tr.flags, TRIGGER_FL_FILTER | TRIGGER_FL_PREDICATE);
+	TEST_EQ(tr.pred->nr_args, 3);
+
+	args[0] = -1;
+	args[2] = (unsigned long)str;
+	TEST_EQ(filter_predicate_match(tr.pred, args), true);
+	args[0] = 0;
+	TEST_EQ(filter_predicate_match(tr.pred, args), false);
+	args[0] = -2;
+	args[2] = (unsigned long)(str + 1);
+	TEST_EQ(filter_predicate_match(tr.pred, args), false);
+	args[2] = 0;
+	TEST_EQ(filter_predicate_match(tr.pred, args), false);
+
+	uftrace_setup_trigger("foo::baz2@if:arg1==\"foo\"", &stabs,
+			      &root, NULL, false, ptype);
+	memset(&tr, 0, sizeof(tr));
+	TEST_NE(uftrace_match_filter(0x4100, &root, &tr), NULL);
+
+	args[0] = (unsigned long)"foo";
+	TEST_EQ(filter_predicate_match(tr.pred, args), true);
+	args[0] = (unsigned long)"foobar";
+	TEST_EQ(filter_predicate_match(tr.pred, args), false);
+
+	/* delimiters in a string are not split */
+	uftrace_setup_trigger("foo::~foo@if:arg1==\"a,b;c\",trace;foo::foo@trace",
+			      &stabs, &root, NULL, false, ptype);
+	memset(&tr, 0, sizeof(tr));
+	TEST_NE(uftrace_match_filter(0x6000, &root, &tr), NULL);
+	TEST_EQ(tr.flags, TRIGGER_FL_PREDICATE | TRIGGER_FL_TRACE);
+	TEST_EQ(tr.pred->nr_insns, 1);
+
+	args[0] = (unsigned long)"a,b;c";
+	TEST_EQ(filter_predicate_match(tr.pred, args), true);
+	args[0] = (unsigned long)"a";
+	TEST_EQ(filter_predicate_match(tr.pred, args), false);
+
+	memset(&tr, 0, sizeof(tr));
+	TEST_NE(uftrace_match_filter(0x1000, &root, &tr), NULL);
+	TEST_EQ(tr.flags, TRIGGER_FL_TRACE);
+
+	/* invalid predicates are ignored */
+	uftrace_setup_trigger("foo::baz3@if:arg9>1;foo::baz3@if:arg1^=1",
+			      &stabs, &root, NULL, false, ptype);
+	memset(&tr, 0, sizeof(tr));
+	TEST_EQ(uftrace_match_filter(0x5000, &root, &tr), NULL);
+
+	uftrace_cleanup_filter(&root);
+	TEST_EQ(RB_EMPTY_ROOT(&root), true);
+
+	return TEST_OK;
+}
+
 #endif /* UNIT_TEST */
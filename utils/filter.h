@@ -30,6 +30,7 @@ enum trigger_flag {
 	TRIGGER_FL_READ		= (1U << 11),
 	TRIGGER_FL_FINISH	= (1U << 13),
 	TRIGGER_FL_AUTO_ARGS	= (1U << 14),
+	TRIGGER_FL_PREDICATE	= (1U << 15),
 };
 
 enum filter_mode {
@@ -92,6 +93,48 @@ struct uftrace_arg_spec {
 	};
 };
 
+enum filter_pred_op {
+	PRED_OP_EQ,
+	PRED_OP_NE,
+	PRED_OP_LT,
+	PRED_OP_LE,
+	PRED_OP_GT,
+	PRED_OP_GE,
+	PRED_OP_BIT,		/* (arg & val) != 0 */
+	PRED_OP_STR_EQ,
+	PRED_OP_STR_NE,
+	PRED_OP_STR_PREFIX,
+};
+
+/**
+ * filter_pred_insn - an instruction of argument predicate
+ *
+ * Each instruction compares an integer argument (in the argument
+ * index) with the value or a string pointed by the argument.  The
+ * instructions are ANDed until an instruction with the @or set, which
+ * starts a new group (i.e. 'a && b || c' is 3 instructions and the
+ * last one has @or).
+ */
+struct filter_pred_insn {
+	unsigned char		op;
+	unsigned char		idx;
+	bool			or;
+	unsigned short		len;	/* string length */
+	union {
+		long		val;
+		char		*str;
+	};
+};
+
+/* max argument index which can be used in predicates */
+#define PRED_MAX_ARGS  8
+
+struct filter_predicate {
+	int			nr_insns;
+	int			nr_args;	/* max argument index used */
+	struct filter_pred_insn	insns[];
+};
+
 struct uftrace_trigger {
 	enum trigger_flag	flags;
 	int			depth;
@@ -100,6 +143,7 @@ struct uftrace_trigger {
 	enum filter_mode	fmode;
 	enum trigger_read_type	read;
 	struct list_head	*pargs;
+	struct filter_predicate	*pred;
 };
 
 struct uftrace_filter {
@@ -121,6 +165,7 @@ enum uftrace_pattern_type {
 struct uftrace_pattern {
 	enum uftrace_pattern_type	type;
 	char				*patt;
+	char				*hint;  /* to skip demangling */
 	regex_t				re;
 };
 
@@ -154,6 +199,7 @@ struct uftrace_pmu_branch {
 typedef void (*trigger_fn_t)(struct uftrace_trigger *tr, void *arg);
 
 struct symtabs;
+struct sym;
 
 void uftrace_setup_filter(char *filter_str, struct symtabs *symtabs,
 			  struct rb_root *root, enum filter_mode *mode,
@@ -167,20 +213,27 @@ void uftrace_setup_argument(char *trigger_str, struct symtabs *symtabs,
 void uftrace_setup_retval(char *trigger_str, struct symtabs *symtabs,
 			  struct rb_root *root, bool auto_args,
 			  enum uftrace_pattern_type ptype);
+void uftrace_setup_auto_args(struct symtabs *symtabs, struct rb_root *root,
+			     unsigned long flags);
 
 struct uftrace_filter *uftrace_match_filter(uint64_t ip, struct rb_root *root,
 					    struct uftrace_trigger *tr);
 void uftrace_cleanup_filter(struct rb_root *root);
 void uftrace_print_filter(struct rb_root *root);
 
+bool filter_predicate_match(struct filter_predicate *pred,
+			    unsigned long *args);
+
 void init_filter_pattern(enum uftrace_pattern_type type,
 			 struct uftrace_pattern *p, char *str);
 bool match_filter_pattern(struct uftrace_pattern *p, char *name);
+bool match_filter_symbol(struct uftrace_pattern *p, struct sym *sym);
 void free_filter_pattern(struct uftrace_pattern *p);
 enum uftrace_pattern_type parse_filter_pattern(const char *str);
 const char * get_filter_pattern(enum uftrace_pattern_type ptype);
 
 char * uftrace_clear_kernel(char *filter_str);
+bool std_string_supported(void);
 
 void setup_auto_args(void);
 void setup_auto_args_str(char *args, char *rets, char *enums);
@@ -190,6 +243,8 @@ struct uftrace_filter * find_auto_retspec(char *name);
 char *get_auto_argspec_str(void);
 char *get_auto_retspec_str(void);
 char *get_auto_enum_str(void);
+int get_auto_func_count(void);
+const char * get_auto_func_name(int idx, unsigned long flag);
 int extract_trigger_args(char **pargs, char **prets, char *trigger);
 int parse_enum_string(char *enum_str);
 char *get_enum_string(char *name, long val);
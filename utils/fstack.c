@@ -4,6 +4,8 @@
 #include <assert.h>
 #include <errno.h>
 #include <byteswap.h>
+#include <unistd.h>
+#include <sys/resource.h>
 
 /* This should be defined before #include "utils.h" */
 #define PR_FMT     "fstack"
@@ -21,27 +23,226 @@
 bool fstack_enabled = true;
 bool live_disabled = false;
 
-static enum filter_mode fstack_filter_mode = FILTER_MODE_NONE;
+enum filter_mode fstack_filter_mode = FILTER_MODE_NONE;
 
 static int __read_task_ustack(struct ftrace_task_handle *task);
 
+/* number of file descriptors left for other files (not task data) */
+#define TASK_FILE_RESERVED  64
+#define TASK_FILE_MIN       4
+
+/**
+ * setup_task_file_pool - setup the limit of open task data files
+ * @handle - file handle
+ *
+ * Data files of all tasks used to be opened at the same time so it
+ * could hit the open file limit (RLIMIT_NOFILE) if the data has too
+ * many tasks.  Now they're managed in a LRU list and the least recently
+ * read file will be closed (and reopened later) if it reaches the
+ * limit.  If user didn't give the limit, it's set from the rlimit.
+ */
+static void setup_task_file_pool(struct ftrace_file_handle *handle)
+{
+	struct rlimit rlim;
+	int limit = 0;
+
+	INIT_LIST_HEAD(&handle->open_files);
+	handle->nr_open_files = 0;
+
+	if (getrlimit(RLIMIT_NOFILE, &rlim) == 0 &&
+	    rlim.rlim_cur != RLIM_INFINITY) {
+		limit = rlim.rlim_cur - TASK_FILE_RESERVED - handle->nr_perf;
+		if (handle->kernel)
+			limit -= handle->kernel->nr_cpus;
+
+		if (limit < TASK_FILE_MIN)
+			limit = TASK_FILE_MIN;
+	}
+
+	if (handle->max_open_files <= 0 ||
+	    (limit && handle->max_open_files > limit))
+		handle->max_open_files = limit;
+
+	pr_dbg("open task data files up to %d at once\n",
+	       handle->max_open_files);
+}
+
+static void close_task_file(struct ftrace_file_handle *handle,
+			    struct ftrace_task_handle *task, bool reopen)
+{
+	if (task->fp == NULL)
+		return;
+
+	if (reopen)
+		task->fpos = ftello(task->fp);
+
+	fclose(task->fp);
+	task->fp = NULL;
+	task->fp_closed = reopen;
+
+	list_del(&task->lru);
+	handle->nr_open_files--;
+}
+
+static void evict_task_file(struct ftrace_file_handle *handle)
+{
+	struct ftrace_task_handle *lru;
+
+	lru = list_first_entry(&handle->open_files, typeof(*lru), lru);
+
+	pr_dbg3("closing data file of task %d at %ld\n",
+		lru->tid, (long)ftello(lru->fp));
+	close_task_file(handle, lru, true);
+}
+
+/* make sure that data file of @task is opened, returns 0 on success */
+static int open_task_file(struct ftrace_file_handle *handle,
+			  struct ftrace_task_handle *task)
+{
+	char *filename;
+
+	if (task->fp) {
+		list_move_tail(&task->lru, &handle->open_files);
+		return 0;
+	}
+
+	if (!task->fp_closed)
+		return -1;
+
+	if (handle->max_open_files &&
+	    handle->nr_open_files >= handle->max_open_files)
+		evict_task_file(handle);
+
+	xasprintf(&filename, "%s/%d.dat", handle->dirname, task->tid);
+
+	task->fp = fopen(filename, "rb");
+	while (task->fp == NULL && errno == EMFILE &&
+	       !list_empty(&handle->open_files)) {
+		evict_task_file(handle);
+		task->fp = fopen(filename, "rb");
+	}
+
+	if (task->fp == NULL) {
+		pr_dbg("cannot open task data file: %s: %m\n", filename);
+		task->fp_closed = false;
+		task->done = true;
+		free(filename);
+		return -1;
+	}
+
+	if (task->fpos) {
+		pr_dbg3("reopening %s at %ld\n", filename, (long)task->fpos);
+		fseeko(task->fp, task->fpos, SEEK_SET);
+	}
+	else
+		pr_dbg2("opening %s\n", filename);
+
+	task->fp_closed = false;
+	list_add_tail(&task->lru, &handle->open_files);
+	handle->nr_open_files++;
+
+	free(filename);
+	return 0;
+}
+
+static inline unsigned task_hash_slot(struct ftrace_file_handle *handle,
+				      int tid)
+{
+	/* multiplicative hashing: task_hash_size is a power of 2 */
+	return ((unsigned)tid * 2654435761U) & (handle->task_hash_size - 1);
+}
+
+static void setup_task_hash(struct ftrace_file_handle *handle)
+{
+	int i;
+	unsigned slot;
+
+	free(handle->task_hash);
+
+	handle->task_hash_size = 16;
+	while (handle->task_hash_size < handle->nr_tasks * 2)
+		handle->task_hash_size *= 2;
+
+	handle->task_hash = xmalloc(handle->task_hash_size *
+				    sizeof(*handle->task_hash));
+	memset(handle->task_hash, -1, handle->task_hash_size *
+	       sizeof(*handle->task_hash));
+
+	for (i = 0; i < handle->nr_tasks; i++) {
+		slot = task_hash_slot(handle, handle->tasks[i].tid);
+
+		while (handle->task_hash[slot] >= 0)
+			slot = (slot + 1) & (handle->task_hash_size - 1);
+
+		handle->task_hash[slot] = i;
+	}
+}
+
 struct ftrace_task_handle *get_task_handle(struct ftrace_file_handle *handle,
 					   int tid)
 {
 	int i;
+	unsigned slot;
 
-	for (i = 0; i < handle->nr_tasks; i++) {
+	if (handle->task_hash == NULL) {
+		for (i = 0; i < handle->nr_tasks; i++) {
+			if (handle->tasks[i].tid == tid)
+				return &handle->tasks[i];
+		}
+		return NULL;
+	}
+
+	slot = task_hash_slot(handle, tid);
+	while ((i = handle->task_hash[slot]) >= 0) {
 		if (handle->tasks[i].tid == tid)
 			return &handle->tasks[i];
+
+		slot = (slot + 1) & (handle->task_hash_size - 1);
 	}
 	return NULL;
 }
 
+/* initial number of fstack entries, it grows on demand */
+#define FSTACK_INIT_SIZE  16
+
+/**
+ * fstack_reserve - make sure func_stack has an entry at @idx
+ * @task: task handle
+ * @idx: index of func_stack to be accessed
+ *
+ * The func_stack is allocated with a small size at first and grows
+ * (doubles) when a deeper entry is needed.  Most tasks don't go deep
+ * so it saves memory for data which has many tasks.
+ */
+static void fstack_reserve(struct ftrace_task_handle *task, int idx)
+{
+	int i;
+	int new_size;
+
+	if (task->func_stack == NULL || idx < task->func_stack_size)
+		return;
+
+	new_size = task->func_stack_size;
+	while (new_size <= idx)
+		new_size *= 2;
+
+	task->func_stack = xrealloc(task->func_stack,
+				    new_size * sizeof(*task->func_stack));
+	memset(&task->func_stack[task->func_stack_size], 0,
+	       (new_size - task->func_stack_size) * sizeof(*task->func_stack));
+
+	/* FIXME: save filter depth at fork() and restore */
+	for (i = task->func_stack_size; i < new_size; i++)
+		task->func_stack[i].orig_depth = task->h->depth;
+
+	task->func_stack_size = new_size;
+}
+
 static void setup_task_handle(struct ftrace_file_handle *handle,
 		       struct ftrace_task_handle *task, int tid)
 {
 	int i;
-	int max_stack;
+	int size;
 
 	task->stack_count = 0;
 	task->display_depth = 0;
@@ -55,11 +256,15 @@ static void setup_task_handle(struct ftrace_file_handle *handle,
 	task->display_depth_set = (fstack_enabled && !live_disabled &&
 				   !handle->time_range.start);
 
-	max_stack = handle->hdr.max_stack;
-	task->func_stack = xcalloc(1, sizeof(*task->func_stack) * max_stack);
+	size = FSTACK_INIT_SIZE;
+	if (handle->hdr.max_stack && handle->hdr.max_stack < size)
+		size = handle->hdr.max_stack;
+
+	task->func_stack = xcalloc(size, sizeof(*task->func_stack));
+	task->func_stack_size = size;
 
 	/* FIXME: save filter depth at fork() and restore */
-	for (i = 0; i < max_stack; i++)
+	for (i = 0; i < size; i++)
 		task->func_stack[i].orig_depth = handle->depth;
 }
 
@@ -73,16 +278,15 @@ void reset_task_handle(struct ftrace_file_handle *handle)
 
 		task->done = true;
 
-		if (task->fp) {
-			fclose(task->fp);
-			task->fp = NULL;
-		}
+		close_task_file(handle, task, false);
+		task->fp_closed = false;
 
 		free(task->args.data);
 		task->args.data = NULL;
 
 		free(task->func_stack);
 		task->func_stack = NULL;
+		task->func_stack_size = 0;
 
 		reset_rstack_list(&task->rstack_list);
 	}
@@ -90,6 +294,12 @@ void reset_task_handle(struct ftrace_file_handle *handle)
 	free(handle->tasks);
 	handle->tasks = NULL;
 
+	free(handle->task_hash);
+	handle->task_hash = NULL;
+	handle->task_hash_size = 0;
+
+	reset_rstack_heap(&handle->task_heap);
+
 	handle->nr_tasks = 0;
 }
 
@@ -103,14 +313,14 @@ static void prepare_task_handle(struct ftrace_file_handle *handle,
 	task->h = handle;
 	task->t = find_task(&handle->sessions, tid);
 
+	/* it'll be opened when reading the data */
 	xasprintf(&filename, "%s/%d.dat", handle->dirname, tid);
-	task->fp = fopen(filename, "rb");
-	if (task->fp == NULL) {
+	if (access(filename, R_OK) < 0) {
 		pr_dbg("cannot open task data file: %s: %m\n", filename);
 		task->done = true;
 	}
 	else
-		pr_dbg2("opening %s\n", filename);
+		task->fp_closed = true;
 
 	free(filename);
 
@@ -169,6 +379,8 @@ static void setup_task_filter(char *tid_filter, struct ftrace_file_handle *handl
 	pr_dbg("setup filters for %d task(s)\n", nr_filters);
 
 setup:
+	setup_task_file_pool(handle);
+
 	handle->nr_tasks = handle->info.nr_tid;
 	handle->tasks = xmalloc(sizeof(*handle->tasks) * handle->nr_tasks);
 
@@ -190,13 +402,12 @@ setup:
 			task->done = true;
 
 			/* need to read the data to check elapsed time */
-			if (task->fp) {
+			if (open_task_file(handle, task) == 0) {
 				if (!__read_task_ustack(task)) {
 					update_first_timestamp(handle, task,
 							       &task->ustack);
 				}
-				fclose(task->fp);
-				task->fp = NULL;
+				close_task_file(handle, task, false);
 			}
 			continue;
 		}
@@ -204,9 +415,85 @@ setup:
 		setup_task_handle(handle, task, tid);
 	}
 
+	setup_task_hash(handle);
+	/* (re-)build the heap on the first read */
+	reset_rstack_heap(&handle->task_heap);
+
 	free(filter_tids);
 }
 
+/**
+ * fstack_add_task - add a task which was not known when data was opened
+ * @handle: file handle
+ * @tid: task id
+ * @fp: stream to read the task data
+ *
+ * This function is for the data which is being recorded (like in the
+ * streaming live mode).  The @fp is used as if it's the data file of
+ * the task and will be closed by reset_task_handle().  Note that the
+ * existing task handles can be moved by this.
+ *
+ * It returns the new task handle.
+ */
+struct ftrace_task_handle *fstack_add_task(struct ftrace_file_handle *handle,
+					   int tid, FILE *fp)
+{
+	struct ftrace_task_handle *task;
+	int i;
+
+	handle->tasks = xrealloc(handle->tasks,
+				 (handle->nr_tasks + 1) * sizeof(*task));
+
+	/* the task handles might be moved, relink the open files */
+	INIT_LIST_HEAD(&handle->open_files);
+	for (i = 0; i < handle->nr_tasks; i++) {
+		task = &handle->tasks[i];
+		if (task->fp)
+			list_add_tail(&task->lru, &handle->open_files);
+	}
+
+	task = &handle->tasks[handle->nr_tasks++];
+
+	memset(task, 0, sizeof(*task));
+	task->tid = tid;
+	task->h = handle;
+	task->t = find_task(&handle->sessions, tid);
+	task->fp = fp;
+
+	list_add_tail(&task->lru, &handle->open_files);
+	handle->nr_open_files++;
+
+	setup_rstack_list(&task->rstack_list);
+	setup_task_handle(handle, task, tid);
+
+	setup_task_hash(handle);
+	reset_rstack_heap(&handle->task_heap);
+
+	return task;
+}
+
+/**
+ * fstack_resume_task - continue to read a task after more data is added
+ * @handle: file handle
+ * @task: task handle
+ *
+ * The task is marked as done when it reaches the end of the data.
+ * This function clears it so that it can read new data appended to
+ * the @task->fp after that.
+ */
+void fstack_resume_task(struct ftrace_file_handle *handle,
+			struct ftrace_task_handle *task)
+{
+	if (task->fp == NULL)
+		return;
+
+	clearerr(task->fp);
+	task->done = false;
+
+	/* it was removed from the heap when it was done */
+	reset_rstack_heap(&handle->task_heap);
+}
+
 struct filter_data {
 	char *str;
 	enum uftrace_pattern_type patt_type;
@@ -299,9 +586,6 @@ static const char *fixup_syms[] = {
 	"fork", "vfork", "daemon",
 };
 
-static int setjmp_depth;
-static int setjmp_count;
-
 static int build_fixup_filter(struct uftrace_session *s, void *arg)
 {
 	size_t i;
@@ -421,6 +705,69 @@ int fstack_setup_filters(struct opts *opts, struct ftrace_file_handle *handle)
 	return 0;
 }
 
+/**
+ * fstack_setup_tasks - setup task handles only
+ * @opts: uftrace user options
+ * @handle: handle for uftrace data
+ *
+ * This function is for a handle opened by open_shared_data_file().
+ * The filters and triggers are kept in the (shared) sessions, so they
+ * should be set up by fstack_setup_filters() with the original handle.
+ */
+void fstack_setup_tasks(struct opts *opts, struct ftrace_file_handle *handle)
+{
+	setup_task_filter(opts->tid, handle);
+}
+
+/**
+ * fstack_setup_session - setup filters for a session added later
+ * @opts: uftrace user options
+ * @handle: handle for uftrace data
+ * @s: new session
+ *
+ * This function sets up argument specs, filters and triggers of a
+ * session which is added after the data was opened.  It's same as
+ * what open_data_file() and fstack_setup_filters() do for existing
+ * sessions.
+ */
+void fstack_setup_session(struct opts *opts, struct ftrace_file_handle *handle,
+			  struct uftrace_session *s)
+{
+	struct uftrace_info *info = &handle->info;
+	struct spec_data spec = {
+		.patt_type = info->patt_type,
+	};
+	struct filter_data data = {
+		.patt_type = opts->patt_type,
+	};
+
+	if (handle->hdr.info_mask & ARG_SPEC) {
+		spec.str = info->argspec;
+		build_arg_spec(s, &spec);
+		spec.str = info->retspec;
+		build_ret_spec(s, &spec);
+
+		if (info->auto_args_enabled) {
+			spec.auto_args = true;
+			spec.str = info->autoarg;
+			build_arg_spec(s, &spec);
+			spec.str = info->autoret;
+			build_ret_spec(s, &spec);
+		}
+	}
+
+	if (opts->filter) {
+		data.str = opts->filter;
+		setup_filters(s, &data);
+	}
+	if (opts->trigger) {
+		data.str = opts->trigger;
+		setup_trigger(s, &data);
+	}
+
+	build_fixup_filter(s, NULL);
+}
+
 /**
  * fstack_entry - function entry handler
  * @task    - tracee task
@@ -459,9 +806,7 @@ int fstack_entry(struct ftrace_task_handle *task,
 		return -1;
 	}
 
-	sess = find_task_session(sessions, task->tid, rstack->time);
-	if (sess == NULL)
-		sess = find_task_session(sessions, task->t->pid, rstack->time);
+	sess = task_find_session(sessions, task, rstack->time);
 
 	if (is_kernel_record(task, rstack)) {
 		addr = get_real_address(addr);
@@ -478,8 +823,8 @@ int fstack_entry(struct ftrace_task_handle *task,
 			if (!strncmp(fixup->name, "exec", 4))
 				fstack->flags |= FSTACK_FL_EXEC;
 			else if (strstr(fixup->name, "setjmp")) {
-				setjmp_depth = task->display_depth + 1;
-				setjmp_count = task->stack_count;
+				task->setjmp_depth = task->display_depth + 1;
+				task->setjmp_count = task->stack_count;
 			}
 			else if (strstr(fixup->name, "longjmp")) {
 				fstack->flags |= FSTACK_FL_LONGJMP;
@@ -602,11 +947,11 @@ int fstack_update(int type, struct ftrace_task_handle *task,
 			task->user_stack_count = 0;
 		}
 		else if (fstack->flags & FSTACK_FL_LONGJMP) {
-			task->display_depth = setjmp_depth;
-			task->stack_count = setjmp_count;
+			task->display_depth = task->setjmp_depth;
+			task->stack_count = task->setjmp_count;
 			/* these are user functions */
-			task->user_display_depth = setjmp_depth;
-			task->user_stack_count = setjmp_count;
+			task->user_display_depth = task->setjmp_depth;
+			task->user_stack_count = task->setjmp_count;
 		}
 		else {
 			task->display_depth++;
@@ -659,6 +1004,10 @@ static int fstack_check_skip(struct ftrace_task_handle *task,
 		return -1;
 
 	if (rstack->type == UFTRACE_EXIT) {
+		/* it can be the first record of a forked task */
+		if (task->stack_count == 0)
+			return 0;
+
 		/* fstack_consume() is not called yet */
 		fstack = &task->func_stack[task->stack_count - 1];
 
@@ -668,9 +1017,7 @@ static int fstack_check_skip(struct ftrace_task_handle *task,
 		return 0;
 	}
 
-	sess = find_task_session(sessions, task->tid, rstack->time);
-	if (sess == NULL)
-		sess = find_task_session(sessions, task->t->pid, rstack->time);
+	sess = task_find_session(sessions, task, rstack->time);
 
 	if (sess == NULL) {
 		struct uftrace_session *fsess = sessions->first;
@@ -834,11 +1181,109 @@ bool fstack_check_filter(struct ftrace_task_handle *task)
 	return true;
 }
 
+/*
+ * Records in the rstack list are kept in a ring buffer and argument
+ * data is saved in an arena.  Records are added at the tail and
+ * removed at either end, so the argument data is also used like a
+ * FIFO (or LIFO) and it doesn't need to be allocated individually.
+ * As the data can be moved when the arena grows, nodes save the
+ * position of the data rather than a pointer.
+ */
+#define RSTACK_LIST_INIT_SIZE  64
+#define RSTACK_LIST_ARGS_ALIGN  8
+
+/*
+ * The list itself is not bounded since pending records are needed until
+ * the filter decides, but don't hold on to buffers grown by a burst of
+ * records once they are all gone.
+ */
+#define RSTACK_LIST_MAX_NODES  4096
+#define RSTACK_LIST_MAX_ARENA  (1024 * 1024)
+
 void setup_rstack_list(struct uftrace_rstack_list *list)
 {
-	INIT_LIST_HEAD(&list->read);
-	INIT_LIST_HEAD(&list->unused);
-	list->count = 0;
+	memset(list, 0, sizeof(*list));
+}
+
+static struct uftrace_rstack_list_node *
+get_rstack_list_node(struct uftrace_rstack_list *list, int idx)
+{
+	return &list->nodes[(list->head + idx) & (list->size - 1)];
+}
+
+static void grow_rstack_list(struct uftrace_rstack_list *list)
+{
+	struct uftrace_rstack_list_node *nodes;
+	unsigned size = list->size ? list->size * 2 : RSTACK_LIST_INIT_SIZE;
+	unsigned first = list->size - list->head;
+
+	nodes = xmalloc(size * sizeof(*nodes));
+
+	/* unwrap the ring so that the first node comes at index 0 */
+	if (list->count) {
+		if (first > (unsigned)list->count)
+			first = list->count;
+
+		memcpy(nodes, &list->nodes[list->head], first * sizeof(*nodes));
+		memcpy(&nodes[first], list->nodes,
+		       (list->count - first) * sizeof(*nodes));
+	}
+
+	free(list->nodes);
+	list->nodes = nodes;
+	list->size = size;
+	list->head = 0;
+}
+
+static uint64_t reserve_rstack_list_args(struct uftrace_rstack_list *list,
+					 unsigned len)
+{
+	uint64_t pos;
+
+	len = ALIGN(len, RSTACK_LIST_ARGS_ALIGN);
+
+	if (list->arena_tail + len - list->arena_base > list->arena_size) {
+		size_t live = list->arena_tail - list->arena_head;
+		size_t size = list->arena_size ?: 4096;
+
+		/* discard consumed data at the front */
+		if (list->arena_head != list->arena_base) {
+			memmove(list->arena,
+				list->arena + (list->arena_head - list->arena_base),
+				live);
+			list->arena_base = list->arena_head;
+		}
+
+		while (live + len > size)
+			size *= 2;
+
+		if (size != list->arena_size) {
+			list->arena = xrealloc(list->arena, size);
+			list->arena_size = size;
+		}
+	}
+
+	pos = list->arena_tail;
+	list->arena_tail += len;
+	return pos;
+}
+
+static void drain_rstack_list(struct uftrace_rstack_list *list)
+{
+	list->head = 0;
+	list->arena_base = list->arena_head = list->arena_tail;
+
+	if (list->size > RSTACK_LIST_MAX_NODES) {
+		free(list->nodes);
+		list->nodes = NULL;
+		list->size = 0;
+	}
+
+	if (list->arena_size > RSTACK_LIST_MAX_ARENA) {
+		free(list->arena);
+		list->arena = NULL;
+		list->arena_size = 0;
+	}
 }
 
 void add_to_rstack_list(struct uftrace_rstack_list *list,
@@ -847,34 +1292,67 @@ void add_to_rstack_list(struct uftrace_rstack_list *list,
 {
 	struct uftrace_rstack_list_node *node;
 
-	if (list_empty(&list->unused)) {
-		node = xmalloc(sizeof(*node));
-		node->args.data = NULL;
-	}
-	else {
-		node = list_first_entry(&list->unused, typeof(*node), list);
-		list_del(&node->list);
-	}
+	if ((unsigned)list->count == list->size)
+		grow_rstack_list(list);
 
+	node = get_rstack_list_node(list, list->count);
 	memcpy(&node->rstack, rstack, sizeof(*rstack));
+
 	if (rstack->more) {
-		memcpy(&node->args, args, sizeof(*args));
-		node->args.data = xmalloc(args->len);
-		memcpy(node->args.data, args->data, args->len);
+		node->args = args->args;
+		node->args_len = args->len;
+		node->args_pos = reserve_rstack_list_args(list, args->len);
+
+		memcpy(list->arena + (node->args_pos - list->arena_base),
+		       args->data, args->len);
 	}
 
-	list_add_tail(&node->list, &list->read);
 	list->count++;
 }
 
 struct uftrace_record *get_first_rstack_list(struct uftrace_rstack_list *list)
 {
-	struct uftrace_rstack_list_node *node;
-
 	assert(list->count > 0);
 
-	node = list_first_entry(&list->read, typeof(*node), list);
-	return &node->rstack;
+	return &get_rstack_list_node(list, 0)->rstack;
+}
+
+/**
+ * get_last_rstack_list - get a record from the end of the list
+ * @list: rstack list
+ * @n: number of records to skip from the last
+ *
+ * This function returns the last record in @list if @n is 0, or the
+ * record @n records before the last one.
+ */
+struct uftrace_record *get_last_rstack_list(struct uftrace_rstack_list *list,
+					    int n)
+{
+	assert(n < list->count);
+
+	return &get_rstack_list_node(list, list->count - 1 - n)->rstack;
+}
+
+/**
+ * restore_first_rstack_list_args - copy argument data of the first record
+ * @list: rstack list
+ * @args: arguments to save the data
+ *
+ * This function copies argument data of the first record in @list to
+ * @args.  It should be called before the record is consumed.
+ */
+void restore_first_rstack_list_args(struct uftrace_rstack_list *list,
+				    struct fstack_arguments *args)
+{
+	struct uftrace_rstack_list_node *node = get_rstack_list_node(list, 0);
+
+	assert(list->count > 0 && node->rstack.more);
+
+	args->args = node->args;
+	args->len  = node->args_len;
+	args->data = xrealloc(args->data, node->args_len ?: 1);
+	memcpy(args->data, list->arena + (node->args_pos - list->arena_base),
+	       node->args_len);
 }
 
 void consume_first_rstack_list(struct uftrace_rstack_list *list)
@@ -883,13 +1361,15 @@ void consume_first_rstack_list(struct uftrace_rstack_list *list)
 
 	assert(list->count > 0);
 
-	node = list_first_entry(&list->read, typeof(*node), list);
-	list_move(&node->list, &list->unused);
-
-	if (node->rstack.more)
-		assert(node->args.data == NULL);
+	node = get_rstack_list_node(list, 0);
+	if (node->rstack.more) {
+		list->arena_head = node->args_pos +
+			ALIGN(node->args_len, RSTACK_LIST_ARGS_ALIGN);
+	}
 
-	list->count--;
+	list->head = (list->head + 1) & (list->size - 1);
+	if (--list->count == 0)
+		drain_rstack_list(list);
 }
 
 void delete_last_rstack_list(struct uftrace_rstack_list *list)
@@ -898,33 +1378,128 @@ void delete_last_rstack_list(struct uftrace_rstack_list *list)
 
 	assert(list->count > 0);
 
-	node = list_last_entry(&list->read, typeof(*node), list);
-	if (node->rstack.more) {
-		free(node->args.data);
-		node->args.data = NULL;
-	}
+	node = get_rstack_list_node(list, list->count - 1);
+	if (node->rstack.more)
+		list->arena_tail = node->args_pos;
 
-	list_move(&node->list, &list->unused);
-	list->count--;
+	if (--list->count == 0)
+		drain_rstack_list(list);
 }
 
 void reset_rstack_list(struct uftrace_rstack_list *list)
 {
-	while (!list_empty(&list->read)) {
-		struct uftrace_rstack_list_node *node;
+	free(list->nodes);
+	free(list->arena);
+	setup_rstack_list(list);
+}
 
-		node = list_first_entry(&list->read, typeof(*node), list);
-		list_del(&node->list);
-		free(node);
+static inline bool rstack_heap_less(struct uftrace_rstack_heap *heap,
+				    int a, int b)
+{
+	/* prefer lower index on the same timestamp (like a linear scan) */
+	if (heap->time[a] != heap->time[b])
+		return heap->time[a] < heap->time[b];
+	return a < b;
+}
+
+static void rstack_heap_sift_down(struct uftrace_rstack_heap *heap, int pos)
+{
+	int *idx = heap->idx;
+	int curr = idx[pos];
+
+	while (true) {
+		int child = pos * 2 + 1;
+
+		if (child >= heap->nr)
+			break;
+
+		if (child + 1 < heap->nr &&
+		    rstack_heap_less(heap, idx[child + 1], idx[child]))
+			child++;
+
+		if (!rstack_heap_less(heap, idx[child], curr))
+			break;
+
+		idx[pos] = idx[child];
+		pos = child;
 	}
+	idx[pos] = curr;
+}
+
+/**
+ * setup_rstack_heap - prepare a heap to merge records of streams
+ * @heap: rstack heap
+ * @nr_streams: number of streams (tasks or cpus) to merge
+ *
+ * This function allocates a min-heap which returns index of the stream
+ * which has the oldest record.  Callers should add current timestamp
+ * of each stream using add_to_rstack_heap() and update it after
+ * consuming the first record so that finding the oldest one costs
+ * O(log n) instead of scanning all streams.
+ */
+void setup_rstack_heap(struct uftrace_rstack_heap *heap, int nr_streams)
+{
+	heap->nr = 0;
+	heap->idx = xcalloc(nr_streams ?: 1, sizeof(*heap->idx));
+	heap->time = xcalloc(nr_streams ?: 1, sizeof(*heap->time));
+	heap->ready = true;
+}
+
+void add_to_rstack_heap(struct uftrace_rstack_heap *heap, int idx,
+			uint64_t time)
+{
+	int pos = heap->nr++;
 
-	while (!list_empty(&list->unused)) {
-		struct uftrace_rstack_list_node *node;
+	heap->time[idx] = time;
 
-		node = list_first_entry(&list->unused, typeof(*node), list);
-		list_del(&node->list);
-		free(node);
+	/* sift up */
+	while (pos > 0) {
+		int parent = (pos - 1) / 2;
+
+		if (!rstack_heap_less(heap, idx, heap->idx[parent]))
+			break;
+
+		heap->idx[pos] = heap->idx[parent];
+		pos = parent;
 	}
+	heap->idx[pos] = idx;
+}
+
+int get_first_rstack_heap(struct uftrace_rstack_heap *heap)
+{
+	if (heap->nr == 0)
+		return -1;
+
+	return heap->idx[0];
+}
+
+void update_first_rstack_heap(struct uftrace_rstack_heap *heap,
+			      uint64_t time)
+{
+	assert(heap->nr > 0);
+
+	heap->time[heap->idx[0]] = time;
+	rstack_heap_sift_down(heap, 0);
+}
+
+void delete_first_rstack_heap(struct uftrace_rstack_heap *heap)
+{
+	assert(heap->nr > 0);
+
+	heap->idx[0] = heap->idx[--heap->nr];
+	if (heap->nr)
+		rstack_heap_sift_down(heap, 0);
+}
+
+void reset_rstack_heap(struct uftrace_rstack_heap *heap)
+{
+	free(heap->idx);
+	free(heap->time);
+
+	heap->idx = NULL;
+	heap->time = NULL;
+	heap->nr = 0;
+	heap->ready = false;
 }
 
 static void swap_byte_order(struct uftrace_record *rstack)
@@ -1097,6 +1672,60 @@ static void save_task_event(struct ftrace_task_handle *task,
 		fseek(task->fp, 8 - rem, SEEK_CUR);
 }
 
+/*
+ * skip event data which cannot be handled (likely recorded by a newer
+ * version) using the length so that following records can be read.
+ */
+static int skip_task_event(struct ftrace_task_handle *task,
+			   struct uftrace_record *rec, uint16_t len)
+{
+	static bool warned;
+
+	if (!warned) {
+		pr_warn("unsupported data in event %u, skipping\n", rec->addr);
+		warned = true;
+	}
+
+	task->args.len = 0;
+
+	/* the data is aligned to 8 bytes including the length */
+	if (fseek(task->fp, ALIGN(len + sizeof(len), 8) - sizeof(len),
+		  SEEK_CUR) < 0)
+		return -1;
+
+	return 0;
+}
+
+/* user (SDT) events have 64-bit argument values */
+static int read_task_user_event(struct ftrace_task_handle *task,
+				struct uftrace_record *rec)
+{
+	uint64_t args[EVENT_MAX_ARGS];
+	uint16_t len;
+	unsigned i;
+
+	if (fread(&len, sizeof(len), 1, task->fp) != 1)
+		return -1;
+
+	if (task->h->needs_byte_swap)
+		len = bswap_16(len);
+
+	if (!(task->h->hdr.feat_mask & EVENT_ARGS) ||
+	    len > sizeof(args) || len % sizeof(*args))
+		return skip_task_event(task, rec, len);
+
+	if (fread(args, len, 1, task->fp) != 1)
+		return -1;
+
+	if (task->h->needs_byte_swap) {
+		for (i = 0; i < len / sizeof(*args); i++)
+			args[i] = bswap_64(args[i]);
+	}
+
+	save_task_event(task, args, len);
+	return 0;
+}
+
 /**
  * get_event_name - find event name from event id
  * @handle - handle to uftrace data
@@ -1202,6 +1831,53 @@ out:
 	return evt_name;
 }
 
+/**
+ * get_event_args - format argument values of an user event
+ * @handle - handle to uftrace data
+ * @evt_id - event id
+ * @data   - argument data of the event
+ * @len    - length of @data
+ *
+ * This function returns a string of argument values separated by comma.
+ * Callers must free the returned string.  It returns %NULL if the event
+ * has no argument.
+ */
+char *get_event_args(struct ftrace_file_handle *handle, unsigned evt_id,
+		     void *data, unsigned len)
+{
+	struct uftrace_event *ev;
+	uint64_t *args = data;
+	char buf[EVENT_MAX_ARGS * 24];
+	size_t pos = 0;
+	int i;
+
+	list_for_each_entry(ev, &handle->events, list) {
+		if (ev->id == evt_id)
+			break;
+	}
+	if (list_no_entry(ev, &handle->events, list))
+		return NULL;
+
+	for (i = 0; i < ev->nr_args && (i + 1) * sizeof(*args) <= len; i++) {
+		const char *sep = i ? ", " : "";
+
+		if (ev->arg_size[i] < 0)
+			pos += snprintf(buf + pos, sizeof(buf) - pos, "%s%"PRId64,
+					sep, (int64_t)args[i]);
+		else if (ev->arg_size[i] == 8)
+			pos += snprintf(buf + pos, sizeof(buf) - pos, "%s%#"PRIx64,
+					sep, args[i]);
+		else
+			pos += snprintf(buf + pos, sizeof(buf) - pos, "%s%"PRIu64,
+					sep, args[i]);
+	}
+
+	if (pos == 0)
+		return NULL;
+
+	return xstrdup(buf);
+}
+
 int read_task_event(struct ftrace_task_handle *task,
 		    struct uftrace_record *rec)
 {
@@ -1212,6 +1888,7 @@ int read_task_event(struct ftrace_task_handle *task,
 		struct uftrace_pmu_cache  cache;
 		struct uftrace_pmu_branch branch;
 	} u;
+	uint16_t len;
 
 	switch (rec->addr) {
 	case EVENT_ID_READ_PROC_STATM:
@@ -1281,7 +1958,21 @@ int read_task_event(struct ftrace_task_handle *task,
 		break;
 
 	default:
-		pr_err_ns("unknown event has data: %u\n", rec->addr);
+		if (rec->addr >= EVENT_ID_USER) {
+			if (read_task_user_event(task, rec) < 0)
+				return -1;
+			break;
+		}
+
+		/* unknown event */
+		if (fread(&len, sizeof(len), 1, task->fp) != 1)
+			return -1;
+
+		if (task->h->needs_byte_swap)
+			len = bswap_16(len);
+
+		if (skip_task_event(task, rec, len) < 0)
+			return -1;
 		break;
 	}
 
@@ -1307,7 +1998,7 @@ int read_task_ustack(struct ftrace_file_handle *handle,
 	if (task->valid)
 		return 0;
 
-	if (task->done || task->fp == NULL)
+	if (task->done || open_task_file(handle, task) < 0)
 		return -1;
 
 	if (__read_task_ustack(task) < 0) {
@@ -1369,10 +2060,7 @@ get_task_ustack(struct ftrace_file_handle *handle, int idx)
 		if (!check_time_range(&handle->time_range, curr->time))
 			continue;
 
-		sess = find_task_session(sessions, task->tid, curr->time);
-		if (sess == NULL)
-			sess = find_task_session(sessions, task->t->pid,
-						 curr->time);
+		sess = task_find_session(sessions, task, curr->time);
 
 		if (sess &&
 		    (curr->type == UFTRACE_ENTRY || curr->type == UFTRACE_EXIT))
@@ -1398,7 +2086,7 @@ get_task_ustack(struct ftrace_file_handle *handle, int idx)
 			}
 		}
 		else if (curr->type == UFTRACE_EXIT) {
-			struct uftrace_rstack_list_node *last;
+			struct uftrace_record *last;
 			uint64_t delta;
 			int last_type;
 
@@ -1420,9 +2108,8 @@ get_task_ustack(struct ftrace_file_handle *handle, int idx)
 				break;
 			}
 
-			last = list_last_entry(&rstack_list->read,
-					       typeof(*last), list);
-			delta = curr->time - last->rstack.time;
+			last = get_last_rstack_list(rstack_list, 0);
+			delta = curr->time - last->time;
 
 			if (delta < time_filter) {
 				/*
@@ -1438,10 +2125,8 @@ get_task_ustack(struct ftrace_file_handle *handle, int idx)
 
 				/* also delete matching entry (at the last) */
 				do {
-					last = list_last_entry(&rstack_list->read,
-							       typeof(*last), list);
-
-					last_type = last->rstack.type;
+					last = get_last_rstack_list(rstack_list, 0);
+					last_type = last->type;
 					delete_last_rstack_list(rstack_list);
 				}
 				while (last_type != UFTRACE_ENTRY);
@@ -1480,27 +2165,43 @@ out:
 static int read_user_stack(struct ftrace_file_handle *handle,
 			   struct ftrace_task_handle **task)
 {
-	int i, next_i = -1;
-	uint64_t next_time = 0;
+	struct uftrace_rstack_heap *heap = &handle->task_heap;
 	struct uftrace_record *tmp;
+	int i;
 
-	for (i = 0; i < handle->info.nr_tid; i++) {
+	if (!heap->ready) {
+		setup_rstack_heap(heap, handle->nr_tasks);
+
+		for (i = 0; i < handle->nr_tasks; i++) {
+			tmp = get_task_ustack(handle, i);
+			if (tmp)
+				add_to_rstack_heap(heap, i, tmp->time);
+		}
+	}
+
+	/*
+	 * Only the first task can be consumed after it's returned, so
+	 * other tasks in the heap still have valid timestamps.
+	 */
+	while ((i = get_first_rstack_heap(heap)) >= 0) {
 		tmp = get_task_ustack(handle, i);
-		if (tmp == NULL)
+		if (tmp == NULL) {
+			delete_first_rstack_heap(heap);
 			continue;
-
-		if (next_i < 0 || tmp->time < next_time) {
-			next_time = tmp->time;
-			next_i = i;
 		}
+
+		if (tmp->time == heap->time[i])
+			break;
+
+		update_first_rstack_heap(heap, tmp->time);
 	}
 
-	if (next_i < 0)
+	if (i < 0)
 		return -1;
 
-	*task = &handle->tasks[next_i];
+	*task = &handle->tasks[i];
 
-	return next_i;
+	return i;
 }
 
 /* convert perf sched events to a virtual schedule function */
@@ -1584,6 +2285,8 @@ static void fstack_account_time(struct ftrace_task_handle *task)
 		if (is_kernel_func)
 			task->stack_count += task->user_stack_count;
 
+		fstack_reserve(task, task->stack_count);
+
 		/* calculate duration from now on */
 		for (i = 0; i < task->stack_count; i++) {
 			fstack = &task->func_stack[i];
@@ -1609,6 +2312,8 @@ static void fstack_account_time(struct ftrace_task_handle *task)
 		if (is_kernel_func)
 			task->stack_count += task->user_stack_count;
 
+		fstack_reserve(task, task->stack_count);
+
 		timestamp_after_lost = rstack->time - 1;
 		task->lost_seen = false;
 
@@ -1634,6 +2339,12 @@ static void fstack_account_time(struct ftrace_task_handle *task)
 	if (task->func_stack == NULL)
 		return;
 
+	/*
+	 * stack_count can be increased after this (for ENTRY) and users
+	 * access func_stack[stack_count] so make sure it's available.
+	 */
+	fstack_reserve(task, task->stack_count + 1);
+
 	if (rstack->type == UFTRACE_ENTRY) {
 		fstack = &task->func_stack[task->stack_count];
 
@@ -1762,22 +2473,15 @@ static void __fstack_consume(struct ftrace_task_handle *task,
 	struct ftrace_file_handle *handle = task->h;
 
 	if (rstack->more) {
-		struct uftrace_rstack_list_node *node;
+		struct uftrace_rstack_list *list;
 
 		if (is_user_record(task, rstack))
-			node = list_first_entry(&task->rstack_list.read,
-						typeof(*node), list);
+			list = &task->rstack_list;
 		else
-			node = list_first_entry(&kernel->rstack_list[cpu].read,
-						typeof(*node), list);
-		assert(node->args.data);
+			list = &kernel->rstack_list[cpu];
 
 		/* restore args/retval to task */
-		free(task->args.data);
-		task->args.args = node->args.args;
-		task->args.data = node->args.data;
-		task->args.len  = node->args.len;
-		node->args.data = NULL;
+		restore_first_rstack_list_args(list, &task->args);
 	}
 
 	if (is_user_record(task, rstack)) {
@@ -2165,4 +2869,235 @@ TEST_CASE(fstack_time)
 	return TEST_OK;
 }
 
+TEST_CASE(fstack_file_pool)
+{
+	struct ftrace_file_handle *handle = &fstack_test_handle;
+	struct ftrace_task_handle *task;
+	int i;
+
+	/* only one task data file can be opened at a time */
+	handle->max_open_files = 1;
+
+	TEST_EQ(fstack_test_setup_file(handle, ARRAY_SIZE(test_tids)), 0);
+	TEST_EQ(handle->max_open_files, 1);
+
+	for (i = 0; i < NUM_RECORD; i++) {
+		TEST_EQ(read_rstack(handle, &task), 0);
+		TEST_EQ(task->tid, test_tids[0]);
+		TEST_EQ((uint64_t)task->rstack->addr,  (uint64_t)test_record[0][i].addr);
+		TEST_LE(handle->nr_open_files, 1);
+
+		TEST_EQ(read_rstack(handle, &task), 0);
+		TEST_EQ(task->tid, test_tids[1]);
+		TEST_EQ((uint64_t)task->rstack->addr,  (uint64_t)test_record[1][i].addr);
+		TEST_LE(handle->nr_open_files, 1);
+	}
+	TEST_LT(read_rstack(handle, &task), 0);
+
+	handle->max_open_files = 0;
+	return TEST_OK;
+}
+
+TEST_CASE(fstack_heap)
+{
+	struct uftrace_rstack_heap heap = {};
+	uint64_t times[] = { 300, 100, 400, 100, 200 };
+	int order[] = { 1, 3, 4, 0, 2 };
+	int i;
+
+	setup_rstack_heap(&heap, ARRAY_SIZE(times));
+
+	for (i = 0; i < (int)ARRAY_SIZE(times); i++)
+		add_to_rstack_heap(&heap, i, times[i]);
+
+	/* same timestamp should be ordered by index */
+	for (i = 0; i < (int)ARRAY_SIZE(order); i++) {
+		TEST_EQ(get_first_rstack_heap(&heap), order[i]);
+		delete_first_rstack_heap(&heap);
+	}
+	TEST_EQ(get_first_rstack_heap(&heap), -1);
+
+	for (i = 0; i < (int)ARRAY_SIZE(times); i++)
+		add_to_rstack_heap(&heap, i, times[i]);
+
+	/* consume the first and move it after others */
+	TEST_EQ(get_first_rstack_heap(&heap), 1);
+	update_first_rstack_heap(&heap, 350);
+	TEST_EQ(get_first_rstack_heap(&heap), 3);
+	update_first_rstack_heap(&heap, 500);
+	TEST_EQ(get_first_rstack_heap(&heap), 4);
+
+	reset_rstack_heap(&heap);
+	TEST_EQ(heap.ready, false);
+
+	return TEST_OK;
+}
+
+TEST_CASE(fstack_rstack_list)
+{
+	struct uftrace_rstack_list list;
+	struct uftrace_record rec = {
+		.type = UFTRACE_ENTRY,
+	};
+	struct fstack_arguments args = {};
+	struct fstack_arguments saved = {};
+	uint64_t i;
+
+	setup_rstack_list(&list);
+
+	/* make the ring wrap around before it grows */
+	for (i = 0; i < RSTACK_LIST_INIT_SIZE / 2; i++) {
+		rec.time = i;
+		add_to_rstack_list(&list, &rec, NULL);
+	}
+	for (i = 0; i < RSTACK_LIST_INIT_SIZE / 2 - 1; i++)
+		consume_first_rstack_list(&list);
+
+	for (i = RSTACK_LIST_INIT_SIZE / 2; i < 1000; i++) {
+		rec.time = i;
+		rec.more = i % 3 == 0;
+		args.data = &i;
+		args.len = i % 7 + 1;
+		add_to_rstack_list(&list, &rec, &args);
+	}
+	TEST_EQ(list.count, 1000 - RSTACK_LIST_INIT_SIZE / 2 + 1);
+	TEST_EQ(get_last_rstack_list(&list, 0)->time, 999);
+	TEST_EQ(get_last_rstack_list(&list, 2)->time, 997);
+
+	/* delete the last records and add them again */
+	for (i = 0; i < 10; i++)
+		delete_last_rstack_list(&list);
+	TEST_EQ(get_last_rstack_list(&list, 0)->time, 989);
+
+	for (i = 990; i < 1000; i++) {
+		rec.time = i;
+		rec.more = i % 3 == 0;
+		args.data = &i;
+		args.len = i % 7 + 1;
+		add_to_rstack_list(&list, &rec, &args);
+	}
+
+	for (i = RSTACK_LIST_INIT_SIZE / 2 - 1; i < 1000; i++) {
+		struct uftrace_record *curr = get_first_rstack_list(&list);
+
+		TEST_EQ(curr->time, i);
+		if (curr->more) {
+			restore_first_rstack_list_args(&list, &saved);
+			TEST_EQ(saved.len, (unsigned)(i % 7 + 1));
+			TEST_MEMEQ(saved.data, &i, saved.len);
+		}
+		consume_first_rstack_list(&list);
+	}
+	TEST_EQ(list.count, 0);
+	TEST_EQ(list.head, 0U);
+
+	free(saved.data);
+	reset_rstack_list(&list);
+	TEST_EQ(list.size, 0U);
+
+	return TEST_OK;
+}
+
+TEST_CASE(fstack_grow)
+{
+	struct ftrace_file_handle handle = {
+		.depth = 3,
+		.hdr.max_stack = 1024,
+	};
+	struct ftrace_task_handle task = {
+		.h = &handle,
+	};
+
+	setup_task_handle(&handle, &task, 1234);
+	TEST_EQ(task.func_stack_size, FSTACK_INIT_SIZE);
+
+	task.func_stack[0].addr = 0x40000;
+	fstack_reserve(&task, 100);
+	TEST_EQ(task.func_stack_size, 128);
+	TEST_EQ(task.func_stack[0].addr, 0x40000);
+	TEST_EQ(task.func_stack[100].orig_depth, 3);
+	TEST_EQ(task.func_stack[127].addr, 0);
+
+	/* it should not shrink */
+	fstack_reserve(&task, 10);
+	TEST_EQ(task.func_stack_size, 128);
+
+	free(task.func_stack);
+	return TEST_OK;
+}
+
+static FILE *fstack_test_stream(struct ftrace_file_handle *handle, int idx,
+				int nr_rec, FILE **writer)
+{
+	char *filename;
+	FILE *fp;
+
+	xasprintf(&filename, "%s/%d.dat", handle->dirname, test_tids[idx]);
+
+	/* the writer appends records while the reader follows it */
+	*writer = fopen(filename, "w");
+	fp = fopen(filename, "r");
+	free(filename);
+
+	if (*writer == NULL || fp == NULL)
+		return NULL;
+
+	fwrite(test_record[idx], sizeof(test_record[idx][0]), nr_rec, *writer);
+	fflush(*writer);
+
+	test_tasks[idx].tid = test_tids[idx];
+	return fp;
+}
+
+TEST_CASE(fstack_stream)
+{
+	struct ftrace_file_handle *handle = &fstack_test_handle;
+	struct ftrace_task_handle *task;
+	FILE *fp, *writer[NUM_TASK];
+	uint64_t merged[] = { 150, 250, 300, 350, 400, 450 };
+	unsigned i;
+
+	TEST_EQ(fstack_test_setup_file(handle, 0), 0);
+
+	/* task 1234 has sent the first half of its data */
+	fp = fstack_test_stream(handle, 0, 2, &writer[0]);
+	TEST_NE(fp, NULL);
+
+	task = fstack_add_task(handle, test_tids[0], fp);
+	task->t = &test_tasks[0];
+	TEST_EQ(handle->nr_tasks, 1);
+
+	TEST_EQ(read_rstack(handle, &task), 0);
+	TEST_EQ(task->rstack->time, 100);
+	TEST_EQ(read_rstack(handle, &task), 0);
+	TEST_EQ(task->rstack->time, 200);
+	TEST_NE(read_rstack(handle, &task), 0);
+
+	/* the rest of the data arrives */
+	fwrite(&test_record[0][2], sizeof(test_record[0][0]), 2, writer[0]);
+	fflush(writer[0]);
+	fstack_resume_task(handle, &handle->tasks[0]);
+
+	/* and a new task started */
+	fp = fstack_test_stream(handle, 1, NUM_RECORD, &writer[1]);
+	TEST_NE(fp, NULL);
+
+	task = fstack_add_task(handle, test_tids[1], fp);
+	task->t = &test_tasks[1];
+	TEST_EQ(handle->nr_tasks, 2);
+
+	for (i = 0; i < ARRAY_SIZE(merged); i++) {
+		TEST_EQ(read_rstack(handle, &task), 0);
+		TEST_EQ(task->rstack->time, merged[i]);
+	}
+	TEST_NE(read_rstack(handle, &task), 0);
+
+	fclose(writer[0]);
+	fclose(writer[1]);
+
+	/* let fstack_test_finish_file() remove the data files */
+	handle->info.nr_tid = NUM_TASK;
+	return TEST_OK;
+}
+
 #endif /* UNIT_TEST */
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <sys/types.h>
 
 #include "uftrace.h"
 #include "utils/filter.h"
@@ -39,10 +40,17 @@ struct ftrace_task_handle {
 	bool fork_handled;
 	bool fstack_set;
 	bool display_depth_set;
+	bool fp_closed;
 	FILE *fp;
+	off_t fpos;
+	struct list_head lru;
 	struct sym *func;
 	struct uftrace_task *t;
 	struct ftrace_file_handle *h;
+	/* last session found and its valid time range */
+	struct uftrace_session *sess_last;
+	uint64_t sess_start;
+	uint64_t sess_end;
 	struct uftrace_record ustack;
 	struct uftrace_record kstack;
 	struct uftrace_record *rstack;
@@ -53,6 +61,8 @@ struct ftrace_task_handle {
 	int display_depth;
 	int user_display_depth;
 	int fork_display_depth;
+	int setjmp_depth;
+	int setjmp_count;
 	int column_index;
 	int event_color;
 	enum context ctx;
@@ -72,6 +82,7 @@ struct ftrace_task_handle {
 		uint64_t total_time;
 		uint64_t child_time;
 	} *func_stack;
+	int func_stack_size;
 	struct fstack_arguments args;
 };
 
@@ -95,9 +106,16 @@ enum argspec_string_bits {
 
 extern bool fstack_enabled;
 extern bool live_disabled;
+extern enum filter_mode fstack_filter_mode;
 
 struct ftrace_task_handle *get_task_handle(struct ftrace_file_handle *handle,
 					   int tid);
+
+/* data file can be closed by the file pool and reopened when it's needed */
+static inline bool has_task_data(struct ftrace_task_handle *task)
+{
+	return task->fp != NULL || task->fp_closed;
+}
 void reset_task_handle(struct ftrace_file_handle *handle);
 
 int read_rstack(struct ftrace_file_handle *handle,
@@ -129,6 +147,13 @@ void setup_fstack_args(char *argspec, char *retspec,
 		       struct ftrace_file_handle *handle, bool auto_args,
 		       enum uftrace_pattern_type patt_type);
 int fstack_setup_filters(struct opts *opts, struct ftrace_file_handle *handle);
+void fstack_setup_tasks(struct opts *opts, struct ftrace_file_handle *handle);
+void fstack_setup_session(struct opts *opts, struct ftrace_file_handle *handle,
+			  struct uftrace_session *s);
+struct ftrace_task_handle *fstack_add_task(struct ftrace_file_handle *handle,
+					   int tid, FILE *fp);
+void fstack_resume_task(struct ftrace_file_handle *handle,
+			struct ftrace_task_handle *task);
 
 int fstack_entry(struct ftrace_task_handle *task,
 		 struct uftrace_record *rstack,
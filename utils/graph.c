@@ -14,6 +14,7 @@ void graph_init(struct uftrace_graph *graph, struct uftrace_session *s)
 {
 	memset(graph, 0, sizeof(*graph));
 	graph->sess = s;
+	graph->arena = ARENA_INIT;
 
 	INIT_LIST_HEAD(&graph->root.head);
 	INIT_LIST_HEAD(&graph->special_nodes);
@@ -57,11 +58,147 @@ struct uftrace_task_graph * graph_get_task(struct ftrace_task_handle *task,
 	return tg;
 }
 
+#define GRAPH_HASH_INIT_SIZE  64
+
+/* FNV-1a hash of the string */
+static unsigned long hash_name(const char *name)
+{
+	unsigned long hash = 2166136261UL;
+
+	while (*name) {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619UL;
+	}
+	return hash;
+}
+
+static unsigned long hash_node(struct uftrace_graph_node *parent, char *name)
+{
+	/* names are interned so that it can use the pointer */
+	unsigned long key = (unsigned long)parent ^ ((unsigned long)name << 1);
+
+	return (key * 0x9e37fffffffc0001ULL) >> 32;
+}
+
+/* returns the interned copy of @name in the @graph */
+static char * intern_name(struct uftrace_graph *graph, char *name)
+{
+	unsigned mask = graph->name_hash_size - 1;
+	unsigned slot;
+	char *str;
+
+	if (graph->name_hash == NULL) {
+		graph->name_hash_size = GRAPH_HASH_INIT_SIZE;
+		graph->name_hash = xcalloc(graph->name_hash_size,
+					   sizeof(*graph->name_hash));
+		mask = graph->name_hash_size - 1;
+	}
+
+	slot = hash_name(name) & mask;
+	while ((str = graph->name_hash[slot]) != NULL) {
+		if (!strcmp(str, name))
+			return str;
+		slot = (slot + 1) & mask;
+	}
+
+	str = arena_strdup(&graph->arena, name);
+	graph->name_hash[slot] = str;
+
+	/* keep load factor under 50% */
+	if (++graph->nr_names * 2 > graph->name_hash_size) {
+		char **old_hash = graph->name_hash;
+		unsigned old_size = graph->name_hash_size;
+		unsigned i;
+
+		graph->name_hash_size *= 2;
+		graph->name_hash = xcalloc(graph->name_hash_size,
+					   sizeof(*graph->name_hash));
+		mask = graph->name_hash_size - 1;
+
+		for (i = 0; i < old_size; i++) {
+			if (old_hash[i] == NULL)
+				continue;
+
+			slot = hash_name(old_hash[i]) & mask;
+			while (graph->name_hash[slot])
+				slot = (slot + 1) & mask;
+			graph->name_hash[slot] = old_hash[i];
+		}
+		free(old_hash);
+	}
+
+	return str;
+}
+
+static void insert_node_hash(struct uftrace_graph *graph,
+			     struct uftrace_graph_node *node)
+{
+	unsigned mask = graph->node_hash_size - 1;
+	unsigned slot = hash_node(node->parent, node->name) & mask;
+
+	while (graph->node_hash[slot])
+		slot = (slot + 1) & mask;
+	graph->node_hash[slot] = node;
+}
+
+static struct uftrace_graph_node * find_child(struct uftrace_graph *graph,
+					      struct uftrace_graph_node *parent,
+					      char *name)
+{
+	struct uftrace_graph_node *node;
+	unsigned mask = graph->node_hash_size - 1;
+	unsigned slot;
+
+	if (graph->node_hash == NULL)
+		return NULL;
+
+	slot = hash_node(parent, name) & mask;
+	while ((node = graph->node_hash[slot]) != NULL) {
+		if (node->parent == parent && node->name == name)
+			return node;
+		slot = (slot + 1) & mask;
+	}
+	return NULL;
+}
+
+static void add_child(struct uftrace_graph *graph,
+		      struct uftrace_graph_node *node)
+{
+	if (graph->node_hash == NULL) {
+		graph->node_hash_size = GRAPH_HASH_INIT_SIZE;
+		graph->node_hash = xcalloc(graph->node_hash_size,
+					   sizeof(*graph->node_hash));
+	}
+
+	list_add_tail(&node->list, &node->parent->head);
+	node->parent->nr_edges++;
+
+	insert_node_hash(graph, node);
+
+	/* keep load factor under 50% */
+	if (++graph->nr_nodes * 2 > graph->node_hash_size) {
+		struct uftrace_graph_node **old_hash = graph->node_hash;
+		unsigned old_size = graph->node_hash_size;
+		unsigned i;
+
+		graph->node_hash_size *= 2;
+		graph->node_hash = xcalloc(graph->node_hash_size,
+					   sizeof(*graph->node_hash));
+
+		for (i = 0; i < old_size; i++) {
+			if (old_hash[i])
+				insert_node_hash(graph, old_hash[i]);
+		}
+		free(old_hash);
+	}
+}
+
 static int add_graph_entry(struct uftrace_task_graph *tg, char *name)
 {
 	struct uftrace_graph_node *node = NULL;
 	struct uftrace_graph_node *curr = tg->node;
 	struct uftrace_record *rstack = tg->task->rstack;
+	struct uftrace_graph *graph = tg->graph;
 
 	if (tg->lost)
 		return 1;  /* ignore kernel functions after LOST */
@@ -75,24 +212,22 @@ static int add_graph_entry(struct uftrace_task_graph *tg, char *name)
 	if (curr == NULL)
 		return -1;
 
-	list_for_each_entry(node, &curr->head, list) {
-		if (name && !strcmp(name, node->name))
-			break;
-	}
+	name = intern_name(graph, name ?: "none");
 
-	if (list_no_entry(node, &curr->head, list)) {
+	node = find_child(graph, curr, name);
+	if (node == NULL) {
 		struct uftrace_trigger tr;
-		struct uftrace_session *sess = tg->graph->sess;
+		struct uftrace_session *sess = graph->sess;
 
-		node = xcalloc(1, sizeof(*node));
+		node = arena_alloc(&graph->arena, sizeof(*node));
+		memset(node, 0, sizeof(*node));
 
 		node->addr = rstack->addr;
-		node->name = xstrdup(name ?: "none");
+		node->name = name;
 		INIT_LIST_HEAD(&node->head);
 
 		node->parent = curr;
-		list_add_tail(&node->list, &node->parent->head);
-		node->parent->nr_edges++;
+		add_child(graph, node);
 
 		if (uftrace_match_filter(node->addr, &sess->fixups, &tr)) {
 			struct sym *sym;
@@ -112,13 +247,13 @@ static int add_graph_entry(struct uftrace_task_graph *tg, char *name)
 			else
 				goto out;
 
-			snode = xmalloc(sizeof(*snode));
+			snode = arena_alloc(&graph->arena, sizeof(*snode));
 			snode->node = node;
 			snode->type = type;
 			snode->pid  = tg->task->t->pid;
 
 			/* find recent one first */
-			list_add(&snode->list, &tg->graph->special_nodes);
+			list_add(&snode->list, &graph->special_nodes);
 		}
 	}
 
@@ -211,30 +346,21 @@ int graph_add_node(struct uftrace_task_graph *tg, int type, char *name)
 		return 0;
 }
 
-static void graph_destroy_node(struct uftrace_graph_node *node)
-{
-	struct uftrace_graph_node *child;
-
-	list_for_each_entry(child, &node->head, list)
-		graph_destroy_node(child);
-
-	list_del(&node->list);
-	free(node->name);
-	free(node);
-}
-
 void graph_destroy(struct uftrace_graph *graph)
 {
-	struct uftrace_graph_node *node, *tmp;
-	struct uftrace_special_node *snode, *stmp;
+	/* all nodes, names and special nodes are in the arena */
+	arena_free(&graph->arena);
 
-	list_for_each_entry_safe(node, tmp, &graph->root.head, list)
-		graph_destroy_node(node);
+	free(graph->node_hash);
+	graph->node_hash = NULL;
+	graph->node_hash_size = graph->nr_nodes = 0;
 
-	list_for_each_entry_safe(snode, stmp, &graph->special_nodes, list) {
-		list_del(&snode->list);
-		free(snode);
-	}
+	free(graph->name_hash);
+	graph->name_hash = NULL;
+	graph->name_hash_size = graph->nr_names = 0;
+
+	INIT_LIST_HEAD(&graph->root.head);
+	INIT_LIST_HEAD(&graph->special_nodes);
 }
 
 void graph_remove_task(void)
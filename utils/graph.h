@@ -5,6 +5,7 @@
 #include <stdbool.h>
 
 #include "uftrace.h"
+#include "utils/utils.h"
 #include "utils/list.h"
 #include "utils/rbtree.h"
 #include "utils/fstack.h"
@@ -39,6 +40,16 @@ struct uftrace_graph {
 	struct uftrace_session		*sess;
 	struct list_head		special_nodes;
 	struct uftrace_graph_node	root;
+	/* nodes and (interned) names are allocated from the arena */
+	struct arena			arena;
+	/* hash table of nodes (keyed by parent and name) */
+	struct uftrace_graph_node	**node_hash;
+	unsigned			node_hash_size;
+	unsigned			nr_nodes;
+	/* hash table of interned names */
+	char				**name_hash;
+	unsigned			name_hash_size;
+	unsigned			nr_names;
 };
 
 struct uftrace_task_graph {
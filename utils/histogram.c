@@ -0,0 +1,315 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/histogram.h"
+#include "utils/utils.h"
+
+/* make sure the bucket at @idx is allocated */
+static void histogram_grow(struct histogram *hist, int idx)
+{
+	int first = hist->first;
+	int last = hist->first + hist->nr_buckets;
+	uint64_t *counts;
+
+	if (hist->counts == NULL)
+		first = last = idx;
+
+	if (idx < first)
+		first = idx;
+	if (idx >= last)
+		last = idx + 1;
+
+	/* allocate a whole power of 2 range at once */
+	first -= first % HIST_SUB_BUCKETS;
+	last = ALIGN(last, HIST_SUB_BUCKETS);
+
+	counts = xcalloc(last - first, sizeof(*counts));
+	if (hist->counts) {
+		memcpy(counts + hist->first - first, hist->counts,
+		       hist->nr_buckets * sizeof(*counts));
+		free(hist->counts);
+	}
+
+	hist->counts = counts;
+	hist->first = first;
+	hist->nr_buckets = last - first;
+}
+
+/**
+ * histogram_add - add a value to the histogram
+ * @hist: histogram
+ * @value: value (duration) to add
+ */
+void histogram_add(struct histogram *hist, uint64_t value)
+{
+	int idx = histogram_index(value);
+
+	if (idx < hist->first || idx >= hist->first + hist->nr_buckets)
+		histogram_grow(hist, idx);
+
+	if (hist->nr_samples == 0 || hist->min > value)
+		hist->min = value;
+	if (hist->max < value)
+		hist->max = value;
+
+	hist->counts[idx - hist->first]++;
+	hist->nr_samples++;
+}
+
+/**
+ * histogram_add_bucket - add a number of values to a bucket
+ * @hist: histogram
+ * @idx: bucket index
+ * @count: number of values to add
+ *
+ * This function is to restore a histogram from saved bucket counts.
+ * The exact values are unknown so the min and max are set to the
+ * bounds of the buckets.  The caller can set the actual values later.
+ */
+void histogram_add_bucket(struct histogram *hist, int idx, uint64_t count)
+{
+	if (count == 0 || idx < 0 || idx >= HIST_NR_BUCKETS)
+		return;
+
+	if (idx < hist->first || idx >= hist->first + hist->nr_buckets)
+		histogram_grow(hist, idx);
+
+	if (hist->nr_samples == 0 || hist->min > histogram_lower(idx))
+		hist->min = histogram_lower(idx);
+	if (hist->max < histogram_upper(idx))
+		hist->max = histogram_upper(idx);
+
+	hist->counts[idx - hist->first] += count;
+	hist->nr_samples += count;
+}
+
+/**
+ * histogram_merge - merge two histograms
+ * @dst: histogram to have the result
+ * @src: histogram to be merged
+ *
+ * This function adds all values in @src to @dst.  The @src is not
+ * changed so the caller should free it if not needed.
+ */
+void histogram_merge(struct histogram *dst, struct histogram *src)
+{
+	int i;
+
+	if (src->nr_samples == 0)
+		return;
+
+	if (src->first < dst->first || dst->counts == NULL)
+		histogram_grow(dst, src->first);
+	if (src->first + src->nr_buckets > dst->first + dst->nr_buckets)
+		histogram_grow(dst, src->first + src->nr_buckets - 1);
+
+	if (dst->nr_samples == 0 || dst->min > src->min)
+		dst->min = src->min;
+	if (dst->max < src->max)
+		dst->max = src->max;
+
+	for (i = 0; i < src->nr_buckets; i++)
+		dst->counts[src->first - dst->first + i] += src->counts[i];
+	dst->nr_samples += src->nr_samples;
+}
+
+/**
+ * histogram_percentile - get a percentile value of the histogram
+ * @hist: histogram
+ * @pcnt: percentile (0 ~ 100)
+ *
+ * This function returns the largest value in the bucket which contains
+ * the given percentile of values (but not out of the actual min/max).
+ * It returns 0 if empty.
+ */
+uint64_t histogram_percentile(struct histogram *hist, double pcnt)
+{
+	double pos = hist->nr_samples * pcnt / 100;
+	uint64_t target = pos;
+	uint64_t sum = 0;
+	uint64_t value;
+	int i;
+
+	if (hist->nr_samples == 0)
+		return 0;
+
+	/* round up, but it needs one sample at least */
+	if (target < pos || target == 0)
+		target++;
+
+	for (i = 0; i < hist->nr_buckets; i++) {
+		sum += hist->counts[i];
+		if (sum >= target)
+			break;
+	}
+
+	if (i == hist->nr_buckets)
+		i--;
+
+	value = histogram_upper(hist->first + i);
+	if (value < hist->min)
+		value = hist->min;
+	if (value > hist->max)
+		value = hist->max;
+
+	return value;
+}
+
+/**
+ * histogram_free - release memory of the histogram
+ * @hist: histogram
+ */
+void histogram_free(struct histogram *hist)
+{
+	free(hist->counts);
+	*hist = HISTOGRAM_INIT;
+}
+
+#ifdef UNIT_TEST
+
+TEST_CASE(histogram_bucket)
+{
+	uint64_t values[] = {
+		0, 1, 31, 32, 33, 63, 64, 65, 100, 1000, 1023, 1024,
+		123456789, 1ULL << 40, (1ULL << 40) + 12345, UINT64_MAX,
+	};
+	uint64_t lower, upper;
+	unsigned i;
+	int idx;
+
+	for (i = 0; i < ARRAY_SIZE(values); i++) {
+		idx = histogram_index(values[i]);
+		lower = histogram_lower(idx);
+		upper = histogram_upper(idx);
+
+		TEST_LT(idx, HIST_NR_BUCKETS);
+		TEST_LE(lower, values[i]);
+		TEST_GE(upper, values[i]);
+
+		/* relative error should be small */
+		TEST_LE(upper - lower, lower / HIST_SUB_BUCKETS);
+	}
+
+	/* small values should be exact */
+	for (i = 0; i < 2 * HIST_SUB_BUCKETS; i++)
+		TEST_EQ(histogram_index(i), (int)i);
+
+	TEST_EQ(histogram_index(UINT64_MAX), HIST_NR_BUCKETS - 1);
+	TEST_EQ(histogram_upper(HIST_NR_BUCKETS - 1), UINT64_MAX);
+
+	return TEST_OK;
+}
+
+TEST_CASE(histogram_percentile)
+{
+	struct histogram hist = HISTOGRAM_INIT;
+	uint64_t val;
+	int i;
+
+	TEST_EQ(histogram_percentile(&hist, 50), 0);
+
+	for (i = 1; i <= 1000; i++)
+		histogram_add(&hist, i * 1000);
+
+	TEST_EQ(hist.nr_samples, 1000);
+
+	val = histogram_percentile(&hist, 50);
+	TEST_GE(val, 500 * 1000);
+	TEST_LT(val, 500 * 1000 * 33 / 32);
+
+	val = histogram_percentile(&hist, 99);
+	TEST_GE(val, 990 * 1000);
+	TEST_LT(val, 990 * 1000 * 33 / 32);
+
+	val = histogram_percentile(&hist, 0);
+	TEST_GE(val, 1000);
+	TEST_LT(val, 1000 * 33 / 32);
+
+	/* it should not exceed the actual max */
+	TEST_EQ(histogram_percentile(&hist, 100), 1000 * 1000);
+
+	histogram_free(&hist);
+	TEST_EQ(hist.counts, NULL);
+	TEST_EQ(hist.nr_samples, 0);
+
+	return TEST_OK;
+}
+
+TEST_CASE(histogram_merge)
+{
+	struct histogram all = HISTOGRAM_INIT;
+	struct histogram small = HISTOGRAM_INIT;
+	struct histogram large = HISTOGRAM_INIT;
+	struct histogram empty = HISTOGRAM_INIT;
+	double pcnt[] = { 0, 10, 50, 90, 99, 99.9, 100 };
+	unsigned i;
+
+	for (i = 1; i <= 10000; i++) {
+		histogram_add(&all, i * 37);
+		if (i % 3)
+			histogram_add(&large, i * 37);
+		else
+			histogram_add(&small, i * 37);
+	}
+
+	/* merge to an empty histogram and then merge another */
+	histogram_merge(&empty, &large);
+	histogram_merge(&empty, &small);
+	TEST_EQ(empty.nr_samples, all.nr_samples);
+
+	for (i = 0; i < ARRAY_SIZE(pcnt); i++) {
+		TEST_EQ(histogram_percentile(&empty, pcnt[i]),
+			histogram_percentile(&all, pcnt[i]));
+	}
+
+	/* smaller values should be merged into the histogram as well */
+	histogram_free(&small);
+	histogram_add(&small, 3);
+	histogram_merge(&large, &small);
+	TEST_EQ(histogram_percentile(&large, 0), 3);
+
+	histogram_free(&all);
+	histogram_free(&small);
+	histogram_free(&large);
+	histogram_free(&empty);
+
+	return TEST_OK;
+}
+
+TEST_CASE(histogram_add_bucket)
+{
+	struct histogram orig = HISTOGRAM_INIT;
+	struct histogram copy = HISTOGRAM_INIT;
+	double pcnt[] = { 10, 50, 90, 99, 99.9 };
+	unsigned i;
+
+	for (i = 1; i <= 5000; i++)
+		histogram_add(&orig, i * i);
+
+	/* restore it from the bucket counts */
+	for (i = 0; i < (unsigned)orig.nr_buckets; i++)
+		histogram_add_bucket(&copy, orig.first + i, orig.counts[i]);
+
+	TEST_EQ(copy.nr_samples, orig.nr_samples);
+	TEST_LE(copy.min, orig.min);
+	TEST_GE(copy.max, orig.max);
+
+	copy.min = orig.min;
+	copy.max = orig.max;
+	for (i = 0; i < ARRAY_SIZE(pcnt); i++) {
+		TEST_EQ(histogram_percentile(&copy, pcnt[i]),
+			histogram_percentile(&orig, pcnt[i]));
+	}
+
+	/* invalid buckets are ignored */
+	histogram_add_bucket(&copy, -1, 1);
+	histogram_add_bucket(&copy, HIST_NR_BUCKETS, 1);
+	TEST_EQ(copy.nr_samples, orig.nr_samples);
+
+	histogram_free(&orig);
+	histogram_free(&copy);
+
+	return TEST_OK;
+}
+
+#endif /* UNIT_TEST */
@@ -0,0 +1,72 @@
+#ifndef UFTRACE_HISTOGRAM_H
+#define UFTRACE_HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Log-linear (HDR-style) histogram of durations in nsec.  Each power
+ * of 2 range is divided into HIST_SUB_BUCKETS linear buckets so that
+ * the relative error of a value is less than 1/HIST_SUB_BUCKETS.
+ * Values smaller than HIST_SUB_BUCKETS have their own buckets.
+ *
+ * Only the buckets between the smallest and the largest value are
+ * allocated (in units of a power of 2 range), so that it usually
+ * takes a few KB even for long-tailed distributions.  Two histograms
+ * can be merged by adding counts of the same bucket.
+ */
+#define HIST_SUB_BITS     5
+#define HIST_SUB_BUCKETS  (1 << HIST_SUB_BITS)
+#define HIST_NR_BUCKETS   ((64 - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS)
+
+struct histogram {
+	uint64_t	*counts;
+	uint64_t	nr_samples;
+	uint64_t	min;
+	uint64_t	max;
+	int		first;   /* bucket index of counts[0] */
+	int		nr_buckets;
+};
+
+#define HISTOGRAM_INIT  (struct histogram){ .counts = NULL, }
+
+static inline int histogram_index(uint64_t value)
+{
+	int shift;
+
+	if (value < HIST_SUB_BUCKETS)
+		return value;
+
+	shift = 63 - __builtin_clzll(value) - HIST_SUB_BITS;
+	return shift * HIST_SUB_BUCKETS + (value >> shift);
+}
+
+/* smallest value in the bucket */
+static inline uint64_t histogram_lower(int idx)
+{
+	int shift = idx / HIST_SUB_BUCKETS - 1;
+
+	if (shift < 0)
+		return idx;
+
+	return (uint64_t)(idx % HIST_SUB_BUCKETS + HIST_SUB_BUCKETS) << shift;
+}
+
+/* largest value in the bucket */
+static inline uint64_t histogram_upper(int idx)
+{
+	int shift = idx / HIST_SUB_BUCKETS - 1;
+
+	if (shift < 0)
+		return idx;
+
+	return histogram_lower(idx) + (1ULL << shift) - 1;
+}
+
+void histogram_add(struct histogram *hist, uint64_t value);
+void histogram_add_bucket(struct histogram *hist, int idx, uint64_t count);
+void histogram_merge(struct histogram *dst, struct histogram *src);
+uint64_t histogram_percentile(struct histogram *hist, double pcnt);
+void histogram_free(struct histogram *hist);
+
+#endif /* UFTRACE_HISTOGRAM_H */
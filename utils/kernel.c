@@ -1226,6 +1226,8 @@ int finish_kernel_data(struct uftrace_kernel_reader *kernel)
 	free(kernel->missed_events);
 	free(kernel->tids);
 
+	reset_rstack_heap(&kernel->heap);
+
 	trace_seq_destroy(&kernel->trace_buf);
 	pevent_free(kernel->pevent);
 	kernel->pevent = NULL;
@@ -1469,7 +1471,7 @@ static int read_kernel_cpu(struct ftrace_file_handle *handle, int cpu)
 				break;
 		}
 		else if (curr->type == UFTRACE_EXIT) {
-			struct uftrace_rstack_list_node *last;
+			struct uftrace_record *last;
 			uint64_t delta;
 			int count;
 
@@ -1494,17 +1496,16 @@ static int read_kernel_cpu(struct ftrace_file_handle *handle, int cpu)
 				break;
 			}
 
-			last = list_last_entry(&rstack_list->read,
-					       typeof(*last), list);
+			last = get_last_rstack_list(rstack_list, 0);
 			count = 1;
 
 			/* skip EVENT records, if any*/
-			while (last->rstack.type == UFTRACE_EVENT) {
-				last = list_prev_entry(last, list);
+			while (last->type == UFTRACE_EVENT) {
+				last = get_last_rstack_list(rstack_list, count);
 				count++;
 			}
 
-			delta = curr->time - last->rstack.time;
+			delta = curr->time - last->time;
 
 			if (delta < time_filter) {
 				/* also delete matching entry (at the last) */
@@ -1603,48 +1604,56 @@ int read_kernel_stack(struct ftrace_file_handle *handle,
 	int first_tid = -1;
 	uint64_t first_timestamp = 0;
 	struct uftrace_kernel_reader *kernel = handle->kernel;
+	struct uftrace_rstack_heap *heap = &kernel->heap;
 	struct uftrace_record *first_rstack;
 
-retry:
-	first_rstack = NULL;
-	for (i = 0; i < kernel->nr_cpus; i++) {
-		uint64_t timestamp;
-
-		if (kernel->rstack_done[i] && kernel->rstack_list[i].count == 0)
-			continue;
+	if (!heap->ready) {
+		setup_rstack_heap(heap, kernel->nr_cpus);
 
-		if (!kernel->rstack_valid[i]) {
-			read_kernel_cpu(handle, i);
-			if (!kernel->rstack_valid[i])
+		for (i = 0; i < kernel->nr_cpus; i++) {
+			if (kernel->rstack_done[i] &&
+			    kernel->rstack_list[i].count == 0)
 				continue;
+
+			if (!kernel->rstack_valid[i]) {
+				read_kernel_cpu(handle, i);
+				if (!kernel->rstack_valid[i])
+					continue;
+			}
+
+			add_to_rstack_heap(heap, i, kernel->rstacks[i].time);
 		}
+	}
 
-		timestamp = kernel->rstacks[i].time;
-		if (!first_rstack || first_timestamp > timestamp) {
-			first_rstack = &kernel->rstacks[i];
-			first_timestamp = timestamp;
-			first_tid = kernel->tids[i];
-			first_cpu = i;
+retry:
+	/* only the first cpu can be consumed, others are still valid */
+	while ((first_cpu = get_first_rstack_heap(heap)) >= 0) {
+		if (!kernel->rstack_valid[first_cpu]) {
+			read_kernel_cpu(handle, first_cpu);
+			if (!kernel->rstack_valid[first_cpu]) {
+				delete_first_rstack_heap(heap);
+				continue;
+			}
 		}
+
+		first_timestamp = kernel->rstacks[first_cpu].time;
+		if (first_timestamp == heap->time[first_cpu])
+			break;
+
+		update_first_rstack_heap(heap, first_timestamp);
 	}
 
-	if (first_rstack == NULL)
+	if (first_cpu < 0)
 		return -1;
 
+	first_rstack = &kernel->rstacks[first_cpu];
+	first_tid = kernel->tids[first_cpu];
+
 	*taskp = get_task_handle(handle, first_tid);
-	if (*taskp == NULL || (*taskp)->fp == NULL) {
+	if (*taskp == NULL || !has_task_data(*taskp)) {
 		/* force re-read on that cpu */
 		kernel->rstack_valid[first_cpu] = false;
 
-		if (first_rstack->more) {
-			struct uftrace_rstack_list_node *node;
-
-			node = list_first_entry(&kernel->rstack_list[first_cpu].read,
-						typeof(*node), list);
-			free(node->args.data);
-			node->args.data = NULL;
-		}
-
 		consume_first_rstack_list(&kernel->rstack_list[first_cpu]);
 		goto retry;
 	}
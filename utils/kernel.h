@@ -37,6 +37,7 @@ struct uftrace_kernel_reader {
 	struct ftrace_file_handle	*handle;
 	struct uftrace_record		*rstacks;
 	struct uftrace_rstack_list	*rstack_list;
+	struct uftrace_rstack_heap	heap;
 	struct trace_seq		trace_buf;
 	struct uftrace_record		trace_rec;
 	bool				*rstack_valid;
@@ -6,6 +6,7 @@
 #include <unistd.h>
 #include <byteswap.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #include <sys/syscall.h>
 
 #include "uftrace.h"
@@ -164,7 +165,8 @@ void finish_perf_record(struct uftrace_perf_writer *perf)
  * @sock: socket fd to send perf data
  *
  * This function copies contents in the perf ring buffer to a file
- * or a network socket.
+ * or a network socket.  When sending to the network, the data is sent
+ * in a single message even if the ring buffer is wrapped around.
  */
 void record_perf_data(struct uftrace_perf_writer *perf, int cpu, int sock)
 {
@@ -174,7 +176,8 @@ void record_perf_data(struct uftrace_perf_writer *perf, int cpu, int sock)
 	uint64_t mask = pc->data_size - 1;
 	uint64_t old, pos, start, end;
 	unsigned long size;
-	unsigned char *buf;
+	struct iovec iov[2];
+	int i, nr_iov = 0;
 
 	pos = *ptr;
 	old = perf->data_pos[cpu];
@@ -204,27 +207,31 @@ void record_perf_data(struct uftrace_perf_writer *perf, int cpu, int sock)
 
 	/* handle wrap around */
 	if ((start & mask) + size != (end & mask)) {
-		buf = &data[start & mask];
 		size = mask + 1 - (start & mask);
+
+		iov[nr_iov].iov_base = &data[start & mask];
+		iov[nr_iov].iov_len  = size;
+		nr_iov++;
 		start += size;
+	}
+
+	iov[nr_iov].iov_base = &data[start & mask];
+	iov[nr_iov].iov_len  = end - start;
+	nr_iov++;
+
+	if (sock > 0) {
+		send_trace_perf_data(sock, cpu, iov, nr_iov);
+		goto out;
+	}
 
-		if (sock > 0)
-			send_trace_perf_data(sock, cpu, buf, size);
-		else if (fwrite(buf, 1, size, perf->fp[cpu]) != size) {
+	for (i = 0; i < nr_iov; i++) {
+		if (fwrite(iov[i].iov_base, 1, iov[i].iov_len,
+			   perf->fp[cpu]) != iov[i].iov_len) {
 			pr_dbg("failed to write perf data: %m\n");
-			goto out;
+			break;
 		}
 	}
 
-	buf = &data[start & mask];
-	size = end - start;
-	start += size;
-
-	if (sock > 0)
-		send_trace_perf_data(sock, cpu, buf, size);
-	else if (fwrite(buf, 1, size, perf->fp[cpu]) != size)
-		pr_dbg("failed to write perf data: %m\n");
-
 out:
 	/* ensure all reads are done before we write the tail. */
 	full_memory_barrier();
@@ -293,6 +300,8 @@ void finish_perf_data(struct ftrace_file_handle *handle)
 
 	free(handle->perf);
 	handle->perf = NULL;
+
+	reset_rstack_heap(&handle->perf_heap);
 }
 
 static int read_perf_event(struct ftrace_file_handle *handle,
@@ -416,24 +425,42 @@ again:
 int read_perf_data(struct ftrace_file_handle *handle)
 {
 	struct uftrace_perf_reader *perf;
-	uint64_t min_time = ~0ULL;
-	int best = -1;
+	struct uftrace_rstack_heap *heap = &handle->perf_heap;
+	int best;
 	int i;
 
-	for (i = 0; i < handle->nr_perf; i++) {
-		perf = &handle->perf[i];
+	if (!heap->ready) {
+		setup_rstack_heap(heap, handle->nr_perf);
 
-		if (perf->done)
-			continue;
-		if (!perf->valid) {
-			if (read_perf_event(handle, perf) < 0)
+		for (i = 0; i < handle->nr_perf; i++) {
+			perf = &handle->perf[i];
+
+			if (perf->done)
 				continue;
+			if (!perf->valid) {
+				if (read_perf_event(handle, perf) < 0)
+					continue;
+			}
+
+			add_to_rstack_heap(heap, i, perf->time);
 		}
+	}
+
+	/* only the first one can be consumed, others are still valid */
+	while ((best = get_first_rstack_heap(heap)) >= 0) {
+		perf = &handle->perf[best];
 
-		if (perf->time < min_time) {
-			min_time = perf->time;
-			best = i;
+		if (!perf->valid) {
+			if (read_perf_event(handle, perf) < 0) {
+				delete_first_rstack_heap(heap);
+				continue;
+			}
 		}
+
+		if (perf->time == heap->time[best])
+			break;
+
+		update_first_rstack_heap(heap, perf->time);
 	}
 
 	handle->last_perf_idx = best;
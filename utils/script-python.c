@@ -44,10 +44,13 @@ static PyAPI_FUNC(void) (*__PyErr_Clear)(void);
 
 static PyAPI_FUNC(PyObject *) (*__PyObject_GetAttrString)(PyObject *, const char *);
 static PyAPI_FUNC(int) (*__PyCallable_Check)(PyObject *);
+static PyAPI_FUNC(int) (*__PyObject_SetAttrString)(PyObject *, const char *, PyObject *);
 static PyAPI_FUNC(PyObject *) (*__PyObject_CallObject)(PyObject *callable_object, PyObject *args);
 static PyAPI_FUNC(int) (*__PyRun_SimpleStringFlags)(const char *, PyCompilerFlags *);
 
 static PyAPI_FUNC(PyObject *) (*__PyString_FromString)(const char *);
+static PyAPI_FUNC(PyObject *) (*__PyString_FromStringAndSize)(const char *, Py_ssize_t);
+static PyAPI_FUNC(PyObject *) (*__PyString_InternFromString)(const char *);
 static PyAPI_FUNC(PyObject *) (*__PyInt_FromLong)(long);
 static PyAPI_FUNC(PyObject *) (*__PyLong_FromLong)(long);
 static PyAPI_FUNC(PyObject *) (*__PyLong_FromUnsignedLongLong)(unsigned PY_LONG_LONG);
@@ -60,6 +63,8 @@ static PyAPI_FUNC(PyObject *) (*__PyTuple_New)(Py_ssize_t size);
 static PyAPI_FUNC(int) (*__PyTuple_SetItem)(PyObject *, Py_ssize_t, PyObject *);
 static PyAPI_FUNC(PyObject *) (*__PyTuple_GetItem)(PyObject *, Py_ssize_t);
 
+static PyAPI_FUNC(PyObject *) (*__PyList_New)(Py_ssize_t size);
+static PyAPI_FUNC(int) (*__PyList_Append)(PyObject *, PyObject *);
 static PyAPI_FUNC(Py_ssize_t) (*__PyList_Size)(PyObject *);
 static PyAPI_FUNC(PyObject *) (*__PyList_GetItem)(PyObject *, Py_ssize_t);
 
@@ -68,7 +73,7 @@ static PyAPI_FUNC(int) (*__PyDict_SetItem)(PyObject *mp, PyObject *key, PyObject
 static PyAPI_FUNC(int) (*__PyDict_SetItemString)(PyObject *dp, const char *key, PyObject *item);
 static PyAPI_FUNC(PyObject *) (*__PyDict_GetItem)(PyObject *mp, PyObject *key);
 
-static PyObject *pModule, *pFuncEntry, *pFuncExit, *pFuncEnd;
+static PyObject *pModule, *pFuncEntry, *pFuncExit, *pFuncEnd, *pFuncBatch;
 
 enum py_context_idx {
 	PY_CTX_TID = 0,
@@ -93,6 +98,9 @@ static const char *py_context_table[] = {
 	"retval",
 };
 
+/* interned string objects of the above keys */
+static PyObject *py_context_keys[ARRAY_SIZE(py_context_table)];
+
 #define INIT_PY_API_FUNC(func) \
 	do { \
 		__##func = dlsym(python_handle, #func); \
@@ -197,7 +205,7 @@ static void python_insert_tuple(PyObject *tuple, char type, int idx,
 	__PyTuple_SetItem(tuple, idx, obj);
 }
 
-static void python_insert_dict(PyObject *dict, char type, const char *key,
+static void python_insert_dict(PyObject *dict, char type, PyObject *key,
 			       union python_val val)
 {
 	PyObject *obj;
@@ -218,7 +226,7 @@ static void python_insert_dict(PyObject *dict, char type, const char *key,
 		break;
 	}
 
-	__PyDict_SetItemString(dict, key, obj);
+	__PyDict_SetItem(dict, key, obj);
 	Py_XDECREF(obj);
 }
 
@@ -240,31 +248,36 @@ static void insert_tuple_string(PyObject *tuple, int idx, char *v)
 	python_insert_tuple(tuple, 's', idx, val);
 }
 
+static void insert_tuple_string_len(PyObject *tuple, int idx, char *v, int len)
+{
+	__PyTuple_SetItem(tuple, idx, __PyString_FromStringAndSize(v, len));
+}
+
 static void insert_tuple_double(PyObject *tuple, int idx, double v)
 {
 	union python_val val = { .f = v, };
 	python_insert_tuple(tuple, 'f', idx, val);
 }
 
-static void insert_dict_long(PyObject *dict, const char *key, long v)
+static void insert_dict_long(PyObject *dict, PyObject *key, long v)
 {
 	union python_val val = { .l = v, };
 	python_insert_dict(dict, 'l', key, val);
 }
 
-static void insert_dict_ull(PyObject *dict, const char *key, unsigned long long v)
+static void insert_dict_ull(PyObject *dict, PyObject *key, unsigned long long v)
 {
 	union python_val val = { .ull = v, };
 	python_insert_dict(dict, 'U', key, val);
 }
 
-static void insert_dict_string(PyObject *dict, const char *key, char *v)
+static void insert_dict_string(PyObject *dict, PyObject *key, char *v)
 {
 	union python_val val = { .s = v, };
 	python_insert_dict(dict, 's', key, val);
 }
 
-#define PYCTX(_item)  py_context_table[PY_CTX_##_item]
+#define PYCTX(_item)  py_context_keys[PY_CTX_##_item]
 
 static void setup_common_context(PyObject **pDict, struct script_context *sc_ctx)
 {
@@ -314,7 +327,6 @@ static void setup_argument_context(PyObject **pDict, bool is_retval,
 		const int null_str = -1;
 		unsigned short slen;
 		char ch_str[2];
-		char *str;
 		double dval;
 
 		/* skip unwanted arguments or retval */
@@ -379,18 +391,13 @@ static void setup_argument_context(PyObject **pDict, bool is_retval,
 			/* get string length (2 bytes in the beginning) */
 			memcpy(&slen, data, 2);
 
-			str = xmalloc(slen + 1);
-
-			/* copy real string contents */
-			memcpy(str, data + 2, slen);
-			str[slen] = '\0';
-
 			/* NULL string is encoded as '0xffffffff' */
-			if (!memcmp(str, &null_str, sizeof(null_str)))
-				strcpy(str, "NULL");
+			if (slen == sizeof(null_str) &&
+			    !memcmp(data + 2, &null_str, sizeof(null_str)))
+				insert_tuple_string(args, count++, "NULL");
+			else
+				insert_tuple_string_len(args, count++, data + 2, slen);
 
-			insert_tuple_string(args, count++, str);
-			free(str);
 			data += ALIGN(slen + 2, 4);
 			break;
 
@@ -413,11 +420,11 @@ static void setup_argument_context(PyObject **pDict, bool is_retval,
 		PyObject *retval = __PyTuple_GetItem(args, 0);
 
 		/* single return value doesn't need a tuple */
-		__PyDict_SetItemString(*pDict, PYCTX(RETVAL), retval);
+		__PyDict_SetItem(*pDict, PYCTX(RETVAL), retval);
 	}
 	else {
 		/* arguments will be returned in a tuple */
-		__PyDict_SetItemString(*pDict, PYCTX(ARGS), args);
+		__PyDict_SetItem(*pDict, PYCTX(ARGS), args);
 	}
 	Py_XDECREF(args);
 }
@@ -503,6 +510,55 @@ int python_uftrace_exit(struct script_context *sc_ctx)
 	return 0;
 }
 
+static void append_batch_name(char *name, void *arg)
+{
+	PyObject *names = arg;
+	PyObject *obj = __PyString_FromString(name);
+
+	__PyList_Append(names, obj);
+	Py_XDECREF(obj);
+}
+
+int python_uftrace_batch(struct script_batch *batch)
+{
+	PyObject *records, *names, *pythonContext;
+
+	if (unlikely(!pFuncBatch))
+		return -1;
+
+	pthread_mutex_lock(&python_interpreter_lock);
+
+	/* names which are not passed yet (index continues) */
+	names = __PyList_New(0);
+	script_for_each_new_name(append_batch_name, names);
+
+	/* pass the records as a string to be decoded by 'struct' module */
+	records = __PyString_FromStringAndSize((char *)batch->recs,
+					       batch->nr * sizeof(*batch->recs));
+
+	pythonContext = __PyTuple_New(2);
+	__PyTuple_SetItem(pythonContext, 0, records);
+	__PyTuple_SetItem(pythonContext, 1, names);
+
+	/* Call python function "uftrace_batch". */
+	__PyObject_CallObject(pFuncBatch, pythonContext);
+	if (debug) {
+		if (__PyErr_Occurred() && !python_error_reported) {
+			pr_dbg("uftrace_batch failed:\n");
+			__PyErr_Print();
+
+			python_error_reported = true;
+		}
+	}
+
+	/* Free PyTuple. */
+	Py_XDECREF(pythonContext);
+
+	pthread_mutex_unlock(&python_interpreter_lock);
+
+	return 0;
+}
+
 int python_uftrace_end(void)
 {
 	if (unlikely(!pFuncEnd))
@@ -536,6 +592,8 @@ int python_atfork_prepare(void)
 int script_init_for_python(char *py_pathname,
 			   enum uftrace_pattern_type ptype)
 {
+	unsigned i;
+
 	pr_dbg("%s(\"%s\")\n", __func__, py_pathname);
 
 	/* Bind script_uftrace functions to python's. */
@@ -543,6 +601,7 @@ int script_init_for_python(char *py_pathname,
 	script_uftrace_exit = python_uftrace_exit;
 	script_uftrace_end = python_uftrace_end;
 	script_atfork_prepare = python_atfork_prepare;
+	script_uftrace_batch = NULL;
 
 	python_handle = dlopen(libpython, RTLD_LAZY | RTLD_GLOBAL);
 	if (!python_handle) {
@@ -561,10 +620,13 @@ int script_init_for_python(char *py_pathname,
 
 	INIT_PY_API_FUNC(PyObject_GetAttrString);
 	INIT_PY_API_FUNC(PyCallable_Check);
+	INIT_PY_API_FUNC(PyObject_SetAttrString);
 	INIT_PY_API_FUNC(PyObject_CallObject);
 	INIT_PY_API_FUNC(PyRun_SimpleStringFlags);
 
 	INIT_PY_API_FUNC(PyString_FromString);
+	INIT_PY_API_FUNC(PyString_FromStringAndSize);
+	INIT_PY_API_FUNC(PyString_InternFromString);
 	INIT_PY_API_FUNC(PyInt_FromLong);
 	INIT_PY_API_FUNC(PyLong_FromLong);
 	INIT_PY_API_FUNC(PyLong_FromUnsignedLongLong);
@@ -577,6 +639,8 @@ int script_init_for_python(char *py_pathname,
 	INIT_PY_API_FUNC(PyTuple_SetItem);
 	INIT_PY_API_FUNC(PyTuple_GetItem);
 
+	INIT_PY_API_FUNC(PyList_New);
+	INIT_PY_API_FUNC(PyList_Append);
 	INIT_PY_API_FUNC(PyList_Size);
 	INIT_PY_API_FUNC(PyList_GetItem);
 
@@ -591,6 +655,9 @@ int script_init_for_python(char *py_pathname,
 
 	__Py_Initialize();
 
+	for (i = 0; i < ARRAY_SIZE(py_context_table); i++)
+		py_context_keys[i] = __PyString_InternFromString(py_context_table[i]);
+
 	/* Import python module that is passed by -p option. */
 	if (import_python_module(py_pathname) < 0) {
 		pthread_mutex_unlock(&python_interpreter_lock);
@@ -616,17 +683,39 @@ int script_init_for_python(char *py_pathname,
 	PyObject *pFuncBegin = __PyObject_GetAttrString(pModule, "uftrace_begin");
 	if (pFuncBegin && __PyCallable_Check(pFuncBegin))
 		__PyObject_CallObject(pFuncBegin, NULL);
+	else
+		__PyErr_Clear();
 
+	pFuncBatch = __PyObject_GetAttrString(pModule, "uftrace_batch");
+	if (!pFuncBatch || !__PyCallable_Check(pFuncBatch)) {
+		__PyErr_Clear();
+		pr_dbg("uftrace_batch is not callable!\n");
+		pFuncBatch = NULL;
+	}
+	else {
+		PyObject *fmt = __PyString_FromString(SCRIPT_RECORD_FORMAT);
+
+		/* let script know the record layout */
+		__PyObject_SetAttrString(pModule, "UFTRACE_RECORD_FORMAT", fmt);
+		Py_XDECREF(fmt);
+
+		script_uftrace_batch = python_uftrace_batch;
+	}
+	/* per-record hooks are optional if the script handles batches */
 	pFuncEntry = __PyObject_GetAttrString(pModule, "uftrace_entry");
 	if (!pFuncEntry || !__PyCallable_Check(pFuncEntry)) {
-		if (__PyErr_Occurred())
+		if (pFuncBatch)
+			__PyErr_Clear();
+		else if (__PyErr_Occurred())
 			__PyErr_Print();
 		pr_dbg("uftrace_entry is not callable!\n");
 		pFuncEntry = NULL;
 	}
 	pFuncExit = __PyObject_GetAttrString(pModule, "uftrace_exit");
 	if (!pFuncExit || !__PyCallable_Check(pFuncExit)) {
-		if (__PyErr_Occurred())
+		if (pFuncBatch)
+			__PyErr_Clear();
+		else if (__PyErr_Occurred())
 			__PyErr_Print();
 		pr_dbg("uftrace_exit is not callable!\n");
 		pFuncExit = NULL;
@@ -11,6 +11,8 @@
 #define PR_DOMAIN  DBG_SCRIPT
 
 #include <unistd.h>
+#include <pthread.h>
+#include "uftrace.h"
 #include "utils/script.h"
 #include "utils/filter.h"
 #include "utils/list.h"
@@ -28,6 +30,7 @@ script_uftrace_entry_t script_uftrace_entry;
 script_uftrace_exit_t script_uftrace_exit;
 script_uftrace_end_t script_uftrace_end;
 script_atfork_prepare_t script_atfork_prepare;
+script_uftrace_batch_t script_uftrace_batch;
 
 struct script_filter_item {
 	struct list_head	list;
@@ -36,6 +39,39 @@ struct script_filter_item {
 
 static LIST_HEAD(filters);
 
+/*
+ * symbol names in batch records are replaced by an index of this table
+ * and each name is passed to script only once.  It's protected by the
+ * lock since libmcount can add records from different threads.
+ */
+static struct {
+	unsigned		*hash;		/* index + 1 of names */
+	unsigned		hash_size;
+	char			**names;
+	unsigned		nr_names;
+	unsigned		nr_passed;	/* already passed to script */
+	unsigned		max_names;
+	struct arena		arena;
+	unsigned		gen;		/* changed when reset */
+	pthread_mutex_t		lock;
+} script_names = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+#define SCRIPT_NAME_CACHE_SIZE  64
+
+/*
+ * recently used names in the current thread to avoid taking the lock
+ * for every record.  Names are looked up by pointer but the string is
+ * compared as well since the name can be a temporary buffer.
+ */
+static __thread struct script_name_cache {
+	const char		*name;		/* pointer given by caller */
+	const char		*str;		/* copy in the name table */
+	unsigned		idx;
+	unsigned		gen;
+} script_name_cache[SCRIPT_NAME_CACHE_SIZE];
+
 static enum script_type_t get_script_type(const char *str)
 {
 	char *ext = strrchr(str, '.');
@@ -93,6 +129,175 @@ void script_finish_filter(void)
 	}
 }
 
+static unsigned long hash_script_name(const char *name)
+{
+	unsigned long hash = 2166136261UL;
+
+	while (*name) {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619UL;
+	}
+	return hash;
+}
+
+static void grow_script_names(void)
+{
+	unsigned mask, slot, i;
+
+	free(script_names.hash);
+
+	script_names.hash_size = script_names.hash_size * 2 ?: 1024;
+	script_names.hash = xcalloc(script_names.hash_size,
+				    sizeof(*script_names.hash));
+	mask = script_names.hash_size - 1;
+
+	for (i = 0; i < script_names.nr_names; i++) {
+		slot = hash_script_name(script_names.names[i]) & mask;
+		while (script_names.hash[slot])
+			slot = (slot + 1) & mask;
+		script_names.hash[slot] = i + 1;
+	}
+}
+
+/* returns index of @name in the name table */
+static unsigned get_script_name_id(char *name)
+{
+	struct script_name_cache *nc;
+	unsigned mask, slot, idx;
+
+	nc = &script_name_cache[((unsigned long)name >> 3) %
+				SCRIPT_NAME_CACHE_SIZE];
+	if (nc->name == name && nc->str && nc->gen == script_names.gen &&
+	    !strcmp(nc->str, name))
+		return nc->idx;
+
+	pthread_mutex_lock(&script_names.lock);
+
+	if (script_names.hash == NULL)
+		grow_script_names();
+
+	mask = script_names.hash_size - 1;
+	slot = hash_script_name(name) & mask;
+
+	while ((idx = script_names.hash[slot]) != 0) {
+		if (!strcmp(script_names.names[idx - 1], name))
+			goto out;
+		slot = (slot + 1) & mask;
+	}
+
+	if (script_names.nr_names == script_names.max_names) {
+		script_names.max_names = script_names.max_names * 2 ?: 256;
+		script_names.names = xrealloc(script_names.names,
+					      script_names.max_names *
+					      sizeof(*script_names.names));
+	}
+
+	idx = ++script_names.nr_names;
+	script_names.names[idx - 1] = arena_strdup(&script_names.arena, name);
+	script_names.hash[slot] = idx;
+
+	/* keep load factor under 50% */
+	if (script_names.nr_names * 2 > script_names.hash_size)
+		grow_script_names();
+
+out:
+	nc->name = name;
+	nc->str  = script_names.names[idx - 1];
+	nc->idx  = idx - 1;
+	nc->gen  = script_names.gen;
+
+	pthread_mutex_unlock(&script_names.lock);
+	return idx - 1;
+}
+
+static void reset_script_names(void)
+{
+	free(script_names.hash);
+	free(script_names.names);
+	arena_free(&script_names.arena);
+
+	script_names.hash = NULL;
+	script_names.hash_size = 0;
+	script_names.names = NULL;
+	script_names.nr_names = 0;
+	script_names.nr_passed = 0;
+	script_names.max_names = 0;
+	script_names.gen++;
+}
+
+/**
+ * script_add_batch - add a record to the batch
+ * @batch: script batch
+ * @sc_ctx: script context of the record
+ * @type: record type (UFTRACE_ENTRY or UFTRACE_EXIT)
+ *
+ * This function saves @sc_ctx into @batch as a fixed-size record.
+ * Arguments and return values are not saved.  It returns %true if
+ * @batch is full so that caller should pass it to script.
+ */
+bool script_add_batch(struct script_batch *batch,
+		      struct script_context *sc_ctx, int type)
+{
+	struct script_record *rec;
+
+	if (batch->recs == NULL)
+		batch->recs = xmalloc(SCRIPT_BATCH_SIZE * sizeof(*rec));
+
+	rec = &batch->recs[batch->nr++];
+
+	rec->timestamp = sc_ctx->timestamp;
+	rec->duration  = type == UFTRACE_EXIT ? sc_ctx->duration : 0;
+	rec->address   = sc_ctx->address;
+	rec->tid       = sc_ctx->tid;
+	rec->depth     = sc_ctx->depth;
+	rec->type      = type;
+	rec->unused    = 0;
+	rec->name_id   = get_script_name_id(sc_ctx->name);
+	rec->reserved  = 0;
+
+	return batch->nr == SCRIPT_BATCH_SIZE;
+}
+
+/* pass records in @batch to script (if any) */
+void script_flush_batch(struct script_batch *batch)
+{
+	if (batch->nr && script_uftrace_batch)
+		script_uftrace_batch(batch);
+
+	batch->nr = 0;
+}
+
+void script_finish_batch(struct script_batch *batch)
+{
+	script_flush_batch(batch);
+
+	free(batch->recs);
+	batch->recs = NULL;
+}
+
+/**
+ * script_for_each_new_name - call @func for names not passed yet
+ * @func: callback function
+ * @arg: argument to @func
+ *
+ * This function calls @func for each name added to the name table
+ * after the previous call in the order of index.  Script should call
+ * this before passing a batch so that all names in the records can be
+ * found.
+ */
+void script_for_each_new_name(void (*func)(char *name, void *arg), void *arg)
+{
+	unsigned i;
+
+	pthread_mutex_lock(&script_names.lock);
+
+	for (i = script_names.nr_passed; i < script_names.nr_names; i++)
+		func(script_names.names[i], arg);
+	script_names.nr_passed = script_names.nr_names;
+
+	pthread_mutex_unlock(&script_names.lock);
+}
+
 int script_init(char *script_pathname, enum uftrace_pattern_type ptype)
 {
 	pr_dbg2("%s(\"%s\")\n", __func__, script_pathname);
@@ -132,4 +337,5 @@ void script_finish(void)
 	}
 
 	script_finish_filter();
+	reset_script_names();
 }
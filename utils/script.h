@@ -31,18 +31,47 @@ struct script_context {
 	struct list_head	*argspec;
 };
 
+/*
+ * fixed-size record passed to script in a batch.  The layout should
+ * match to SCRIPT_RECORD_FORMAT (in python struct module format).
+ */
+struct script_record {
+	uint64_t		timestamp;
+	uint64_t		duration;	/* exit only */
+	uint64_t		address;
+	int32_t			tid;
+	int16_t			depth;
+	uint8_t			type;		/* UFTRACE_ENTRY or EXIT */
+	uint8_t			unused;
+	uint32_t		name_id;	/* index of the name table */
+	uint32_t		reserved;
+};
+
+#define SCRIPT_RECORD_FORMAT  "=QQQihBBII"
+
+/* max number of records in a batch */
+#define SCRIPT_BATCH_SIZE  4096
+
+struct script_batch {
+	struct script_record	*recs;
+	int			nr;
+};
+
 extern char *script_str;
 
 typedef int (*script_uftrace_entry_t)(struct script_context *sc_ctx);
 typedef int (*script_uftrace_exit_t)(struct script_context *sc_ctx);
 typedef int (*script_uftrace_end_t)(void);
 typedef int (*script_atfork_prepare_t)(void);
+typedef int (*script_uftrace_batch_t)(struct script_batch *batch);
 
 /* The below functions are used both in record time and script command. */
 extern script_uftrace_entry_t script_uftrace_entry;
 extern script_uftrace_exit_t script_uftrace_exit;
 extern script_uftrace_end_t script_uftrace_end;
 extern script_atfork_prepare_t script_atfork_prepare;
+/* it's NULL if the script doesn't support batch */
+extern script_uftrace_batch_t script_uftrace_batch;
 
 int script_init(char *script_pathname, enum uftrace_pattern_type ptype);
 void script_finish(void);
@@ -51,4 +80,10 @@ void script_add_filter(char *func, enum uftrace_pattern_type ptype);
 int script_match_filter(char *func);
 void script_finish_filter(void);
 
+bool script_add_batch(struct script_batch *batch,
+		      struct script_context *sc_ctx, int type);
+void script_flush_batch(struct script_batch *batch);
+void script_finish_batch(struct script_batch *batch);
+void script_for_each_new_name(void (*func)(char *name, void *arg), void *arg);
+
 #endif /* UFTRACE_SCRIPT_H */
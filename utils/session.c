@@ -66,10 +66,7 @@ void read_session_map(char *dirname, struct symtabs *symtabs, char *sid)
 		map->len = namelen;
 		map->next = NULL;
 		memcpy(map->prot, prot, 4);
-		map->symtab.sym = NULL;
-		map->symtab.sym_names = NULL;
-		map->symtab.nr_sym = 0;
-		map->symtab.nr_alloc = 0;
+		memset(&map->symtab, 0, sizeof(map->symtab));
 		memcpy(map->libname, path, namelen);
 		map->libname[strlen(path)] = '\0';
 		last_libname = map->libname;
@@ -84,6 +81,8 @@ static void delete_session_map(struct symtabs *symtabs)
 {
 	struct uftrace_mmap *map, *tmp;
 
+	free_map_index(symtabs);
+
 	map = symtabs->maps;
 	while (map) {
 		tmp = map->next;
@@ -140,11 +139,12 @@ void create_session(struct uftrace_session_link *sessions,
 	pr_dbg2("new session: pid = %d, session = %.16s\n",
 		s->pid, s->sid);
 
-	s->symtabs.flags = SYMTAB_FL_USE_SYMFILE | SYMTAB_FL_DEMANGLE;
+	s->symtabs.flags = SYMTAB_FL_USE_SYMFILE;
 	if (sym_rel_addr)
 		s->symtabs.flags |= SYMTAB_FL_ADJ_OFFSET;
 
 	read_session_map(dirname, &s->symtabs, s->sid);
+	build_map_index(&s->symtabs);
 	load_symtabs(&s->symtabs, dirname, s->exename);
 	set_kernel_base(&s->symtabs, s->sid);
 
@@ -272,7 +272,7 @@ void session_add_dlopen(struct uftrace_session *sess, uint64_t timestamp,
 	strcpy(udl->name, libname);
 
 	memset(&udl->symtabs, 0, sizeof(udl->symtabs));
-	udl->symtabs.flags = SYMTAB_FL_DEMANGLE | SYMTAB_FL_USE_SYMFILE;
+	udl->symtabs.flags = SYMTAB_FL_USE_SYMFILE;
 	udl->symtabs.kernel_base = sess->symtabs.kernel_base;
 	udl->symtabs.dirname = sess->symtabs.dirname;
 
@@ -313,6 +313,79 @@ struct sym * session_find_dlsym(struct uftrace_session *sess, uint64_t timestamp
 	return sym;
 }
 
+/* symbol cache used by the current thread instead of the session's */
+static __thread struct uftrace_sym_cache *thread_sym_cache;
+
+/**
+ * session_setup_thread_cache - use a private symbol cache in this thread
+ *
+ * The symbol cache in sessions is not thread-safe.  A thread which
+ * looks up symbols in parallel with others should call this function
+ * to have its own cache for all sessions.
+ */
+void session_setup_thread_cache(void)
+{
+	thread_sym_cache = xcalloc(SESSION_SYM_CACHE_SIZE,
+				   sizeof(*thread_sym_cache));
+}
+
+void session_finish_thread_cache(void)
+{
+	free(thread_sym_cache);
+	thread_sym_cache = NULL;
+}
+
+/**
+ * session_find_sym - find symbol in the session
+ * @sess: pointer to a current session
+ * @timestamp: timestamp of the address
+ * @addr: instruction address
+ *
+ * This function finds a matching symbol for @addr in @sess including
+ * libraries loaded by dlopen.  The result from the session symbol
+ * table is saved in a cache since it's not changed over time.
+ */
+struct sym * session_find_sym(struct uftrace_session *sess, uint64_t timestamp,
+			      uint64_t addr)
+{
+	struct uftrace_sym_cache *cache = thread_sym_cache;
+	struct uftrace_sym_cache *sc = NULL;
+	struct sym *sym;
+
+	if (cache == NULL) {
+		if (sess->sym_cache == NULL)
+			sess->sym_cache = xcalloc(SESSION_SYM_CACHE_SIZE,
+						  sizeof(*sess->sym_cache));
+		cache = sess->sym_cache;
+	}
+
+	/* address 0 is used for empty slot */
+	if (addr) {
+		unsigned idx = (addr * 0x9e37fffffffc0001ULL) >>
+			       (64 - SESSION_SYM_CACHE_BITS);
+
+		sc = &cache[idx];
+		if (sc->addr == addr && sc->sess == sess) {
+			sym = sc->sym;
+			goto out;
+		}
+	}
+
+	sym = find_symtabs(&sess->symtabs, addr);
+	if (sc) {
+		sc->addr = addr;
+		sc->sess = sess;
+		sc->sym = sym;
+	}
+
+out:
+	/* symbols in dlopen'ed libraries depend on the timestamp */
+	if (sym == NULL)
+		sym = session_find_dlsym(sess, timestamp, addr);
+
+	return sym;
+}
+
 void delete_session(struct uftrace_session *sess)
 {
 	struct uftrace_dlopen_list *udl, *tmp;
@@ -325,6 +398,7 @@ void delete_session(struct uftrace_session *sess)
 
 	unload_symtabs(&sess->symtabs);
 	delete_session_map(&sess->symtabs);
+	free(sess->sym_cache);
 	free(sess);
 }
 
@@ -377,26 +451,57 @@ static void add_session_ref(struct uftrace_task *task, struct uftrace_session *s
 	task->sref_last = sref;
 }
 
-/**
- * find_task_session - find a matching session using @pid and @timestamp
- * @sessions: session link to manage sessions and tasks
- * @pid - task pid to search
- * @timestamp - timestamp of task
- *
- * This function searches the sessions tree using @pid and @timestamp.
- * The most recent session that has a smaller than the @timestamp will
- * be returned.  If it didn't find a session tries to search sesssion
- * list of parent or thread-leader.
+/* returns start time of the first session of @pid (or -1ULL) */
+static uint64_t first_session_time(struct uftrace_session_link *sessions,
+				   int pid)
+{
+	struct uftrace_session *iter;
+	struct rb_node *p = sessions->root.rb_node;
+	uint64_t time = -1ULL;
+
+	while (p) {
+		iter = rb_entry(p, struct uftrace_session, node);
+
+		if (iter->pid > pid)
+			p = p->rb_left;
+		else if (iter->pid < pid)
+			p = p->rb_right;
+		else {
+			time = iter->start_time;
+			p = p->rb_left;
+		}
+	}
+
+	return time;
+}
+
+/*
+ * It also returns the time range [@start, @end) which the search
+ * gives the same result.
  */
-struct uftrace_session *find_task_session(struct uftrace_session_link *sessions,
-					  int pid, uint64_t timestamp)
+static struct uftrace_session *
+__find_task_session(struct uftrace_session_link *sessions, int pid,
+		    uint64_t timestamp, uint64_t *start, uint64_t *end)
 {
 	struct uftrace_task *t;
 	struct uftrace_sess_ref *r;
 	struct uftrace_session *s = find_session(sessions, pid, timestamp);
 
-	if (s)
+	if (s) {
+		struct rb_node *next = rb_next(&s->node);
+
+		*start = s->start_time;
+		*end = -1ULL;
+
+		if (next) {
+			struct uftrace_session *n;
+
+			n = rb_entry(next, struct uftrace_session, node);
+			if (n->pid == pid)
+				*end = n->start_time;
+		}
 		return s;
+	}
 
 	/* if it cannot find its own session, inherit from parent or leader */
 	t = find_task(sessions, pid);
@@ -405,14 +510,73 @@ struct uftrace_session *find_task_session(struct uftrace_session_link *sessions,
 
 	r = &t->sref;
 	while (r) {
-		if (r->start <= timestamp && timestamp < r->end)
+		if (r->start <= timestamp && timestamp < r->end) {
+			*start = r->start;
+			*end = r->end;
+
+			/* its own session (if any) will take precedence */
+			if (*end > first_session_time(sessions, pid))
+				*end = first_session_time(sessions, pid);
 			return r->sess;
+		}
 		r = r->next;
 	}
 
 	return NULL;
 }
 
+/**
+ * find_task_session - find a matching session using @pid and @timestamp
+ * @sessions: session link to manage sessions and tasks
+ * @pid - task pid to search
+ * @timestamp - timestamp of task
+ *
+ * This function searches the sessions tree using @pid and @timestamp.
+ * The most recent session that has a smaller than the @timestamp will
+ * be returned.  If it didn't find a session tries to search sesssion
+ * list of parent or thread-leader.
+ */
+struct uftrace_session *find_task_session(struct uftrace_session_link *sessions,
+					  int pid, uint64_t timestamp)
+{
+	uint64_t start, end;
+
+	return __find_task_session(sessions, pid, timestamp, &start, &end);
+}
+
+/**
+ * task_find_session - find a matching session of @task at @timestamp
+ * @sessions: session link to manage sessions and tasks
+ * @task: handle for functions in a task
+ * @timestamp: timestamp of task
+ *
+ * This function is same as calling find_task_session() with the tid
+ * and then pid of @task, but it remembers the last session and its
+ * valid time range in @task so that consecutive records of the task
+ * don't need to search the session tree again.
+ */
+struct uftrace_session *task_find_session(struct uftrace_session_link *sessions,
+					  struct ftrace_task_handle *task,
+					  uint64_t timestamp)
+{
+	struct uftrace_session *s;
+	uint64_t start, end;
+
+	if (task->sess_last && task->sess_start <= timestamp &&
+	    timestamp < task->sess_end)
+		return task->sess_last;
+
+	s = __find_task_session(sessions, task->tid, timestamp, &start, &end);
+	if (s) {
+		task->sess_last = s;
+		task->sess_start = start;
+		task->sess_end = end;
+		return s;
+	}
+
+	return find_task_session(sessions, task->t->pid, timestamp);
+}
+
 /**
  * create_task - create a new task from task message
  * @sessions: session link to manage sessions and tasks
@@ -569,13 +733,8 @@ struct sym * task_find_sym(struct uftrace_session_link *sessions,
 			   struct uftrace_record *rec)
 {
 	struct uftrace_session *sess;
-	struct symtabs *symtabs;
-	struct sym *sym = NULL;
 
-	sess = find_task_session(sessions, task->tid, rec->time);
-
-	if (sess == NULL)
-		sess = find_task_session(sessions, task->t->pid, rec->time);
+	sess = task_find_session(sessions, task, rec->time);
 
 	if (sess == NULL && is_kernel_record(task, rec))
 		sess = sessions->first;
@@ -583,13 +742,7 @@ struct sym * task_find_sym(struct uftrace_session_link *sessions,
 	if (sess == NULL)
 		return NULL;
 
-	symtabs = &sess->symtabs;
-	sym = find_symtabs(symtabs, rec->addr);
-
-	if (sym == NULL)
-		sym = session_find_dlsym(sess, rec->time, rec->addr);
-
-	return sym;
+	return session_find_sym(sess, rec->time, rec->addr);
 }
 
 /**
@@ -606,12 +759,8 @@ struct sym * task_find_sym_addr(struct uftrace_session_link *sessions,
 				uint64_t time, uint64_t addr)
 {
 	struct uftrace_session *sess;
-	struct sym *sym = NULL;
-
-	sess = find_task_session(sessions, task->tid, time);
 
-	if (sess == NULL)
-		sess = find_task_session(sessions, task->t->pid, time);
+	sess = task_find_session(sessions, task, time);
 
 	if (sess == NULL) {
 		struct uftrace_session *fsess = sessions->first;
@@ -622,11 +771,7 @@ struct sym * task_find_sym_addr(struct uftrace_session_link *sessions,
 			return NULL;
 	}
 
-	sym = find_symtabs(&sess->symtabs, addr);
-	if (sym == NULL)
-		sym = session_find_dlsym(sess, time, addr);
-
-	return sym;
+	return session_find_sym(sess, time, addr);
 }
 
 #ifdef UNIT_TEST
@@ -899,6 +1044,27 @@ TEST_CASE(task_search)
 	sess = find_task_session(&test_sessions, 6, 100);
 	TEST_EQ(sess, NULL);
 
+	/* cached session should not be used after exec */
+	{
+		struct ftrace_task_handle th = {
+			.tid = 4,
+			.t = find_task(&test_sessions, 4),
+		};
+
+		sess = task_find_session(&test_sessions, &th, 400);
+		TEST_NE(sess, NULL);
+		TEST_STREQ(sess->sid, "initial");
+		TEST_EQ(th.sess_end, 500);
+
+		sess = task_find_session(&test_sessions, &th, 450);
+		TEST_EQ(sess, th.sess_last);
+		TEST_STREQ(sess->sid, "initial");
+
+		sess = task_find_session(&test_sessions, &th, 500);
+		TEST_NE(sess, NULL);
+		TEST_STREQ(sess->sid, "after_exec");
+	}
+
 	delete_sessions(&test_sessions);
 	TEST_EQ(RB_EMPTY_ROOT(&test_sessions.root), true);
 	TEST_EQ(RB_EMPTY_ROOT(&test_sessions.tasks), true);
@@ -949,6 +1115,10 @@ TEST_CASE(task_symbol)
 	TEST_NE(sym, NULL);
 	TEST_STREQ(sym->name, "main");
 
+	/* it should get the same result from the cache */
+	TEST_EQ(task_find_sym_addr(&test_sessions, &task, 200, 0x400410), sym);
+	TEST_EQ(task_find_sym_addr(&test_sessions, &task, 200, 0x401000), NULL);
+
 	delete_sessions(&test_sessions);
 	TEST_EQ(RB_EMPTY_ROOT(&test_sessions.root), true);
 
@@ -15,6 +15,7 @@
 #include <unistd.h>
 #include <assert.h>
 #include <inttypes.h>
+#include <pthread.h>
 
 /* This should be defined before #include "utils.h" */
 #define PR_FMT     "symbol"
@@ -72,6 +73,71 @@ static int namefind(const void *a, const void *b)
 	return strcmp(name, sym->name);
 }
 
+/**
+ * symtab_add_name - copy a symbol name into the symbol table
+ * @symtab: symbol table
+ * @name: symbol name (from ELF or symbol file)
+ *
+ * This function returns a copy of @name which is allocated in the
+ * string arena of @symtab.  The names are released at once when the
+ * @symtab is unloaded.  Note that C++ symbols keep the mangled names
+ * and they are demangled when displayed - see symbol_getname().
+ */
+char * symtab_add_name(struct symtab *symtab, char *name)
+{
+	return arena_strdup(&symtab->names, name);
+}
+
+/* build a dense array of symbol addresses (sym[] should be sorted) */
+static void build_addr_index(struct symtab *symtab)
+{
+	size_t i;
+
+	free(symtab->addrs);
+	symtab->addrs = NULL;
+
+	if (symtab->nr_sym == 0)
+		return;
+
+	symtab->addrs = xmalloc(symtab->nr_sym * sizeof(*symtab->addrs));
+	for (i = 0; i < symtab->nr_sym; i++)
+		symtab->addrs[i] = symtab->sym[i].addr;
+}
+
+/* find the symbol contains @addr in the (address-sorted) @symtab */
+static struct sym * search_symtab(struct symtab *symtab, uint64_t addr)
+{
+	const uint64_t *base = symtab->addrs;
+	size_t n = symtab->nr_sym;
+	struct sym *sym;
+
+	if (base == NULL) {
+		return bsearch(&addr, symtab->sym, symtab->nr_sym,
+			       sizeof(*symtab->sym), addrfind);
+	}
+
+	if (n == 0 || addr < base[0])
+		return NULL;
+
+	/*
+	 * find the last symbol whose address is not greater than @addr.
+	 * the loop doesn't have a (unpredictable) branch on the result
+	 * of comparison and only touches the dense address array.
+	 */
+	while (n > 1) {
+		size_t half = n / 2;
+
+		base = (base[half] <= addr) ? base + half : base;
+		n -= half;
+	}
+
+	sym = &symtab->sym[base - symtab->addrs];
+	if (addr < sym->addr + sym->size)
+		return sym;
+
+	return NULL;
+}
+
 bool check_libpthread(const char *filename)
 {
 	int fd;
@@ -193,37 +259,49 @@ elf_error:
 
 static void __unload_symtab(struct symtab *symtab)
 {
-	size_t i;
-
-	for (i = 0; i < symtab->nr_sym; i++) {
-		struct sym *sym = symtab->sym + i;
-		free(sym->name);
-	}
+	/* all symbol names are in the arena */
+	arena_free(&symtab->names);
 
 	free(symtab->sym_names);
 	free(symtab->sym);
+	free(symtab->addrs);
 
 	symtab->nr_sym = 0;
+	symtab->nr_alloc = 0;
 	symtab->sym = NULL;
 	symtab->sym_names = NULL;
+	symtab->addrs = NULL;
 }
 
 void unload_symtabs(struct symtabs *symtabs)
 {
+	struct uftrace_mmap *map;
+
 	pr_dbg2("unload symbol tables\n");
 	__unload_symtab(&symtabs->symtab);
 	__unload_symtab(&symtabs->dsymtab);
 
+	/* symbols of shared libraries (if loaded) */
+	for (map = symtabs->maps; map; map = map->next) {
+		if (map == MAP_MAIN || map == MAP_KERNEL)
+			continue;
+		__unload_symtab(&map->symtab);
+	}
+
 	symtabs->loaded = false;
 }
 
+static bool is_internal_name(const char *name)
+{
+	return name[0] == '_' && !is_mangled_name(name);
+}
+
 static int load_symtab(struct symtab *symtab, const char *filename,
 		       unsigned long offset, unsigned long flags)
 {
 	int fd;
 	Elf *elf;
 	int ret = -1;
-	unsigned grow = SYMTAB_GROW;
 	size_t i, nr_sym = 0, nr_dynsym = 0;
 	Elf_Scn *sym_sec, *dynsym_sec, *sec;
 	Elf_Data *sym_data;
@@ -308,6 +386,10 @@ static int load_symtab(struct symtab *symtab, const char *filename,
 	if (sym_data == NULL)
 		goto elf_error;
 
+	/* presize the table using the number of ELF symbols */
+	symtab->nr_alloc = symtab->nr_sym + nr_sym;
+	symtab->sym = xrealloc(symtab->sym, symtab->nr_alloc * sizeof(*symtab->sym));
+
 	pr_dbg2("loading symbols from %s (offset: %#lx)\n", filename, offset);
 	for (i = 0; i < nr_sym; i++) {
 		GElf_Sym elf_sym;
@@ -332,14 +414,6 @@ static int load_symtab(struct symtab *symtab, const char *filename,
 			continue;
 		prev_sym_value = elf_sym.st_value;
 
-		if (symtab->nr_sym >= symtab->nr_alloc) {
-			if (symtab->nr_alloc >= grow * 4)
-				grow *= 2;
-			symtab->nr_alloc += grow;
-			symtab->sym = xrealloc(symtab->sym,
-					       symtab->nr_alloc * sizeof(*sym));
-		}
-
 		sym = &symtab->sym[symtab->nr_sym++];
 
 		sym->addr = elf_sym.st_value + offset;
@@ -361,11 +435,8 @@ static int load_symtab(struct symtab *symtab, const char *filename,
 		}
 
 		name = elf_strptr(elf, symstr_idx, elf_sym.st_name);
-
-		if (flags & SYMTAB_FL_DEMANGLE)
-			sym->name = demangle(name);
-		else
-			sym->name = xstrdup(name);
+		sym->name = symtab_add_name(symtab, name);
+		sym->demangled = NULL;
 
 		pr_dbg3("[%zd] %c %"PRIx64" + %-5u %s\n", symtab->nr_sym,
 			sym->type, sym->addr, sym->size, sym->name);
@@ -387,8 +458,9 @@ static int load_symtab(struct symtab *symtab, const char *filename,
 		while (curr->addr == next->addr &&
 		       next < &symtab->sym[symtab->nr_sym]) {
 
-			/* prefer names not started by '_' */
-			if (bestname[0] == '_' && next->name[0] != '_')
+			/* prefer names not started by '_' (except C++ names) */
+			if (is_internal_name(bestname) &&
+			    !is_internal_name(next->name))
 				bestname = next->name;
 
 			count++;
@@ -396,19 +468,10 @@ static int load_symtab(struct symtab *symtab, const char *filename,
 		}
 
 		if (count) {
-			struct sym *tmp = curr;
-
-			bestname = xstrdup(bestname);
-
-			while (tmp < next - 1) {
-				free(tmp->name);
-				tmp++;
-			}
-
 			memmove(curr, next - 1,
 				(symtab->nr_sym - i - count) * sizeof(*next));
 
-			free(curr->name);
+			/* the name is still in the arena */
 			curr->name = bestname;
 
 			symtab->nr_sym -= count;
@@ -421,6 +484,7 @@ static int load_symtab(struct symtab *symtab, const char *filename,
 
 	symtab->nr_alloc = symtab->nr_sym;
 	symtab->sym = xrealloc(symtab->sym, symtab->nr_sym * sizeof(*symtab->sym));
+	build_addr_index(symtab);
 
 	symtab->sym_names = xmalloc(sizeof(*symtab->sym_names) * symtab->nr_sym);
 
@@ -456,6 +520,7 @@ static void sort_dynsymtab(struct symtab *dsymtab)
 
 	/* sort ->sym by address now */
 	qsort(dsymtab->sym, dsymtab->nr_sym, sizeof(*dsymtab->sym), addrsort);
+	build_addr_index(dsymtab);
 
 	/* find position of sorted symbol */
 	for (i = 0; i < dsymtab->nr_sym; i++) {
@@ -521,7 +586,6 @@ int load_elf_dynsymtab(struct symtab *dsymtab, Elf *elf,
 {
 	int ret = -1;
 	int idx, nr_rels = 0, nr_dyns = 0;
-	unsigned grow = SYMTAB_GROW;
 	Elf_Scn *dynsym_sec, *relplt_sec, *dynamic_sec, *sec;
 	Elf_Data *dynsym_data, *relplt_data;
 	size_t shstr_idx, dynstr_idx = 0;
@@ -621,6 +685,11 @@ int load_elf_dynsymtab(struct symtab *dsymtab, Elf *elf,
 
 	prev_addr = plt_addr;
 
+	/* presize the table using the number of PLT relocations */
+	dsymtab->nr_alloc = dsymtab->nr_sym + nr_rels;
+	dsymtab->sym = xrealloc(dsymtab->sym,
+				dsymtab->nr_alloc * sizeof(*dsymtab->sym));
+
 	for (idx = 0; idx < nr_rels; idx++) {
 		GElf_Sym esym;
 		struct sym *sym;
@@ -649,14 +718,6 @@ int load_elf_dynsymtab(struct symtab *dsymtab, Elf *elf,
 		if (*name == '\0')
 			continue;
 
-		if (dsymtab->nr_sym >= dsymtab->nr_alloc) {
-			if (dsymtab->nr_alloc >= grow * 4)
-				grow *= 2;
-			dsymtab->nr_alloc += grow;
-			dsymtab->sym = xrealloc(dsymtab->sym,
-						dsymtab->nr_alloc * sizeof(*sym));
-		}
-
 		sym = &dsymtab->sym[dsymtab->nr_sym++];
 
 		if (ehdr.e_machine == EM_ARM && esym.st_value)
@@ -667,11 +728,8 @@ int load_elf_dynsymtab(struct symtab *dsymtab, Elf *elf,
 		sym->type = ST_PLT;
 
 		prev_addr = sym->addr;
-
-		if (flags & SYMTAB_FL_DEMANGLE)
-			sym->name = demangle(name);
-		else
-			sym->name = xstrdup(name);
+		sym->name = symtab_add_name(dsymtab, name);
+		sym->demangled = NULL;
 
 		pr_dbg3("[%zd] %c %"PRIx64" + %-5u %s\n", dsymtab->nr_sym,
 			sym->type, sym->addr, sym->size, sym->name);
@@ -735,9 +793,9 @@ static void merge_symtabs(struct symtab *left, struct symtab *right)
 		return;
 
 	if (left->nr_sym == 0) {
+		__unload_symtab(left);
 		*left = *right;
-		right->nr_sym = 0;
-		right->sym = NULL;
+		memset(right, 0, sizeof(*right));
 		return;
 	}
 
@@ -765,11 +823,19 @@ static void merge_symtabs(struct symtab *left, struct symtab *right)
 	left->sym_names = NULL;
 	right->sym_names = NULL;
 
+	/* move the symbol names too */
+	arena_merge(&left->names, &right->names);
+	right->nr_sym = right->nr_alloc = 0;
+
 	left->nr_sym = left->nr_alloc = nr_sym;
 	left->sym = syms;
 	left->sym_names = xmalloc(nr_sym * sizeof(*left->sym_names));
 
 	qsort(left->sym, left->nr_sym, sizeof(*left->sym), addrsort);
+	build_addr_index(left);
+
+	free(right->addrs);
+	right->addrs = NULL;
 
 	for (i = 0; i < left->nr_sym; i++)
 		left->sym_names[i] = &left->sym[i];
@@ -856,8 +922,7 @@ static int update_symtab_using_dynsym(struct symtab *symtab, const char *filenam
 			continue;
 
 		addr = esym.st_value + offset;
-		sym = bsearch(&addr, symtab->sym, symtab->nr_sym,
-			      sizeof(*sym), addrfind);
+		sym = search_symtab(symtab, addr);
 		if (sym == NULL)
 			continue;
 
@@ -865,13 +930,10 @@ static int update_symtab_using_dynsym(struct symtab *symtab, const char *filenam
 			continue;
 
 		pr_dbg3("update symbol name to %s\n", name);
-		free(sym->name);
 		count++;
 
-		if (flags & SYMTAB_FL_DEMANGLE)
-			sym->name = demangle(name);
-		else
-			sym->name = xstrdup(name);
+		sym->name = symtab_add_name(symtab, name);
+		sym->demangled = NULL;
 	}
 	ret = 0;
 
@@ -1246,7 +1308,8 @@ int load_symbol_file(struct symtabs *symtabs, const char *symfile,
 
 		sym->addr = addr + offset;
 		sym->type = type;
-		sym->name = demangle(name);
+		sym->name = symtab_add_name(stab, name);
+		sym->demangled = NULL;
 		sym->size = 0;
 
 		pr_dbg3("[%zd] %c %"PRIx64" + %-5u %s\n", stab->nr_sym,
@@ -1261,6 +1324,7 @@ int load_symbol_file(struct symtabs *symtabs, const char *symfile,
 
 	stab = &symtabs->symtab;
 	qsort(stab->sym, stab->nr_sym, sizeof(*stab->sym), addrsort);
+	build_addr_index(stab);
 
 	stab->sym_names = xmalloc(sizeof(*stab->sym_names) * stab->nr_sym);
 
@@ -1451,7 +1515,8 @@ static int load_module_symbol(struct symtab *symtab, const char *symfile,
 
 		sym->addr = addr + offset;
 		sym->type = type;
-		sym->name = demangle(name);
+		sym->name = symtab_add_name(symtab, name);
+		sym->demangled = NULL;
 		sym->size = 0;
 
 		pr_dbg3("[%zd] %c %lx + %-5u %s\n", symtab->nr_sym,
@@ -1463,6 +1528,7 @@ static int load_module_symbol(struct symtab *symtab, const char *symfile,
 	free(line);
 
 	qsort(symtab->sym, symtab->nr_sym, sizeof(*symtab->sym), addrsort);
+	build_addr_index(symtab);
 
 	symtab->sym_names = xmalloc(sizeof(*symtab->sym_names) * symtab->nr_sym);
 
@@ -1671,6 +1737,23 @@ struct uftrace_mmap * find_map(struct symtabs *symtabs, uint64_t addr)
 			return MAP_MAIN;
 	}
 
+	if (symtabs->map_index) {
+		size_t lo = 0, hi = symtabs->nr_map;
+
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+
+			maps = symtabs->map_index[mid];
+			if (addr < maps->start)
+				hi = mid;
+			else if (addr >= maps->end)
+				lo = mid + 1;
+			else
+				return maps;
+		}
+		return NULL;
+	}
+
 	maps = symtabs->maps;
 	while (maps) {
 		if (maps->start <= addr && addr < maps->end)
@@ -1681,6 +1764,56 @@ struct uftrace_mmap * find_map(struct symtabs *symtabs, uint64_t addr)
 	return NULL;
 }
 
+static int mapcmp(const void *a, const void *b)
+{
+	const struct uftrace_mmap *ma = *(const struct uftrace_mmap **)a;
+	const struct uftrace_mmap *mb = *(const struct uftrace_mmap **)b;
+
+	if (ma->start > mb->start)
+		return 1;
+	if (ma->start < mb->start)
+		return -1;
+	return 0;
+}
+
+/**
+ * build_map_index - build sorted array of memory mappings
+ * @symtabs: symbol table which has the maps
+ *
+ * This function builds an array of maps sorted by start address so
+ * that find_map() can use binary search instead of walking the list.
+ * It should be called after all maps are added to @symtabs.
+ */
+void build_map_index(struct symtabs *symtabs)
+{
+	struct uftrace_mmap *map;
+	size_t i = 0;
+
+	free_map_index(symtabs);
+
+	for (map = symtabs->maps; map; map = map->next)
+		symtabs->nr_map++;
+
+	if (symtabs->nr_map == 0)
+		return;
+
+	symtabs->map_index = xcalloc(symtabs->nr_map,
+				     sizeof(*symtabs->map_index));
+
+	for (map = symtabs->maps; map; map = map->next)
+		symtabs->map_index[i++] = map;
+
+	qsort(symtabs->map_index, symtabs->nr_map,
+	      sizeof(*symtabs->map_index), mapcmp);
+}
+
+void free_map_index(struct symtabs *symtabs)
+{
+	free(symtabs->map_index);
+	symtabs->map_index = NULL;
+	symtabs->nr_map = 0;
+}
+
 struct uftrace_mmap * find_symbol_map(struct symtabs *symtabs, char *name)
 {
 	struct uftrace_mmap *maps;
@@ -1700,6 +1833,57 @@ struct uftrace_mmap * find_symbol_map(struct symtabs *symtabs, char *name)
 	return NULL;
 }
 
+/*
+ * symbol tables of libraries are loaded on the first lookup.  It can be
+ * called from multiple threads (i.e. replay --num-thread) so load it
+ * under the lock and publish the number of symbols at last.
+ */
+static void load_map_symtab(struct symtabs *symtabs, struct uftrace_mmap *map)
+{
+	static pthread_mutex_t load_lock = PTHREAD_MUTEX_INITIALIZER;
+	struct symtab stab = {};
+	bool found = false;
+	size_t nr_sym;
+
+	pthread_mutex_lock(&load_lock);
+
+	/* someone might load it already */
+	if (map->symtab.nr_sym)
+		goto out;
+
+	if (symtabs->flags & SYMTAB_FL_USE_SYMFILE) {
+		char *symfile = NULL;
+		unsigned long offset = 0;
+
+		if (symtabs->flags & SYMTAB_FL_ADJ_OFFSET)
+			offset = map->start;
+
+		xasprintf(&symfile, "%s/%s.sym", symtabs->dirname,
+			  basename(map->libname));
+		if (!load_module_symbol(&stab, symfile, offset))
+			found = true;
+		free(symfile);
+	}
+
+	if (!found) {
+		load_symtab(&stab, map->libname, map->start,
+			    symtabs->flags);
+	}
+
+	nr_sym = stab.nr_sym;
+	if (nr_sym == 0) {
+		__unload_symtab(&stab);
+		goto out;
+	}
+
+	stab.nr_sym = 0;
+	map->symtab = stab;
+	__atomic_store_n(&map->symtab.nr_sym, nr_sym, __ATOMIC_RELEASE);
+
+out:
+	pthread_mutex_unlock(&load_lock);
+}
+
 struct sym * find_symtabs(struct symtabs *symtabs, uint64_t addr)
 {
 	struct symtab *stab = &symtabs->symtab;
@@ -1715,58 +1899,58 @@ struct sym * find_symtabs(struct symtabs *symtabs, uint64_t addr)
 		if (!ktab)
 			return NULL;
 
-		sym = bsearch(&kaddr, ktab->sym, ktab->nr_sym,
-			      sizeof(*ktab->sym), addrfind);
-		return sym;
+		return search_symtab(ktab, kaddr);
 	}
 
 	if (maps == MAP_MAIN) {
-		sym = bsearch(&addr, stab->sym, stab->nr_sym,
-			      sizeof(*sym), addrfind);
+		sym = search_symtab(stab, addr);
 		if (sym)
 			return sym;
 
 		/* try dynamic symbols if failed */
-		sym = bsearch(&addr, dtab->sym, dtab->nr_sym,
-			      sizeof(*sym), addrfind);
-		return sym;
+		return search_symtab(dtab, addr);
 	}
 
 	if (maps) {
-		if (maps->symtab.nr_sym == 0) {
-			bool found = false;
-
-			if (symtabs->flags & SYMTAB_FL_USE_SYMFILE) {
-				char *symfile = NULL;
-				unsigned long offset = 0;
-
-				if (symtabs->flags & SYMTAB_FL_ADJ_OFFSET)
-					offset = maps->start;
-
-				xasprintf(&symfile, "%s/%s.sym", symtabs->dirname,
-					  basename(maps->libname));
-				if (!load_module_symbol(&maps->symtab, symfile,
-							offset)) {
-					found = true;
-				}
-				free(symfile);
-			}
+		if (__atomic_load_n(&maps->symtab.nr_sym, __ATOMIC_ACQUIRE) == 0)
+			load_map_symtab(symtabs, maps);
 
-			if (!found) {
-				load_symtab(&maps->symtab, maps->libname,
-					    maps->start, symtabs->flags);
-			}
-		}
+		sym = search_symtab(&maps->symtab, addr);
+	}
+
+	return sym;
+}
+
+/* search the (demangled) @name in mangled symbols */
+static struct sym * find_demangled_name(struct symtab *symtab,
+					const char *name)
+{
+	struct sym *sym;
+	char *hint;
+	size_t i;
+
+	hint = demangle_hint(name);
+
+	for (i = 0; i < symtab->nr_sym; i++) {
+		sym = &symtab->sym[i];
+
+		if (!is_mangled_name(sym->name))
+			continue;
+		if (hint && !strstr(sym->name, hint))
+			continue;
 
-		stab = &maps->symtab;
-		sym = bsearch(&addr, stab->sym, stab->nr_sym,
-			      sizeof(*sym), addrfind);
+		if (!strcmp(name, symbol_getname(sym, sym->addr)))
+			goto out;
 	}
+	sym = NULL;
 
+out:
+	free(hint);
 	return sym;
 }
 
-struct sym * find_symname(struct symtab *symtab, const char *name)
+/* find symbol using the name as is (without demangling) */
+struct sym * find_raw_symname(struct symtab *symtab, const char *name)
 {
 	size_t i;
 
@@ -1791,8 +1975,156 @@ struct sym * find_symname(struct symtab *symtab, const char *name)
 	return NULL;
 }
 
+struct sym * find_symname(struct symtab *symtab, const char *name)
+{
+	struct sym *sym;
+
+	sym = find_raw_symname(symtab, name);
+	if (sym)
+		return sym;
+
+	return find_demangled_name(symtab, name);
+}
+
+struct demangled_name {
+	enum symbol_demangler mode;
+	char name[];
+};
+
+struct demangle_entry {
+	char *mangled;
+	struct demangled_name *demangled;
+};
+
+/*
+ * cache of demangled names shared by all symbol tables (and sessions).
+ * it's protected by the lock since libmcount can use it from different
+ * threads (and the simple demangler is not thread-safe).  The result is
+ * also saved in the symbol so that the lock is taken only on the first
+ * lookup of each symbol.
+ */
+static struct {
+	struct demangle_entry *table;
+	unsigned size;
+	unsigned nr_entries;
+	enum symbol_demangler mode;
+	struct arena names;
+	pthread_mutex_t lock;
+} demangle_cache = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static unsigned long hash_mangled_name(const char *name)
+{
+	unsigned long hash = 2166136261UL;
+
+	while (*name) {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619UL;
+	}
+	return hash;
+}
+
+static void grow_demangle_cache(void)
+{
+	struct demangle_entry *old_table = demangle_cache.table;
+	unsigned old_size = demangle_cache.size;
+	unsigned mask, slot, i;
+
+	demangle_cache.size = old_size ? old_size * 2 : 1024;
+	demangle_cache.table = xcalloc(demangle_cache.size,
+				       sizeof(*demangle_cache.table));
+	mask = demangle_cache.size - 1;
+
+	for (i = 0; i < old_size; i++) {
+		struct demangle_entry *de = &old_table[i];
+
+		if (de->mangled == NULL)
+			continue;
+
+		slot = hash_mangled_name(de->mangled) & mask;
+		while (demangle_cache.table[slot].mangled)
+			slot = (slot + 1) & mask;
+		demangle_cache.table[slot] = *de;
+	}
+	free(old_table);
+}
+
+/*
+ * The names are not freed as they might be still used by others (or
+ * cached in symbols).  The mode is usually set once at startup.
+ */
+static void reset_demangle_cache(void)
+{
+	free(demangle_cache.table);
+
+	demangle_cache.table = NULL;
+	demangle_cache.size = 0;
+	demangle_cache.nr_entries = 0;
+	demangle_cache.mode = demangler;
+}
+
+/* returns demangled name of @name (it should not be freed) */
+static struct demangled_name * get_demangled_name(char *name)
+{
+	struct demangle_entry *de;
+	struct demangled_name *dname;
+	unsigned mask, slot;
+	char *demangled;
+	size_t len;
+
+	pthread_mutex_lock(&demangle_cache.lock);
+
+	if (demangle_cache.mode != demangler)
+		reset_demangle_cache();
+	if (demangle_cache.table == NULL)
+		grow_demangle_cache();
+
+	mask = demangle_cache.size - 1;
+	slot = hash_mangled_name(name) & mask;
+
+	while ((de = &demangle_cache.table[slot])->mangled != NULL) {
+		if (!strcmp(de->mangled, name)) {
+			dname = de->demangled;
+			goto out;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	demangled = demangle(name);
+
+	len = strlen(demangled) + 1;
+	dname = arena_alloc(&demangle_cache.names, sizeof(*dname) + len);
+	dname->mode = demangler;
+	memcpy(dname->name, demangled, len);
+	if (demangled != name)
+		free(demangled);
+
+	de->mangled = arena_strdup(&demangle_cache.names, name);
+	de->demangled = dname;
+
+	/* keep load factor under 50% */
+	if (++demangle_cache.nr_entries * 2 > demangle_cache.size)
+		grow_demangle_cache();
+
+out:
+	pthread_mutex_unlock(&demangle_cache.lock);
+	return dname;
+}
+
+/**
+ * symbol_getname - get a name of a symbol for display
+ * @sym: symbol (can be %NULL)
+ * @addr: address of the symbol
+ *
+ * This function returns the (demangled) name of @sym.  If @sym is
+ * %NULL, it returns the @addr in a string.  C++ symbols are demangled
+ * on the first use and the result is saved in the demangle cache and
+ * the symbol.
+ */
 char *symbol_getname(struct sym *sym, uint64_t addr)
 {
+	struct demangled_name *dname;
 	char *name;
 
 	if (sym == NULL) {
@@ -1800,7 +2132,17 @@ char *symbol_getname(struct sym *sym, uint64_t addr)
 		return name;
 	}
 
-	return sym->name;
+	if (!is_mangled_name(sym->name))
+		return sym->name;
+
+	/* other threads might set it at the same time but it's fine */
+	dname = __atomic_load_n(&sym->demangled, __ATOMIC_ACQUIRE);
+	if (dname == NULL || dname->mode != demangler) {
+		dname = get_demangled_name(sym->name);
+		__atomic_store_n(&sym->demangled, dname, __ATOMIC_RELEASE);
+	}
+
+	return dname->name;
 }
 
 /* must be used in pair with symbol_getname() */
@@ -1882,3 +2224,41 @@ void set_kernel_base(struct symtabs *symtabs, const char *session_id)
 
 	symtabs->kernel_base = kernel_base_addr;
 }
+
+#ifdef UNIT_TEST
+
+TEST_CASE(symbol_demangle_cache)
+{
+	struct sym sym = {
+		.addr = 0x1000,
+		.size = 16,
+		.type = ST_GLOBAL,
+		.name = "_ZN2ns3fooEv",
+	};
+	struct sym sym2 = sym;
+	enum symbol_demangler old = demangler;
+	char *name, *name2;
+
+	demangler = DEMANGLE_SIMPLE;
+
+	name = symbol_getname(&sym, sym.addr);
+	TEST_STREQ(name, "ns::foo");
+	TEST_NE(sym.demangled, NULL);
+
+	/* it should return the cached name for the same symbol */
+	TEST_EQ(symbol_getname(&sym, sym.addr), name);
+
+	/* and for the same mangled name in another symbol */
+	TEST_EQ(symbol_getname(&sym2, sym2.addr), name);
+
+	/* changing the mode should not free the old names */
+	demangler = DEMANGLE_NONE;
+	name2 = symbol_getname(&sym, sym.addr);
+	TEST_STREQ(name2, "_ZN2ns3fooEv");
+	TEST_STREQ(name, "ns::foo");
+
+	demangler = old;
+	return TEST_OK;
+}
+
+#endif /* UNIT_TEST */
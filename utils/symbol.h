@@ -29,11 +29,15 @@ enum symtype {
 	ST_KERNEL	= 'K',
 };
 
+struct demangled_name;
+
 struct sym {
 	uint64_t addr;
 	unsigned size;
 	enum symtype type;
 	char *name;
+	/* set by symbol_getname() for C++ symbols */
+	struct demangled_name *demangled;
 };
 
 #define SYMTAB_GROW  16
@@ -44,6 +48,10 @@ struct symtab {
 	size_t nr_sym;
 	size_t nr_alloc;
 	bool name_sorted;
+	/* sorted symbol addresses for lookup (optional) */
+	uint64_t *addrs;
+	/* storage for symbol names */
+	struct arena names;
 };
 
 struct uftrace_mmap {
@@ -57,7 +65,6 @@ struct uftrace_mmap {
 };
 
 enum symtab_flag {
-	SYMTAB_FL_DEMANGLE	= (1U << 0),
 	SYMTAB_FL_USE_SYMFILE	= (1U << 1),
 	SYMTAB_FL_ADJ_OFFSET	= (1U << 2),
 	SYMTAB_FL_SKIP_NORMAL	= (1U << 3),
@@ -73,6 +80,9 @@ struct symtabs {
 	struct symtab dsymtab;
 	uint64_t kernel_base;
 	struct uftrace_mmap *maps;
+	/* maps sorted by address for binary search (optional) */
+	struct uftrace_mmap **map_index;
+	size_t nr_map;
 };
 
 /* only meaningful for 64-bit systems */
@@ -94,6 +104,8 @@ void set_kernel_base(struct symtabs *symtabs, const char *session_id);
 
 struct sym * find_symtabs(struct symtabs *symtabs, uint64_t addr);
 struct sym * find_symname(struct symtab *symtab, const char *name);
+struct sym * find_raw_symname(struct symtab *symtab, const char *name);
+char * symtab_add_name(struct symtab *symtab, char *name);
 void load_symtabs(struct symtabs *symtabs, const char *dirname,
 		  const char *filename);
 void unload_symtabs(struct symtabs *symtabs);
@@ -124,6 +136,8 @@ size_t count_dynsym(struct symtabs *symtabs);
 #define MAP_KERNEL (struct uftrace_mmap *)2
 
 struct uftrace_mmap * find_map(struct symtabs *symtabs, uint64_t addr);
+void build_map_index(struct symtabs *symtabs);
+void free_map_index(struct symtabs *symtabs);
 struct uftrace_mmap * find_map_by_name(struct symtabs *symtabs,
 				       const char *prefix);
 struct uftrace_mmap * find_symbol_map(struct symtabs *symtabs, char *name);
@@ -165,6 +179,13 @@ enum symbol_demangler {
 extern enum symbol_demangler demangler;
 
 char *demangle(char *str);
+char *demangle_hint(const char *str);
+
+/* only C++ symbols (in Itanium C++ ABI) are demangled */
+static inline bool is_mangled_name(const char *name)
+{
+	return name[0] == '_' && name[1] == 'Z';
+}
 
 #ifdef HAVE_CXA_DEMANGLE
 /* copied from /usr/include/c++/4.7.2/cxxabi.h */
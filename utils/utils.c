@@ -456,6 +456,36 @@ void strv_split(struct strv *strv, const char *str, const char *delim)
 	free(saved_str);
 }
 
+/**
+ * strv_split_quoted - split given string except in quotes
+ * @strv:  string vector
+ * @str:   input string
+ * @delim: delimiter character to split the string
+ *
+ * This function is same as strv_split() but @delim inside of double
+ * quotes is not considered so that strings like if:arg1=="a,b" in
+ * trigger actions are kept intact.
+ */
+void strv_split_quoted(struct strv *strv, const char *str, char delim)
+{
+	char *buf = xstrdup(str);
+	char *pos, *start = buf;
+	bool quote = false;
+
+	for (pos = buf; *pos; pos++) {
+		if (*pos == '"')
+			quote = !quote;
+		else if (*pos == delim && !quote) {
+			*pos = '\0';
+			strv_append(strv, start);
+			start = pos + 1;
+		}
+	}
+	strv_append(strv, start);
+
+	free(buf);
+}
+
 /**
  * strv_copy - copy argc and argv to string vector
  * @strv: string vector
@@ -531,6 +561,114 @@ void strv_free(struct strv *strv)
 	strv->nr = 0;
 }
 
+struct arena_chunk {
+	struct arena_chunk *next;
+	size_t size;
+	size_t used;
+	char data[];
+};
+
+/**
+ * arena_alloc - allocate memory from an arena
+ * @arena: memory arena
+ * @size: size of memory
+ *
+ * This function returns @size bytes of (uninitialized) memory in
+ * @arena.  The memory cannot be freed individually but released at
+ * once by arena_free().  Large requests get a separate chunk.
+ */
+void * arena_alloc(struct arena *arena, size_t size)
+{
+	struct arena_chunk *chunk = arena->chunk;
+	void *ptr;
+
+	size = ALIGN(size, sizeof(long));
+
+	if (chunk == NULL || chunk->used + size > chunk->size) {
+		size_t chunk_size = arena->chunk_size ?: ARENA_CHUNK_SIZE;
+
+		if (chunk_size < size)
+			chunk_size = size;
+
+		chunk = xmalloc(sizeof(*chunk) + chunk_size);
+		chunk->size = chunk_size;
+		chunk->used = 0;
+		chunk->next = arena->chunk;
+		arena->chunk = chunk;
+	}
+
+	ptr = chunk->data + chunk->used;
+	chunk->used += size;
+
+	return ptr;
+}
+
+/**
+ * arena_strdup - copy a string into an arena
+ * @arena: memory arena
+ * @str: string to copy
+ *
+ * This function is same as strdup() but allocates the memory in @arena.
+ */
+char * arena_strdup(struct arena *arena, const char *str)
+{
+	size_t len = strlen(str) + 1;
+
+	return memcpy(arena_alloc(arena, len), str, len);
+}
+
+/**
+ * arena_free - release all memory in an arena
+ * @arena: memory arena
+ *
+ * This function releases all memory allocated from @arena.  The
+ * @arena can be used again after this.
+ */
+void arena_free(struct arena *arena)
+{
+	struct arena_chunk *chunk, *next;
+
+	chunk = arena->chunk;
+	while (chunk) {
+		next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	arena->chunk = NULL;
+}
+
+/**
+ * arena_merge - move all memory in an arena to another
+ * @dst: destination arena
+ * @src: source arena
+ *
+ * This function moves all memory chunks in @src to @dst so that the
+ * memory allocated from @src is now released together with @dst.
+ * The @src becomes empty after this.
+ */
+void arena_merge(struct arena *dst, struct arena *src)
+{
+	struct arena_chunk *tail;
+
+	if (src->chunk == NULL)
+		return;
+
+	if (dst->chunk == NULL) {
+		dst->chunk = src->chunk;
+		src->chunk = NULL;
+		return;
+	}
+
+	tail = src->chunk;
+	while (tail->next)
+		tail = tail->next;
+
+	/* keep the current chunk of @dst for later allocation */
+	tail->next = dst->chunk->next;
+	dst->chunk->next = src->chunk;
+	src->chunk = NULL;
+}
+
 #define QUOTE '\''
 #define DQUOTE '"'
 #define QUOTES "\'\""
@@ -776,4 +914,64 @@ TEST_CASE(utils_strv)
 
 	return TEST_OK;
 }
+
+TEST_CASE(utils_arena)
+{
+	struct arena arena = ARENA_INIT;
+	char *p, *q;
+	int i;
+
+	arena.chunk_size = 64;
+
+	p = arena_alloc(&arena, 10);
+	q = arena_alloc(&arena, 10);
+	TEST_NE(p, NULL);
+	TEST_EQ(q - p, (long)ALIGN(10, sizeof(long)));
+
+	/* new chunk for large allocation */
+	p = arena_alloc(&arena, 1000);
+	memset(p, 0, 1000);
+
+	for (i = 0; i < 100; i++) {
+		p = arena_strdup(&arena, "arena test string");
+		TEST_STREQ(p, "arena test string");
+		TEST_EQ((unsigned long)p % sizeof(long), 0);
+	}
+
+	arena_free(&arena);
+	TEST_EQ(arena.chunk, NULL);
+
+	return TEST_OK;
+}
+
+TEST_CASE(utils_arena_merge)
+{
+	struct arena a = ARENA_INIT;
+	struct arena b = ARENA_INIT;
+	char *p, *q;
+
+	a.chunk_size = b.chunk_size = 64;
+
+	p = arena_strdup(&a, "first arena");
+	q = arena_strdup(&b, "second arena");
+	arena_alloc(&b, 1000);
+
+	arena_merge(&a, &b);
+	TEST_EQ(b.chunk, NULL);
+	TEST_STREQ(p, "first arena");
+	TEST_STREQ(q, "second arena");
+
+	/* it should continue to use the current chunk */
+	q = arena_alloc(&a, 8);
+	TEST_EQ(q - p, (long)ALIGN(sizeof("first arena"), sizeof(long)));
+
+	/* merge into an empty arena */
+	arena_merge(&b, &a);
+	TEST_EQ(a.chunk, NULL);
+
+	arena_free(&b);
+	TEST_EQ(b.chunk, NULL);
+
+	return TEST_OK;
+}
 #endif /* UNIT_TEST */
@@ -87,6 +87,16 @@ extern void __pr_err(const char *fmt, ...) __attribute__((noreturn));
 extern void __pr_err_s(const char *fmt, ...) __attribute__((noreturn));
 extern void __pr_warn(const char *fmt, ...);
 extern void __pr_color(char code, const char *fmt, ...);
+extern void __pr_out_str(const char *str, size_t len);
+extern void pr_out_space(int width);
+extern void pr_out_num(uint64_t num, int width, char pad);
+extern void pr_color_start(char code);
+extern void pr_color_end(void);
+
+extern void setup_output_buffer(FILE *fp);
+extern void flush_output_buffer(void);
+extern char * take_output_buffer(size_t *len);
+extern void finish_output_buffer(void);
 
 extern enum color_setting log_color;
 extern enum color_setting out_color;
@@ -131,6 +141,7 @@ extern void setup_signal(void);
 
 #define pr_out(fmt, ...)	__pr_out(fmt, ## __VA_ARGS__)
 #define pr_cont(fmt, ...)	__pr_out(fmt, ## __VA_ARGS__)
+#define pr_out_str(str)		__pr_out_str(str, strlen(str))
 #define pr_use(fmt, ...)	__pr_out("Usage: " fmt, ## __VA_ARGS__)
 
 #define pr_red(fmt, ...)	__pr_color(COLOR_CODE_RED,     fmt, ## __VA_ARGS__)
@@ -265,17 +276,36 @@ struct strv {
 	for (i = 0; i < (strv)->nr && ((s) = (strv)->p[i]); i++)
 
 void strv_split(struct strv *strv, const char *str, const char *delim);
+void strv_split_quoted(struct strv *strv, const char *str, char delim);
 void strv_copy(struct strv *strv, int argc, char *argv[]);
 void strv_append(struct strv *strv, const char *str);
 char * strv_join(struct strv *strv, const char *delim);
 void strv_free(struct strv *strv);
 
+/* arena - bump allocator which releases all memory at once */
+struct arena_chunk;
+
+struct arena {
+	struct arena_chunk *chunk;  /* current chunk */
+	size_t chunk_size;
+};
+
+#define ARENA_CHUNK_SIZE  (64 * 1024)
+#define ARENA_INIT  (struct arena){ .chunk = NULL, .chunk_size = ARENA_CHUNK_SIZE, }
+
+void * arena_alloc(struct arena *arena, size_t size);
+char * arena_strdup(struct arena *arena, const char *str);
+void arena_free(struct arena *arena);
+void arena_merge(struct arena *dst, struct arena *src);
+
 char **parse_cmdline(char *cmd, int *argc);
 void free_parsed_cmdline(char **argv);
 
 struct ftrace_file_handle;
 
 char *get_event_name(struct ftrace_file_handle *handle, unsigned evt_id);
+char *get_event_args(struct ftrace_file_handle *handle, unsigned evt_id,
+		     void *data, unsigned len);
 
 char *absolute_dirname(const char *path, char *resolved_path);
 